@@ -1,13 +1,14 @@
 import asyncio
 import sys
-from dataclasses import dataclass
+from collections import deque
+from dataclasses import dataclass, field
 import os
 import socket
 import tempfile
 import time
 import uuid
 import wave
-from typing import Dict, Optional
+from typing import Deque, Dict, List, Optional, Set, Tuple
 
 import discord
 import numpy as np
@@ -55,6 +56,102 @@ GATEWAY_URLS = list(getattr(app_secrets, "LIGHTHOUSE_GATEWAY_URLS", []))
 TTS_MODEL_PATH = resolve_path(getattr(app_secrets, "TTS_MODEL_PATH", None))
 TTS_CONFIG_PATH = resolve_path(getattr(app_secrets, "TTS_CONFIG_PATH", None))
 TTS_USE_CUDA = bool(getattr(app_secrets, "TTS_USE_CUDA", False))
+# Commands go straight to WiFi-registered lighthouses first; the mesh flood is the fallback.
+DIRECT_ACK_TIMEOUT_S = float(getattr(app_secrets, "DIRECT_ACK_TIMEOUT_S", 0.5))
+DIRECT_ATTEMPTS = int(getattr(app_secrets, "DIRECT_ATTEMPTS", 2))
+REGISTRATION_OFFLINE_S = int(getattr(app_secrets, "REGISTRATION_OFFLINE_S", 15))
+# Gateway posts issued within this window go out as one multi-line POST (the gateway queues 16 lines).
+GATEWAY_BATCH_WINDOW_S = float(getattr(app_secrets, "GATEWAY_BATCH_WINDOW_S", 0.05))
+GATEWAY_BATCH_MAX_LINES = 8
+GATEWAY_BUSY_RETRIES = 3
+# Telemetry frames kept per lighthouse (720 = one hour of 5 s heartbeats).
+TELEMETRY_HISTORY = int(getattr(app_secrets, "TELEMETRY_HISTORY", 720))
+TELEMETRY_WINDOW_S = int(getattr(app_secrets, "TELEMETRY_WINDOW_S", 300))
+# Live announcements start this long after the command: mesh delivery plus the lighthouses'
+# prefetch of the clip. The bot host's clock must be NTP-synced like the lighthouses'.
+ANNOUNCE_LEAD_S = float(getattr(app_secrets, "ANNOUNCE_LEAD_S", 8.0))
+
+# Field order of the firmware's "LT" frame (TelemetryEncoder.h); new fields are only appended.
+TELEMETRY_FIELDS = (
+    "uptime_s",
+    "tx_air_ms",
+    "rx_air_ms",
+    "sent_flood",
+    "sent_direct",
+    "recv_flood",
+    "recv_direct",
+    "flood_dups",
+    "direct_dups",
+    "pool_free",
+    "queue_depth",
+    "noise_floor",
+    "heap_free",
+    "heap_largest",
+    "audio_underruns",
+    "loop_max_us",
+    "stream_seq",
+    "stream_stalls",
+    "stream_stall_ms",
+    "stream_bps",
+    "sync_source",
+    "sync_spread_us",
+    "start_skew_us",
+    "scheduled_starts",
+    "flood_suppressed",
+    "text_raw_bytes",
+    "text_packed_bytes",
+    "text_air_saved_ms",
+    "neighbours_heard",
+    "lbt_busy_pct",
+    "channel_util_pct",
+)
+TELEMETRY_SIGNED_FIELDS = ("noise_floor", "start_skew_us")
+SYNC_SOURCES = ("none", "sntp", "beacon")
+TELEMETRY_FLAG_KEY = 0x01
+TELEMETRY_FLAG_HEARTBEAT = 0x02
+
+
+@dataclass
+class TelemetryFrame:
+    number: int
+    mac: str
+    seq: int
+    base_seq: int
+    key: bool
+    heartbeat: bool
+    values: List[int]
+    firmware: Optional[str]
+
+
+def decode_telemetry(data: bytes) -> Optional[TelemetryFrame]:
+    """Parses an "LT" frame; values are zigzag-decoded deltas (absolute on key frames)."""
+    if len(data) < 16 or data[:2] != b"LT" or data[2] != 1:
+        return None
+    flags = data[3]
+    mac = ":".join(f"{b:02X}" for b in data[5:11])
+    seq = int.from_bytes(data[11:13], "little")
+    base_seq = int.from_bytes(data[13:15], "little")
+    count = data[15]
+    values: List[int] = []
+    pos = 16
+    for _ in range(count):
+        value = shift = 0
+        while True:
+            if pos >= len(data):
+                return None
+            byte = data[pos]
+            pos += 1
+            value |= (byte & 0x7F) << shift
+            shift += 7
+            if not byte & 0x80:
+                break
+        values.append((value >> 1) ^ -(value & 1))
+    firmware = None
+    key = bool(flags & TELEMETRY_FLAG_KEY)
+    if key and pos < len(data):
+        length = data[pos]
+        firmware = data[pos + 1 : pos + 1 + length].decode("utf-8", errors="ignore")
+    return TelemetryFrame(data[4], mac, seq, base_seq, key, bool(flags & TELEMETRY_FLAG_HEARTBEAT), values, firmware)
 
 
 @dataclass
@@ -136,17 +233,34 @@ class LighthouseStatus:
     uptime_s: int
     last_seen: float
     online: bool = True
+    port: int = 0
+    heap_free: int = 0
+    heap_largest: int = 0
+    heap_frag_pct: int = 0
+    stream_seq: int = 0
+    stream_stalls: int = 0
+    stream_stall_ms: int = 0
+    stream_bps: int = 0
+    # absolute telemetry by frame seq, for resolving deltas against whichever frame we acked
+    telemetry_frames: Dict[int, List[int]] = field(default_factory=dict)
+    telemetry: Dict[str, int] = field(default_factory=dict)
+    history: Deque[Tuple[float, Dict[str, int]]] = field(default_factory=lambda: deque(maxlen=TELEMETRY_HISTORY))
 
 
 class LighthouseRegistry:
     def __init__(self) -> None:
         self.entries: Dict[str, LighthouseStatus] = {}
         self.transport: Optional[asyncio.DatagramTransport] = None
+        # mac (upper case) -> "number=..|pin=..|name=.." waiting for that unit's next heartbeat
+        self.pending_config: Dict[str, str] = {}
+        # LHCMD id -> lighthouse numbers that acknowledged it
+        self.command_waiters: Dict[str, Set[int]] = {}
 
     def set_transport(self, transport: asyncio.DatagramTransport) -> None:
         self.transport = transport
 
     def update_from_packet(self, packet: str, addr) -> Optional[LighthouseStatus]:
+        """Text LHREG heartbeat from firmware that predates the binary telemetry frame."""
         parts = packet.strip().split("|")
         if len(parts) < 6 or parts[0] != "LHREG":
             return None
@@ -158,7 +272,19 @@ class LighthouseRegistry:
             uptime_s = int(parts[5])
         except ValueError:
             uptime_s = 0
+        # heap and stream stats were appended later; older firmware stops at uptime
+        extra = [0] * 7
+        for idx, value in enumerate(parts[6:13]):
+            try:
+                extra[idx] = int(value)
+            except ValueError:
+                pass
+        heap = extra[0:3]
+        stream = extra[3:7]
         now = time.time()
+        if lighthouse_id == "LH-00":
+            # unprovisioned units all report #0; keep them apart until they're numbered
+            lighthouse_id = f"LH-00@{mac.upper()}"
         status = self.entries.get(lighthouse_id)
         if status is None:
             status = LighthouseStatus(
@@ -169,6 +295,9 @@ class LighthouseRegistry:
                 uptime_s=uptime_s,
                 last_seen=now,
                 online=True,
+                heap_free=heap[0],
+                heap_largest=heap[1],
+                heap_frag_pct=heap[2],
             )
             self.entries[lighthouse_id] = status
         else:
@@ -178,8 +307,148 @@ class LighthouseRegistry:
             status.uptime_s = uptime_s
             status.last_seen = now
             status.online = True
+            status.heap_free = heap[0]
+            status.heap_largest = heap[1]
+            status.heap_frag_pct = heap[2]
+            if stream[0] != status.stream_seq and stream[1] > 0:
+                print(
+                    f"{lighthouse_id}: stream {stream[0]} stalled {stream[1]}x "
+                    f"({stream[2]} ms), net {stream[3]} B/s"
+                )
+        status.port = addr[1]
+        status.stream_seq = stream[0]
+        status.stream_stalls = stream[1]
+        status.stream_stall_ms = stream[2]
+        status.stream_bps = stream[3]
         return status
 
+    def update_from_telemetry(self, data: bytes, addr) -> Tuple[Optional[LighthouseStatus], Optional[int]]:
+        """Returns the status and the frame seq to acknowledge, or None if its base was unknown."""
+        frame = decode_telemetry(data)
+        if frame is None:
+            return None, None
+        lighthouse_id = f"LH-{frame.number:02d}" if frame.number else f"LH-00@{frame.mac}"
+        now = time.time()
+        status = self.entries.get(lighthouse_id)
+        if status is None:
+            status = LighthouseStatus(
+                lighthouse_id=lighthouse_id,
+                ip=addr[0],
+                mac=frame.mac,
+                firmware=frame.firmware or "",
+                uptime_s=0,
+                last_seen=now,
+            )
+            self.entries[lighthouse_id] = status
+        status.ip = addr[0]
+        status.port = addr[1]
+        status.mac = frame.mac
+        status.last_seen = now
+        status.online = True
+        if frame.firmware:
+            status.firmware = frame.firmware
+
+        if frame.key:
+            values = [v & 0xFFFFFFFF for v in frame.values]
+        else:
+            base = status.telemetry_frames.get(frame.base_seq)
+            if base is None or len(base) < len(frame.values):
+                return status, None
+            values = [(b + d) & 0xFFFFFFFF for b, d in zip(base, frame.values)]
+        # oldest by arrival, not by seq: seq restarts on reboot and wraps
+        status.telemetry_frames.pop(frame.seq, None)
+        status.telemetry_frames[frame.seq] = values
+        while len(status.telemetry_frames) > 4:
+            del status.telemetry_frames[next(iter(status.telemetry_frames))]
+
+        named = dict(zip(TELEMETRY_FIELDS, values))
+        for key in TELEMETRY_SIGNED_FIELDS:
+            if key in named and named[key] & 0x80000000:
+                named[key] -= 1 << 32
+        status.telemetry = named
+        status.history.append((now, named))
+
+        status.uptime_s = named.get("uptime_s", 0)
+        status.heap_free = named.get("heap_free", 0)
+        status.heap_largest = named.get("heap_largest", 0)
+        if status.heap_free:
+            status.heap_frag_pct = 100 - status.heap_largest * 100 // status.heap_free
+        stream = [named.get(k, 0) for k in ("stream_seq", "stream_stalls", "stream_stall_ms", "stream_bps")]
+        if status.stream_seq and stream[0] != status.stream_seq and stream[1] > 0:
+            print(f"{lighthouse_id}: stream {stream[0]} stalled {stream[1]}x ({stream[2]} ms), net {stream[3]} B/s")
+        status.stream_seq, status.stream_stalls, status.stream_stall_ms, status.stream_bps = stream
+        return status, frame.seq
+
+    def fleet_rows(self, window_s: int) -> List[Dict[str, float]]:
+        """Per-lighthouse rates over the last 'window_s' seconds of history."""
+        rows: List[Dict[str, float]] = []
+        self.mark_offline(REGISTRATION_OFFLINE_S)
+        for status in sorted(self.entries.values(), key=lambda s: s.lighthouse_id):
+            if not status.history:
+                continue
+            now_t, last = status.history[-1]
+            first_t, first = now_t, last
+            for t, sample in status.history:
+                if now_t - t <= window_s:
+                    first_t, first = t, sample
+                    break
+            span = max(now_t - first_t, 1.0)
+
+            def delta(key: str) -> int:
+                # counters restart with the unit; fall back to the value since boot
+                d = last.get(key, 0) - first.get(key, 0)
+                return d if d >= 0 else last.get(key, 0)
+
+            recv = delta("recv_flood") + delta("recv_direct")
+            dups = delta("flood_dups") + delta("direct_dups")
+            loop_max = max(sample.get("loop_max_us", 0) for t, sample in status.history if now_t - t <= window_s)
+            rows.append(
+                {
+                    "id": status.lighthouse_id,
+                    "online": status.online,
+                    "uptime_h": last.get("uptime_s", 0) / 3600,
+                    "tx_air_pct": delta("tx_air_ms") / (span * 10),
+                    "rx_air_pct": delta("rx_air_ms") / (span * 10),
+                    "sent_pm": (delta("sent_flood") + delta("sent_direct")) * 60 / span,
+                    "recv_pm": recv * 60 / span,
+                    "dup_pct": dups * 100 / (recv + dups) if recv + dups else 0.0,
+                    "pool_free": last.get("pool_free", 0),
+                    "queue": last.get("queue_depth", 0),
+                    "noise": last.get("noise_floor", 0),
+                    "heap_kb": last.get("heap_free", 0) / 1024,
+                    "largest_kb": last.get("heap_largest", 0) / 1024,
+                    "underruns": delta("audio_underruns"),
+                    "loop_ms": loop_max / 1000,
+                    "text_raw": delta("text_raw_bytes"),
+                    "text_packed": delta("text_packed_bytes"),
+                    "air_saved_s": delta("text_air_saved_ms") / 1000,
+                    "neighbours": last.get("neighbours_heard", 0),
+                    "lbt_busy_pct": last.get("lbt_busy_pct", 0),
+                    "channel_util_pct": last.get("channel_util_pct", 0),
+                }
+            )
+        return rows
+
+    def sync_rows(self) -> List[Dict[str, object]]:
+        """Clock source and last scheduled-start skew of each lighthouse."""
+        rows: List[Dict[str, object]] = []
+        self.mark_offline(REGISTRATION_OFFLINE_S)
+        for status in sorted(self.entries.values(), key=lambda s: s.lighthouse_id):
+            if not status.telemetry:
+                continue
+            source = status.telemetry.get("sync_source", 0)
+            rows.append(
+                {
+                    "id": status.lighthouse_id,
+                    "online": status.online,
+                    "source": SYNC_SOURCES[source] if source < len(SYNC_SOURCES) else str(source),
+                    "spread_ms": status.telemetry.get("sync_spread_us", 0) / 1000,
+                    "starts": status.telemetry.get("scheduled_starts", 0),
+                    "skew_ms": status.telemetry.get("start_skew_us", 0) / 1000,
+                }
+            )
+        return rows
+
     def mark_offline(self, offline_after_s: int) -> None:
         now = time.time()
         for status in self.entries.values():
@@ -194,6 +463,79 @@ class LighthouseRegistry:
         self.transport.sendto(payload.encode("utf-8"), (status.ip, port))
         return True
 
+    @staticmethod
+    def lighthouse_number(status: LighthouseStatus) -> Optional[int]:
+        if "@" in status.lighthouse_id:
+            return None
+        try:
+            number = int(status.lighthouse_id[3:])
+        except ValueError:
+            return None
+        return number if number > 0 else None
+
+    def direct_targets(self, target: str) -> Dict[int, LighthouseStatus]:
+        """Online, numbered lighthouses that 'target' ("ALL" or a number) addresses."""
+        self.mark_offline(REGISTRATION_OFFLINE_S)
+        targets: Dict[int, LighthouseStatus] = {}
+        for status in self.entries.values():
+            number = self.lighthouse_number(status)
+            if number is None or not status.online or not status.port:
+                continue
+            if target == "ALL" or target == str(number):
+                targets[number] = status
+        return targets
+
+    async def send_direct(self, payload: str, target: str) -> Set[int]:
+        """Sends a HELP payload over UDP and returns the lighthouse numbers that acknowledged it."""
+        targets = self.direct_targets(target)
+        if not targets or not self.transport:
+            return set()
+        cmd_id = uuid.uuid4().hex[:8]
+        acked: Set[int] = set()
+        self.command_waiters[cmd_id] = acked
+        packet = f"LHCMD|{HELP_TOKEN}|{cmd_id}|{payload}".encode("utf-8")
+        try:
+            for _ in range(max(1, DIRECT_ATTEMPTS)):
+                for number, status in targets.items():
+                    if number not in acked:
+                        self.transport.sendto(packet, (status.ip, status.port))
+                deadline = time.monotonic() + DIRECT_ACK_TIMEOUT_S
+                while len(acked) < len(targets) and time.monotonic() < deadline:
+                    await asyncio.sleep(0.02)
+                if len(acked) >= len(targets):
+                    break
+        finally:
+            self.command_waiters.pop(cmd_id, None)
+        return acked
+
+    def on_command_ack(self, packet: str) -> None:
+        parts = packet.split("|")
+        if len(parts) < 3:
+            return
+        waiter = self.command_waiters.get(parts[1])
+        if waiter is None:
+            return
+        try:
+            waiter.add(int(parts[2]))
+        except ValueError:
+            pass
+
+    def queue_config(self, mac: str, fields: str) -> None:
+        self.pending_config[mac.upper()] = fields
+
+    def take_config(self, status: LighthouseStatus) -> Optional[str]:
+        """Returns the LHCFG packet for this unit, or None once it reports the queued number."""
+        mac = status.mac.upper()
+        fields = self.pending_config.get(mac)
+        if fields is None:
+            return None
+        wanted = fields.split("|", 1)[0]
+        if wanted == f"number={status.lighthouse_id[3:5].lstrip('0')}":
+            print(f"{status.lighthouse_id}: provisioned ({mac})")
+            del self.pending_config[mac]
+            return None
+        return f"LHCFG|{HELP_TOKEN}|{mac}|{fields}"
+
 
 class HelpRequestView(discord.ui.View):
     def __init__(
@@ -264,6 +606,8 @@ class HelpQueueManager:
         self.channel: Optional[discord.TextChannel] = None
         self.lighthouse_channels: Dict[int, discord.TextChannel] = {}
         self.gateway_ip: Optional[str] = None
+        self.gateway_outbox: list[str] = []
+        self.gateway_flush: Optional[asyncio.Future] = None
         self.views: Dict[str, HelpRequestView] = {}
         self.ping_waiters: Dict[str, set[int]] = {}
 
@@ -324,6 +668,20 @@ class HelpQueueManager:
         return channel
 
     async def post_to_gateways(self, text: str) -> None:
+        """Queues one line for the gateway; returns once the batch holding it was posted."""
+        self.gateway_outbox.append(text)
+        if self.gateway_flush is None or self.gateway_flush.done():
+            self.gateway_flush = asyncio.ensure_future(self._flush_gateway_outbox())
+        await asyncio.shield(self.gateway_flush)
+
+    async def _flush_gateway_outbox(self) -> None:
+        while self.gateway_outbox:
+            await asyncio.sleep(GATEWAY_BATCH_WINDOW_S)
+            batch = self.gateway_outbox[:GATEWAY_BATCH_MAX_LINES]
+            del self.gateway_outbox[:GATEWAY_BATCH_MAX_LINES]
+            await self._post_gateway_batch("\n".join(batch))
+
+    async def _post_gateway_batch(self, text: str) -> None:
         urls = list(GATEWAY_URLS)
         if not urls and self.gateway_ip:
             urls.append(f"http://{self.gateway_ip}:{GATEWAY_PORT}/mesh")
@@ -334,9 +692,15 @@ class HelpQueueManager:
         async with ClientSession() as session:
             for url in urls:
                 try:
-                    print(f"Posting to gateway {url}: {text} (token len={len(HELP_TOKEN)})")
-                    resp = await session.post(url, data=text, headers=headers, timeout=5)
-                    print(f"Gateway response {resp.status} for {url}")
+                    print(f"Posting to gateway {url}: {text!r} (token len={len(HELP_TOKEN)})")
+                    for attempt in range(GATEWAY_BUSY_RETRIES + 1):
+                        resp = await session.post(url, data=text, headers=headers, timeout=5)
+                        print(f"Gateway response {resp.status} for {url}")
+                        if resp.status != 429 or attempt == GATEWAY_BUSY_RETRIES:
+                            break
+                        # gateway queue is full; it says how long the mesh needs to drain it
+                        delay = float(resp.headers.get("Retry-After", "1"))
+                        await asyncio.sleep(delay)
                 except Exception:
                     print(f"Gateway post failed for {url}")
                     continue
@@ -593,6 +957,18 @@ http_started = False
 lighthouse_registry = LighthouseRegistry()
 
 
+async def deliver_help_command(payload: str, target: str) -> str:
+    """Direct UDP first; floods through the gateway unless the one addressed lighthouse acked.
+    "ALL" always floods too, for lighthouses that aren't on WiFi (direct ones ignore the copy)."""
+    acked = await lighthouse_registry.send_direct(payload, target)
+    if target != "ALL" and int(target) in acked:
+        return "delivered directly"
+    await queue_manager.post_to_gateways(payload)
+    if acked:
+        return f"delivered directly to {len(acked)}, mesh fallback for the rest"
+    return "sent over the mesh"
+
+
 async def start_http_server() -> None:
     app = web.Application()
 
@@ -707,15 +1083,35 @@ class RegistrationProtocol(asyncio.DatagramProtocol):
         self.registry.set_transport(transport)  # type: ignore[arg-type]
 
     def datagram_received(self, data: bytes, addr) -> None:
+        if data[:2] == b"LT":
+            status, seq = self.registry.update_from_telemetry(data, addr)
+            if status:
+                # the seq is the firmware's next delta base; leaving it out forces a key frame
+                ack = f"LHACK|{status.lighthouse_id}|{int(time.time())}"
+                if seq is not None:
+                    ack += f"|{seq}"
+                self.reply(status, ack, addr)
+            return
         try:
             packet = data.decode("utf-8", errors="ignore").strip()
         except Exception:
             return
+        if packet.startswith("LHCMDACK|"):
+            self.registry.on_command_ack(packet)
+            return
+        if packet.startswith("LHCFGACK|"):
+            print(f"Provisioning reply from {addr[0]}: {packet}")
+            return
         status = self.registry.update_from_packet(packet, addr)
         if status:
-            response = f"LHACK|{status.lighthouse_id}|{int(time.time())}"
-            if self.registry.transport:
-                self.registry.transport.sendto(response.encode("utf-8"), addr)
+            self.reply(status, f"LHACK|{status.lighthouse_id}|{int(time.time())}", addr)
+
+    def reply(self, status: LighthouseStatus, ack: str, addr) -> None:
+        if self.registry.transport:
+            self.registry.transport.sendto(ack.encode("utf-8"), addr)
+            config = self.registry.take_config(status)
+            if config:
+                self.registry.transport.sendto(config.encode("utf-8"), addr)
 
 
 @client.event
@@ -785,15 +1181,20 @@ async def send_audio(
     audio_url = f"{base_url}/audio/{audio_id}{suffix}"
 
     payload = f"HELP|MAIL|{target_value}|{audio_url}"
-    await queue_manager.post_to_gateways(payload)
-    await interaction.response.send_message(f"Mailbox audio queued for {target_value}.", ephemeral=True)
+    route = await deliver_help_command(payload, target_value)
+    await interaction.response.send_message(f"Mailbox audio queued for {target_value} ({route}).", ephemeral=True)
 
 @command_tree.command(name="announcement", description="Generate a TTS announcement and send it to lighthouses.")
-@app_commands.describe(target="Lighthouse number or 'all'", message="Announcement text")
+@app_commands.describe(
+    target="Lighthouse number or 'all'",
+    message="Announcement text",
+    live="Play it now on every target, in sync, instead of leaving it in the mailbox",
+)
 async def send_announcement(
     interaction: discord.Interaction,
     target: str,
     message: str,
+    live: Optional[bool] = False,
 ) -> None:
     if not tts_manager.is_configured():
         await interaction.response.send_message("TTS model is not configured.", ephemeral=True)
@@ -832,9 +1233,18 @@ async def send_announcement(
         await interaction.followup.send("Gateway not connected yet; try again after a help request.", ephemeral=True)
         return
     audio_url = f"{base_url}/audio/{audio_id}.wav"
+    if live:
+        # every lighthouse starts the clip at the same wall-clock moment
+        start_ms = int((time.time() + ANNOUNCE_LEAD_S) * 1000)
+        payload = f"HELP|ANNOUNCE|{target_value}|{audio_url}|{start_ms}"
+        route = await deliver_help_command(payload, target_value)
+        await interaction.followup.send(
+            f"Announcement plays on {target_value} in {ANNOUNCE_LEAD_S:.0f} s ({route}).", ephemeral=True
+        )
+        return
     payload = f"HELP|MAIL|{target_value}|{audio_url}"
-    await queue_manager.post_to_gateways(payload)
-    await interaction.followup.send(f"Announcement queued in mailbox for {target_value}.", ephemeral=True)
+    route = await deliver_help_command(payload, target_value)
+    await interaction.followup.send(f"Announcement queued in mailbox for {target_value} ({route}).", ephemeral=True)
 
 
 @command_tree.command(name="ping_lighthouses", description="Ping the mesh and report which lighthouses are online.")
@@ -856,7 +1266,9 @@ async def ping_lighthouses(
         f"Pinging lighthouses (timeout {timeout}s)...",
         ephemeral=True,
     )
-    await queue_manager.post_to_gateways(f"HELP|PING|{ping_id}")
+    payload = f"HELP|PING|{ping_id}"
+    queue_manager.ping_waiters[ping_id].update(await lighthouse_registry.send_direct(payload, "ALL"))
+    await queue_manager.post_to_gateways(payload)
     await asyncio.sleep(timeout)
     online = sorted(queue_manager.ping_waiters.pop(ping_id, set()))
     offline = [lh for lh in range(1, 31) if lh not in online]
@@ -868,6 +1280,115 @@ async def ping_lighthouses(
     )
 
 
+@command_tree.command(name="provision_lighthouse", description="Assign a lighthouse number to a unit by its WiFi MAC.")
+@app_commands.describe(
+    mac="WiFi MAC of the unit (AA:BB:CC:DD:EE:FF)",
+    number="Lighthouse number (1-30)",
+    name="Optional node name",
+    pin="Optional 6-digit BLE PIN",
+)
+@app_commands.default_permissions(administrator=True)
+async def provision_lighthouse(
+    interaction: discord.Interaction,
+    mac: str,
+    number: int,
+    name: Optional[str] = None,
+    pin: Optional[str] = None,
+) -> None:
+    mac = mac.strip().upper()
+    if len(mac) != 17 or mac.count(":") != 5:
+        await interaction.response.send_message("MAC must look like AA:BB:CC:DD:EE:FF.", ephemeral=True)
+        return
+    if number < 1 or number > 30:
+        await interaction.response.send_message("Number must be 1-30.", ephemeral=True)
+        return
+    fields = [f"number={number}"]
+    if name:
+        if any(ch in name for ch in " |=\t"):
+            await interaction.response.send_message("Name can't contain spaces, '|' or '='.", ephemeral=True)
+            return
+        fields.append(f"name={name}")
+    if pin:
+        if len(pin) != 6 or not pin.isdigit():
+            await interaction.response.send_message("PIN must be 6 digits.", ephemeral=True)
+            return
+        fields.append(f"pin={pin}")
+    lighthouse_registry.queue_config(mac, "|".join(fields))
+    await interaction.response.send_message(
+        f"Queued LH-{number:02d} for {mac}; it applies on the unit's next registration heartbeat and reboots.",
+        ephemeral=True,
+    )
+
+
+@command_tree.command(name="fleet_status", description="Mesh health of every registered lighthouse.")
+@app_commands.describe(window_minutes="Window for rates (minutes, default 5)")
+@app_commands.default_permissions(administrator=True)
+async def fleet_status(interaction: discord.Interaction, window_minutes: Optional[int] = None) -> None:
+    window_s = max(1, min(int(window_minutes or TELEMETRY_WINDOW_S // 60), 60)) * 60
+    rows = lighthouse_registry.fleet_rows(window_s)
+    if not rows:
+        await interaction.response.send_message("No telemetry received yet.", ephemeral=True)
+        return
+    lines = ["LH      up(h) tx%  rx%  sent/m recv/m dup% pool q  nf   heap/big(KB) urun loop(ms)"]
+    for r in rows:
+        lines.append(
+            f"{r['id'][:7]:<7}{'' if r['online'] else '*'}"
+            f"{r['uptime_h']:>5.1f} {r['tx_air_pct']:>4.1f} {r['rx_air_pct']:>4.1f} "
+            f"{r['sent_pm']:>6.1f} {r['recv_pm']:>6.1f} {r['dup_pct']:>4.0f} "
+            f"{r['pool_free']:>4} {r['queue']:>2} {r['noise']:>4} "
+            f"{r['heap_kb']:>5.0f}/{r['largest_kb']:<6.0f} {r['underruns']:>4} {r['loop_ms']:>7.1f}"
+        )
+    online = [r for r in rows if r["online"]]
+    if online:
+        lines.append(
+            f"fleet: {len(online)}/{len(rows)} online, tx airtime {sum(r['tx_air_pct'] for r in online):.1f}% total, "
+            f"min pool {min(r['pool_free'] for r in online)}, max queue {max(r['queue'] for r in online)}, "
+            f"max loop {max(r['loop_ms'] for r in online):.1f} ms"
+        )
+        lines.append(
+            f"LoRa neighbours heard {min(r['neighbours'] for r in online)}-{max(r['neighbours'] for r in online)}, "
+            f"max LBT busy {max(r['lbt_busy_pct'] for r in online)}%, "
+            f"max channel use {max(r['channel_util_pct'] for r in online)}%"
+        )
+        text_raw = sum(r["text_raw"] for r in online)
+        if text_raw:
+            lines.append(
+                f"texts packed to {sum(r['text_packed'] for r in online) * 100 / text_raw:.0f}% of "
+                f"{text_raw} B, {sum(r['air_saved_s'] for r in online):.1f} s airtime saved"
+            )
+    body = "\n".join(lines)
+    if len(body) > 1900:
+        body = body[:1900] + "\n..."
+    await interaction.response.send_message(
+        f"Fleet over the last {window_s // 60} min (* = offline):\n```\n{body}\n```", ephemeral=True
+    )
+
+
+@command_tree.command(name="sync_status", description="Clock sync and announcement start skew per lighthouse.")
+@app_commands.default_permissions(administrator=True)
+async def sync_status(interaction: discord.Interaction) -> None:
+    rows = lighthouse_registry.sync_rows()
+    if not rows:
+        await interaction.response.send_message("No telemetry received yet.", ephemeral=True)
+        return
+    lines = ["LH      clock  spread(ms) starts skew(ms)"]
+    for r in rows:
+        lines.append(
+            f"{r['id'][:7]:<7}{'' if r['online'] else '*'}"
+            f"{r['source']:<6} {r['spread_ms']:>10.2f} {r['starts']:>6} {r['skew_ms']:>8.2f}"
+        )
+    started = [r for r in rows if r["starts"]]
+    if len(started) > 1:
+        skews = [r["skew_ms"] for r in started]
+        lines.append(f"last start: {max(skews) - min(skews):.2f} ms between earliest and latest (own clocks)")
+    unsynced = [r["id"] for r in rows if r["source"] == "none"]
+    if unsynced:
+        lines.append(f"unsynced: {', '.join(unsynced)}")
+    body = "\n".join(lines)
+    if len(body) > 1900:
+        body = body[:1900] + "\n..."
+    await interaction.response.send_message(f"Clock sync (* = offline):\n```\n{body}\n```", ephemeral=True)
+
 
 if __name__ == "__main__":
     client.run(BOT_TOKEN)
@@ -0,0 +1,371 @@
+#include "AudioCache.h"
+
+#ifdef ESP32
+#include <HTTPClient.h>
+#include <LittleFS.h>
+#include <WiFi.h>
+#include <Utils.h>
+#endif
+
+namespace {
+bool has_suffix(const char *text, size_t text_len, const char *suffix) {
+  size_t suffix_len = strlen(suffix);
+  if (suffix_len > text_len) {
+    return false;
+  }
+  return strncasecmp(text + text_len - suffix_len, suffix, suffix_len) == 0;
+}
+
+// Extension the decoder will be picked by, ignoring any query string.
+const char *audio_extension(const char *url) {
+  const char *query = strchr(url, '?');
+  size_t len = query ? (size_t)(query - url) : strlen(url);
+  if (has_suffix(url, len, ".mp3")) {
+    return ".mp3";
+  }
+  if (has_suffix(url, len, ".ogg")) {
+    return nullptr;
+  }
+  return ".wav";
+}
+}
+
+AudioCache::AudioCache()
+#ifdef ESP32
+  : _used_bytes(0),
+    _clock(0),
+    _last_lookup(0),
+    _hits(0),
+    _misses(0),
+    _ready(false),
+    _lock(nullptr),
+    _jobs(nullptr),
+    _task(nullptr)
+#endif
+{
+#ifdef ESP32
+  for (uint8_t i = 0; i < AUDIO_CACHE_MAX_ENTRIES; ++i) {
+    _entries[i].valid = false;
+  }
+#endif
+}
+
+bool AudioCache::begin() {
+#ifdef ESP32
+  if (_ready) {
+    return true;
+  }
+  if (!LittleFS.exists(AUDIO_CACHE_DIR)) {
+    LittleFS.mkdir(AUDIO_CACHE_DIR);
+  }
+
+  // rebuild the index from whatever survived the last boot; recency is unknown so all start out oldest
+  File dir = LittleFS.open(AUDIO_CACHE_DIR);
+  if (dir && dir.isDirectory()) {
+    File file = dir.openNextFile();
+    while (file) {
+      char path[48];
+      snprintf(path, sizeof(path), "%s/%s", AUDIO_CACHE_DIR, file.name());
+      const char *name = file.name();
+      size_t name_len = strlen(name);
+      uint32_t size = file.size();
+      file.close();
+      if (has_suffix(name, name_len, ".tmp") || name_len >= sizeof(_entries[0].name)) {
+        LittleFS.remove(path);
+      } else {
+        addEntry(name, size, 0);
+      }
+      file = dir.openNextFile();
+    }
+  }
+
+  _lock = xSemaphoreCreateMutex();
+  _jobs = xQueueCreate(AUDIO_CACHE_QUEUE_SIZE, sizeof(Job));
+  if (_lock == nullptr || _jobs == nullptr) {
+    Serial.println("AudioCache: failed to allocate task resources");
+    return false;
+  }
+  makeRoom(0);
+  // core 0, away from the Arduino loop (mesh + playback) on core 1
+  if (xTaskCreatePinnedToCore(taskEntry, "audio_cache", 6144, this, 1, &_task, 0) != pdPASS) {
+    Serial.println("AudioCache: failed to start download task");
+    return false;
+  }
+  _ready = true;
+  Serial.printf("AudioCache: %u bytes cached (budget %u)\n", (unsigned)_used_bytes, (unsigned)AUDIO_CACHE_BUDGET_BYTES);
+  return true;
+#else
+  return false;
+#endif
+}
+
+bool AudioCache::prefetch(const char *url) {
+#ifdef ESP32
+  if (!_ready || !url || url[0] == '\0') {
+    return false;
+  }
+  Job job;
+  if (strlen(url) >= sizeof(job.url) || !audio_extension(url)) {
+    return false;
+  }
+  char name[sizeof(_entries[0].name)];
+  if (!makeName(url, name, sizeof(name))) {
+    return false;
+  }
+  xSemaphoreTake(_lock, portMAX_DELAY);
+  bool cached = findEntry(name) >= 0;
+  xSemaphoreGive(_lock);
+  if (cached) {
+    return true;
+  }
+  strcpy(job.url, url);
+  return xQueueSend(_jobs, &job, 0) == pdTRUE;
+#else
+  (void)url;
+  return false;
+#endif
+}
+
+bool AudioCache::lookup(const char *url, char *path, size_t path_len) {
+#ifdef ESP32
+  if (!_ready || !url || !path || path_len == 0) {
+    return false;
+  }
+  char name[sizeof(_entries[0].name)];
+  if (!makeName(url, name, sizeof(name))) {
+    return false;
+  }
+  xSemaphoreTake(_lock, portMAX_DELAY);
+  int idx = findEntry(name);
+  if (idx >= 0) {
+    _entries[idx].last_used = ++_clock;
+    _last_lookup = _clock;
+    _hits++;
+    snprintf(path, path_len, "%s/%s", AUDIO_CACHE_DIR, name);
+  } else {
+    _misses++;
+  }
+  xSemaphoreGive(_lock);
+  return idx >= 0;
+#else
+  (void)url;
+  (void)path;
+  (void)path_len;
+  return false;
+#endif
+}
+
+uint32_t AudioCache::getUsedBytes() const {
+#ifdef ESP32
+  return _used_bytes;
+#else
+  return 0;
+#endif
+}
+
+uint32_t AudioCache::getHits() const {
+#ifdef ESP32
+  return _hits;
+#else
+  return 0;
+#endif
+}
+
+uint32_t AudioCache::getMisses() const {
+#ifdef ESP32
+  return _misses;
+#else
+  return 0;
+#endif
+}
+
+#ifdef ESP32
+void AudioCache::taskEntry(void *arg) {
+  static_cast<AudioCache *>(arg)->runTask();
+}
+
+void AudioCache::runTask() {
+  Job job;
+  while (true) {
+    if (xQueueReceive(_jobs, &job, portMAX_DELAY) != pdTRUE) {
+      continue;
+    }
+    download(job.url);
+  }
+}
+
+bool AudioCache::download(const char *url) {
+  char name[sizeof(_entries[0].name)];
+  if (!makeName(url, name, sizeof(name))) {
+    return false;
+  }
+  xSemaphoreTake(_lock, portMAX_DELAY);
+  bool cached = findEntry(name) >= 0;
+  xSemaphoreGive(_lock);
+  if (cached) {
+    return true;  // duplicate job queued while the first was downloading
+  }
+  if (WiFi.status() != WL_CONNECTED) {
+    return false;
+  }
+
+  HTTPClient http;
+  http.setTimeout(AUDIO_CACHE_TIMEOUT_MS);
+  if (!http.begin(url)) {
+    return false;
+  }
+  int code = http.GET();
+  if (code != HTTP_CODE_OK) {
+    Serial.printf("AudioCache: fetch failed (%d) %s\n", code, url);
+    http.end();
+    return false;
+  }
+  int total = http.getSize();
+  if (total > (int)AUDIO_CACHE_BUDGET_BYTES) {
+    Serial.printf("AudioCache: %d bytes exceeds budget, streaming only\n", total);
+    http.end();
+    return false;
+  }
+  if (total > 0) {
+    xSemaphoreTake(_lock, portMAX_DELAY);
+    makeRoom((uint32_t)total);
+    xSemaphoreGive(_lock);
+  }
+
+  char tmp_path[48];
+  char final_path[48];
+  snprintf(tmp_path, sizeof(tmp_path), "%s/%s.tmp", AUDIO_CACHE_DIR, name);
+  snprintf(final_path, sizeof(final_path), "%s/%s", AUDIO_CACHE_DIR, name);
+  File file = LittleFS.open(tmp_path, "w");
+  if (!file) {
+    http.end();
+    return false;
+  }
+
+  WiFiClient *stream = http.getStreamPtr();
+  uint8_t chunk[512];
+  uint32_t written = 0;
+  unsigned long last_data_ms = millis();
+  bool ok = true;
+  while (total < 0 || written < (uint32_t)total) {
+    size_t avail = stream->available();
+    if (avail == 0) {
+      if (!http.connected()) {
+        ok = (total < 0);  // length unknown: EOF marks the end
+        break;
+      }
+      if (millis() - last_data_ms > AUDIO_CACHE_TIMEOUT_MS) {
+        ok = false;
+        break;
+      }
+      vTaskDelay(pdMS_TO_TICKS(2));
+      continue;
+    }
+    size_t n = stream->readBytes(chunk, avail < sizeof(chunk) ? avail : sizeof(chunk));
+    if (file.write(chunk, n) != n) {
+      ok = false;  // flash full
+      break;
+    }
+    written += n;
+    last_data_ms = millis();
+    if (written > AUDIO_CACHE_BUDGET_BYTES) {
+      ok = false;
+      break;
+    }
+  }
+  file.close();
+  http.end();
+
+  if (!ok || written == 0 || !LittleFS.rename(tmp_path, final_path)) {
+    LittleFS.remove(tmp_path);
+    Serial.printf("AudioCache: download aborted after %u bytes\n", (unsigned)written);
+    return false;
+  }
+
+  xSemaphoreTake(_lock, portMAX_DELAY);
+  addEntry(name, written, ++_clock);
+  makeRoom(0);
+  xSemaphoreGive(_lock);
+  Serial.printf("AudioCache: cached %s (%u bytes)\n", name, (unsigned)written);
+  return true;
+}
+
+int AudioCache::findEntry(const char *name) const {
+  for (uint8_t i = 0; i < AUDIO_CACHE_MAX_ENTRIES; ++i) {
+    if (_entries[i].valid && strcmp(_entries[i].name, name) == 0) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+void AudioCache::addEntry(const char *name, uint32_t size, uint32_t last_used) {
+  int slot = -1;
+  int oldest = -1;
+  for (uint8_t i = 0; i < AUDIO_CACHE_MAX_ENTRIES; ++i) {
+    if (!_entries[i].valid) {
+      slot = i;
+      break;
+    }
+    if (oldest < 0 || _entries[i].last_used < _entries[oldest].last_used) {
+      oldest = i;
+    }
+  }
+  if (slot < 0) {
+    removeEntry(oldest);
+    slot = oldest;
+  }
+  Entry &entry = _entries[slot];
+  strncpy(entry.name, name, sizeof(entry.name) - 1);
+  entry.name[sizeof(entry.name) - 1] = '\0';
+  entry.size = size;
+  entry.last_used = last_used;
+  entry.valid = true;
+  _used_bytes += size;
+}
+
+void AudioCache::removeEntry(int idx) {
+  Entry &entry = _entries[idx];
+  if (!entry.valid) {
+    return;
+  }
+  char path[48];
+  snprintf(path, sizeof(path), "%s/%s", AUDIO_CACHE_DIR, entry.name);
+  LittleFS.remove(path);
+  _used_bytes -= entry.size;
+  entry.valid = false;
+}
+
+void AudioCache::makeRoom(uint32_t incoming) {
+  while (_used_bytes + incoming > AUDIO_CACHE_BUDGET_BYTES) {
+    int victim = -1;
+    for (uint8_t i = 0; i < AUDIO_CACHE_MAX_ENTRIES; ++i) {
+      // never evict the clip just played (it may still be open) or the one just downloaded
+      uint32_t used = _entries[i].last_used;
+      if (!_entries[i].valid || (used > 0 && (used == _last_lookup || used == _clock))) {
+        continue;
+      }
+      if (victim < 0 || _entries[i].last_used < _entries[victim].last_used) {
+        victim = i;
+      }
+    }
+    if (victim < 0) {
+      break;
+    }
+    Serial.printf("AudioCache: evicting %s\n", _entries[victim].name);
+    removeEntry(victim);
+  }
+}
+
+bool AudioCache::makeName(const char *url, char *name, size_t name_len) {
+  const char *ext = audio_extension(url);
+  if (!ext || name_len < 17 + strlen(ext)) {
+    return false;
+  }
+  uint8_t hash[8];
+  mesh::Utils::sha256(hash, sizeof(hash), (const uint8_t *)url, strlen(url));
+  mesh::Utils::toHex(name, hash, sizeof(hash));
+  strcat(name, ext);
+  return true;
+}
+#endif
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <Arduino.h>
+#include "global_configs.h"
+
+#ifdef ESP32
+#include <freertos/FreeRTOS.h>
+#include <freertos/queue.h>
+#include <freertos/semphr.h>
+#endif
+
+// On-flash (LittleFS) cache of streamed audio clips. Files are named by a hash of the
+// source URL, fetched by a background task, and evicted least-recently-used once the
+// cache grows past AUDIO_CACHE_BUDGET_BYTES.
+class AudioCache {
+public:
+  AudioCache();
+
+  // LittleFS must already be mounted.
+  bool begin();
+  // Queue 'url' for background download; returns true if cached or queued.
+  bool prefetch(const char *url);
+  // Copies the local file path for 'url' into 'path' if it is fully cached.
+  bool lookup(const char *url, char *path, size_t path_len);
+  uint32_t getUsedBytes() const;
+  uint32_t getHits() const;
+  uint32_t getMisses() const;
+
+private:
+#ifdef ESP32
+  struct Entry {
+    char name[24];
+    uint32_t size;
+    uint32_t last_used;
+    bool valid;
+  };
+
+  struct Job {
+    char url[192];
+  };
+
+  Entry _entries[AUDIO_CACHE_MAX_ENTRIES];
+  uint32_t _used_bytes;
+  uint32_t _clock;
+  uint32_t _last_lookup;
+  uint32_t _hits;
+  uint32_t _misses;
+  bool _ready;
+  SemaphoreHandle_t _lock;
+  QueueHandle_t _jobs;
+  TaskHandle_t _task;
+
+  static void taskEntry(void *arg);
+  void runTask();
+  bool download(const char *url);
+  int findEntry(const char *name) const;
+  void addEntry(const char *name, uint32_t size, uint32_t last_used);
+  void removeEntry(int idx);
+  void makeRoom(uint32_t incoming);
+  static bool makeName(const char *url, char *name, size_t name_len);
+#endif
+};
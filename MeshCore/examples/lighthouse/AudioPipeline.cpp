@@ -0,0 +1,192 @@
+#include "AudioPipeline.h"
+
+#ifdef ESP32
+#include <esp_heap_caps.h>
+#include "global_configs.h"
+#endif
+
+namespace {
+bool ends_with(const char *text, const char *suffix) {
+  if (!text || !suffix) {
+    return false;
+  }
+  size_t text_len = strlen(text);
+  size_t suffix_len = strlen(suffix);
+  if (suffix_len > text_len) {
+    return false;
+  }
+  return strncasecmp(text + text_len - suffix_len, suffix, suffix_len) == 0;
+}
+}
+
+AudioPipeline::AudioPipeline()
+#ifdef ESP32
+  : _source(nullptr),
+    _buffer(nullptr),
+    _decoder(nullptr),
+    _buffer_bytes(nullptr),
+    _mp3_space(nullptr),
+    _buffer_capacity(0),
+    _buffer_in_psram(false),
+    _reuses(0)
+#else
+  : _reuses(0)
+#endif
+{
+}
+
+bool AudioPipeline::begin() {
+#ifdef ESP32
+  if (_buffer_bytes == nullptr && psramFound()) {
+    _buffer_bytes = static_cast<uint8_t *>(heap_caps_malloc(AUDIO_BUFFER_PSRAM_MAX_BYTES, MALLOC_CAP_SPIRAM));
+    if (_buffer_bytes) {
+      _buffer_capacity = AUDIO_BUFFER_PSRAM_MAX_BYTES;
+      _buffer_in_psram = true;
+    }
+  }
+  if (_buffer_bytes == nullptr) {
+    _buffer_bytes = static_cast<uint8_t *>(heap_caps_malloc(AUDIO_BUFFER_INTERNAL_MAX_BYTES, MALLOC_CAP_8BIT));
+    _buffer_capacity = AUDIO_BUFFER_INTERNAL_MAX_BYTES;
+  }
+  if (_buffer_bytes == nullptr) {
+    _buffer_bytes = static_cast<uint8_t *>(heap_caps_malloc(AUDIO_BUFFER_BYTES, MALLOC_CAP_8BIT));
+    _buffer_capacity = _buffer_bytes ? AUDIO_BUFFER_BYTES : 0;
+  }
+  if (_mp3_space == nullptr) {
+    _mp3_space = static_cast<uint8_t *>(heap_caps_malloc(AudioGeneratorMP3::preAllocSize(), MALLOC_CAP_8BIT));
+  }
+  if (!isReady()) {
+    Serial.println("AudioPipeline: failed to reserve decoder memory");
+    return false;
+  }
+  Serial.printf("AudioPipeline: %u byte read-ahead in %s\n",
+                (unsigned)_buffer_capacity, _buffer_in_psram ? "PSRAM" : "internal RAM");
+  return true;
+#else
+  return false;
+#endif
+}
+
+AudioFileSource *AudioPipeline::openFile(const char *path) {
+#ifdef ESP32
+  release();
+  if (!isReady() || !_file.open(path)) {
+    _file.close();
+    return nullptr;
+  }
+  // LittleFS keeps up easily; the minimum read-ahead is plenty
+  return wrap(&_file, AUDIO_BUFFER_BYTES);
+#else
+  (void)path;
+  return nullptr;
+#endif
+}
+
+AudioFileSource *AudioPipeline::openUrl(const char *url, uint32_t buffer_bytes) {
+#ifdef ESP32
+  release();
+  if (!isReady() || !_http.open(url)) {
+    _http.close();
+    return nullptr;
+  }
+  return wrap(&_http, buffer_bytes);
+#else
+  (void)url;
+  (void)buffer_bytes;
+  return nullptr;
+#endif
+}
+
+AudioGenerator *AudioPipeline::decoderFor(const char *name) {
+#ifdef ESP32
+  if (_buffer == nullptr || _decoder != nullptr) {
+    return nullptr;
+  }
+  if (ends_with(name, ".mp3")) {
+    _decoder = new (_mp3_slot) AudioGeneratorMP3(_mp3_space, AudioGeneratorMP3::preAllocSize());
+  } else if (ends_with(name, ".ogg")) {
+    return nullptr;
+  } else {
+    _decoder = new (_wav_slot) AudioGeneratorWAV();
+  }
+  return _decoder;
+#else
+  (void)name;
+  return nullptr;
+#endif
+}
+
+void AudioPipeline::release() {
+#ifdef ESP32
+  if (_decoder) {
+    _decoder->stop();
+    _decoder->~AudioGenerator();
+    _decoder = nullptr;
+  }
+  if (_buffer) {
+    _buffer->~AudioFileSourceBuffer();
+    _buffer = nullptr;
+  }
+  if (_source) {
+    _source->close();
+    _source = nullptr;
+  }
+#endif
+}
+
+bool AudioPipeline::isReady() const {
+#ifdef ESP32
+  return _buffer_bytes != nullptr && _mp3_space != nullptr;
+#else
+  return false;
+#endif
+}
+
+uint32_t AudioPipeline::getBufferCapacity() const {
+#ifdef ESP32
+  return _buffer_capacity;
+#else
+  return 0;
+#endif
+}
+
+bool AudioPipeline::isBufferInPsram() const {
+#ifdef ESP32
+  return _buffer_in_psram;
+#else
+  return false;
+#endif
+}
+
+uint32_t AudioPipeline::getFillLevel() const {
+#ifdef ESP32
+  return _buffer ? _buffer->getFillLevel() : 0;
+#else
+  return 0;
+#endif
+}
+
+uint32_t AudioPipeline::getSourcePos() const {
+#ifdef ESP32
+  return _source ? _source->getPos() : 0;
+#else
+  return 0;
+#endif
+}
+
+uint32_t AudioPipeline::getReuses() const {
+  return _reuses;
+}
+
+#ifdef ESP32
+AudioFileSource *AudioPipeline::wrap(AudioFileSource *source, uint32_t buffer_bytes) {
+  _source = source;
+  if (buffer_bytes == 0 || buffer_bytes > _buffer_capacity) {
+    buffer_bytes = _buffer_capacity;
+  }
+  // the caller-supplied storage overload never allocates and never frees
+  _buffer = new (_buffer_slot) AudioFileSourceBuffer(source, _buffer_bytes, buffer_bytes);
+  _reuses++;
+  return _buffer;
+}
+#endif
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <Arduino.h>
+
+#ifdef ESP32
+#include <new>
+#include <AudioFileSourceBuffer.h>
+#include <AudioFileSourceHTTPStream.h>
+#include <AudioFileSourceLittleFS.h>
+#include <AudioGeneratorMP3.h>
+#include <AudioGeneratorWAV.h>
+#endif
+
+// Reusable source/buffer/decoder set for AudioStreamer. Everything is allocated once in
+// begin(); each playback re-opens a source and placement-constructs the buffer and decoder
+// into fixed storage, and release() tears them down again without touching the heap.
+// Only one stream is ever live, so a single slot of each kind is enough. The read-ahead
+// buffer is reserved at its largest size (in PSRAM when present) and each stream uses
+// as much of it as AudioStreamer asks for.
+class AudioPipeline {
+public:
+  AudioPipeline();
+
+  bool begin();
+  // Open a source; returns the buffered source to hand to the decoder, or nullptr.
+  class AudioFileSource *openFile(const char *path);
+  class AudioFileSource *openUrl(const char *url, uint32_t buffer_bytes);
+  // Decoder for a clip named 'name' (.mp3 or .wav), or nullptr if unsupported.
+  class AudioGenerator *decoderFor(const char *name);
+  // Stop and destroy the current decoder and buffer, and close the source.
+  void release();
+  bool isReady() const;
+  uint32_t getBufferCapacity() const;
+  bool isBufferInPsram() const;
+  // Live stream stats; only meaningful between open*() and release().
+  uint32_t getFillLevel() const;
+  uint32_t getSourcePos() const;
+  uint32_t getReuses() const;
+
+private:
+#ifdef ESP32
+  AudioFileSource *wrap(AudioFileSource *source, uint32_t buffer_bytes);
+
+  AudioFileSourceLittleFS _file;
+  AudioFileSourceHTTPStream _http;
+  AudioFileSource *_source;
+  AudioFileSourceBuffer *_buffer;
+  AudioGenerator *_decoder;
+  uint8_t *_buffer_bytes;
+  uint8_t *_mp3_space;
+  uint32_t _buffer_capacity;
+  bool _buffer_in_psram;
+  alignas(AudioFileSourceBuffer) uint8_t _buffer_slot[sizeof(AudioFileSourceBuffer)];
+  alignas(AudioGeneratorMP3) uint8_t _mp3_slot[sizeof(AudioGeneratorMP3)];
+  alignas(AudioGeneratorWAV) uint8_t _wav_slot[sizeof(AudioGeneratorWAV)];
+#endif
+  uint32_t _reuses;
+};
@@ -1,32 +1,16 @@
 #include "AudioStreamer.h"
 
 #ifdef ESP32
-#include <AudioFileSource.h>
-#include <AudioFileSourceBuffer.h>
-#include <AudioFileSourceHTTPStream.h>
-#include <AudioFileSourceLittleFS.h>
-#include <AudioGeneratorMP3.h>
-#include <AudioGeneratorWAV.h>
 #include <AudioOutputI2S.h>
 #include <LittleFS.h>
+#include <esp_timer.h>
 #include "Amplifier.h"
 #include "LightChime.h"
+#include "LightRing.h"
 #include "global_configs.h"
 #endif
 
 namespace {
-bool ends_with(const char *text, const char *suffix) {
-  if (!text || !suffix) {
-    return false;
-  }
-  size_t text_len = strlen(text);
-  size_t suffix_len = strlen(suffix);
-  if (suffix_len > text_len) {
-    return false;
-  }
-  return strncasecmp(text + text_len - suffix_len, suffix, suffix_len) == 0;
-}
-
 const char *strip_query(const char *url, char *buffer, size_t buffer_len) {
   if (!url || buffer_len == 0) {
     return "";
@@ -39,35 +23,132 @@ const char *strip_query(const char *url, char *buffer, size_t buffer_len) {
   }
   return buffer;
 }
+
+#ifdef ESP32
+constexpr uint16_t kBlockFrames = 128;
+constexpr uint16_t kWriteFrames = 128;
+#endif
 }
 
-class MeteredI2S : public AudioOutputI2S {
+#ifdef ESP32
+// Decoder-facing output: normalises to 16-bit stereo, meters/analyses and queues whole blocks into
+// the PCM ring. Refusing a sample (ring full) makes the generator retry it on its next loop().
+class RingOutput : public AudioOutput {
 public:
-  explicit MeteredI2S(AudioStreamer *owner) : _owner(owner) {}
+  RingOutput(AudioOutputI2S *sink, PcmRing *ring, LevelMeter *meter, SpectrumAnalyzer *spectrum)
+    : _sink(sink), _ring(ring), _meter(meter), _spectrum(spectrum), _count(0), _produced(0) {}
+
+  bool SetRate(int hz) override {
+    hertz = hz;
+    _spectrum->setSampleRate(hz);
+    return _sink->SetRate(hz);
+  }
+
+  bool SetBitsPerSample(int bits) override {
+    bps = bits;
+    return true;
+  }
+
+  bool SetChannels(int chan) override {
+    channels = chan;
+    return true;
+  }
+
+  bool begin() override {
+    _count = 0;
+    _sink->SetBitsPerSample(16);
+    _sink->SetChannels(2);
+    return _sink->begin();
+  }
 
   bool ConsumeSample(int16_t sample[2]) override {
-    if (_owner) {
-      _owner->updateLevel(sample);
+    if (_count == kBlockFrames && !flushBlock()) {
+      return false;
     }
-    return AudioOutputI2S::ConsumeSample(sample);
+    int16_t frame[2] = { sample[0], sample[1] };
+    MakeSampleStereo16(frame);
+    _block[_count * 2] = frame[0];
+    _block[_count * 2 + 1] = frame[1];
+    _count++;
+    _produced++;
+    if (_count == kBlockFrames) {
+      flushBlock();
+    }
+    return true;
   }
 
+  bool stop() override {
+    _count = 0;
+    return _sink->stop();
+  }
+
+  // queue the pending (possibly partial) block; false if the ring has no room yet
+  bool flushBlock() {
+    if (_count == 0) {
+      return true;
+    }
+    if (_ring->space() < _count) {
+      return false;
+    }
+    _meter->processBlock(_block, _count);
+#if AUDIO_SPECTRUM_ENABLED
+    _spectrum->processBlock(_block, _count);
+#endif
+    _ring->write(_block, _count);
+    _count = 0;
+    return true;
+  }
+
+  uint32_t getProduced() const { return _produced; }
+  uint32_t getRate() const { return hertz; }
+
 private:
-  AudioStreamer *_owner;
+  AudioOutputI2S *_sink;
+  PcmRing *_ring;
+  LevelMeter *_meter;
+  SpectrumAnalyzer *_spectrum;
+  uint16_t _count;
+  uint32_t _produced;
+  int16_t _block[kBlockFrames * 2];
 };
+#endif
 
 AudioStreamer::AudioStreamer()
 #ifdef ESP32
   : _decoder(nullptr),
     _source(nullptr),
-    _buffer(nullptr),
+    _i2s(nullptr),
     _output(nullptr),
-    _smoothed_level(0.0f),
-    _fs_ready(false),
+    _meter(AUDIO_SMOOTHING_ALPHA),
+    _spectrum(AUDIO_SPECTRUM_FFT_SIZE, LIGHT_RING_COUNT),
+    _ring_storage(nullptr),
+    _decode_lock(nullptr),
+    _decode_task(nullptr),
+    _writer_task(nullptr),
+    _stream_active(false),
+    _decoder_ended(false),
+    _decode_done(false),
+    _flush_pending(false),
+    _tuner(AUDIO_BUFFER_BYTES, AUDIO_PREROLL_MS, AUDIO_PREROLL_MIN_MS, AUDIO_PREROLL_MAX_MS),
     _preroll_active(false),
-    _preroll_until_ms(0)
+    _fs_ready(false),
+    _is_stream(false),
+    _preroll_bytes(0),
+    _preroll_until_ms(0),
+    _last_tune_ms(0),
+    _underruns_at_start(0),
+    _start_requested(false),
+    _start_gated(false),
+    _start_measuring(false),
+    _start_at_us(0),
+    _start_skew_us(0),
+    _scheduled_starts(0),
+    _logged_starts(0)
 #endif
 {
+#ifdef ESP32
+  _cache_after_url[0] = '\0';
+#endif
 }
 
 void AudioStreamer::begin() {
@@ -78,10 +159,32 @@ void AudioStreamer::begin() {
       Serial.println("AudioStreamer: LittleFS mount failed");
     }
   }
-  if (_output == nullptr) {
-    _output = new MeteredI2S(this);
-    _output->SetPinout(AMP_I2S_BCLK, AMP_I2S_WS, AMP_I2S_DOUT);
-    _output->SetGain(AUDIO_VOLUME);
+  if (_i2s == nullptr) {
+    _i2s = new AudioOutputI2S();
+    _i2s->SetPinout(AMP_I2S_BCLK, AMP_I2S_WS, AMP_I2S_DOUT);
+    _i2s->SetGain(AUDIO_VOLUME);
+    _output = new RingOutput(_i2s, &_ring, &_meter, &_spectrum);
+  }
+  if (_pipeline.begin()) {
+    _tuner.setMaxBuffer(_pipeline.getBufferCapacity());
+  }
+  if (_ring_storage == nullptr) {
+    _ring_storage = new int16_t[AUDIO_RING_FRAMES * 2];
+    if (!_ring.attach(_ring_storage, AUDIO_RING_FRAMES)) {
+      Serial.println("AudioStreamer: AUDIO_RING_FRAMES must be a power of two");
+    }
+  }
+  if (_decode_lock == nullptr) {
+    _decode_lock = xSemaphoreCreateMutex();
+    // the writer outranks the decoder so a long MP3 frame never starves the DMA
+    xTaskCreatePinnedToCore(writerTaskEntry, "audio_i2s", 3072, this, 5, &_writer_task, AUDIO_TASK_CORE);
+    xTaskCreatePinnedToCore(decodeTaskEntry, "audio_decode", 8192, this, 3, &_decode_task, AUDIO_TASK_CORE);
+    if (_writer_task == nullptr || _decode_task == nullptr) {
+      Serial.println("AudioStreamer: failed to start audio tasks");
+    }
+  }
+  if (_fs_ready) {
+    _cache.begin();
   }
 #endif
 }
@@ -95,34 +198,60 @@ bool AudioStreamer::play(const char *url) {
     return false;
   }
 
+  char cached_path[48];
+  if (_cache.lookup(url, cached_path, sizeof(cached_path))) {
+    return playFile(cached_path);
+  }
   stop();
 
-  _source = new AudioFileSourceHTTPStream(url);
-  _buffer = new AudioFileSourceBuffer(_source, AUDIO_BUFFER_BYTES);
+  _source = _pipeline.openUrl(url, _tuner.bufferBytes());
+  if (_source == nullptr) {
+    Serial.println("AudioStreamer: failed to open stream");
+    return false;
+  }
+  _is_stream = true;
+  // stream this time, and have it on flash for the next replay; the download waits for stop()
+  // so it doesn't compete with this stream for the link
+  strncpy(_cache_after_url, url, sizeof(_cache_after_url) - 1);
+  _cache_after_url[sizeof(_cache_after_url) - 1] = '\0';
 
   char url_no_query[192];
-  const char *clean = strip_query(url, url_no_query, sizeof(url_no_query));
+  return startDecoder(strip_query(url, url_no_query, sizeof(url_no_query)));
+#else
+  (void)url;
+  return false;
+#endif
+}
 
-  if (ends_with(clean, ".mp3")) {
-    _decoder = new AudioGeneratorMP3();
-  } else if (ends_with(clean, ".ogg")) {
-    Serial.println("AudioStreamer: OGG not supported in this build.");
-    stop();
+bool AudioStreamer::playAt(const char *url, int64_t start_us) {
+#ifdef ESP32
+  if (isPlaying()) {
     return false;
-  } else {
-    _decoder = new AudioGeneratorWAV();
   }
+  // play() stops and restarts the decoder on its way; startDecoder() picks the request up
+  _start_at_us = start_us;
+  _start_requested = true;
+  bool ok = play(url);
+  _start_requested = false;
+  return ok;
+#else
+  (void)url;
+  (void)start_us;
+  return false;
+#endif
+}
 
-  if (!_decoder->begin(_buffer, _output)) {
-    stop();
-    return false;
-  }
-  if (AUDIO_PREROLL_MS > 0 && _output) {
-    _preroll_active = true;
-    _preroll_until_ms = millis() + AUDIO_PREROLL_MS;
-    _output->SetGain(0.0f);
-  }
-  return true;
+bool AudioStreamer::isStartPending() const {
+#ifdef ESP32
+  return _start_gated;
+#else
+  return false;
+#endif
+}
+
+bool AudioStreamer::prefetch(const char *url) {
+#ifdef ESP32
+  return _cache.prefetch(url);
 #else
   (void)url;
   return false;
@@ -144,29 +273,12 @@ bool AudioStreamer::playFile(const char *path) {
 
   stop();
 
-  _source = new AudioFileSourceLittleFS(path);
-  _buffer = new AudioFileSourceBuffer(_source, AUDIO_BUFFER_BYTES);
-
-  if (ends_with(path, ".mp3")) {
-    _decoder = new AudioGeneratorMP3();
-  } else if (ends_with(path, ".ogg")) {
-    Serial.println("AudioStreamer: OGG not supported in this build.");
-    stop();
+  _source = _pipeline.openFile(path);
+  if (_source == nullptr) {
+    Serial.printf("AudioStreamer: failed to open %s\n", path);
     return false;
-  } else {
-    _decoder = new AudioGeneratorWAV();
   }
-
-  if (!_decoder->begin(_buffer, _output)) {
-    stop();
-    return false;
-  }
-  if (AUDIO_PREROLL_MS > 0 && _output) {
-    _preroll_active = true;
-    _preroll_until_ms = millis() + AUDIO_PREROLL_MS;
-    _output->SetGain(0.0f);
-  }
-  return true;
+  return startDecoder(path);
 #else
   (void)path;
   return false;
@@ -175,44 +287,66 @@ bool AudioStreamer::playFile(const char *path) {
 
 void AudioStreamer::loop() {
 #ifdef ESP32
+  if (_logged_starts != _scheduled_starts) {
+    _logged_starts = _scheduled_starts;
+    Serial.printf("AudioStreamer: scheduled start skew %ld us\n", (long)_start_skew_us);
+  }
   if (_decoder) {
-    if (!_decoder->loop()) {
+    // decoding happens on the audio task; finish once the ring has played out
+    if (_decode_done && _ring.available() == 0) {
       stop();
     }
-    if (_preroll_active && millis() >= _preroll_until_ms && _output) {
-      _preroll_active = false;
-      _output->SetGain(AUDIO_VOLUME);
-    }
-  } else if (_smoothed_level > 0.001f) {
-    _smoothed_level *= 0.9f;
-    if (_smoothed_level < 0.001f) {
-      _smoothed_level = 0.0f;
-    }
+  } else {
+    _meter.decay(0.9f);
+    _spectrum.decay(24);
   }
 #endif
 }
 
 void AudioStreamer::stop() {
 #ifdef ESP32
-  if (_decoder) {
-    _decoder->stop();
-    delete _decoder;
-    _decoder = nullptr;
+  if (_decode_lock == nullptr) {
+    return;
   }
-  if (_buffer) {
-    delete _buffer;
-    _buffer = nullptr;
+  xSemaphoreTake(_decode_lock, portMAX_DELAY);
+  if (_stream_active || _ring.available() > 0) {
+    _stream_active = false;
+    // only the writer task moves the ring's tail; if it is slow to get here (blocked on a full DMA),
+    // the flush stays pending and startDecoder() waits for it before anything new goes in
+    _flush_pending = true;
+    for (uint8_t i = 0; i < 20 && _flush_pending; ++i) {
+      vTaskDelay(1);
+    }
+    if (_ring.getUnderruns() > 0 || _ring.getOverruns() > 0) {
+      Serial.printf("AudioStreamer: underruns=%u overruns=%u\n",
+                    (unsigned)_ring.getUnderruns(), (unsigned)_ring.getOverruns());
+    }
   }
-  if (_source) {
-    delete _source;
-    _source = nullptr;
+  if (_is_stream) {
+    _tuner.endStream(millis(), _pipeline.getSourcePos(), _ring.getUnderruns() - _underruns_at_start);
+    const StreamReport &report = _tuner.lastReport();
+    Serial.printf("AudioStreamer: stream %u stalls=%u (%u ms) net=%u B/s, next buffer=%u preroll=%u ms\n",
+                  (unsigned)report.seq, (unsigned)report.stalls, (unsigned)report.stall_ms,
+                  (unsigned)report.throughput_bps, (unsigned)_tuner.bufferBytes(), (unsigned)_tuner.prerollMs());
+    _is_stream = false;
+    if (_cache_after_url[0] != '\0') {
+      _cache.prefetch(_cache_after_url);
+      _cache_after_url[0] = '\0';
+    }
   }
-  _smoothed_level = 0.0f;
+  // decoder, buffer and source go back to the pipeline for the next clip
+  _pipeline.release();
+  _decoder = nullptr;
+  _source = nullptr;
+  _decoder_ended = false;
+  _decode_done = false;
   _preroll_active = false;
-  _preroll_until_ms = 0;
-  if (_output) {
-    _output->SetGain(AUDIO_VOLUME);
-  }
+  _start_gated = false;
+  _start_measuring = false;
+  _spectrum.reset();
+  xSemaphoreGive(_decode_lock);
+
+  _meter.reset();
 #endif
 }
 
@@ -226,18 +360,224 @@ bool AudioStreamer::isPlaying() const {
 
 float AudioStreamer::getLevel() const {
 #ifdef ESP32
-  return _smoothed_level;
+  return _meter.level();
 #else
   return 0.0f;
 #endif
 }
 
+uint8_t AudioStreamer::getSpectrum(uint8_t *out, uint8_t max) const {
+#ifdef ESP32
+  return _spectrum.bands(out, max);
+#else
+  (void)out;
+  (void)max;
+  return 0;
+#endif
+}
+
+uint32_t AudioStreamer::getUnderruns() const {
+#ifdef ESP32
+  return _ring.getUnderruns();
+#else
+  return 0;
+#endif
+}
+
+uint32_t AudioStreamer::getOverruns() const {
+#ifdef ESP32
+  return _ring.getOverruns();
+#else
+  return 0;
+#endif
+}
+
+StreamReport AudioStreamer::getLastStreamReport() const {
+#ifdef ESP32
+  return _tuner.lastReport();
+#else
+  return StreamReport();
+#endif
+}
+
+int32_t AudioStreamer::getLastStartSkewUs() const {
+#ifdef ESP32
+  return _start_skew_us;
+#else
+  return 0;
+#endif
+}
+
+uint32_t AudioStreamer::getScheduledStarts() const {
+#ifdef ESP32
+  return _scheduled_starts;
+#else
+  return 0;
+#endif
+}
+
 #ifdef ESP32
-void AudioStreamer::updateLevel(int16_t sample[2]) {
-  int32_t left = sample[0] < 0 ? -sample[0] : sample[0];
-  int32_t right = sample[1] < 0 ? -sample[1] : sample[1];
-  float magnitude = (float)((left > right) ? left : right) / 32768.0f;
-  const float alpha = AUDIO_SMOOTHING_ALPHA;
-  _smoothed_level = (_smoothed_level * (1.0f - alpha)) + (magnitude * alpha);
+bool AudioStreamer::startDecoder(const char *name) {
+  _decoder = _pipeline.decoderFor(name);
+  if (_decoder == nullptr) {
+    Serial.printf("AudioStreamer: no decoder for %s\n", name);
+    stop();
+    return false;
+  }
+
+  while (_flush_pending) {
+    vTaskDelay(1);  // the last stop()'s flush would drop this clip's first frames
+  }
+  xSemaphoreTake(_decode_lock, portMAX_DELAY);
+  bool ok = _decoder->begin(_source, _output);
+  if (ok) {
+    _decoder_ended = false;
+    _decode_done = false;
+    _preroll_active = false;
+    // armed before the decoder runs so not even the first block slips out early
+    _start_measuring = false;
+    _start_gated = _start_requested;
+    if (_is_stream) {
+      // hold the decoder until the read-ahead covers the tuned pre-roll (or it times out)
+      unsigned long now = millis();
+      _tuner.beginStream(now, _pipeline.getSourcePos());
+      _underruns_at_start = _ring.getUnderruns();
+      _preroll_bytes = _tuner.prerollBytes();
+      _preroll_until_ms = now + _tuner.prerollMs() * 2 + 250;
+      _preroll_active = _preroll_bytes > 0;
+      _last_tune_ms = now;
+    }
+    _stream_active = true;
+  }
+  xSemaphoreGive(_decode_lock);
+  if (!ok) {
+    stop();
+    return false;
+  }
+  return true;
+}
+
+bool AudioStreamer::sourceComplete() {
+  uint32_t size = _source->getSize();
+  return size > 0 && _pipeline.getSourcePos() >= size;
+}
+
+// called with _decode_lock held
+void AudioStreamer::tuneStream() {
+  unsigned long now = millis();
+  if (_preroll_active) {
+    if (_pipeline.getFillLevel() >= _preroll_bytes || sourceComplete() ||
+        (long)(now - _preroll_until_ms) >= 0) {
+      _preroll_active = false;
+    }
+  }
+  if (now - _last_tune_ms >= AUDIO_TUNE_SAMPLE_MS) {
+    _last_tune_ms = now;
+    bool draining = !_preroll_active && !_decoder_ended && !sourceComplete();
+    _tuner.sample(now, _pipeline.getSourcePos(), _pipeline.getFillLevel(), draining);
+  }
+}
+
+void AudioStreamer::decodeTaskEntry(void *arg) {
+  static_cast<AudioStreamer *>(arg)->decodeTask();
+}
+
+void AudioStreamer::writerTaskEntry(void *arg) {
+  static_cast<AudioStreamer *>(arg)->writerTask();
+}
+
+void AudioStreamer::decodeTask() {
+  while (true) {
+    bool idle = true;
+    xSemaphoreTake(_decode_lock, portMAX_DELAY);
+    if (_stream_active && _decoder && !_decode_done) {
+      if (_is_stream) {
+        tuneStream();
+      }
+      if (_preroll_active) {
+        _source->loop();  // top up the read-ahead only
+      } else {
+        uint32_t before = _output->getProduced();
+        if (!_decoder_ended && !_decoder->loop()) {
+          _decoder_ended = true;
+        }
+        if (_decoder_ended && _output->flushBlock()) {
+          _decode_done = true;
+        }
+        idle = (_output->getProduced() == before);
+      }
+    }
+    xSemaphoreGive(_decode_lock);
+    if (idle) {
+      vTaskDelay(1);  // ring full or source starved; let the writer and WiFi run
+    }
+  }
+}
+
+void AudioStreamer::writerTask() {
+  int16_t chunk[kWriteFrames * 2];
+  uint32_t count = 0;
+  uint32_t pos = 0;
+  bool flowing = false;
+  int64_t skipped = 0;  // frames dropped to catch up with a late scheduled start
+  while (true) {
+    if (_flush_pending) {
+      _ring.discard();
+      count = 0;
+      pos = 0;
+      flowing = false;
+      _flush_pending = false;
+    }
+    if (_start_gated) {
+      // the decoder fills the ring meanwhile; sleep in ticks, then spin out the last one
+      if (_start_at_us - esp_timer_get_time() > 1500) {
+        vTaskDelay(1);
+        continue;
+      }
+      while (_start_at_us - esp_timer_get_time() > 0) {
+      }
+      skipped = 0;
+      _start_measuring = true;
+      _start_gated = false;
+    }
+    if (pos == count) {
+      pos = 0;
+      count = _ring.read(chunk, kWriteFrames);
+      if (count == 0) {
+        // count each starvation once, and only mid-stream (not before the first block or after the last)
+        if (flowing && _stream_active && !_decode_done) {
+          _ring.noteUnderrun();
+        }
+        flowing = false;
+        vTaskDelay(1);
+        continue;
+      }
+      if (_start_measuring) {
+        // a start the ring wasn't ready for drops what should already have played
+        int64_t late_us = esp_timer_get_time() - _start_at_us;
+        uint32_t rate = _output->getRate();
+        int64_t due = late_us > AUDIO_SYNC_TOLERANCE_US && rate > 0 ? late_us * rate / 1000000 : 0;
+        if (skipped + count <= due) {
+          skipped += count;
+          count = 0;
+          continue;
+        }
+        if (due > skipped) {
+          pos = (uint32_t)(due - skipped);
+          skipped = due;
+        }
+        _start_skew_us = (int32_t)(late_us - (rate > 0 ? skipped * 1000000 / rate : 0));
+        _start_measuring = false;
+        _scheduled_starts++;
+      }
+      flowing = true;
+    }
+    while (pos < count && _i2s->ConsumeSample(&chunk[pos * 2])) {
+      pos++;
+    }
+    if (pos < count) {
+      vTaskDelay(1);  // DMA full
+    }
+  }
 }
 #endif
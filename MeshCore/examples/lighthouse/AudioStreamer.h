@@ -1,6 +1,12 @@
 #pragma once
 
 #include <Arduino.h>
+#include "AudioCache.h"
+#include "AudioPipeline.h"
+#include "LevelMeter.h"
+#include "PcmRing.h"
+#include "SpectrumAnalyzer.h"
+#include "StreamTuner.h"
 
 class AudioStreamer {
 public:
@@ -9,23 +15,69 @@ public:
   void begin();
   void loop();
   bool play(const char *url);
+  bool prefetch(const char *url);
   bool playFile(const char *path);
+  // Like play(), but decodes ahead into the ring and holds I2S output until the local timer
+  // (esp_timer_get_time()) reaches 'start_us'. Starting late skips ahead to stay in step.
+  bool playAt(const char *url, int64_t start_us);
+  bool isStartPending() const;
   void stop();
   bool isPlaying() const;
   float getLevel() const;
+  // Band levels (0-255) for up to 'max' bands; returns the number written.
+  uint8_t getSpectrum(uint8_t *out, uint8_t max) const;
+  uint32_t getUnderruns() const;
+  uint32_t getOverruns() const;
+  // Stall/throughput summary of the last finished HTTP stream.
+  StreamReport getLastStreamReport() const;
+  // First frame out vs. the requested time for the last playAt(); positive is late.
+  int32_t getLastStartSkewUs() const;
+  uint32_t getScheduledStarts() const;
 
 private:
 #ifdef ESP32
+  // decode runs on its own task, filling _ring; a second task drains _ring into I2S
   class AudioGenerator *_decoder;
   class AudioFileSource *_source;
-  class AudioFileSourceBuffer *_buffer;
-  class AudioOutputI2S *_output;
-  float _smoothed_level;
+  class AudioOutputI2S *_i2s;
+  class RingOutput *_output;
+  AudioCache _cache;
+  AudioPipeline _pipeline;
+  StreamTuner _tuner;
+  PcmRing _ring;
+  LevelMeter _meter;
+  SpectrumAnalyzer _spectrum;
+  int16_t *_ring_storage;
+  SemaphoreHandle_t _decode_lock;
+  TaskHandle_t _decode_task;
+  TaskHandle_t _writer_task;
+  volatile bool _stream_active;
+  volatile bool _decoder_ended;
+  volatile bool _decode_done;
+  volatile bool _flush_pending;
+  volatile bool _preroll_active;
   bool _fs_ready;
-  bool _preroll_active;
+  bool _is_stream;
+  char _cache_after_url[192];  // cache miss being streamed; queued for download when it ends
+  uint32_t _preroll_bytes;
   unsigned long _preroll_until_ms;
+  unsigned long _last_tune_ms;
+  uint32_t _underruns_at_start;
+  // scheduled start: playAt() requests it, startDecoder() arms the gate, the writer releases it
+  bool _start_requested;
+  volatile bool _start_gated;
+  volatile bool _start_measuring;
+  int64_t _start_at_us;
+  volatile int32_t _start_skew_us;
+  volatile uint32_t _scheduled_starts;
+  uint32_t _logged_starts;
 
-  void updateLevel(int16_t sample[2]);
-  friend class MeteredI2S;
+  bool startDecoder(const char *name);
+  bool sourceComplete();
+  void tuneStream();
+  static void decodeTaskEntry(void *arg);
+  static void writerTaskEntry(void *arg);
+  void decodeTask();
+  void writerTask();
 #endif
 };
@@ -0,0 +1,171 @@
+#include "ChimeSynth.h"
+
+namespace {
+constexpr int32_t kEnvMax = 0xFFFFFF;  // Q24 full scale
+
+// round(sin(2*pi*i/256) * 32767)
+const int16_t kSine[256] = {
+  0, 804, 1608, 2410, 3212, 4011, 4808, 5602, 6393, 7179, 7962, 8739,
+  9512, 10278, 11039, 11793, 12539, 13279, 14010, 14732, 15446, 16151, 16846, 17530,
+  18204, 18868, 19519, 20159, 20787, 21403, 22005, 22594, 23170, 23731, 24279, 24811,
+  25329, 25832, 26319, 26790, 27245, 27683, 28105, 28510, 28898, 29268, 29621, 29956,
+  30273, 30571, 30852, 31113, 31356, 31580, 31785, 31971, 32137, 32285, 32412, 32521,
+  32609, 32678, 32728, 32757, 32767, 32757, 32728, 32678, 32609, 32521, 32412, 32285,
+  32137, 31971, 31785, 31580, 31356, 31113, 30852, 30571, 30273, 29956, 29621, 29268,
+  28898, 28510, 28105, 27683, 27245, 26790, 26319, 25832, 25329, 24811, 24279, 23731,
+  23170, 22594, 22005, 21403, 20787, 20159, 19519, 18868, 18204, 17530, 16846, 16151,
+  15446, 14732, 14010, 13279, 12539, 11793, 11039, 10278, 9512, 8739, 7962, 7179,
+  6393, 5602, 4808, 4011, 3212, 2410, 1608, 804, 0, -804, -1608, -2410,
+  -3212, -4011, -4808, -5602, -6393, -7179, -7962, -8739, -9512, -10278, -11039, -11793,
+  -12539, -13279, -14010, -14732, -15446, -16151, -16846, -17530, -18204, -18868, -19519, -20159,
+  -20787, -21403, -22005, -22594, -23170, -23731, -24279, -24811, -25329, -25832, -26319, -26790,
+  -27245, -27683, -28105, -28510, -28898, -29268, -29621, -29956, -30273, -30571, -30852, -31113,
+  -31356, -31580, -31785, -31971, -32137, -32285, -32412, -32521, -32609, -32678, -32728, -32757,
+  -32767, -32757, -32728, -32678, -32609, -32521, -32412, -32285, -32137, -31971, -31785, -31580,
+  -31356, -31113, -30852, -30571, -30273, -29956, -29621, -29268, -28898, -28510, -28105, -27683,
+  -27245, -26790, -26319, -25832, -25329, -24811, -24279, -23731, -23170, -22594, -22005, -21403,
+  -20787, -20159, -19519, -18868, -18204, -17530, -16846, -16151, -15446, -14732, -14010, -13279,
+  -12539, -11793, -11039, -10278, -9512, -8739, -7962, -7179, -6393, -5602, -4808, -4011,
+  -3212, -2410, -1608, -804,
+};
+
+int32_t sine_at(uint32_t phase) {
+  uint32_t idx = phase >> 24;
+  int32_t frac = (int32_t)((phase >> 16) & 0xFF);
+  int32_t a = kSine[idx];
+  int32_t b = kSine[(idx + 1) & 0xFF];
+  return a + (((b - a) * frac) >> 8);
+}
+}
+
+ChimeSynth::ChimeSynth(uint32_t sample_rate, float volume)
+  : _sample_rate(sample_rate),
+    _volume_q15(volume <= 0.0f ? 0 : (volume >= 1.0f ? 32767 : (int32_t)(volume * 32767.0f + 0.5f))),
+    _score(nullptr),
+    _note_index(0),
+    _phase(0),
+    _phase_step(0),
+    _note_pos(0),
+    _note_samples(0),
+    _attack_end(0),
+    _decay_end(0),
+    _release_start(0),
+    _sustain(0),
+    _stage(0),
+    _env(0),
+    _env_step(0),
+    _env_target(0),
+    _segment_end(0) {
+}
+
+void ChimeSynth::start(const ChimeScore *score) {
+  if (score == nullptr || score->notes == nullptr || score->note_count == 0) {
+    stop();
+    return;
+  }
+  _score = score;
+  _note_index = 0;
+  beginNote();
+}
+
+void ChimeSynth::stop() {
+  _score = nullptr;
+}
+
+uint16_t ChimeSynth::render(int16_t *out, uint16_t count) {
+  uint16_t written = 0;
+  while (written < count && _score) {
+    if (_note_pos >= _note_samples) {
+      if (++_note_index >= _score->note_count) {
+        _score = nullptr;
+        break;
+      }
+      beginNote();
+      continue;
+    }
+    uint32_t n = _segment_end - _note_pos;
+    if (n > (uint32_t)(count - written)) {
+      n = count - written;
+    }
+    if (_phase_step == 0) {
+      // rest
+      for (uint32_t i = 0; i < n; ++i) {
+        out[written++] = 0;
+      }
+    } else {
+      for (uint32_t i = 0; i < n; ++i) {
+        int32_t env_q15 = _env >> 9;
+        int32_t s = (sine_at(_phase) * env_q15) >> 15;
+        out[written++] = (int16_t)((s * _volume_q15) >> 15);
+        _phase += _phase_step;
+        _env += _env_step;
+      }
+    }
+    _note_pos += n;
+    if (_note_pos >= _segment_end) {
+      nextSegment();
+    }
+  }
+  return written;
+}
+
+void ChimeSynth::beginNote() {
+  const ChimeNote &note = _score->notes[_note_index];
+  const ChimeEnvelope &env = _score->envelope;
+  _note_pos = 0;
+  _note_samples = msToSamples(note.duration_ms);
+  _phase = 0;
+  _phase_step = (uint32_t)(((uint64_t)note.freq_hz << 32) / _sample_rate);
+
+  uint32_t release = msToSamples(env.release_ms);
+  if (release > _note_samples / 2) {
+    release = _note_samples / 2;
+  }
+  _release_start = _note_samples - release;
+  _attack_end = msToSamples(env.attack_ms);
+  _decay_end = _attack_end + msToSamples(env.decay_ms);
+  _sustain = (int32_t)(((uint32_t)env.sustain * (uint32_t)kEnvMax) / 255);
+
+  _env = 0;
+  _stage = 0;
+  setSegment(kEnvMax, _attack_end);
+  if (_note_pos >= _segment_end) {
+    nextSegment();
+  }
+}
+
+// attack -> decay -> sustain -> release; any stage may be zero length
+void ChimeSynth::nextSegment() {
+  while (_note_pos >= _segment_end && _stage < 3) {
+    _env = _env_target;
+    _stage++;
+    if (_stage == 1) {
+      setSegment(_sustain, _decay_end);
+    } else if (_stage == 2) {
+      setSegment(_sustain, _release_start);
+    } else {
+      setSegment(0, _note_samples);
+    }
+  }
+  if (_note_pos >= _segment_end) {
+    _env = _env_target;
+  }
+}
+
+void ChimeSynth::setSegment(int32_t target, uint32_t end) {
+  // the release always wins; attack/decay are cut short by it
+  if (_stage < 3 && end > _release_start) {
+    end = _release_start;
+  }
+  if (end < _note_pos) {
+    end = _note_pos;
+  }
+  _env_target = target;
+  _segment_end = end;
+  uint32_t len = end - _note_pos;
+  _env_step = len > 0 ? (target - _env) / (int32_t)len : 0;
+}
+
+uint32_t ChimeSynth::msToSamples(uint16_t ms) const {
+  return (uint32_t)(((uint64_t)_sample_rate * ms) / 1000);
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <stdint.h>
+
+// One step of a chime score. freq_hz == 0 is a rest.
+struct ChimeNote {
+  uint16_t freq_hz;
+  uint16_t duration_ms;
+};
+
+// Linear ADSR applied to every note of a score. The release runs inside the note's
+// duration, so back-to-back notes never overlap.
+struct ChimeEnvelope {
+  uint16_t attack_ms;
+  uint16_t decay_ms;
+  uint8_t sustain;  // 0-255 of peak
+  uint16_t release_ms;
+};
+
+struct ChimeScore {
+  const ChimeNote *notes;
+  uint8_t note_count;
+  ChimeEnvelope envelope;
+};
+
+// Integer wavetable oscillator that renders a ChimeScore to mono 16-bit PCM.
+// 32-bit phase accumulator into a 256-entry sine table with linear interpolation,
+// Q16 envelope, Q15 volume; no floating point per sample, so output is bit-exact
+// across targets. Arduino-free.
+class ChimeSynth {
+public:
+  ChimeSynth(uint32_t sample_rate, float volume);
+
+  void start(const ChimeScore *score);
+  void stop();
+  bool isPlaying() const { return _score != nullptr; }
+  // Render up to 'count' samples; returns how many were written (less once the score ends).
+  uint16_t render(int16_t *out, uint16_t count);
+
+private:
+  uint32_t _sample_rate;
+  int32_t _volume_q15;
+  const ChimeScore *_score;
+  uint8_t _note_index;
+  uint32_t _phase;
+  uint32_t _phase_step;
+  uint32_t _note_pos;       // samples into the current note
+  uint32_t _note_samples;
+  uint32_t _attack_end;
+  uint32_t _decay_end;
+  uint32_t _release_start;
+  int32_t _sustain;         // Q24
+  uint8_t _stage;           // 0 attack, 1 decay, 2 sustain, 3 release
+  int32_t _env;             // Q24
+  int32_t _env_step;
+  int32_t _env_target;
+  uint32_t _segment_end;
+
+  void beginNote();
+  void nextSegment();
+  void setSegment(int32_t target, uint32_t end);
+  uint32_t msToSamples(uint16_t ms) const;
+};
@@ -0,0 +1,114 @@
+#include "GatewayElection.h"
+
+GatewayElection::GatewayElection(uint32_t heartbeat_ms, uint32_t timeout_ms, uint32_t stagger_ms)
+  : _heartbeat_ms(heartbeat_ms),
+    _timeout_ms(timeout_ms),
+    _stagger_ms(stagger_ms),
+    _self(0),
+    _eligible(false),
+    _claimed(false),
+    _resign_pending(false),
+    _peer(0),
+    _peer_seen_ms(0),
+    _claim_at_ms(0),
+    _next_announce_ms(0),
+    _takeovers(0) {
+}
+
+bool GatewayElection::peerValid(uint32_t now_ms) const {
+  return _peer != 0 && (now_ms - _peer_seen_ms) < _timeout_ms;
+}
+
+void GatewayElection::scheduleClaim(uint32_t base_ms) {
+  uint32_t at = base_ms + (uint32_t)_self * _stagger_ms;
+  // 0 means "none"; nudge rather than lose a claim due exactly at wrap-around
+  _claim_at_ms = at != 0 ? at : 1;
+}
+
+void GatewayElection::setEligible(bool eligible, uint32_t now_ms) {
+  if (eligible == _eligible) {
+    return;
+  }
+  _eligible = eligible;
+  if (eligible) {
+    _resign_pending = false;
+    if (!peerValid(now_ms) || _self < _peer) {
+      scheduleClaim(now_ms);
+    }
+  } else {
+    if (_claimed) {
+      _resign_pending = true;
+    }
+    _claimed = false;
+    _claim_at_ms = 0;
+  }
+}
+
+void GatewayElection::onHeartbeat(uint8_t number, bool up, uint32_t now_ms) {
+  if (number == 0 || number == _self) {
+    return;
+  }
+  if (!up) {
+    if (number == _peer) {
+      _peer = 0;
+      if (_eligible && !_claimed) {
+        scheduleClaim(now_ms);
+      }
+    }
+    return;
+  }
+  if (number == _peer || !peerValid(now_ms) || number < _peer) {
+    _peer = number;
+    _peer_seen_ms = now_ms;
+  }
+  if (_peer < _self) {
+    // a lower number is leading: stand by
+    _claimed = false;
+    _claim_at_ms = 0;
+  } else if (_eligible && !_claimed) {
+    // a higher number is leading while we're eligible: take over now
+    scheduleClaim(now_ms);
+  }
+}
+
+GatewayElection::Action GatewayElection::tick(uint32_t now_ms) {
+  if (_resign_pending) {
+    _resign_pending = false;
+    return Action::Resign;
+  }
+  if (!_eligible || _self == 0) {
+    return Action::None;
+  }
+  if (!_claimed) {
+    if (_claim_at_ms == 0 && !(peerValid(now_ms) && _peer < _self)) {
+      // leader went quiet: the stagger counts from when its heartbeat expired
+      scheduleClaim(_peer != 0 ? _peer_seen_ms + _timeout_ms : now_ms);
+    }
+    if (_claim_at_ms == 0 || (int32_t)(now_ms - _claim_at_ms) < 0) {
+      return Action::None;
+    }
+    _claim_at_ms = 0;
+    if (peerValid(now_ms) && _peer < _self) {
+      return Action::None;
+    }
+    _claimed = true;
+    _takeovers++;
+    _next_announce_ms = now_ms;
+  }
+  if ((int32_t)(now_ms - _next_announce_ms) >= 0) {
+    _next_announce_ms = now_ms + _heartbeat_ms;
+    return Action::Announce;
+  }
+  return Action::None;
+}
+
+bool GatewayElection::isLeader(uint32_t now_ms) const {
+  return _eligible && _claimed && !(peerValid(now_ms) && _peer < _self);
+}
+
+uint8_t GatewayElection::leader(uint32_t now_ms) const {
+  if (isLeader(now_ms)) {
+    return _self;
+  }
+  return peerValid(now_ms) ? _peer : 0;
+}
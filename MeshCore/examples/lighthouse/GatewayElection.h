@@ -0,0 +1,51 @@
+#pragma once
+
+#include <stdint.h>
+
+// Picks which WiFi-connected lighthouse relays help traffic to the bot: the lowest-numbered
+// eligible one that is heartbeating. Only the leader sends heartbeats, so the channel
+// carries one "HELP|GW|<n>|UP" per interval no matter how many gateways are standing by.
+//
+// When the leader resigns ("DOWN") or its heartbeat times out, eligible nodes claim after
+// a delay proportional to their number; the lowest claims first and everyone above hears
+// it before their own turn. A lower number becoming eligible claims straight away and
+// the current leader steps down on hearing it.
+// Arduino-free; the caller passes millis().
+class GatewayElection {
+public:
+  enum class Action : uint8_t {
+    None,
+    Announce,  // broadcast "GW|<self>|UP"
+    Resign     // broadcast "GW|<self>|DOWN"
+  };
+
+  GatewayElection(uint32_t heartbeat_ms, uint32_t timeout_ms, uint32_t stagger_ms);
+
+  void setSelf(uint8_t number) { _self = number; }
+  void setEligible(bool eligible, uint32_t now_ms);
+  void onHeartbeat(uint8_t number, bool up, uint32_t now_ms);
+  Action tick(uint32_t now_ms);
+
+  bool isEligible() const { return _eligible; }
+  bool isLeader(uint32_t now_ms) const;
+  // 0 when nobody is known to be leading
+  uint8_t leader(uint32_t now_ms) const;
+  uint32_t getTakeovers() const { return _takeovers; }
+
+private:
+  uint32_t _heartbeat_ms;
+  uint32_t _timeout_ms;
+  uint32_t _stagger_ms;
+  uint8_t _self;
+  bool _eligible;
+  bool _claimed;
+  bool _resign_pending;
+  uint8_t _peer;           // lowest remote leader heard, 0 if none
+  uint32_t _peer_seen_ms;
+  uint32_t _claim_at_ms;   // 0 = no claim scheduled
+  uint32_t _next_announce_ms;
+  uint32_t _takeovers;
+
+  bool peerValid(uint32_t now_ms) const;
+  void scheduleClaim(uint32_t base_ms);
+};
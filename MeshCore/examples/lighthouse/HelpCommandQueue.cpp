@@ -0,0 +1,100 @@
+#include "HelpCommandQueue.h"
+
+#include <string.h>
+
+namespace {
+// Next line of 'body' starting at 'pos', without its terminator or a trailing '\r'.
+// Returns false once the body is used up.
+bool next_line(const char *body, size_t len, size_t &pos, const char *&line, size_t &line_len) {
+  if (pos >= len) {
+    return false;
+  }
+  line = body + pos;
+  const char *end = (const char *)memchr(line, '\n', len - pos);
+  line_len = end ? (size_t)(end - line) : len - pos;
+  pos += line_len + (end ? 1 : 0);
+  if (line_len > 0 && line[line_len - 1] == '\r') {
+    line_len--;
+  }
+  return true;
+}
+}  // namespace
+
+HelpCommandQueue::HelpCommandQueue()
+  : _head(0),
+    _tail(0),
+    _rejected(0) {
+}
+
+uint32_t HelpCommandQueue::space() const {
+  uint32_t head = _head.load(std::memory_order_relaxed);
+  uint32_t tail = _tail.load(std::memory_order_acquire);
+  return kSlots - (head - tail);
+}
+
+uint32_t HelpCommandQueue::available() const {
+  uint32_t tail = _tail.load(std::memory_order_relaxed);
+  uint32_t head = _head.load(std::memory_order_acquire);
+  return head - tail;
+}
+
+HelpCommandQueue::Result HelpCommandQueue::pushLines(const char *body, size_t len, uint32_t *queued) {
+  if (queued) {
+    *queued = 0;
+  }
+  if (!body) {
+    return Result::Empty;
+  }
+
+  // validate and count first; the consumer only ever frees slots, so the space seen here holds
+  uint32_t count = 0;
+  size_t pos = 0;
+  const char *line;
+  size_t line_len;
+  while (next_line(body, len, pos, line, line_len)) {
+    if (line_len == 0) {
+      continue;
+    }
+    if (line_len > kLineMax) {
+      return Result::TooLong;
+    }
+    count++;
+  }
+  if (count == 0) {
+    return Result::Empty;
+  }
+  if (count > space()) {
+    _rejected.fetch_add(1, std::memory_order_relaxed);
+    return Result::Full;
+  }
+
+  uint32_t head = _head.load(std::memory_order_relaxed);
+  pos = 0;
+  while (next_line(body, len, pos, line, line_len)) {
+    if (line_len == 0) {
+      continue;
+    }
+    char *slot = _lines[head & (kSlots - 1)];
+    memcpy(slot, line, line_len);
+    slot[line_len] = '\0';
+    head++;
+  }
+  // publish the whole batch at once
+  _head.store(head, std::memory_order_release);
+  if (queued) {
+    *queued = count;
+  }
+  return Result::Ok;
+}
+
+bool HelpCommandQueue::pop(char *out, size_t out_len) {
+  if (available() == 0 || !out || out_len == 0) {
+    return false;
+  }
+  uint32_t tail = _tail.load(std::memory_order_relaxed);
+  const char *slot = _lines[tail & (kSlots - 1)];
+  strncpy(out, slot, out_len - 1);
+  out[out_len - 1] = '\0';
+  _tail.store(tail + 1, std::memory_order_release);
+  return true;
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+// Commands posted to the gateway, handed from the HTTP task to the mesh loop.
+// Single-producer / single-consumer and lock-free like PcmRing: the web server task only
+// moves _head, the mesh loop only moves _tail. Each slot holds one "HELP|..." line.
+class HelpCommandQueue {
+public:
+  static const uint32_t kSlots = 16;      // power of two
+  static const size_t kLineMax = 320;     // past MAX_TEXT_LEN (160) a line goes out in fragments
+
+  enum class Result : uint8_t {
+    Ok,
+    Empty,    // nothing but blank lines
+    TooLong,  // a line exceeds kLineMax
+    Full      // not enough free slots for the whole batch
+  };
+
+  HelpCommandQueue();
+
+  // producer side: queues every non-blank line of 'body' ('\n' or "\r\n" separated),
+  // all or nothing, so a batch is never half delivered.
+  Result pushLines(const char *body, size_t len, uint32_t *queued = nullptr);
+  uint32_t space() const;
+
+  // consumer side
+  bool pop(char *out, size_t out_len);
+  uint32_t available() const;
+
+  uint32_t getRejected() const { return _rejected.load(std::memory_order_relaxed); }
+
+private:
+  char _lines[kSlots][kLineMax + 1];
+  std::atomic<uint32_t> _head;  // total lines written
+  std::atomic<uint32_t> _tail;  // total lines read
+  std::atomic<uint32_t> _rejected;
+};
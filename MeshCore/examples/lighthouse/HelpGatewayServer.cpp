@@ -3,16 +3,29 @@
 #include "LighthouseMesh.h"
 
 #ifdef ESP32
-#include <WebServer.h>
+#include <AsyncTCP.h>
+#include <ESPAsyncWebServer.h>
 #include "secrets.h"
 #endif
 
+#ifndef HELP_GATEWAY_PORT
+#define HELP_GATEWAY_PORT 8081
+#endif
+
+#ifndef HELP_BOT_HTTP_PORT
+#define HELP_BOT_HTTP_PORT 8080
+#endif
+
 HelpGatewayServer::HelpGatewayServer()
   : _mesh(nullptr),
-    _enabled(false)
+    _enabled(false),
+    _next_send_ms(0),
+    _pacing_ms(0)
 #ifdef ESP32
     , _server(nullptr),
-    _token(nullptr)
+    _token(nullptr),
+    _bot_ip(0),
+    _applied_bot_ip(0)
 #endif
 {
 }
@@ -24,9 +37,6 @@ void HelpGatewayServer::begin(LighthouseMesh *mesh) {
   _token = HELP_BOT_TOKEN;
 #else
   _token = nullptr;
-#endif
-#ifndef HELP_GATEWAY_PORT
-#define HELP_GATEWAY_PORT 8081
 #endif
 
   if (_token == nullptr || _token[0] == '\0') {
@@ -35,12 +45,14 @@ void HelpGatewayServer::begin(LighthouseMesh *mesh) {
     return;
   }
 
-  _server = new WebServer(HELP_GATEWAY_PORT);
-#if defined(ESP32)
-  const char *header_keys[] = {"X-Help-Token"};
-  _server->collectHeaders(header_keys, 1);
-#endif
-  _server->on("/mesh", HTTP_POST, [this]() { this->handleMeshPost(); });
+  _server = new AsyncWebServer(HELP_GATEWAY_PORT);
+  _server->on(
+      "/mesh", HTTP_POST,
+      [this](AsyncWebServerRequest *request) { this->handleMeshPost(request); },
+      nullptr,
+      [this](AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total) {
+        this->handleMeshBody(request, data, len, index, total);
+      });
   _server->begin();
   _enabled = true;
   Serial.printf("HelpGatewayServer: listening on port %d\n", HELP_GATEWAY_PORT);
@@ -50,53 +62,105 @@ void HelpGatewayServer::begin(LighthouseMesh *mesh) {
 }
 
 void HelpGatewayServer::loop() {
+  if (!_enabled || !_mesh) {
+    return;
+  }
 #ifdef ESP32
-  if (_enabled && _server) {
-    _server->handleClient();
+  uint32_t bot_ip = _bot_ip.load(std::memory_order_relaxed);
+  if (bot_ip != 0 && bot_ip != _applied_bot_ip) {
+    _applied_bot_ip = bot_ip;
+    char url[96];
+    snprintf(url, sizeof(url), "http://%s:%d/mesh", IPAddress(bot_ip).toString().c_str(), HELP_BOT_HTTP_PORT);
+    _mesh->setHelpBotUrl(url);
   }
 #endif
+
+  unsigned long now = millis();
+  if ((long)(now - _next_send_ms) < 0 || _mesh->isSendingFragments()) {
+    return;
+  }
+  char line[HelpCommandQueue::kLineMax + 1];
+  if (!_queue.pop(line, sizeof(line))) {
+    return;
+  }
+  Serial.printf("HelpGatewayServer: sending %s (%u queued)\n", line, (unsigned int)_queue.available());
+  _mesh->sendHelpBroadcast(line);
+  _mesh->handleHelpPayload(line);
+  _pacing_ms = _mesh->getBroadcastPacingMs(line);
+  _next_send_ms = now + _pacing_ms;
 }
 
 bool HelpGatewayServer::isEnabled() const {
   return _enabled;
 }
 
-void HelpGatewayServer::handleMeshPost() {
 #ifdef ESP32
-  if (!_server) {
+void HelpGatewayServer::handleMeshBody(AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index,
+                                       size_t total) {
+  if (index == 0) {
+    // sized for a full queue of max-length lines; anything bigger is refused in handleMeshPost()
+    if (total == 0 || total > HelpCommandQueue::kSlots * (HelpCommandQueue::kLineMax + 2)) {
+      return;
+    }
+    request->_tempObject = calloc(total + 1, 1);  // freed with the request
+  }
+  char *body = (char *)request->_tempObject;
+  if (body == nullptr || index + len > total) {
     return;
   }
-#ifndef HELP_BOT_HTTP_PORT
-#define HELP_BOT_HTTP_PORT 8080
-#endif
+  memcpy(body + index, data, len);
+}
+
+void HelpGatewayServer::handleMeshPost(AsyncWebServerRequest *request) {
   if (_token && _token[0] != '\0') {
-    String header_token = _server->header("X-Help-Token");
+    String header_token = request->hasHeader("X-Help-Token") ? request->header("X-Help-Token") : String();
     if (header_token.length() == 0 || header_token != _token) {
       Serial.printf("HelpGatewayServer: unauthorized request (header len=%d, expected len=%u)\n",
                     header_token.length(), (unsigned int)strlen(_token));
-      _server->send(401, "text/plain", "unauthorized");
+      request->send(401, "text/plain", "unauthorized");
       return;
     }
   }
-  if (_mesh) {
-    IPAddress remote_ip = _server->client().remoteIP();
-    if (remote_ip != INADDR_NONE) {
-      char url[96];
-      snprintf(url, sizeof(url), "http://%s:%d/mesh", remote_ip.toString().c_str(), HELP_BOT_HTTP_PORT);
-      _mesh->setHelpBotUrl(url);
+  IPAddress remote_ip = request->client()->remoteIP();
+  if (remote_ip != INADDR_NONE) {
+    _bot_ip.store((uint32_t)remote_ip, std::memory_order_relaxed);
+  }
+
+  const char *body = (const char *)request->_tempObject;
+  if (body == nullptr) {
+    if (request->contentLength() > 0) {
+      request->send(413, "text/plain", "body too large");
+    } else {
+      Serial.println("HelpGatewayServer: missing body");
+      request->send(400, "text/plain", "missing body");
     }
+    return;
   }
-  String body = _server->arg("plain");
-  if (body.length() == 0) {
-    Serial.println("HelpGatewayServer: missing body");
-    _server->send(400, "text/plain", "missing body");
+
+  uint32_t queued = 0;
+  HelpCommandQueue::Result result = _queue.pushLines(body, strlen(body), &queued);
+  if (result == HelpCommandQueue::Result::Full) {
+    // roughly how long the mesh needs to drain what's already waiting
+    uint32_t wait_s = (_queue.available() * (_pacing_ms ? _pacing_ms : 1000) + 999) / 1000;
+    char retry_after[12];
+    snprintf(retry_after, sizeof(retry_after), "%lu", (unsigned long)(wait_s > 0 ? wait_s : 1));
+    AsyncWebServerResponse *response = request->beginResponse(429, "text/plain", "queue full");
+    response->addHeader("Retry-After", retry_after);
+    request->send(response);
+    Serial.printf("HelpGatewayServer: queue full, rejected (%lu total)\n", (unsigned long)_queue.getRejected());
     return;
   }
-  Serial.printf("HelpGatewayServer: received %s\n", body.c_str());
-  if (_mesh) {
-    _mesh->sendHelpBroadcast(body.c_str());
-    _mesh->handleHelpPayload(body.c_str());
+  if (result == HelpCommandQueue::Result::TooLong) {
+    request->send(413, "text/plain", "line too long");
+    return;
   }
-  _server->send(200, "text/plain", "ok");
-#endif
+  if (result == HelpCommandQueue::Result::Empty) {
+    Serial.println("HelpGatewayServer: missing body");
+    request->send(400, "text/plain", "missing body");
+    return;
+  }
+  char reply[24];
+  snprintf(reply, sizeof(reply), "queued %lu", (unsigned long)queued);
+  request->send(202, "text/plain", reply);
 }
+#endif
@@ -1,9 +1,14 @@
 #pragma once
 
 #include <Arduino.h>
+#include <atomic>
+#include "HelpCommandQueue.h"
 
 class LighthouseMesh;
 
+// Accepts "HELP|..." commands from the bot on POST /mesh, one per line.
+// The async web server only validates and queues; loop() feeds the queue into the mesh,
+// one line at a time, spaced by the airtime of the previous one.
 class HelpGatewayServer {
 public:
   HelpGatewayServer();
@@ -15,10 +20,16 @@ public:
 private:
   LighthouseMesh *_mesh;
   bool _enabled;
+  HelpCommandQueue _queue;
+  unsigned long _next_send_ms;
+  uint32_t _pacing_ms;  // last line's spacing, for Retry-After
 #ifdef ESP32
-  class WebServer *_server;
+  class AsyncWebServer *_server;
   const char *_token;
-#endif
+  std::atomic<uint32_t> _bot_ip;  // set by the web task, applied to the bot URL from loop()
+  uint32_t _applied_bot_ip;
 
-  void handleMeshPost();
+  void handleMeshBody(class AsyncWebServerRequest *request, uint8_t *data, size_t len, size_t index, size_t total);
+  void handleMeshPost(class AsyncWebServerRequest *request);
+#endif
 };
@@ -0,0 +1,273 @@
+#include "HelpProtocol.h"
+
+#include <string.h>
+
+namespace {
+struct HelpTypeEntry {
+  const char *name;
+  HelpMsgType type;
+};
+
+const HelpTypeEntry kHelpTypes[] = {
+  {"PING", HelpMsgType::Ping},
+  {"PONG", HelpMsgType::Pong},
+  {"AUDIO", HelpMsgType::Audio},
+  {"ANNOUNCE", HelpMsgType::Announce},
+  {"MAIL", HelpMsgType::Mail},
+  {"ACK", HelpMsgType::Ack},
+  {"DETAILS", HelpMsgType::Details},
+  {"REQ", HelpMsgType::Req},
+  {"CANCEL", HelpMsgType::Cancel},
+  {"CLAIM", HelpMsgType::Claim},
+  {"RESOLVE", HelpMsgType::Resolve},
+  {"GW", HelpMsgType::Gateway},
+  {"TIME", HelpMsgType::Time},
+};
+
+const HelpColor kHelpColors[] = {
+  {"RED", 255, 0, 0},
+  {"ORANGE", 255, 128, 0},
+  {"YELLOW", 255, 255, 0},
+  {"GREEN", 0, 200, 0},
+  {"BLUE", 0, 120, 255},
+  {"VIOLET", 160, 0, 255},
+};
+
+const char kHelpPrefix[] = "HELP|";
+const size_t kHelpPrefixLen = sizeof(kHelpPrefix) - 1;
+}  // namespace
+
+bool HelpSpan::equals(const char *str) const {
+  if (!str) {
+    return false;
+  }
+  return strncmp(ptr, str, len) == 0 && str[len] == '\0';
+}
+
+bool HelpSpan::equals(const HelpSpan &other) const {
+  return len == other.len && memcmp(ptr, other.ptr, len) == 0;
+}
+
+int HelpSpan::toInt() const {
+  int value = 0;
+  bool negative = false;
+  uint16_t i = 0;
+  while (i < len && (ptr[i] == ' ' || ptr[i] == '\t')) {
+    i++;
+  }
+  if (i < len && (ptr[i] == '-' || ptr[i] == '+')) {
+    negative = ptr[i] == '-';
+    i++;
+  }
+  for (; i < len && ptr[i] >= '0' && ptr[i] <= '9'; i++) {
+    value = value * 10 + (ptr[i] - '0');
+  }
+  return negative ? -value : value;
+}
+
+uint64_t HelpSpan::toUInt64() const {
+  uint64_t value = 0;
+  uint16_t i = 0;
+  while (i < len && (ptr[i] == ' ' || ptr[i] == '\t')) {
+    i++;
+  }
+  for (; i < len && ptr[i] >= '0' && ptr[i] <= '9'; i++) {
+    value = value * 10 + (uint64_t)(ptr[i] - '0');
+  }
+  return value;
+}
+
+size_t HelpSpan::copyTo(char *dest, size_t dest_len) const {
+  if (!dest || dest_len == 0) {
+    return 0;
+  }
+  size_t n = len < dest_len - 1 ? len : dest_len - 1;
+  memcpy(dest, ptr, n);
+  dest[n] = '\0';
+  return n;
+}
+
+HelpSpan HelpMessage::field(uint8_t idx) const {
+  if (idx < num_fields) {
+    return fields[idx];
+  }
+  HelpSpan none = {"", 0};
+  return none;
+}
+
+bool parseHelpMessage(const char *text, HelpMessage &out) {
+  if (!text) {
+    return false;
+  }
+  const char *payload = text;
+  if (strncmp(payload, kHelpPrefix, kHelpPrefixLen) != 0) {
+    payload = strstr(text, kHelpPrefix);
+    if (!payload) {
+      return false;
+    }
+  }
+
+  out.payload = payload;
+  out.type = HelpMsgType::Unknown;
+  out.type_name.ptr = "";
+  out.type_name.len = 0;
+  out.num_fields = 0;
+
+  const char *p = payload + kHelpPrefixLen;
+  bool have_type = false;
+  while (true) {
+    const char *end = strchr(p, '|');
+    size_t len = end ? (size_t)(end - p) : strlen(p);
+    HelpSpan span = {p, (uint16_t)len};
+    if (!have_type) {
+      out.type_name = span;
+      have_type = true;
+    } else if (out.num_fields < HelpMessage::kMaxFields) {
+      out.fields[out.num_fields++] = span;
+    } else {
+      break;
+    }
+    if (!end) {
+      break;
+    }
+    p = end + 1;
+  }
+  out.type = lookupHelpType(out.type_name);
+  return true;
+}
+
+HelpMsgType lookupHelpType(const HelpSpan &name) {
+  for (size_t i = 0; i < sizeof(kHelpTypes) / sizeof(kHelpTypes[0]); i++) {
+    if (name.equals(kHelpTypes[i].name)) {
+      return kHelpTypes[i].type;
+    }
+  }
+  return HelpMsgType::Unknown;
+}
+
+const char *helpTypeName(HelpMsgType type) {
+  for (size_t i = 0; i < sizeof(kHelpTypes) / sizeof(kHelpTypes[0]); i++) {
+    if (kHelpTypes[i].type == type) {
+      return kHelpTypes[i].name;
+    }
+  }
+  return "";
+}
+
+const HelpColor *lookupHelpColor(const char *name) {
+  if (!name) {
+    return NULL;
+  }
+  HelpSpan span = {name, (uint16_t)strlen(name)};
+  return lookupHelpColor(span);
+}
+
+const HelpColor *lookupHelpColor(const HelpSpan &name) {
+  if (name.empty()) {
+    return NULL;
+  }
+  for (size_t i = 0; i < sizeof(kHelpColors) / sizeof(kHelpColors[0]); i++) {
+    if (name.equals(kHelpColors[i].name)) {
+      return &kHelpColors[i];
+    }
+  }
+  return NULL;
+}
+
+size_t helpColorCount() {
+  return sizeof(kHelpColors) / sizeof(kHelpColors[0]);
+}
+
+const HelpColor &helpColorAt(size_t idx) {
+  return kHelpColors[idx % helpColorCount()];
+}
+
+HelpDirectLog::HelpDirectLog() : _head(0) {
+  memset(_keys, 0, sizeof(_keys));
+}
+
+uint32_t HelpDirectLog::key(const char *text) {
+  HelpMessage msg;
+  if (!parseHelpMessage(text, msg)) {
+    return 0;
+  }
+  uint32_t hash = 2166136261u;  // FNV-1a
+  for (const char *p = msg.payload; *p; ++p) {
+    hash = (hash ^ (uint8_t)*p) * 16777619u;
+  }
+  return hash != 0 ? hash : 1;
+}
+
+bool HelpDirectLog::add(const char *text) {
+  uint32_t k = key(text);
+  if (k == 0 || contains(text)) {
+    return false;
+  }
+  _keys[_head] = k;
+  _head = (uint8_t)((_head + 1) % kSize);
+  return true;
+}
+
+bool HelpDirectLog::contains(const char *text) const {
+  uint32_t k = key(text);
+  if (k == 0) {
+    return false;
+  }
+  for (uint8_t i = 0; i < kSize; ++i) {
+    if (_keys[i] == k) {
+      return true;
+    }
+  }
+  return false;
+}
+
+HelpRequestState::HelpRequestState() {
+  reset();
+}
+
+bool HelpRequestState::matches(const char *req_id) const {
+  return _state != State::Idle && req_id && strcmp(_request_id, req_id) == 0;
+}
+
+bool HelpRequestState::matches(const HelpSpan &req_id) const {
+  return _state != State::Idle && !req_id.empty() && req_id.equals(_request_id);
+}
+
+bool HelpRequestState::open(const char *req_id, const char *color_name) {
+  HelpSpan id = {req_id ? req_id : "", (uint16_t)(req_id ? strlen(req_id) : 0)};
+  HelpSpan color = {color_name ? color_name : "", (uint16_t)(color_name ? strlen(color_name) : 0)};
+  return open(id, color);
+}
+
+bool HelpRequestState::open(const HelpSpan &req_id, const HelpSpan &color_name) {
+  // a truncated id could never be claimed or closed again, so refuse it outright
+  if (_state != State::Idle || req_id.empty() || req_id.len >= sizeof(_request_id)) {
+    return false;
+  }
+  req_id.copyTo(_request_id, sizeof(_request_id));
+  color_name.copyTo(_color_name, sizeof(_color_name));
+  _state = State::Pending;
+  return true;
+}
+
+bool HelpRequestState::claim(const HelpSpan &req_id) {
+  if (!matches(req_id)) {
+    return false;
+  }
+  _state = State::Claimed;
+  return true;
+}
+
+bool HelpRequestState::close(const HelpSpan &req_id) {
+  if (!matches(req_id)) {
+    return false;
+  }
+  reset();
+  return true;
+}
+
+void HelpRequestState::reset() {
+  _state = State::Idle;
+  _request_id[0] = '\0';
+  _color_name[0] = '\0';
+}
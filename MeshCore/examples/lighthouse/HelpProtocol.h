@@ -0,0 +1,126 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Parsing and request-state helpers for the "HELP|<TYPE>|..." channel protocol.
+// Kept free of Arduino dependencies so it can be compiled and exercised on the host.
+
+enum class HelpMsgType : uint8_t {
+  Unknown,
+  Ping,
+  Pong,
+  Audio,
+  Announce,
+  Mail,
+  Ack,
+  Details,
+  Req,
+  Cancel,
+  Claim,
+  Resolve,
+  Gateway,
+  Time
+};
+
+// Non-owning view of one '|' separated field; never NUL terminated.
+struct HelpSpan {
+  const char *ptr;
+  uint16_t len;
+
+  bool empty() const { return len == 0; }
+  bool equals(const char *str) const;
+  bool equals(const HelpSpan &other) const;
+  int toInt() const;                              // atoi() semantics, stops at first non-digit
+  uint64_t toUInt64() const;                      // unsigned, for epoch timestamps; 0 if none
+  size_t copyTo(char *dest, size_t dest_len) const;  // always NUL terminates (truncates)
+};
+
+struct HelpMessage {
+  static const uint8_t kMaxFields = 8;
+
+  const char *payload;   // points at "HELP|..." inside the original text
+  HelpMsgType type;
+  HelpSpan type_name;
+  HelpSpan fields[kMaxFields];  // fields after the type
+  uint8_t num_fields;
+
+  // returns an empty span for missing fields, so handlers can treat both cases alike
+  HelpSpan field(uint8_t idx) const;
+};
+
+// Locates the "HELP|" prefix in 'text' and splits it in place, without copying or mutating.
+// Returns false if 'text' is not a help message at all.
+bool parseHelpMessage(const char *text, HelpMessage &out);
+
+HelpMsgType lookupHelpType(const HelpSpan &name);
+const char *helpTypeName(HelpMsgType type);
+
+struct HelpColor {
+  const char *name;
+  uint8_t r, g, b;
+};
+
+// Returns NULL for unknown/empty colour names.
+const HelpColor *lookupHelpColor(const char *name);
+const HelpColor *lookupHelpColor(const HelpSpan &name);
+size_t helpColorCount();
+const HelpColor &helpColorAt(size_t idx);
+
+// Commands the bot delivered straight over WiFi, so the channel flood it also sends as a fallback
+// isn't acted on twice. Keyed on the "HELP|..." payload, since the flood arrives as
+// "<sender>: HELP|...".
+class HelpDirectLog {
+public:
+  static const uint8_t kSize = 32;
+
+  HelpDirectLog();
+
+  // Records a direct delivery; false if it isn't a help message or was already seen (a bot retry).
+  bool add(const char *text);
+  // True if this command, direct or as channel text, was already delivered directly.
+  bool contains(const char *text) const;
+
+private:
+  uint32_t _keys[kSize];  // 0 = free
+  uint8_t _head;
+
+  static uint32_t key(const char *text);
+};
+
+// Tracks this lighthouse's own help request: Idle -> Pending -> Claimed -> Idle.
+class HelpRequestState {
+public:
+  enum class State : uint8_t {
+    Idle,
+    Pending,
+    Claimed
+  };
+
+  static const uint8_t kMaxRequestIdLen = 31;
+
+  HelpRequestState();
+
+  State state() const { return _state; }
+  bool isActive() const { return _state != State::Idle; }
+  bool isClaimed() const { return _state == State::Claimed; }
+  const char *requestId() const { return _request_id; }
+  const char *colorName() const { return _color_name; }
+  bool matches(const char *req_id) const;
+  bool matches(const HelpSpan &req_id) const;
+
+  // Idle -> Pending. Returns false (no change) if a request is already active, or the id is
+  // empty or longer than kMaxRequestIdLen.
+  bool open(const char *req_id, const char *color_name);
+  bool open(const HelpSpan &req_id, const HelpSpan &color_name);
+  // Pending -> Claimed, only for the active request id.
+  bool claim(const HelpSpan &req_id);
+  // Any -> Idle, only for the active request id.
+  bool close(const HelpSpan &req_id);
+  void reset();
+
+private:
+  State _state;
+  char _request_id[kMaxRequestIdLen + 1];
+  char _color_name[8];
+};
@@ -0,0 +1,38 @@
+#include "LevelMeter.h"
+
+LevelMeter::LevelMeter(float alpha)
+  : _alpha(alpha),
+    _level(0.0f) {
+}
+
+void LevelMeter::processBlock(const int16_t *stereo, uint32_t frames) {
+  if (stereo == nullptr || frames == 0) {
+    return;
+  }
+  int32_t peak = 0;
+  for (uint32_t i = 0; i < frames * 2; ++i) {
+    int32_t v = stereo[i];
+    if (v < 0) {
+      v = -v;
+    }
+    if (v > peak) {
+      peak = v;
+    }
+  }
+  float magnitude = (float)peak / 32768.0f;
+  float level = _level.load(std::memory_order_relaxed);
+  _level.store((level * (1.0f - _alpha)) + (magnitude * _alpha), std::memory_order_relaxed);
+}
+
+void LevelMeter::decay(float factor) {
+  float level = _level.load(std::memory_order_relaxed);
+  if (level <= 0.001f) {
+    return;
+  }
+  level *= factor;
+  _level.store(level < 0.001f ? 0.0f : level, std::memory_order_relaxed);
+}
+
+void LevelMeter::reset() {
+  _level.store(0.0f, std::memory_order_relaxed);
+}
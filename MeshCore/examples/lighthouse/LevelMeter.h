@@ -0,0 +1,20 @@
+#pragma once
+
+#include <atomic>
+#include <stdint.h>
+
+// Block peak meter with exponential smoothing. processBlock() runs on the decode side,
+// level() may be read from any task.
+class LevelMeter {
+public:
+  explicit LevelMeter(float alpha);
+
+  void processBlock(const int16_t *stereo, uint32_t frames);
+  void decay(float factor);
+  void reset();
+  float level() const { return _level.load(std::memory_order_relaxed); }
+
+private:
+  float _alpha;
+  std::atomic<float> _level;
+};
@@ -2,24 +2,30 @@
 #include "Amplifier.h"
 
 #ifdef ESP32
-#include <math.h>
 
 namespace {
-constexpr float kPi = 3.14159265f;
-constexpr uint16_t kToneCount = 2;
-constexpr float kTonesHz[kToneCount] = { 880.0f, 1174.7f };
-constexpr uint16_t kToneMs[kToneCount] = { 120, 180 };
-constexpr uint16_t kGapMs = 40;
+constexpr ChimeNote kMessageNotes[] = { { 880, 120 }, { 0, 40 }, { 1175, 180 }, { 0, 40 } };
+constexpr ChimeNote kClaimNotes[] = { { 784, 90 }, { 988, 90 }, { 1175, 200 } };
+constexpr ChimeNote kResolveNotes[] = { { 1175, 110 }, { 988, 110 }, { 1568, 320 } };
+constexpr ChimeNote kCancelNotes[] = { { 659, 140 }, { 0, 30 }, { 440, 260 } };
+
+constexpr ChimeEnvelope kBellEnvelope = { 5, 60, 160, 60 };
+constexpr ChimeEnvelope kSoftEnvelope = { 15, 40, 200, 80 };
+
+const ChimeScore kScores[] = {
+  { kMessageNotes, sizeof(kMessageNotes) / sizeof(kMessageNotes[0]), kBellEnvelope },
+  { kClaimNotes, sizeof(kClaimNotes) / sizeof(kClaimNotes[0]), kBellEnvelope },
+  { kResolveNotes, sizeof(kResolveNotes) / sizeof(kResolveNotes[0]), kBellEnvelope },
+  { kCancelNotes, sizeof(kCancelNotes) / sizeof(kCancelNotes[0]), kSoftEnvelope },
+};
 }
 
 LightChime::LightChime()
   : _initialized(false),
     _amplifier(nullptr),
-    _playing(false),
-    _tone_index(0),
-    _tone_elapsed_ms(0),
-    _phase(0.0f),
-    _last_sample_ms(0) {
+    _synth(CHIME_SAMPLE_RATE, CHIME_VOLUME),
+    _start_ms(0),
+    _samples_done(0) {
 }
 
 void LightChime::begin() {
@@ -30,99 +36,55 @@ void LightChime::begin() {
   _initialized = true;
 }
 
-void LightChime::playMessageChime() {
+void LightChime::play(ChimePattern pattern) {
   if (!_initialized) {
     return;
   }
-  _playing = true;
-  _tone_index = 0;
-  _tone_elapsed_ms = 0;
-  _phase = 0.0f;
-  _last_sample_ms = millis();
-}
-
-void LightChime::loop() {
-  if (!_initialized || !_playing) {
-    return;
-  }
-
-  uint32_t now = millis();
-  uint32_t elapsed_ms = now - _last_sample_ms;
-  if (elapsed_ms == 0) {
+  uint8_t idx = (uint8_t)pattern;
+  if (idx >= sizeof(kScores) / sizeof(kScores[0])) {
     return;
   }
+  _synth.start(&kScores[idx]);
+  _start_ms = millis();
+  _samples_done = 0;
+}
 
-  _last_sample_ms = now;
+void LightChime::playMessageChime() {
+  play(ChimePattern::Message);
+}
 
-  uint16_t samples = (uint16_t)((CHIME_SAMPLE_RATE * elapsed_ms) / 1000);
-  if (samples == 0) {
+void LightChime::loop() {
+  if (!_initialized || !_synth.isPlaying()) {
     return;
   }
 
-  while (samples > 0 && _playing) {
-    uint16_t batch = samples > kBufferSamples ? kBufferSamples : samples;
-    fillBuffer(batch);
-    _amplifier->writeMonoSamples(_buffer, batch);
-    samples -= batch;
-  }
-}
-
-void LightChime::fillBuffer(uint16_t samples) {
-  float freq = currentToneFreq();
-  bool silent = (freq <= 0.1f);
-  float phase_step = (2.0f * kPi * freq) / CHIME_SAMPLE_RATE;
-
-  for (uint16_t i = 0; i < samples; ++i) {
-    int16_t sample = 0;
-    if (!silent) {
-      float s = sinf(_phase) * CHIME_VOLUME;
-      sample = (int16_t)(s * 32767.0f);
-      _phase += phase_step;
-      if (_phase >= 2.0f * kPi) {
-        _phase -= 2.0f * kPi;
-      }
+  // Sample clock from the start of the chime, so no fraction of a sample is lost between calls.
+  uint32_t due = (uint32_t)(((uint64_t)(millis() - _start_ms) * CHIME_SAMPLE_RATE) / 1000);
+  uint32_t samples = due - _samples_done;
+
+  // The score advances by samples rendered, not wall time: catch up on everything that has
+  // elapsed, one buffer at a time, unless the amplifier stops taking samples.
+  while (samples > 0 && _synth.isPlaying()) {
+    uint16_t batch = samples > kBufferSamples ? kBufferSamples : (uint16_t)samples;
+    uint16_t rendered = _synth.render(_buffer, batch);
+    if (rendered == 0) {
+      break;
     }
-    _buffer[i] = sample;
-  }
-
-  uint16_t ms_advanced = (uint16_t)((samples * 1000) / CHIME_SAMPLE_RATE);
-  _tone_elapsed_ms += ms_advanced;
-  if (_tone_elapsed_ms >= currentToneDurationMs()) {
-    _tone_index++;
-    _tone_elapsed_ms = 0;
-    _phase = 0.0f;
-    if (_tone_index >= kToneCount * 2) {
-      _playing = false;
-      return;
+    size_t written = _amplifier->writeMonoSamples(_buffer, rendered);
+    _samples_done += rendered;
+    samples -= rendered;
+    if (written < rendered) {
+      break;
     }
   }
 }
 
-float LightChime::currentToneFreq() const {
-  if (_tone_index >= kToneCount * 2) {
-    return 0.0f;
-  }
-  if ((_tone_index % 2) == 1) {
-    return 0.0f;
-  }
-  return kTonesHz[_tone_index / 2];
-}
-
-uint16_t LightChime::currentToneDurationMs() const {
-  if (_tone_index >= kToneCount * 2) {
-    return 0;
-  }
-  if ((_tone_index % 2) == 1) {
-    return kGapMs;
-  }
-  return kToneMs[_tone_index / 2];
-}
-
 #else
 
 LightChime::LightChime() {}
 void LightChime::begin() {}
 void LightChime::loop() {}
+void LightChime::play(ChimePattern pattern) { (void)pattern; }
 void LightChime::playMessageChime() {}
 
 #endif
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <Arduino.h>
+#include "ChimeSynth.h"
 
 #ifndef CHIME_SAMPLE_RATE
 #define CHIME_SAMPLE_RATE 16000
@@ -10,29 +11,31 @@
 #define CHIME_VOLUME 0.4f
 #endif
 
+enum class ChimePattern : uint8_t {
+  Message,
+  Claim,
+  Resolve,
+  Cancel,
+};
+
 class LightChime {
 public:
   LightChime();
 
   void begin();
   void loop();
+  void play(ChimePattern pattern);
   void playMessageChime();
 
 private:
 #ifdef ESP32
   bool _initialized;
   class Amplifier *_amplifier;
-  bool _playing;
-  uint16_t _tone_index;
-  uint32_t _tone_elapsed_ms;
-  float _phase;
-  unsigned long _last_sample_ms;
+  ChimeSynth _synth;
+  unsigned long _start_ms;
+  uint32_t _samples_done;  // rendered and handed to the amplifier since _start_ms
 
   static const uint16_t kBufferSamples = 256;
   int16_t _buffer[kBufferSamples];
-
-  void fillBuffer(uint16_t samples);
-  float currentToneFreq() const;
-  uint16_t currentToneDurationMs() const;
 #endif
 };
@@ -2,6 +2,7 @@
 
 #include <Arduino.h>
 #include <Adafruit_NeoPixel.h>
+#include "RingCompositor.h"
 
 #ifndef LIGHT_RING_PIN
 #define LIGHT_RING_PIN 48
@@ -11,6 +12,16 @@
 #define LIGHT_RING_COUNT 12
 #endif
 
+// Upper bound on show() calls; frames are only pushed when they change.
+#ifndef LIGHT_RING_MAX_FPS
+#define LIGHT_RING_MAX_FPS 50
+#endif
+
+// 1.0 keeps colours as specified; ~2.2 gives perceptually even fades but darkens dim colours.
+#ifndef LIGHT_RING_GAMMA
+#define LIGHT_RING_GAMMA 1.0f
+#endif
+
 class LightRing {
 public:
   LightRing();
@@ -26,6 +37,8 @@ public:
   void setPulseColor(uint8_t r, uint8_t g, uint8_t b);
   void setPulseDuration(uint16_t millis);
   void setAudioLevel(float level);
+  // Per-LED band levels (0-255); shown instead of the flat audio level while any band is lit.
+  void setSpectrum(const uint8_t *bands, uint8_t count);
   void setBlinking(bool enabled, uint8_t r = 255, uint8_t g = 255, uint8_t b = 255, uint16_t interval_ms = 500);
   void setOrbiting(bool enabled, uint16_t interval_ms);
 
@@ -37,40 +50,45 @@ private:
   };
 
   Adafruit_NeoPixel _pixels;
-  uint32_t _pulse_color;
+  RingCompositor _compositor;
+  unsigned long _last_frame_ms;
+  RingPixel _pulse_color;
   uint16_t _pulse_duration_ms;
   unsigned long _pulse_start_ms;
   bool _pulse_active;
   Mode _mode;
-  uint32_t _spin_color;
+  RingPixel _spin_color;
   uint16_t _spin_interval_ms;
   unsigned long _last_spin_ms;
   uint16_t _spin_index;
-  uint32_t _status_color;
+  RingPixel _status_color;
   uint16_t _status_duration_ms;
   unsigned long _status_start_ms;
-  uint32_t _idle_color;
+  RingPixel _idle_color;
   bool _idle_enabled;
-  bool _idle_dirty;
   float _audio_level;
   bool _audio_active;
-  bool _audio_dirty;
+  uint8_t _spectrum[LIGHT_RING_COUNT];
+  bool _spectrum_active;
   bool _blink_active;
   bool _blink_on;
-  uint32_t _blink_color;
+  RingPixel _blink_color;
   uint16_t _blink_interval_ms;
   unsigned long _blink_last_ms;
-  bool _blink_dirty;
   bool _orbit_active;
   uint16_t _orbit_interval_ms;
   unsigned long _orbit_last_ms;
   uint16_t _orbit_index;
 
-  void applyPulse(uint16_t elapsed_ms);
-  void applySpin();
-  void applyStatus();
-  void applyIdle();
-  void applyAudio();
-  void applyBlink();
-  void applyOrbit();
+  void advance(unsigned long now);
+  void renderFrame(unsigned long now);
+  // layers, bottom to top
+  void drawIdle();
+  void drawSpin();
+  void drawPulse(unsigned long now);
+  void drawStatus();
+  void drawOrbit();
+  void drawAudio();
+  void drawSpectrum();
+  void drawBlink();
 };
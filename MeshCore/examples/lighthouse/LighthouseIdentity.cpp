@@ -0,0 +1,213 @@
+#include "LighthouseIdentity.h"
+
+#ifdef ESP32
+#include <Preferences.h>
+#endif
+
+namespace {
+const char *kPrefsNamespace = "lighthouse";
+const char *kCommand = "LHCFG";
+
+bool is_separator(char c) {
+  return c == ' ' || c == '|' || c == '\t' || c == '\r' || c == '\n';
+}
+
+// next separator-delimited token of 'text' starting at *pos; false at end
+bool next_token(const char *text, size_t *pos, const char **start, size_t *len) {
+  size_t i = *pos;
+  while (text[i] != '\0' && is_separator(text[i])) {
+    i++;
+  }
+  if (text[i] == '\0') {
+    *pos = i;
+    return false;
+  }
+  *start = &text[i];
+  while (text[i] != '\0' && !is_separator(text[i])) {
+    i++;
+  }
+  *len = (size_t)(&text[i] - *start);
+  *pos = i;
+  return true;
+}
+
+bool parse_uint(const char *text, size_t len, uint32_t *out) {
+  if (len == 0 || len > 9) {
+    return false;
+  }
+  uint32_t value = 0;
+  for (size_t i = 0; i < len; ++i) {
+    if (text[i] < '0' || text[i] > '9') {
+      return false;
+    }
+    value = value * 10 + (uint32_t)(text[i] - '0');
+  }
+  *out = value;
+  return true;
+}
+
+bool key_is(const char *token, size_t key_len, const char *key) {
+  return strlen(key) == key_len && strncmp(token, key, key_len) == 0;
+}
+}
+
+LighthouseIdentity::LighthouseIdentity()
+  : _number(LIGHTHOUSE_NUMBER <= kMaxNumber ? LIGHTHOUSE_NUMBER : 0),
+#ifdef BLE_PIN_CODE
+    _pin(BLE_PIN_CODE),
+#else
+    _pin(0),
+#endif
+    _custom_name(false) {
+  deriveName();
+}
+
+void LighthouseIdentity::begin() {
+#ifdef ESP32
+  Preferences prefs;
+  if (!prefs.begin(kPrefsNamespace, true)) {
+    Serial.println("Identity: NVS unavailable, using build defaults");
+    return;
+  }
+  uint8_t number = prefs.getUChar("number", _number);
+  if (number <= kMaxNumber) {
+    _number = number;
+  }
+  _pin = prefs.getUInt("pin", _pin);
+  char name[kMaxName] = {};
+  if (prefs.getString("name", name, sizeof(name)) > 0 && name[0] != '\0') {
+    strncpy(_name, name, sizeof(_name) - 1);
+    _name[sizeof(_name) - 1] = '\0';
+    _custom_name = true;
+  }
+  prefs.end();
+#endif
+  deriveName();
+  if (!isProvisioned()) {
+    Serial.println("Identity: not provisioned; send \"LHCFG number=N\" over serial");
+  }
+}
+
+bool LighthouseIdentity::applyConfig(const char *fields, char *reply, size_t reply_len) {
+  uint8_t number = _number;
+  uint32_t pin = _pin;
+  bool custom_name = _custom_name;
+  char name[kMaxName];
+  strncpy(name, _name, sizeof(name));
+
+  size_t pos = 0;
+  const char *token;
+  size_t len;
+  while (next_token(fields, &pos, &token, &len)) {
+    const char *eq = (const char *)memchr(token, '=', len);
+    if (eq == nullptr) {
+      snprintf(reply, reply_len, "LHCFG error: expected key=value, got %.*s", (int)len, token);
+      return false;
+    }
+    size_t key_len = (size_t)(eq - token);
+    const char *value = eq + 1;
+    size_t value_len = len - key_len - 1;
+    uint32_t parsed = 0;
+    if (key_is(token, key_len, "number")) {
+      if (!parse_uint(value, value_len, &parsed) || parsed < 1 || parsed > kMaxNumber) {
+        snprintf(reply, reply_len, "LHCFG error: number must be 1-%u", (unsigned)kMaxNumber);
+        return false;
+      }
+      number = (uint8_t)parsed;
+    } else if (key_is(token, key_len, "pin")) {
+      if (!parse_uint(value, value_len, &parsed) || parsed < 100000 || parsed > 999999) {
+        snprintf(reply, reply_len, "LHCFG error: pin must be 6 digits");
+        return false;
+      }
+      pin = parsed;
+    } else if (key_is(token, key_len, "name")) {
+      if (value_len >= sizeof(name)) {
+        snprintf(reply, reply_len, "LHCFG error: name longer than %u", (unsigned)(sizeof(name) - 1));
+        return false;
+      }
+      // an empty name goes back to "Lighthouse-N"
+      memcpy(name, value, value_len);
+      name[value_len] = '\0';
+      custom_name = value_len > 0;
+    } else {
+      snprintf(reply, reply_len, "LHCFG error: unknown key %.*s", (int)key_len, token);
+      return false;
+    }
+  }
+
+  _number = number;
+  _pin = pin;
+  _custom_name = custom_name;
+  if (_custom_name) {
+    strncpy(_name, name, sizeof(_name));
+  }
+  deriveName();
+  if (!save()) {
+    snprintf(reply, reply_len, "LHCFG error: could not write NVS");
+    return false;
+  }
+  describe(reply, reply_len);
+  return true;
+}
+
+bool LighthouseIdentity::handleCommand(const char *line, char *reply, size_t reply_len, bool *reboot) {
+  if (reboot) {
+    *reboot = false;
+  }
+  size_t cmd_len = strlen(kCommand);
+  if (line == nullptr || strncmp(line, kCommand, cmd_len) != 0 ||
+      (line[cmd_len] != '\0' && !is_separator(line[cmd_len]))) {
+    return false;
+  }
+  const char *rest = line + cmd_len;
+  size_t pos = 0;
+  const char *token;
+  size_t len;
+  if (!next_token(rest, &pos, &token, &len)) {
+    describe(reply, reply_len);
+    return true;
+  }
+  if (len == 6 && strncmp(token, "reboot", 6) == 0) {
+    snprintf(reply, reply_len, "LHCFG rebooting");
+    if (reboot) {
+      *reboot = true;
+    }
+    return true;
+  }
+  if (applyConfig(rest, reply, reply_len)) {
+    size_t used = strlen(reply);
+    snprintf(reply + used, reply_len - used, " (saved; LHCFG reboot to apply)");
+  }
+  return true;
+}
+
+void LighthouseIdentity::describe(char *out, size_t out_len) const {
+  snprintf(out, out_len, "LHCFG number=%u pin=%lu name=%s",
+           (unsigned)_number, (unsigned long)_pin, _name);
+}
+
+bool LighthouseIdentity::save() {
+#ifdef ESP32
+  Preferences prefs;
+  if (!prefs.begin(kPrefsNamespace, false)) {
+    return false;
+  }
+  bool ok = prefs.putUChar("number", _number) > 0;
+  ok = ok && prefs.putUInt("pin", _pin) > 0;
+  if (_custom_name) {
+    ok = ok && prefs.putString("name", _name) > 0;
+  } else {
+    prefs.remove("name");
+  }
+  prefs.end();
+  return ok;
+#else
+  return false;
+#endif
+}
+
+void LighthouseIdentity::deriveName() {
+  if (!_custom_name) {
+    snprintf(_name, sizeof(_name), "Lighthouse-%d", _number);
+  }
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <Arduino.h>
+#include "global_configs.h"
+
+// Per-unit identity: lighthouse number, BLE PIN and node name. Kept in NVS so a single
+// firmware image serves every lighthouse. Provisioned with a text command,
+//   LHCFG number=7 pin=123456 name=Dock-East
+// over USB serial, the BLE link or the registration UDP channel; a bare "LHCFG" prints
+// the current values and "LHCFG reboot" restarts to apply them.
+class LighthouseIdentity {
+public:
+  static const uint8_t kMaxNumber = 30;
+  static const size_t kMaxName = 32;
+
+  LighthouseIdentity();
+
+  // Load from NVS; anything missing falls back to the LIGHTHOUSE_NUMBER / BLE_PIN_CODE build defaults.
+  void begin();
+
+  bool isProvisioned() const { return _number != 0; }
+  uint8_t number() const { return _number; }
+  uint32_t blePin() const { return _pin; }
+  const char *name() const { return _name; }
+
+  // Apply space- or '|'-separated key=value fields and persist them. All-or-nothing:
+  // on a bad field nothing changes and 'reply' says why.
+  bool applyConfig(const char *fields, char *reply, size_t reply_len);
+  // Handles one "LHCFG ..." line. Returns false if 'line' isn't an LHCFG command.
+  bool handleCommand(const char *line, char *reply, size_t reply_len, bool *reboot);
+  void describe(char *out, size_t out_len) const;
+
+private:
+  uint8_t _number;
+  uint32_t _pin;
+  bool _custom_name;
+  char _name[kMaxName];
+
+  bool save();
+  void deriveName();
+};
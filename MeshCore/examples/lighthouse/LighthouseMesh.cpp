@@ -1,9 +1,11 @@
 #include "LighthouseMesh.h"
 #include "LightRing.h"
 #include "LightChime.h"
+#include "LighthouseIdentity.h"
 #include "AudioStreamer.h"
 #include "DiscordServer.h"
 #include "HelpBotClient.h"
+#include "HelpCommandQueue.h"
 #include "global_configs.h"
 #include <Arduino.h>
 #include <Mesh.h>
@@ -11,15 +13,43 @@
 #include <helpers/StaticPoolPacketManager.h>
 #ifdef ESP32
 #include <WiFi.h>
+#include <esp_timer.h>
 #endif
 
-#ifndef LIGHTHOUSE_NUMBER
-#error "LIGHTHOUSE_NUMBER must be defined (1-30)"
+namespace {
+// Scheduled playback outside this window is stale or bogus.
+const int64_t kScheduleMaxLateUs = 60LL * 1000 * 1000;
+const int64_t kScheduleMaxLeadUs = 10LL * 60 * 1000 * 1000;
+
+// The timebase SyncClock and AudioStreamer::playAt() share.
+int64_t local_micros() {
+#ifdef ESP32
+  return esp_timer_get_time();
+#else
+  return (int64_t)micros();
 #endif
+}
+
+// local_micros() at the radio's last TX-done / RX-done interrupt, so beacon stamps don't carry the
+// loop's polling delay. Falls back to now if the radio doesn't stamp, or the stamp isn't this event.
+int64_t radio_event_micros(const mesh::Radio *radio) {
+  int64_t now = local_micros();
+  uint32_t irq = radio->getLastIrqMicros();
+  uint32_t age = (uint32_t)micros() - irq;
+  return irq != 0 && age < 1000000 ? now - age : now;
+}
+}  // namespace
 
 LighthouseMesh::LighthouseMesh(mesh::Radio &radio, mesh::RNG &rng, mesh::RTCClock &rtc, SimpleMeshTables &tables)
-    : BaseChatMesh(radio, *new ArduinoMillis(), rng, rtc, *new StaticPoolPacketManager(16), tables) {
+    : BaseChatMesh(radio, *new ArduinoMillis(), rng, rtc, *new StaticPoolPacketManager(16), tables)
+#ifdef WITH_UDP_BRIDGE
+      , _bridge(&_bridge_prefs, _mgr, &rtc)
+#endif
+      , _gateway(GATEWAY_HEARTBEAT_MS, GATEWAY_TIMEOUT_MS, GATEWAY_CLAIM_STAGGER_MS)
+      , _sync_clock(SYNC_MAX_AGE_MS)
+{
   _serial = NULL;
+  setFragmentPool(&_fragments);
   _lighthouse_channel = NULL;
   _light_ring = NULL;
   _light_chime = NULL;
@@ -27,10 +57,6 @@ LighthouseMesh::LighthouseMesh(mesh::Radio &radio, mesh::RNG &rng, mesh::RTCCloc
   _discord_server = NULL;
   _help_bot_client = NULL;
   _last_button_send = 0;
-  _active_ble_pin = 0;
-  _help_state = HelpState::Idle;
-  _active_request_id[0] = '\0';
-  _help_color_name[0] = '\0';
   _request_seq = 0;
   _announcement_active = false;
   _announcement_acknowledged = false;
@@ -56,9 +82,41 @@ LighthouseMesh::LighthouseMesh(mesh::Radio &radio, mesh::RNG &rng, mesh::RTCCloc
   for (uint8_t i = 0; i < kAckCacheSize; ++i) {
     _ack_cache[i][0] = '\0';
   }
-  
-  // Create node name based on lighthouse number
-  sprintf(_node_name, "Lighthouse-%d", LIGHTHOUSE_NUMBER);
+  for (uint8_t i = 0; i < kGatewayBackupSlots; ++i) {
+    _gateway_backup[i].due_ms = 0;
+  }
+  _gateway_leader = 0;
+  _scheduled_url[0] = '\0';
+  _scheduled_start_us = 0;
+  _scheduled_armed = false;
+  _scheduled_announce = false;
+  _beacon_seq = 0;
+  _beacon_tx_epoch_us = 0;
+  _beacon_hash_pending = false;
+  _beacon_hash_valid = false;
+  _next_beacon_ms = 0;
+  _beacon_from = 0;
+  _beacon_rx_seq = 0;
+  _beacon_rx_us = 0;
+  memset(_rx_stamps, 0, sizeof(_rx_stamps));
+  _rx_stamp_head = 0;
+  _current_rx_us = 0;
+  _lighthouse_number = 0;
+  strcpy(_node_name, "Lighthouse");
+#ifdef WITH_UDP_BRIDGE
+  // the bridge only reads delay and secret from prefs
+  memset(&_bridge_prefs, 0, sizeof(_bridge_prefs));
+  _bridge_prefs.bridge_delay = 0;
+  StrHelper::strncpy(_bridge_prefs.bridge_secret, LIGHTHOUSE_BRIDGE_SECRET, sizeof(_bridge_prefs.bridge_secret));
+  _bridge_retry_ms = 0;
+#endif
+}
+
+void LighthouseMesh::setIdentity(const LighthouseIdentity &identity) {
+  _lighthouse_number = identity.number();
+  _gateway.setSelf(_lighthouse_number);
+  strncpy(_node_name, identity.name(), sizeof(_node_name) - 1);
+  _node_name[sizeof(_node_name) - 1] = '\0';
 }
 
 void LighthouseMesh::begin() {
@@ -70,7 +128,7 @@ void LighthouseMesh::begin() {
   if (_lighthouse_channel == NULL) {
     Serial.println("ERROR: Failed to create lighthouse channel");
   } else {
-    Serial.printf("Lighthouse #%d: Channel created successfully\n", LIGHTHOUSE_NUMBER);
+    Serial.printf("Lighthouse #%d: Channel created successfully\n", _lighthouse_number);
   }
 }
 
@@ -106,11 +164,129 @@ void LighthouseMesh::setHelpBotUrl(const char *url) {
 }
 
 void LighthouseMesh::loop() {
+#ifdef WITH_UDP_BRIDGE
+  updateBridge();
+#endif
   mesh::Mesh::loop();
+  updateGateway();
+  updateTimeSync();
+  updateScheduledPlayback();
   updateAnnouncement();
   updateMailbox();
 }
 
+void LighthouseMesh::setGatewayEligible(bool eligible) {
+  _gateway.setEligible(eligible, millis());
+}
+
+bool LighthouseMesh::isGatewayLeader() const {
+  return _gateway.isLeader(millis());
+}
+
+uint8_t LighthouseMesh::getGatewayLeader() const {
+  return _gateway.leader(millis());
+}
+
+void LighthouseMesh::updateGateway() {
+  unsigned long now = millis();
+  GatewayElection::Action action = _gateway.tick(now);
+  if (action == GatewayElection::Action::Announce) {
+    sendGatewayHeartbeat(true);
+  } else if (action == GatewayElection::Action::Resign) {
+    sendGatewayHeartbeat(false);
+  }
+
+  uint8_t leader = _gateway.leader(now);
+  if (leader != _gateway_leader) {
+    Serial.printf("Help relay: gateway leader %d -> %d\n", _gateway_leader, leader);
+    _gateway_leader = leader;
+  }
+
+  for (uint8_t i = 0; i < kGatewayBackupSlots; ++i) {
+    GatewayBackup &backup = _gateway_backup[i];
+    if (backup.due_ms == 0 || (long)(now - backup.due_ms) < 0) {
+      continue;
+    }
+    backup.due_ms = 0;
+    char ack_key[40];
+    snprintf(ack_key, sizeof(ack_key), "%s|%s", backup.type, backup.req_id);
+    if (!isAcked(ack_key) && _gateway.isEligible()) {
+      Serial.printf("Help relay: no ACK for %s, posting as backup\n", ack_key);
+      postHelpMessage(backup.type, backup.req_id, backup.text);
+    }
+  }
+}
+
+void LighthouseMesh::queueGatewayBackup(const char *type, const char *req_id, const char *text) {
+  GatewayBackup *slot = NULL;
+  for (uint8_t i = 0; i < kGatewayBackupSlots; ++i) {
+    GatewayBackup &backup = _gateway_backup[i];
+    if (backup.due_ms != 0 && strcmp(backup.type, type) == 0 && strcmp(backup.req_id, req_id) == 0) {
+      return;
+    }
+    if (!slot || (slot->due_ms != 0 && (backup.due_ms == 0 || (long)(backup.due_ms - slot->due_ms) < 0))) {
+      slot = &backup;  // first free slot, else the one due soonest
+    }
+  }
+  // spread standbys out so the first one's ACK stops the rest
+  uint8_t leader = _gateway.leader(millis());
+  uint8_t rank = leader != 0 && leader < _lighthouse_number ? _lighthouse_number - leader : _lighthouse_number;
+  strncpy(slot->type, type, sizeof(slot->type) - 1);
+  slot->type[sizeof(slot->type) - 1] = '\0';
+  strncpy(slot->req_id, req_id, sizeof(slot->req_id) - 1);
+  slot->req_id[sizeof(slot->req_id) - 1] = '\0';
+  strncpy(slot->text, text, sizeof(slot->text) - 1);
+  slot->text[sizeof(slot->text) - 1] = '\0';
+  unsigned long due = millis() + GATEWAY_BACKUP_DELAY_MS + (unsigned long)rank * GATEWAY_CLAIM_STAGGER_MS;
+  slot->due_ms = due != 0 ? due : 1;
+}
+
+void LighthouseMesh::updateWallClock(int64_t epoch_us, int64_t local_us) {
+  _sync_clock.updateSntp(epoch_us, local_us);
+}
+
+SyncClock::Source LighthouseMesh::getSyncSource() const {
+  return _sync_clock.source(local_micros());
+}
+
+uint32_t LighthouseMesh::getSyncSpreadUs() const {
+  return _sync_clock.getSpreadUs(local_micros());
+}
+
+void LighthouseMesh::updateTimeSync() {
+  // only an SNTP-disciplined leader beacons, so beacon time never derives from beacon time
+  if (_lighthouse_channel == NULL || !_gateway.isLeader(millis()) ||
+      _sync_clock.source(local_micros()) != SyncClock::Source::Sntp) {
+    return;
+  }
+  unsigned long now = millis();
+  if (_next_beacon_ms != 0 && (long)(now - _next_beacon_ms) < 0) {
+    return;
+  }
+  _next_beacon_ms = now + SYNC_BEACON_INTERVAL_MS;
+
+  uint32_t timestamp = getRTCClock()->getCurrentTime();
+  char message[64];
+  snprintf(message, sizeof(message), "HELP|TIME|%d|%lu|%llu", _lighthouse_number,
+           (unsigned long)(_beacon_seq + 1), (unsigned long long)_beacon_tx_epoch_us);
+  _beacon_seq++;
+  _beacon_tx_epoch_us = 0;
+  _beacon_hash_valid = false;
+  _beacon_hash_pending = true;  // sendFloodScoped() notes the packet so logTx() can stamp it
+  sendGroupMessage(timestamp, _lighthouse_channel->channel, _node_name, message, strlen(message));
+  _beacon_hash_pending = false;
+}
+
+void LighthouseMesh::sendGatewayHeartbeat(bool up) {
+  if (_lighthouse_channel == NULL) {
+    return;
+  }
+  uint32_t timestamp = getRTCClock()->getCurrentTime();
+  char message[32];
+  snprintf(message, sizeof(message), "HELP|GW|%d|%s", _lighthouse_number, up ? "UP" : "DOWN");
+  sendGroupMessage(timestamp, _lighthouse_channel->channel, _node_name, message, strlen(message));
+}
+
 bool LighthouseMesh::sendButtonPressMessage() {
   unsigned long now = millis();
   
@@ -125,19 +301,19 @@ bool LighthouseMesh::sendButtonPressMessage() {
   
   // Create message: "Lighthouse <NUMBER>: Button Pressed"
   char message[64];
-  sprintf(message, "Lighthouse %d: Button Pressed", LIGHTHOUSE_NUMBER);
+  sprintf(message, "Lighthouse %d: Button Pressed", _lighthouse_number);
   
   uint32_t timestamp = getRTCClock()->getCurrentTime();
   bool success = sendGroupMessage(timestamp, _lighthouse_channel->channel, _node_name, message, strlen(message));
   
   if (success) {
     _last_button_send = now;
-    Serial.printf("Lighthouse #%d: Sent button press message\n", LIGHTHOUSE_NUMBER);
+    Serial.printf("Lighthouse #%d: Sent button press message\n", _lighthouse_number);
     if (_discord_server) {
       _discord_server->sendChannelMessage(message);
     }
   } else {
-    Serial.printf("Lighthouse #%d: Failed to send button press message\n", LIGHTHOUSE_NUMBER);
+    Serial.printf("Lighthouse #%d: Failed to send button press message\n", _lighthouse_number);
   }
   
   return success;
@@ -145,7 +321,7 @@ bool LighthouseMesh::sendButtonPressMessage() {
 
 bool LighthouseMesh::requestHelp(const char *color_name) {
   unsigned long now = millis();
-  if (_help_state != HelpState::Idle) {
+  if (_help_request.isActive()) {
     return false;
   }
   if (now - _last_button_send < BUTTON_SEND_COOLDOWN_MS_VALUE) {
@@ -157,41 +333,36 @@ bool LighthouseMesh::requestHelp(const char *color_name) {
 
   uint32_t timestamp = getRTCClock()->getCurrentTime();
   _request_seq++;
-  snprintf(_active_request_id, sizeof(_active_request_id), "LH%02d-%lu-%u",
-           LIGHTHOUSE_NUMBER, (unsigned long)timestamp, _request_seq);
-  if (color_name && color_name[0] != '\0') {
-    strncpy(_help_color_name, color_name, sizeof(_help_color_name) - 1);
-    _help_color_name[sizeof(_help_color_name) - 1] = '\0';
-  } else {
-    _help_color_name[0] = '\0';
-  }
+  char req_id[32];
+  snprintf(req_id, sizeof(req_id), "LH%02d-%lu-%u",
+           _lighthouse_number, (unsigned long)timestamp, _request_seq);
 
   char message[96];
-  if (_help_color_name[0] != '\0') {
+  if (color_name && color_name[0] != '\0') {
     snprintf(message, sizeof(message), "HELP|REQ|%s|%d|%lu|%s",
-             _active_request_id, LIGHTHOUSE_NUMBER, (unsigned long)timestamp, _help_color_name);
+             req_id, _lighthouse_number, (unsigned long)timestamp, color_name);
   } else {
     snprintf(message, sizeof(message), "HELP|REQ|%s|%d|%lu",
-             _active_request_id, LIGHTHOUSE_NUMBER, (unsigned long)timestamp);
+             req_id, _lighthouse_number, (unsigned long)timestamp);
   }
 
   bool success = sendGroupMessage(timestamp, _lighthouse_channel->channel, _node_name, message, strlen(message));
   if (success) {
-    _help_state = HelpState::Pending;
+    _help_request.open(req_id, color_name);
     _last_button_send = now;
-    Serial.printf("Lighthouse #%d: Help requested (%s)\n", LIGHTHOUSE_NUMBER, _active_request_id);
-    forwardHelpMessage("REQ", _active_request_id, message);
+    Serial.printf("Lighthouse #%d: Help requested (%s)\n", _lighthouse_number, req_id);
+    forwardHelpMessage("REQ", req_id, message);
     if (_light_ring) {
       _light_ring->setOrbiting(true, HELP_ORBIT_INTERVAL_MS);
     }
   } else {
-    Serial.printf("Lighthouse #%d: Failed to send help request\n", LIGHTHOUSE_NUMBER);
+    Serial.printf("Lighthouse #%d: Failed to send help request\n", _lighthouse_number);
   }
   return success;
 }
 
 bool LighthouseMesh::cancelHelp() {
-  if (_help_state == HelpState::Idle || _active_request_id[0] == '\0') {
+  if (!_help_request.isActive()) {
     return false;
   }
   if (_lighthouse_channel == NULL) {
@@ -201,30 +372,26 @@ bool LighthouseMesh::cancelHelp() {
   uint32_t timestamp = getRTCClock()->getCurrentTime();
   char message[96];
   snprintf(message, sizeof(message), "HELP|CANCEL|%s|%d|%lu",
-           _active_request_id, LIGHTHOUSE_NUMBER, (unsigned long)timestamp);
+           _help_request.requestId(), _lighthouse_number, (unsigned long)timestamp);
 
   bool success = sendGroupMessage(timestamp, _lighthouse_channel->channel, _node_name, message, strlen(message));
   if (success) {
-    Serial.printf("Lighthouse #%d: Help canceled (%s)\n", LIGHTHOUSE_NUMBER, _active_request_id);
-    forwardHelpMessage("CANCEL", _active_request_id, message);
-    _help_state = HelpState::Idle;
-    _active_request_id[0] = '\0';
-    _help_color_name[0] = '\0';
-    if (_light_ring) {
-      _light_ring->setIdleColor(LIGHTHOUSE_IDLE_R, LIGHTHOUSE_IDLE_G, LIGHTHOUSE_IDLE_B);
-    }
+    Serial.printf("Lighthouse #%d: Help canceled (%s)\n", _lighthouse_number, _help_request.requestId());
+    forwardHelpMessage("CANCEL", _help_request.requestId(), message);
+    _help_request.reset();
+    clearHelpIndicator();
   } else {
-    Serial.printf("Lighthouse #%d: Failed to cancel help request\n", LIGHTHOUSE_NUMBER);
+    Serial.printf("Lighthouse #%d: Failed to cancel help request\n", _lighthouse_number);
   }
   return success;
 }
 
 bool LighthouseMesh::isHelpActive() const {
-  return _help_state != HelpState::Idle;
+  return _help_request.isActive();
 }
 
 bool LighthouseMesh::isHelpClaimed() const {
-  return _help_state == HelpState::Claimed;
+  return _help_request.isClaimed();
 }
 
 bool LighthouseMesh::isAnnouncementActive() const {
@@ -294,8 +461,66 @@ void LighthouseMesh::stopAnnouncement() {
   }
 }
 
+void LighthouseMesh::schedulePlayback(const char *url, uint64_t start_epoch_ms, bool announce) {
+  int64_t now_us = local_micros();
+  int64_t start_us = now_us;
+  if (_sync_clock.isSynced(now_us)) {
+    start_us = _sync_clock.toLocalUs((int64_t)start_epoch_ms * 1000, now_us);
+  } else {
+    Serial.println("Scheduled audio: clock not synced, playing now");
+  }
+  if (now_us - start_us > kScheduleMaxLateUs || start_us - now_us > kScheduleMaxLeadUs) {
+    Serial.printf("Scheduled audio: start %lld ms away, ignored\n", (long long)((start_us - now_us) / 1000));
+    return;
+  }
+  if (_scheduled_armed && _audio_streamer) {
+    _audio_streamer->stop();
+  }
+  strncpy(_scheduled_url, url, sizeof(_scheduled_url) - 1);
+  _scheduled_url[sizeof(_scheduled_url) - 1] = '\0';
+  _scheduled_start_us = start_us;
+  _scheduled_armed = false;
+  _scheduled_announce = announce;
+  // on flash by arming time, ideally, so the start doesn't wait on HTTP
+  if (_audio_streamer) {
+    _audio_streamer->prefetch(url);
+  }
+  Serial.printf("Scheduled audio in %lld ms: %s\n", (long long)((start_us - now_us) / 1000), _scheduled_url);
+}
+
+void LighthouseMesh::updateScheduledPlayback() {
+  if (_scheduled_url[0] == '\0' || !_audio_streamer) {
+    return;
+  }
+  if (!_scheduled_armed) {
+    if (_scheduled_start_us - local_micros() > (int64_t)AUDIO_SYNC_ARM_MS * 1000) {
+      return;
+    }
+    _audio_streamer->stop();  // a synchronised clip takes over from whatever is playing
+    if (!_audio_streamer->playAt(_scheduled_url, _scheduled_start_us)) {
+      Serial.printf("Scheduled audio: failed to start %s\n", _scheduled_url);
+      _scheduled_url[0] = '\0';
+      return;
+    }
+    _scheduled_armed = true;
+    if (_scheduled_announce && _light_ring) {
+      _light_ring->setBlinking(true, 255, 255, 255, 500);
+    }
+    return;
+  }
+  if (_audio_streamer->isPlaying()) {
+    return;
+  }
+  _scheduled_url[0] = '\0';
+  _scheduled_armed = false;
+  if (_scheduled_announce && _light_ring) {
+    _light_ring->setBlinking(false);
+    restoreIdleColor();
+  }
+}
+
 void LighthouseMesh::updateAnnouncement() {
-  if (!_announcement_active || !_audio_streamer) {
+  if (!_announcement_active || !_audio_streamer || _scheduled_armed) {
     return;
   }
 
@@ -412,7 +637,7 @@ void LighthouseMesh::stopMailbox() {
 }
 
 void LighthouseMesh::updateMailbox() {
-  if (!_mailbox_active || !_audio_streamer) {
+  if (!_mailbox_active || !_audio_streamer || _scheduled_armed) {
     return;
   }
   if (_announcement_active) {
@@ -490,26 +715,16 @@ void LighthouseMesh::restoreIdleColor() {
   if (!_light_ring) {
     return;
   }
-  if (_help_state != HelpState::Idle && _help_color_name[0] != '\0') {
-    if (strcmp(_help_color_name, "RED") == 0) {
-      _light_ring->setIdleColor(255, 0, 0);
-    } else if (strcmp(_help_color_name, "ORANGE") == 0) {
-      _light_ring->setIdleColor(255, 128, 0);
-    } else if (strcmp(_help_color_name, "YELLOW") == 0) {
-      _light_ring->setIdleColor(255, 255, 0);
-    } else if (strcmp(_help_color_name, "GREEN") == 0) {
-      _light_ring->setIdleColor(0, 200, 0);
-    } else if (strcmp(_help_color_name, "BLUE") == 0) {
-      _light_ring->setIdleColor(0, 120, 255);
-    } else if (strcmp(_help_color_name, "VIOLET") == 0) {
-      _light_ring->setIdleColor(160, 0, 255);
+  if (_help_request.isActive() && _help_request.colorName()[0] != '\0') {
+    const HelpColor *color = lookupHelpColor(_help_request.colorName());
+    if (color) {
+      _light_ring->setIdleColor(color->r, color->g, color->b);
     } else {
       _light_ring->setIdleColor(LIGHTHOUSE_IDLE_R, LIGHTHOUSE_IDLE_G, LIGHTHOUSE_IDLE_B);
     }
     return;
   }
-  _light_ring->setIdleColor(LIGHTHOUSE_IDLE_R, LIGHTHOUSE_IDLE_G, LIGHTHOUSE_IDLE_B);
-  _light_ring->setOrbiting(false, HELP_ORBIT_INTERVAL_MS);
+  clearHelpIndicator();
 }
 
 bool LighthouseMesh::handleMailboxButton() {
@@ -550,31 +765,107 @@ bool LighthouseMesh::handleMailboxButton() {
 }
 
 const char *LighthouseMesh::getActiveRequestId() const {
-  return _active_request_id;
+  return _help_request.requestId();
 }
 
-void LighthouseMesh::sendHelpBroadcast(const char *text) {
+bool LighthouseMesh::sendHelpBroadcast(const char *text) {
   if (!text || _lighthouse_channel == NULL) {
-    return;
+    return false;
   }
   uint32_t timestamp = getRTCClock()->getCurrentTime();
-  sendGroupMessage(timestamp, _lighthouse_channel->channel, _node_name, text, strlen(text));
+  size_t text_len = strlen(text);
+  char prefix[sizeof(_node_name) + 2];
+  snprintf(prefix, sizeof(prefix), "%s: ", _node_name);
+  size_t prefix_len = strlen(prefix);
+  uint8_t packed[5 + sizeof(prefix) + HelpCommandQueue::kLineMax];
+  if (prefix_len + text_len <= MAX_TEXT_LEN || packText(packed, prefix, text, text_len) > 0) {
+    return sendGroupMessage(timestamp, _lighthouse_channel->channel, _node_name, text, text_len);
+  }
+
+  // same plaintext as sendGroupMessage() builds, receivers can't tell the difference once reassembled
+  uint8_t plain[5 + sizeof(prefix) + HelpCommandQueue::kLineMax];
+  size_t len = 5 + prefix_len + text_len;
+  if (len > sizeof(plain)) {
+    return false;
+  }
+  memcpy(plain, &timestamp, 4);
+  plain[4] = 0;  // TXT_TYPE_PLAIN
+  memcpy(&plain[5], prefix, prefix_len);
+  memcpy(&plain[5 + prefix_len], text, text_len);
+  if (allowTextCompression() && len - 5 <= MAX_EXPANDED_TEXT_LEN) {
+    // fewer fragments, if not down to one
+    int n = TxtCompressor::compress((const char *)&plain[5], len - 5, &packed[5], sizeof(packed) - 5);
+    if (n > 0 && (size_t)n < len - 5) {
+      memcpy(packed, plain, 4);
+      packed[4] = TXT_FLAG_COMPRESSED << 2;
+      memcpy(plain, packed, 5 + n);
+      len = 5 + n;
+    }
+    countPackedText(prefix_len + text_len, len - 5);
+  }
+  bool sent = sendGroupFragmented(PAYLOAD_TYPE_GRP_TXT, _lighthouse_channel->channel, plain, len);
+  Serial.printf("Lighthouse #%d: %s %u byte broadcast in fragments (%u on air)\n", _lighthouse_number,
+                sent ? "sending" : "couldn't send", (unsigned int)text_len, (unsigned int)(len - 5));
+  return sent;
+}
+
+uint32_t LighthouseMesh::getBroadcastPacingMs(const char *text) {
+  size_t text_len = strlen(text);
+  char prefix[sizeof(_node_name) + 2];
+  snprintf(prefix, sizeof(prefix), "%s: ", _node_name);
+  uint8_t packed[MAX_TEXT_LEN];
+  int packed_len = packText(packed, prefix, text, text_len);
+
+  // GRP_TXT on air: header, path len, channel hash, MAC, then timestamp/flags + "<name>: <text>"
+  // (or that packed) padded to the cipher block
+  size_t plain = 5 + (packed_len > 0 ? packed_len : strlen(prefix) + text_len);
+  size_t payload = PATH_HASH_SIZE + CIPHER_MAC_SIZE
+                   + ((plain + CIPHER_BLOCK_SIZE - 1) / CIPHER_BLOCK_SIZE) * CIPHER_BLOCK_SIZE;
+  uint32_t airtime;
+  if (plain - 5 > MAX_TEXT_LEN) {
+    // fragments, full ones but for the last (fewer when packed, this errs long)
+    size_t count = (payload + FRAGMENT_DATA_SIZE - 1) / FRAGMENT_DATA_SIZE;
+    airtime = _radio->getEstAirtimeFor(2 + MAX_PACKET_PAYLOAD) * count;
+  } else {
+    airtime = _radio->getEstAirtimeFor(2 + payload);
+  }
+  // the dispatcher then holds the radio quiet for airtime * budget factor
+  return (uint32_t)(airtime * (1.0f + getEffectiveBudgetFactor()));
+}
+
+int LighthouseMesh::getPoolFree() const {
+  return _mgr->getFreeCount();
+}
+
+int LighthouseMesh::getQueueDepth() const {
+  return _mgr->getOutboundCount(0xFFFFFFFF);
+}
+
+int LighthouseMesh::getNoiseFloor() const {
+  return _radio->getNoiseFloor();
 }
 
 void LighthouseMesh::handleHelpPayload(const char *text) {
+  if (wasHandledDirectly(text)) {
+    return;
+  }
   handleHelpMessage(text);
 }
 
-const char *LighthouseMesh::getNodeName() {
-  return _node_name;
+bool LighthouseMesh::handleDirectPayload(const char *text) {
+  if (!_direct_log.add(text)) {
+    return false;
+  }
+  Serial.printf("Lighthouse #%d: Direct command: %s\n", _lighthouse_number, text);
+  return handleHelpMessage(text);
 }
 
-uint32_t LighthouseMesh::getBLEPin() {
-  if (_active_ble_pin == 0) {
-    // Generate a PIN based on lighthouse number (ensures uniqueness)
-    _active_ble_pin = 100000 + LIGHTHOUSE_NUMBER;
-  }
-  return _active_ble_pin;
+bool LighthouseMesh::wasHandledDirectly(const char *text) const {
+  return _direct_log.contains(text);
+}
+
+const char *LighthouseMesh::getNodeName() {
+  return _node_name;
 }
 
 // Override methods from BaseChatMesh
@@ -598,14 +889,141 @@ bool LighthouseMesh::filterRecvFloodPacket(mesh::Packet* packet) {
   return false;
 }
 
+bool LighthouseMesh::allowPacketForward(const mesh::Packet* packet) {
+#if LIGHTHOUSE_FLOOD_FORWARD
+  return packet->isRouteFlood() && packet->path_len < LIGHTHOUSE_FLOOD_MAX_HOPS;
+#else
+  return false;
+#endif
+}
+
+uint32_t LighthouseMesh::getRetransmitDelay(const mesh::Packet* packet) {
+  // slots a whole airtime apart, so a rebroadcast that beat ours is overheard before our slot
+  uint32_t t = _radio->getEstAirtimeFor(packet->getRawLength()) * 52 / 50;
+  if (getRetransmitMaxSlots() > 0) return calcContentionDelay(packet, t);
+  return getRNG()->nextInt(0, FLOOD_RETRANSMIT_SLOTS) * t;
+}
+
+uint8_t LighthouseMesh::getRetransmitMaxSlots() const {
+  return FLOOD_RETRANSMIT_MAX_SLOTS;
+}
+
+uint32_t LighthouseMesh::getTxSlotWait(const mesh::Packet* packet, uint32_t airtime_millis) {
+  uint32_t wait = mesh::Mesh::getTxSlotWait(packet, airtime_millis);   // link rate sessions (off here)
+  if (wait > 0) {
+    return wait;
+  }
+#if LIGHTHOUSE_TDMA
+  int64_t now_us = local_micros();
+  if (!_sync_clock.isSynced(now_us)) {
+    return 0;  // no frame to agree on
+  }
+  uint32_t slot_ms = _radio->getEstAirtimeFor(TDMA_SLOT_BYTES) + TDMA_GUARD_MS;
+  uint32_t spare_start = TDMA_FLEET_SIZE * slot_ms;
+  uint32_t spare_ms = TDMA_SPARE_SLOTS * slot_ms;
+  uint32_t longest = _radio->getEstAirtimeFor(MAX_TRANS_UNIT) + TDMA_GUARD_MS;
+  if (spare_ms < longest) {
+    spare_ms = longest;  // whatever is queued fits there
+  }
+  uint32_t frame_ms = spare_start + spare_ms;
+  uint32_t pos = (uint32_t)((_sync_clock.toEpochUs(now_us) / 1000) % frame_ms);
+
+  bool relay = packet->isRouteFlood() && packet->path_len > 0;
+  bool own = _lighthouse_number >= 1 && _lighthouse_number <= TDMA_FLEET_SIZE && !relay
+             && airtime_millis + TDMA_GUARD_MS <= slot_ms;
+  uint32_t start = own ? (_lighthouse_number - 1) * slot_ms : spare_start;
+  uint32_t len = own ? slot_ms : spare_ms;
+  // starting up to half the guard late still ends clear of the next slot
+  if (pos >= start && pos + airtime_millis + TDMA_GUARD_MS / 2 <= start + len) {
+    return 0;
+  }
+  return (start + frame_ms - pos) % frame_ms;
+#else
+  return 0;
+#endif
+}
+
+bool LighthouseMesh::allowTextCompression() const {
+  return LIGHTHOUSE_TEXT_COMPRESSION;
+}
+
+uint8_t LighthouseMesh::getFloodSuppressThreshold() const {
+  return FLOOD_SUPPRESS_THRESHOLD;
+}
+
+float LighthouseMesh::getFloodSuppressMinSNR() const {
+  return FLOOD_SUPPRESS_MIN_SNR;
+}
+
 void LighthouseMesh::sendFloodScoped(const ContactInfo& recipient, mesh::Packet* pkt, uint32_t delay_millis) {
   sendFlood(pkt, delay_millis);
 }
 
 void LighthouseMesh::sendFloodScoped(const mesh::GroupChannel& channel, mesh::Packet* pkt, uint32_t delay_millis) {
+  if (_beacon_hash_pending) {
+    pkt->calculatePacketHash(_beacon_hash);
+    _beacon_hash_valid = true;
+    _beacon_hash_pending = false;
+  }
+#ifdef WITH_UDP_BRIDGE
+  // Prefer the LAN: peers get the IP copy now, and the LoRa copy (for anyone off WiFi)
+  // is held back so it arrives as a duplicate rather than first.
+  bool via_ip = _bridge.hasLivePeers();
+  sendFlood(pkt, via_ip ? delay_millis + LIGHTHOUSE_BRIDGE_LORA_DELAY_MS : delay_millis);
+  _bridge.sendPacket(pkt);
+#else
   sendFlood(pkt, delay_millis);
+#endif
+}
+
+void LighthouseMesh::logRx(mesh::Packet *packet, int len, float score) {
+  if (packet->getPayloadType() == PAYLOAD_TYPE_GRP_TXT && packet->isRouteFlood() && packet->path_len == 0) {
+    // heard straight from the sender: the receive time is good for a time beacon
+    RxStamp &stamp = _rx_stamps[_rx_stamp_head];
+    stamp.local_us = radio_event_micros(_radio);
+    packet->calculatePacketHash(stamp.hash);
+    _rx_stamp_head = (uint8_t)((_rx_stamp_head + 1) % kRxStampSlots);
+  }
+#ifdef WITH_UDP_BRIDGE
+  // share what we hear over LoRa with lighthouses out of its range
+  _bridge.sendPacket(packet);
+#endif
 }
 
+void LighthouseMesh::logTx(mesh::Packet *packet, int len) {
+  if (_beacon_hash_valid) {
+    uint8_t hash[MAX_HASH_SIZE];
+    packet->calculatePacketHash(hash);
+    if (memcmp(hash, _beacon_hash, MAX_HASH_SIZE) == 0) {
+      _beacon_tx_epoch_us = _sync_clock.toEpochUs(radio_event_micros(_radio));
+      _beacon_hash_valid = false;
+    }
+  }
+#ifdef WITH_UDP_BRIDGE
+  _bridge.sendPacket(packet);  // no-op for floods already sent from sendFloodScoped()
+#endif
+}
+
+#ifdef WITH_UDP_BRIDGE
+void LighthouseMesh::updateBridge() {
+#ifdef ESP32
+  bool network_up = WiFi.status() == WL_CONNECTED;
+#else
+  bool network_up = true;
+#endif
+  if (_bridge.isRunning() && !network_up) {
+    _bridge.end();
+  } else if (!_bridge.isRunning() && network_up &&
+             (_bridge_retry_ms == 0 || millis() - _bridge_retry_ms >= LIGHTHOUSE_BRIDGE_RETRY_MS)) {
+    _bridge_retry_ms = millis();
+    _bridge.begin();
+    Serial.printf("Lighthouse #%d: LAN bridge %s\n", _lighthouse_number,
+                  _bridge.isRunning() ? "up" : "failed");
+  }
+  _bridge.loop();
+}
+#endif
+
 void LighthouseMesh::logRxRaw(float snr, float rssi, const uint8_t raw[], int len) {
   // Optional: log received packets for debugging
 }
@@ -620,7 +1038,7 @@ bool LighthouseMesh::onContactPathRecv(ContactInfo& from, uint8_t* in_path, uint
 
 void LighthouseMesh::onDiscoveredContact(ContactInfo &contact, bool is_new, uint8_t path_len, const uint8_t* path) {
   Serial.printf("Lighthouse #%d: %s contact %s (path_len=%u)\n",
-                LIGHTHOUSE_NUMBER,
+                _lighthouse_number,
                 is_new ? "Discovered" : "Updated",
                 contact.name,
                 (unsigned int)path_len);
@@ -628,7 +1046,7 @@ void LighthouseMesh::onDiscoveredContact(ContactInfo &contact, bool is_new, uint
 
 void LighthouseMesh::onContactPathUpdated(const ContactInfo &contact) {
   Serial.printf("Lighthouse #%d: Contact path updated for %s (out_path_len=%u)\n",
-                LIGHTHOUSE_NUMBER,
+                _lighthouse_number,
                 contact.name,
                 (unsigned int)contact.out_path_len);
 }
@@ -638,10 +1056,10 @@ ContactInfo* LighthouseMesh::processAck(const uint8_t *data) {
 }
 
 void LighthouseMesh::onMessageRecv(const ContactInfo &from, mesh::Packet *pkt, uint32_t sender_timestamp, const char *text) {
-  Serial.printf("Lighthouse #%d: Received message from %s: %s\n", LIGHTHOUSE_NUMBER, from.name, text);
+  Serial.printf("Lighthouse #%d: Received message from %s: %s\n", _lighthouse_number, from.name, text);
   if (_discord_server) {
     char message[192];
-    snprintf(message, sizeof(message), "Lighthouse %d received from %s: %s", LIGHTHOUSE_NUMBER, from.name, text ? text : "");
+    snprintf(message, sizeof(message), "Lighthouse %d received from %s: %s", _lighthouse_number, from.name, text ? text : "");
     _discord_server->sendChannelMessage(message);
   }
 }
@@ -655,8 +1073,22 @@ void LighthouseMesh::onSignedMessageRecv(const ContactInfo &from, mesh::Packet *
 }
 
 void LighthouseMesh::onChannelMessageRecv(const mesh::GroupChannel &channel, mesh::Packet *pkt, uint32_t timestamp, const char *text) {
-  Serial.printf("Lighthouse #%d: Channel message: %s\n", LIGHTHOUSE_NUMBER, text);
-  if (text && handleHelpMessage(text)) {
+  Serial.printf("Lighthouse #%d: Channel message: %s\n", _lighthouse_number, text);
+  if (wasHandledDirectly(text)) {
+    return;  // the bot already delivered this over WiFi; the flood is its fallback
+  }
+  _current_rx_us = 0;
+  uint8_t hash[MAX_HASH_SIZE];
+  pkt->calculatePacketHash(hash);
+  for (uint8_t i = 0; i < kRxStampSlots; ++i) {
+    if (_rx_stamps[i].local_us != 0 && memcmp(_rx_stamps[i].hash, hash, MAX_HASH_SIZE) == 0) {
+      _current_rx_us = _rx_stamps[i].local_us;
+      break;
+    }
+  }
+  bool handled = text && handleHelpMessage(text);
+  _current_rx_us = 0;
+  if (handled) {
     return;
   }
   if (_light_ring) {
@@ -717,7 +1149,7 @@ void LighthouseMesh::broadcastAck(const char *type, const char *req_id) {
   uint32_t timestamp = getRTCClock()->getCurrentTime();
   char message[96];
   snprintf(message, sizeof(message), "HELP|ACK|%s|%s|%d|%lu",
-           type, req_id, LIGHTHOUSE_NUMBER, (unsigned long)timestamp);
+           type, req_id, _lighthouse_number, (unsigned long)timestamp);
   sendGroupMessage(timestamp, _lighthouse_channel->channel, _node_name, message, strlen(message));
 }
 
@@ -731,6 +1163,17 @@ bool LighthouseMesh::forwardHelpMessage(const char *type, const char *req_id, co
     Serial.printf("Help relay: already acked %s\n", ack_key);
     return false;
   }
+  if (!_gateway.isEligible()) {
+    return false;
+  }
+  if (!_gateway.isLeader(millis())) {
+    queueGatewayBackup(type, req_id, text);
+    return false;
+  }
+  return postHelpMessage(type, req_id, text);
+}
+
+bool LighthouseMesh::postHelpMessage(const char *type, const char *req_id, const char *text) {
 #ifdef ESP32
   if (WiFi.status() != WL_CONNECTED) {
     Serial.println("Help relay: WiFi not connected");
@@ -750,242 +1193,265 @@ bool LighthouseMesh::forwardHelpMessage(const char *type, const char *req_id, co
   return false;
 }
 
+const LighthouseMesh::HelpHandler LighthouseMesh::kHelpHandlers[] = {
+  {HelpMsgType::Ping, &LighthouseMesh::onHelpPing},
+  {HelpMsgType::Pong, &LighthouseMesh::onHelpPong},
+  {HelpMsgType::Audio, &LighthouseMesh::onHelpAudio},
+  {HelpMsgType::Announce, &LighthouseMesh::onHelpAudio},
+  {HelpMsgType::Mail, &LighthouseMesh::onHelpAudio},
+  {HelpMsgType::Ack, &LighthouseMesh::onHelpAck},
+  {HelpMsgType::Details, &LighthouseMesh::onHelpDetails},
+  {HelpMsgType::Req, &LighthouseMesh::onHelpReq},
+  {HelpMsgType::Cancel, &LighthouseMesh::onHelpCancel},
+  {HelpMsgType::Claim, &LighthouseMesh::onHelpClaim},
+  {HelpMsgType::Resolve, &LighthouseMesh::onHelpResolve},
+  {HelpMsgType::Gateway, &LighthouseMesh::onHelpGateway},
+  {HelpMsgType::Time, &LighthouseMesh::onHelpTime},
+};
+
 bool LighthouseMesh::handleHelpMessage(const char *text) {
-  if (!text) {
+  HelpMessage msg;
+  if (!parseHelpMessage(text, msg)) {
     return false;
   }
-  const char *payload = text;
-  if (strncmp(payload, "HELP|", 5) != 0) {
-    payload = strstr(text, "HELP|");
-    if (!payload) {
-      return false;
+  for (size_t i = 0; i < sizeof(kHelpHandlers) / sizeof(kHelpHandlers[0]); ++i) {
+    if (kHelpHandlers[i].type == msg.type) {
+      (this->*kHelpHandlers[i].handle)(msg);
+      break;
     }
   }
+  return true;
+}
 
-  char buffer[192];
-  strncpy(buffer, payload, sizeof(buffer) - 1);
-  buffer[sizeof(buffer) - 1] = '\0';
+namespace {
+// Common "<req_id>|<lighthouse>|..." prefix of REQ/CANCEL/CLAIM/RESOLVE.
+bool parseHelpTarget(const HelpMessage &msg, HelpSpan &req_id, int &lh_id) {
+  req_id = msg.field(0);
+  HelpSpan lh_str = msg.field(1);
+  if (req_id.empty() || lh_str.empty()) {
+    return false;
+  }
+  lh_id = lh_str.toInt();
+  Serial.printf("Help msg: %.*s req=%.*s lh=%d\n", (int)msg.type_name.len, msg.type_name.ptr,
+                (int)req_id.len, req_id.ptr, lh_id);
+  return true;
+}
+}  // namespace
 
-  char *saveptr = nullptr;
-  char *token = strtok_r(buffer, "|", &saveptr);
-  if (!token || strcmp(token, "HELP") != 0) {
-    return true;
+void LighthouseMesh::relayPong(const char *ack_key, const char *text) {
+  if (!isAcked(ack_key) && _gateway.isLeader(millis()) && _help_bot_client && _help_bot_client->isEnabled()) {
+    rememberAck(ack_key);
+    if (_help_bot_client->postMeshEvent(text, _node_name)) {
+      Serial.printf("Help relay: forwarded PONG %s\n", ack_key);
+    }
   }
-  const char *type = strtok_r(nullptr, "|", &saveptr);
-  if (!type) {
-    return true;
+}
+
+void LighthouseMesh::onHelpPing(const HelpMessage &msg) {
+  HelpSpan ping_id = msg.field(0);
+  if (ping_id.empty()) {
+    return;
   }
+  uint32_t timestamp = getRTCClock()->getCurrentTime();
+  char message[96];
+  snprintf(message, sizeof(message), "HELP|PONG|%.*s|%d|%lu",
+           (int)ping_id.len, ping_id.ptr, _lighthouse_number, (unsigned long)timestamp);
+  sendHelpBroadcast(message);
+  char ack_key[40];
+  snprintf(ack_key, sizeof(ack_key), "PONG|%.*s|%d", (int)ping_id.len, ping_id.ptr, _lighthouse_number);
+  relayPong(ack_key, message);
+}
 
-  if (strcmp(type, "PING") == 0) {
-    const char *ping_id = strtok_r(nullptr, "|", &saveptr);
-    if (!ping_id) {
-      return true;
-    }
-    uint32_t timestamp = getRTCClock()->getCurrentTime();
-    char message[96];
-    snprintf(message, sizeof(message), "HELP|PONG|%s|%d|%lu",
-             ping_id, LIGHTHOUSE_NUMBER, (unsigned long)timestamp);
-    sendHelpBroadcast(message);
-    char ack_key[40];
-    snprintf(ack_key, sizeof(ack_key), "PONG|%s|%d", ping_id, LIGHTHOUSE_NUMBER);
-    if (!isAcked(ack_key) && _help_bot_client && _help_bot_client->isEnabled()) {
-      rememberAck(ack_key);
-      if (_help_bot_client->postMeshEvent(message, _node_name)) {
-        Serial.printf("Help relay: forwarded PONG %s\n", ack_key);
-      }
-    }
-    return true;
+void LighthouseMesh::onHelpPong(const HelpMessage &msg) {
+  HelpSpan ping_id = msg.field(0);
+  HelpSpan lh_str = msg.field(1);
+  if (ping_id.empty() || lh_str.empty()) {
+    return;
   }
+  char ack_key[40];
+  snprintf(ack_key, sizeof(ack_key), "PONG|%.*s|%.*s",
+           (int)ping_id.len, ping_id.ptr, (int)lh_str.len, lh_str.ptr);
+  relayPong(ack_key, msg.payload);
+}
 
-  if (strcmp(type, "PONG") == 0) {
-    const char *ping_id = strtok_r(nullptr, "|", &saveptr);
-    const char *lh_str = strtok_r(nullptr, "|", &saveptr);
-    if (!ping_id || !lh_str) {
-      return true;
-    }
-    char ack_key[40];
-    snprintf(ack_key, sizeof(ack_key), "PONG|%s|%s", ping_id, lh_str);
-    if (!isAcked(ack_key) && _help_bot_client && _help_bot_client->isEnabled()) {
-      rememberAck(ack_key);
-      if (_help_bot_client->postMeshEvent(payload, _node_name)) {
-        Serial.printf("Help relay: forwarded PONG %s\n", ack_key);
+void LighthouseMesh::onHelpAudio(const HelpMessage &msg) {
+  HelpSpan target = msg.field(0);
+  HelpSpan url_span = msg.field(1);
+  if (target.empty() || url_span.empty()) {
+    return;
+  }
+  if (!target.equals("ALL") && target.toInt() != _lighthouse_number) {
+    return;
+  }
+  char url[192];
+  url_span.copyTo(url, sizeof(url));
+  Serial.printf("Audio request for lighthouse %d: %s\n", _lighthouse_number, url);
+  uint64_t start_epoch_ms = msg.field(2).toUInt64();
+  if (start_epoch_ms != 0 && msg.type != HelpMsgType::Mail) {
+    // "<target>|<url>|<start_epoch_ms>": play once, in step with the other lighthouses
+    schedulePlayback(url, start_epoch_ms, msg.type == HelpMsgType::Announce);
+    return;
+  }
+  if (_audio_streamer && msg.type != HelpMsgType::Audio) {
+    // ANNOUNCE/MAIL replay until acknowledged; fetch once now so replays come from flash
+    _audio_streamer->prefetch(url);
+  }
+  if (msg.type == HelpMsgType::Announce) {
+    startAnnouncement(url);
+  } else if (msg.type == HelpMsgType::Mail) {
+    enqueueMailbox(url);
+    if (!_mailbox_active) {
+      if (_announcement_active) {
+        _mailbox_active = true;
+        _mailbox_alerting = false;
+      } else {
+        startMailboxAlert();
       }
     }
-    return true;
+  } else if (_audio_streamer && !_audio_streamer->isPlaying()) {
+    _audio_streamer->play(url);
   }
+}
 
-  if (strcmp(type, "AUDIO") == 0 || strcmp(type, "ANNOUNCE") == 0 || strcmp(type, "MAIL") == 0) {
-    const char *target = strtok_r(nullptr, "|", &saveptr);
-    const char *url = strtok_r(nullptr, "|", &saveptr);
-    if (!target || !url) {
-      return true;
-    }
-    bool matches = false;
-    if (strcmp(target, "ALL") == 0) {
-      matches = true;
-    } else {
-      int target_id = atoi(target);
-      matches = (target_id == LIGHTHOUSE_NUMBER);
-    }
-    if (matches) {
-      Serial.printf("Audio request for lighthouse %d: %s\n", LIGHTHOUSE_NUMBER, url);
-      if (strcmp(type, "ANNOUNCE") == 0) {
-        startAnnouncement(url);
-      } else if (strcmp(type, "MAIL") == 0) {
-        enqueueMailbox(url);
-        if (!_mailbox_active) {
-          if (_announcement_active) {
-            _mailbox_active = true;
-            _mailbox_alerting = false;
-          } else {
-            startMailboxAlert();
-          }
-        }
-      } else if (_audio_streamer && !_audio_streamer->isPlaying()) {
-        _audio_streamer->play(url);
-      }
-    }
-    return true;
+void LighthouseMesh::onHelpAck(const HelpMessage &msg) {
+  HelpSpan ack_type = msg.field(0);
+  HelpSpan req_id = msg.field(1);
+  if (ack_type.empty() || req_id.empty()) {
+    return;
   }
+  char ack_key[40];
+  snprintf(ack_key, sizeof(ack_key), "%.*s|%.*s",
+           (int)ack_type.len, ack_type.ptr, (int)req_id.len, req_id.ptr);
+  rememberAck(ack_key);
+}
 
-  if (strcmp(type, "ACK") == 0) {
-    const char *ack_type = strtok_r(nullptr, "|", &saveptr);
-    const char *req_id = strtok_r(nullptr, "|", &saveptr);
-    if (!ack_type || !req_id) {
-      return true;
-    }
-    char ack_key[40];
-    snprintf(ack_key, sizeof(ack_key), "%s|%s", ack_type, req_id);
-    rememberAck(ack_key);
-    return true;
+void LighthouseMesh::onHelpDetails(const HelpMessage &msg) {
+  HelpSpan req_id = msg.field(0);
+  HelpSpan lh_str = msg.field(1);
+  HelpSpan reason = msg.field(2);
+  if (req_id.empty() || lh_str.empty()) {
+    return;
+  }
+  if (lh_str.toInt() != _lighthouse_number || !_help_request.matches(req_id)) {
+    return;
   }
+  if (_audio_streamer && !_audio_streamer->isPlaying()) {
+    _audio_streamer->playFile(MENTOUR_ON_THEIR_WAY_PATH);
+  }
+  if (!reason.empty()) {
+    Serial.printf("Help details: %.*s\n", (int)reason.len, reason.ptr);
+  }
+}
 
-  if (strcmp(type, "DETAILS") == 0) {
-    const char *req_id = strtok_r(nullptr, "|", &saveptr);
-    const char *lh_str = strtok_r(nullptr, "|", &saveptr);
-    const char *reason = strtok_r(nullptr, "|", &saveptr);
-    if (!req_id || !lh_str) {
-      return true;
-    }
-    int lh_id = atoi(lh_str);
-    if (lh_id == LIGHTHOUSE_NUMBER && strcmp(_active_request_id, req_id) == 0) {
-      if (_audio_streamer && !_audio_streamer->isPlaying()) {
-        _audio_streamer->playFile(MENTOUR_ON_THEIR_WAY_PATH);
-      }
-      if (reason && reason[0] != '\0') {
-        Serial.printf("Help details: %s\n", reason);
-      }
-    }
-    return true;
+void LighthouseMesh::onHelpReq(const HelpMessage &msg) {
+  HelpSpan req_id;
+  int lh_id;
+  if (!parseHelpTarget(msg, req_id, lh_id)) {
+    return;
+  }
+  char req_id_str[32];
+  req_id.copyTo(req_id_str, sizeof(req_id_str));
+  forwardHelpMessage("REQ", req_id_str, msg.payload);
+  if (lh_id == _lighthouse_number && _help_request.open(req_id, msg.field(2))) {
+    showHelpPending();
   }
+}
 
-  const char *req_id = strtok_r(nullptr, "|", &saveptr);
-  const char *lh_str = strtok_r(nullptr, "|", &saveptr);
-  if (!req_id || !lh_str) {
-    return true;
+void LighthouseMesh::onHelpCancel(const HelpMessage &msg) {
+  HelpSpan req_id;
+  int lh_id;
+  if (!parseHelpTarget(msg, req_id, lh_id)) {
+    return;
   }
-  int lh_id = atoi(lh_str);
-  const char *color_name = strtok_r(nullptr, "|", &saveptr);
-  Serial.printf("Help msg: %s req=%s lh=%d\n", type, req_id, lh_id);
-
-  if (strcmp(type, "REQ") == 0) {
-    forwardHelpMessage(type, req_id, payload);
-    if (lh_id == LIGHTHOUSE_NUMBER && _help_state == HelpState::Idle) {
-      strncpy(_active_request_id, req_id, sizeof(_active_request_id) - 1);
-      _active_request_id[sizeof(_active_request_id) - 1] = '\0';
-      _help_state = HelpState::Pending;
-      if (color_name && color_name[0] != '\0') {
-        strncpy(_help_color_name, color_name, sizeof(_help_color_name) - 1);
-        _help_color_name[sizeof(_help_color_name) - 1] = '\0';
-        if (_light_ring) {
-          if (strcmp(color_name, "RED") == 0) {
-            _light_ring->setIdleColor(255, 0, 0);
-          } else if (strcmp(color_name, "ORANGE") == 0) {
-            _light_ring->setIdleColor(255, 128, 0);
-          } else if (strcmp(color_name, "YELLOW") == 0) {
-            _light_ring->setIdleColor(255, 255, 0);
-          } else if (strcmp(color_name, "GREEN") == 0) {
-            _light_ring->setIdleColor(0, 200, 0);
-          } else if (strcmp(color_name, "BLUE") == 0) {
-            _light_ring->setIdleColor(0, 120, 255);
-          } else if (strcmp(color_name, "VIOLET") == 0) {
-            _light_ring->setIdleColor(160, 0, 255);
-          }
-        }
-      }
-      if (_light_ring) {
-        _light_ring->setOrbiting(true, HELP_ORBIT_INTERVAL_MS);
-      }
-    }
-    return true;
+  char req_id_str[32];
+  req_id.copyTo(req_id_str, sizeof(req_id_str));
+  forwardHelpMessage("CANCEL", req_id_str, msg.payload);
+  if (lh_id == _lighthouse_number && _help_request.close(req_id)) {
+    clearHelpIndicator();
+    playHelpFeedback(255, 64, 64, SFX_DEQUEUE_PATH, ChimePattern::Cancel);
   }
+}
 
-  if (strcmp(type, "CANCEL") == 0) {
-    forwardHelpMessage(type, req_id, payload);
-    if (lh_id == LIGHTHOUSE_NUMBER && strcmp(_active_request_id, req_id) == 0) {
-      _help_state = HelpState::Idle;
-      _active_request_id[0] = '\0';
-      _help_color_name[0] = '\0';
-      if (_light_ring) {
-      _light_ring->setIdleColor(LIGHTHOUSE_IDLE_R, LIGHTHOUSE_IDLE_G, LIGHTHOUSE_IDLE_B);
-      _light_ring->setOrbiting(false, HELP_ORBIT_INTERVAL_MS);
-      }
-      if (_light_ring) {
-        _light_ring->setPulseColor(255, 64, 64);
-        _light_ring->notifyChannelMessage();
-      }
-      if (_audio_streamer && !_audio_streamer->isPlaying()) {
-        if (!_audio_streamer->playFile(SFX_DEQUEUE_PATH) && _light_chime) {
-          _light_chime->playMessageChime();
-        }
-      } else if (_light_chime && (!_audio_streamer || !_audio_streamer->isPlaying())) {
-        _light_chime->playMessageChime();
-      }
-    }
-    return true;
+void LighthouseMesh::onHelpClaim(const HelpMessage &msg) {
+  HelpSpan req_id;
+  int lh_id;
+  if (!parseHelpTarget(msg, req_id, lh_id)) {
+    return;
+  }
+  if (lh_id == _lighthouse_number && _help_request.claim(req_id)) {
+    playHelpFeedback(0, 200, 0, SFX_CLAIM_PATH, ChimePattern::Claim);
   }
+}
 
-  if (strcmp(type, "CLAIM") == 0) {
-    if (lh_id == LIGHTHOUSE_NUMBER && strcmp(_active_request_id, req_id) == 0) {
-      _help_state = HelpState::Claimed;
-      if (_light_ring) {
-        _light_ring->setPulseColor(0, 200, 0);
-        _light_ring->notifyChannelMessage();
-      }
-      if (_audio_streamer && !_audio_streamer->isPlaying()) {
-        if (!_audio_streamer->playFile(SFX_CLAIM_PATH) && _light_chime) {
-          _light_chime->playMessageChime();
-        }
-      } else if (_light_chime && (!_audio_streamer || !_audio_streamer->isPlaying())) {
-        _light_chime->playMessageChime();
-      }
-    }
-    return true;
+void LighthouseMesh::onHelpResolve(const HelpMessage &msg) {
+  HelpSpan req_id;
+  int lh_id;
+  if (!parseHelpTarget(msg, req_id, lh_id)) {
+    return;
   }
+  if (lh_id == _lighthouse_number && _help_request.close(req_id)) {
+    clearHelpIndicator();
+    playHelpFeedback(0, 120, 255, SFX_RESOLVE_PATH, ChimePattern::Resolve);
+  }
+}
 
-  if (strcmp(type, "RESOLVE") == 0) {
-    if (lh_id == LIGHTHOUSE_NUMBER && strcmp(_active_request_id, req_id) == 0) {
-      _help_state = HelpState::Idle;
-      _active_request_id[0] = '\0';
-      _help_color_name[0] = '\0';
-      if (_light_ring) {
-      _light_ring->setIdleColor(LIGHTHOUSE_IDLE_R, LIGHTHOUSE_IDLE_G, LIGHTHOUSE_IDLE_B);
-      _light_ring->setOrbiting(false, HELP_ORBIT_INTERVAL_MS);
-      }
-      if (_light_ring) {
-        _light_ring->setPulseColor(0, 120, 255);
-        _light_ring->notifyChannelMessage();
-      }
-      if (_audio_streamer && !_audio_streamer->isPlaying()) {
-        if (!_audio_streamer->playFile(SFX_RESOLVE_PATH) && _light_chime) {
-          _light_chime->playMessageChime();
-        }
-      } else if (_light_chime && (!_audio_streamer || !_audio_streamer->isPlaying())) {
-        _light_chime->playMessageChime();
-      }
-    }
-    return true;
+void LighthouseMesh::onHelpGateway(const HelpMessage &msg) {
+  HelpSpan lh_str = msg.field(0);
+  HelpSpan state = msg.field(1);
+  int lh_id = lh_str.toInt();
+  if (lh_id <= 0 || lh_id > 255 || state.empty()) {
+    return;
   }
+  _gateway.onHeartbeat((uint8_t)lh_id, state.equals("UP"), millis());
+}
 
-  return true;
+void LighthouseMesh::onHelpTime(const HelpMessage &msg) {
+  int lh_id = msg.field(0).toInt();
+  uint32_t seq = (uint32_t)msg.field(1).toUInt64();
+  int64_t prev_tx_epoch_us = (int64_t)msg.field(2).toUInt64();
+  if (lh_id <= 0 || lh_id > 255 || lh_id == _lighthouse_number || seq == 0) {
+    return;
+  }
+  if (lh_id == _beacon_from && seq == _beacon_rx_seq + 1 && prev_tx_epoch_us != 0 && _beacon_rx_us != 0) {
+    // seq-1 ended on air at prev_tx_epoch_us and ended arriving here at _beacon_rx_us
+    _sync_clock.addBeaconSample(prev_tx_epoch_us - _beacon_rx_us, local_micros());
+    Serial.printf("Time beacon: #%d seq %lu, offset spread %lu us\n", lh_id, (unsigned long)seq,
+                  (unsigned long)_sync_clock.getSpreadUs(local_micros()));
+  }
+  _beacon_from = (uint8_t)lh_id;
+  _beacon_rx_seq = seq;
+  _beacon_rx_us = _current_rx_us;  // 0 unless heard directly over LoRa
+}
+
+void LighthouseMesh::showHelpPending() {
+  if (!_light_ring) {
+    return;
+  }
+  const HelpColor *color = lookupHelpColor(_help_request.colorName());
+  if (color) {
+    _light_ring->setIdleColor(color->r, color->g, color->b);
+  }
+  _light_ring->setOrbiting(true, HELP_ORBIT_INTERVAL_MS);
+}
+
+void LighthouseMesh::clearHelpIndicator() {
+  if (!_light_ring) {
+    return;
+  }
+  _light_ring->setIdleColor(LIGHTHOUSE_IDLE_R, LIGHTHOUSE_IDLE_G, LIGHTHOUSE_IDLE_B);
+  _light_ring->setOrbiting(false, HELP_ORBIT_INTERVAL_MS);
+}
+
+void LighthouseMesh::playHelpFeedback(uint8_t r, uint8_t g, uint8_t b, const char *sfx_path, ChimePattern chime) {
+  if (_light_ring) {
+    _light_ring->setPulseColor(r, g, b);
+    _light_ring->notifyChannelMessage();
+  }
+  if (_audio_streamer) {
+    if (!_audio_streamer->isPlaying() && !_audio_streamer->playFile(sfx_path) && _light_chime) {
+      _light_chime->play(chime);
+    }
+  } else if (_light_chime) {
+    _light_chime->play(chime);
+  }
 }
@@ -3,6 +3,10 @@
 #include <Arduino.h>
 #include <Mesh.h>
 
+#ifndef WITH_FRAGMENTS
+#error "LighthouseMesh sends long HELP lines fragmented, build with -D WITH_FRAGMENTS"
+#endif
+
 #if defined(NRF52_PLATFORM) || defined(STM32_PLATFORM)
 #include <InternalFileSystem.h>
 #elif defined(RP2040_PLATFORM)
@@ -18,8 +22,15 @@
 #include <helpers/SimpleMeshTables.h>
 #include <helpers/StaticPoolPacketManager.h>
 #include <helpers/ArduinoHelpers.h>
+#ifdef WITH_UDP_BRIDGE
+#include <helpers/bridges/UDPBridge.h>
+#endif
 #include <target.h>
 #include "global_configs.h"
+#include "GatewayElection.h"
+#include "HelpProtocol.h"
+#include "LightChime.h"
+#include "SyncClock.h"
 
 /* ---------------------------------- CONFIGURATION ------------------------------------- */
 
@@ -63,6 +74,8 @@ class LighthouseMesh : public BaseChatMesh {
 public:
   LighthouseMesh(mesh::Radio &radio, mesh::RNG &rng, mesh::RTCClock &rtc, SimpleMeshTables &tables);
 
+  // Call before begin(); takes the lighthouse number and node name.
+  void setIdentity(const class LighthouseIdentity &identity);
   void begin();
   void startInterface(BaseSerialInterface &serial);
   void setLightRing(class LightRing *ring);
@@ -82,17 +95,43 @@ public:
   bool handleAnnouncementButton();
   bool handleMailboxButton();
   const char *getActiveRequestId() const;
-  void sendHelpBroadcast(const char *text);
+  // Lines too long for one channel message go out in fragments; false while the last of those is still going.
+  bool sendHelpBroadcast(const char *text);
+  // How long to wait after sendHelpBroadcast() before the next one, so they don't pile up in the pool.
+  uint32_t getBroadcastPacingMs(const char *text);
+  int getPoolFree() const;
+  int getQueueDepth() const;
+  int getNoiseFloor() const;
   void handleHelpPayload(const char *text);
+  // A HELP command that reached this node over WiFi. Returns false if the same payload was
+  // already handled directly; the mesh copy of it is ignored as well.
+  bool handleDirectPayload(const char *text);
+  // Whether this node can relay to the bot right now (WiFi up, bot URL known).
+  void setGatewayEligible(bool eligible);
+  bool isGatewayLeader() const;
+  uint8_t getGatewayLeader() const;
+  // Wall-clock reference for scheduled playback: system time just set by SNTP and read
+  // right after the local timer (esp_timer_get_time()).
+  void updateWallClock(int64_t epoch_us, int64_t local_us);
+  SyncClock::Source getSyncSource() const;
+  uint32_t getSyncSpreadUs() const;
   const char *getNodeName();
-  uint32_t getBLEPin();
 
 protected:
+  void logRx(mesh::Packet *packet, int len, float score) override;
+  void logTx(mesh::Packet *packet, int len) override;
   float getAirtimeBudgetFactor() const override;
   int getInterferenceThreshold() const override;
   int calcRxDelay(float score, uint32_t air_time) const override;
   uint8_t getExtraAckTransmitCount() const override;
   bool filterRecvFloodPacket(mesh::Packet* packet) override;
+  bool allowPacketForward(const mesh::Packet* packet) override;
+  uint32_t getRetransmitDelay(const mesh::Packet* packet) override;
+  uint8_t getRetransmitMaxSlots() const override;
+  uint32_t getTxSlotWait(const mesh::Packet* packet, uint32_t airtime_millis) override;
+  uint8_t getFloodSuppressThreshold() const override;
+  float getFloodSuppressMinSNR() const override;
+  bool allowTextCompression() const override;
 
   void sendFloodScoped(const ContactInfo& recipient, mesh::Packet* pkt, uint32_t delay_millis=0) override;
   void sendFloodScoped(const mesh::GroupChannel& channel, mesh::Packet* pkt, uint32_t delay_millis=0) override;
@@ -130,7 +169,14 @@ private:
   class DiscordServer *_discord_server;
   class HelpBotClient *_help_bot_client;
   char _node_name[32];
-  uint32_t _active_ble_pin;
+  uint8_t _lighthouse_number;
+#ifdef WITH_UDP_BRIDGE
+  NodePrefs _bridge_prefs;
+  UDPBridge _bridge;
+  unsigned long _bridge_retry_ms;
+
+  void updateBridge();
+#endif
   unsigned long _last_button_send;
 #ifdef BUTTON_SEND_COOLDOWN_MS
   static const unsigned long BUTTON_SEND_COOLDOWN_MS_VALUE = BUTTON_SEND_COOLDOWN_MS;
@@ -138,15 +184,8 @@ private:
   static const unsigned long BUTTON_SEND_COOLDOWN_MS_VALUE = 2000; // 2 second cooldown
 #endif
 
-  enum class HelpState {
-    Idle,
-    Pending,
-    Claimed
-  };
-
-  HelpState _help_state;
-  char _active_request_id[32];
-  char _help_color_name[8];
+  HelpRequestState _help_request;
+  HelpDirectLog _direct_log;  // commands the bot sent over WiFi; their mesh flood is skipped
   uint16_t _request_seq;
   bool _announcement_active;
   bool _announcement_acknowledged;
@@ -188,7 +227,86 @@ private:
 
   bool isAcked(const char *key) const;
   void rememberAck(const char *key);
+  bool wasHandledDirectly(const char *text) const;
   void broadcastAck(const char *type, const char *req_id);
   bool handleHelpMessage(const char *text);
   bool forwardHelpMessage(const char *type, const char *req_id, const char *text);
+  bool postHelpMessage(const char *type, const char *req_id, const char *text);
+
+  GatewayElection _gateway;
+
+  // Help messages a standby gateway posts itself unless the leader's ACK shows up first.
+  struct GatewayBackup {
+    char type[8];
+    char req_id[32];
+    char text[160];
+    unsigned long due_ms;  // 0 = free slot
+  };
+  static const uint8_t kGatewayBackupSlots = 4;
+  GatewayBackup _gateway_backup[kGatewayBackupSlots];
+  uint8_t _gateway_leader;  // last leader logged
+
+  void updateGateway();
+  void queueGatewayBackup(const char *type, const char *req_id, const char *text);
+  void sendGatewayHeartbeat(bool up);
+
+  // AUDIO/ANNOUNCE with a start time: every target starts the clip at the same wall-clock
+  // moment. Armed AUDIO_SYNC_ARM_MS ahead so the first frames are decoded before it.
+  char _scheduled_url[192];  // empty = nothing scheduled
+  int64_t _scheduled_start_us;  // local timer
+  bool _scheduled_armed;
+  bool _scheduled_announce;
+
+  void schedulePlayback(const char *url, uint64_t start_epoch_ms, bool announce);
+  void updateScheduledPlayback();
+
+  mesh::FragmentPool _fragments;  // HELP lines longer than one channel message
+
+  // Time beacons, for lighthouses without SNTP: the SNTP-synced gateway leader sends
+  // "HELP|TIME|<n>|<seq>|<tx time of seq-1>", the second half of a two-step sync; listeners
+  // pair it with the local receive time of seq-1. Only zero-hop LoRa receptions are stamped, both
+  // ends from the radio's TX-done / RX-done interrupt rather than when the loop polls it.
+  SyncClock _sync_clock;
+  uint32_t _beacon_seq;
+  int64_t _beacon_tx_epoch_us;  // when our last beacon finished transmitting; 0 = unknown
+  uint8_t _beacon_hash[MAX_HASH_SIZE];
+  bool _beacon_hash_pending;  // the next channel flood is a beacon
+  bool _beacon_hash_valid;
+  unsigned long _next_beacon_ms;
+  uint8_t _beacon_from;
+  uint32_t _beacon_rx_seq;
+  int64_t _beacon_rx_us;
+
+  struct RxStamp {
+    uint8_t hash[MAX_HASH_SIZE];
+    int64_t local_us;
+  };
+  static const uint8_t kRxStampSlots = 4;
+  RxStamp _rx_stamps[kRxStampSlots];
+  uint8_t _rx_stamp_head;
+  int64_t _current_rx_us;  // stamp of the channel message being handled; 0 if none
+
+  void updateTimeSync();
+
+  struct HelpHandler {
+    HelpMsgType type;
+    void (LighthouseMesh::*handle)(const HelpMessage &msg);
+  };
+  static const HelpHandler kHelpHandlers[];
+
+  void onHelpPing(const HelpMessage &msg);
+  void onHelpPong(const HelpMessage &msg);
+  void onHelpAudio(const HelpMessage &msg);
+  void onHelpAck(const HelpMessage &msg);
+  void onHelpDetails(const HelpMessage &msg);
+  void onHelpReq(const HelpMessage &msg);
+  void onHelpCancel(const HelpMessage &msg);
+  void onHelpClaim(const HelpMessage &msg);
+  void onHelpResolve(const HelpMessage &msg);
+  void onHelpGateway(const HelpMessage &msg);
+  void onHelpTime(const HelpMessage &msg);
+  void relayPong(const char *ack_key, const char *text);
+  void showHelpPending();
+  void clearHelpIndicator();
+  void playHelpFeedback(uint8_t r, uint8_t g, uint8_t b, const char *sfx_path, ChimePattern chime);
 };
@@ -0,0 +1,90 @@
+#include "PcmRing.h"
+
+#include <string.h>
+
+PcmRing::PcmRing()
+  : _storage(nullptr),
+    _mask(0),
+    _head(0),
+    _tail(0),
+    _underruns(0),
+    _overruns(0) {
+}
+
+bool PcmRing::attach(int16_t *storage, uint32_t frames) {
+  if (storage == nullptr || frames < 2 || (frames & (frames - 1)) != 0) {
+    return false;
+  }
+  _storage = storage;
+  _mask = frames - 1;
+  _head.store(0, std::memory_order_relaxed);
+  _tail.store(0, std::memory_order_relaxed);
+  return true;
+}
+
+uint32_t PcmRing::space() const {
+  if (_storage == nullptr) {
+    return 0;
+  }
+  uint32_t head = _head.load(std::memory_order_relaxed);
+  uint32_t tail = _tail.load(std::memory_order_acquire);
+  return capacity() - (head - tail);
+}
+
+uint32_t PcmRing::available() const {
+  uint32_t tail = _tail.load(std::memory_order_relaxed);
+  uint32_t head = _head.load(std::memory_order_acquire);
+  return head - tail;
+}
+
+uint32_t PcmRing::write(const int16_t *frames, uint32_t count) {
+  uint32_t free_frames = space();
+  uint32_t n = count < free_frames ? count : free_frames;
+  if (n < count) {
+    _overruns.fetch_add(1, std::memory_order_relaxed);
+  }
+  if (n == 0) {
+    return 0;
+  }
+  uint32_t head = _head.load(std::memory_order_relaxed);
+  uint32_t start = head & _mask;
+  uint32_t first = capacity() - start;
+  if (first > n) {
+    first = n;
+  }
+  memcpy(&_storage[start * 2], frames, first * 2 * sizeof(int16_t));
+  if (n > first) {
+    memcpy(&_storage[0], &frames[first * 2], (n - first) * 2 * sizeof(int16_t));
+  }
+  _head.store(head + n, std::memory_order_release);
+  return n;
+}
+
+uint32_t PcmRing::read(int16_t *frames, uint32_t count) {
+  uint32_t queued = available();
+  uint32_t n = count < queued ? count : queued;
+  if (n == 0) {
+    return 0;
+  }
+  uint32_t tail = _tail.load(std::memory_order_relaxed);
+  uint32_t start = tail & _mask;
+  uint32_t first = capacity() - start;
+  if (first > n) {
+    first = n;
+  }
+  memcpy(frames, &_storage[start * 2], first * 2 * sizeof(int16_t));
+  if (n > first) {
+    memcpy(&frames[first * 2], &_storage[0], (n - first) * 2 * sizeof(int16_t));
+  }
+  _tail.store(tail + n, std::memory_order_release);
+  return n;
+}
+
+void PcmRing::discard() {
+  _tail.store(_head.load(std::memory_order_acquire), std::memory_order_release);
+}
+
+void PcmRing::resetCounters() {
+  _underruns.store(0, std::memory_order_relaxed);
+  _overruns.store(0, std::memory_order_relaxed);
+}
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <atomic>
+#include <stddef.h>
+#include <stdint.h>
+
+// Single-producer / single-consumer ring of interleaved 16-bit stereo frames.
+// Lock-free: the producer only moves _head, the consumer only moves _tail.
+// Storage is supplied by the caller and must hold 'frames' * 2 samples, 'frames' a power of two.
+class PcmRing {
+public:
+  PcmRing();
+
+  bool attach(int16_t *storage, uint32_t frames);
+  uint32_t capacity() const { return _mask + 1; }
+
+  // producer side
+  uint32_t write(const int16_t *frames, uint32_t count);  // returns frames written; short write counts an overrun
+  uint32_t space() const;
+
+  // consumer side
+  uint32_t read(int16_t *frames, uint32_t count);
+  uint32_t available() const;
+  void discard();  // drop everything currently queued
+  void noteUnderrun() { _underruns.fetch_add(1, std::memory_order_relaxed); }
+
+  uint32_t getUnderruns() const { return _underruns.load(std::memory_order_relaxed); }
+  uint32_t getOverruns() const { return _overruns.load(std::memory_order_relaxed); }
+  void resetCounters();
+
+private:
+  int16_t *_storage;
+  uint32_t _mask;
+  std::atomic<uint32_t> _head;  // total frames written
+  std::atomic<uint32_t> _tail;  // total frames read
+  std::atomic<uint32_t> _underruns;
+  std::atomic<uint32_t> _overruns;
+};
@@ -0,0 +1,63 @@
+#include "RingCompositor.h"
+
+#include <math.h>
+#include <string.h>
+
+namespace {
+uint8_t blend(uint8_t dst, uint8_t src, uint8_t alpha) {
+  return (uint8_t)(((uint16_t)src * alpha + (uint16_t)dst * (255 - alpha) + 127) / 255);
+}
+}
+
+RingCompositor::RingCompositor(uint16_t count)
+  : _count(count > RING_COMPOSITOR_MAX_PIXELS ? RING_COMPOSITOR_MAX_PIXELS : count),
+    _valid(false) {
+  memset(_frame, 0, sizeof(_frame));
+  memset(_out, 0, sizeof(_out));
+  setGamma(1.0f);
+}
+
+void RingCompositor::setGamma(float gamma, float scale) {
+  for (uint16_t i = 0; i < 256; ++i) {
+    float v = powf((float)i / 255.0f, gamma) * scale * 255.0f + 0.5f;
+    _lut[i] = v >= 255.0f ? 255 : (v <= 0.0f ? 0 : (uint8_t)v);
+  }
+  _valid = false;
+}
+
+void RingCompositor::clear() {
+  memset(_frame, 0, sizeof(RingPixel) * _count);
+}
+
+void RingCompositor::fill(RingPixel color, uint8_t alpha) {
+  for (uint16_t i = 0; i < _count; ++i) {
+    set(i, color, alpha);
+  }
+}
+
+void RingCompositor::set(uint16_t index, RingPixel color, uint8_t alpha) {
+  if (index >= _count || alpha == 0) {
+    return;
+  }
+  RingPixel &px = _frame[index];
+  if (alpha == 255) {
+    px = color;
+    return;
+  }
+  px.r = blend(px.r, color.r, alpha);
+  px.g = blend(px.g, color.g, alpha);
+  px.b = blend(px.b, color.b, alpha);
+}
+
+bool RingCompositor::commit() {
+  bool changed = !_valid;
+  for (uint16_t i = 0; i < _count; ++i) {
+    RingPixel px = { _lut[_frame[i].r], _lut[_frame[i].g], _lut[_frame[i].b] };
+    if (px.r != _out[i].r || px.g != _out[i].g || px.b != _out[i].b) {
+      _out[i] = px;
+      changed = true;
+    }
+  }
+  _valid = true;
+  return changed;
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <stdint.h>
+
+#ifndef RING_COMPOSITOR_MAX_PIXELS
+#define RING_COMPOSITOR_MAX_PIXELS 64
+#endif
+
+struct RingPixel {
+  uint8_t r;
+  uint8_t g;
+  uint8_t b;
+};
+
+// Frame buffer for the light ring. Effects paint layers bottom-up with an alpha,
+// commit() runs the frame through a gamma LUT and reports whether the result differs
+// from the last committed frame, so the caller only pushes pixels when something changed.
+// Arduino-free; frames can be rendered and inspected on the host.
+class RingCompositor {
+public:
+  explicit RingCompositor(uint16_t count);
+
+  // Rebuilds the LUT: out = 255 * scale * (in / 255) ^ gamma. Setup-time only (uses powf).
+  void setGamma(float gamma, float scale = 1.0f);
+
+  uint16_t count() const { return _count; }
+  void clear();
+  void fill(RingPixel color, uint8_t alpha = 255);
+  void set(uint16_t index, RingPixel color, uint8_t alpha = 255);
+
+  // Gamma-corrects the frame into output(); true if it differs from the previous commit.
+  bool commit();
+  // Forces the next commit() to report a change (e.g. after the strip was cleared elsewhere).
+  void invalidate() { _valid = false; }
+  const RingPixel *output() const { return _out; }
+  const RingPixel *frame() const { return _frame; }
+
+private:
+  uint16_t _count;
+  bool _valid;
+  uint8_t _lut[256];
+  RingPixel _frame[RING_COMPOSITOR_MAX_PIXELS];
+  RingPixel _out[RING_COMPOSITOR_MAX_PIXELS];
+};
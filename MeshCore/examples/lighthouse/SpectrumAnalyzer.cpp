@@ -0,0 +1,173 @@
+#include "SpectrumAnalyzer.h"
+
+#include <math.h>
+
+namespace {
+constexpr float kPi = 3.14159265f;
+constexpr uint32_t kLowestHz = 60;
+constexpr uint32_t kHighestHz = 12000;
+// band energy (log2, Q4) mapped to 0..255: kFloorQ4 is dark, kFloorQ4 + kSpanQ4 is full
+constexpr int32_t kFloorQ4 = 24 * 16;
+constexpr int32_t kSpanQ4 = 16 * 16;
+// per-block fall-off so bars drop smoothly instead of flickering
+constexpr uint8_t kFallPerBlock = 12;
+
+int16_t to_q15(float v) {
+  float scaled = v * 32767.0f;
+  return (int16_t)(scaled >= 0.0f ? scaled + 0.5f : scaled - 0.5f);
+}
+
+// log2(v) in Q4, 0 for v == 0
+int32_t log2_q4(uint64_t v) {
+  if (v == 0) {
+    return 0;
+  }
+  int32_t msb = 63 - __builtin_clzll(v);
+  uint32_t frac = msb >= 4 ? (uint32_t)(v >> (msb - 4)) & 0xF : (uint32_t)(v << (4 - msb)) & 0xF;
+  return (msb << 4) | (int32_t)frac;
+}
+}
+
+SpectrumAnalyzer::SpectrumAnalyzer(uint16_t fft_size, uint8_t band_count)
+  : _n(16),
+    _log2n(4),
+    _band_count(band_count > SPECTRUM_MAX_BANDS ? SPECTRUM_MAX_BANDS : band_count),
+    _fill(0),
+    _sample_rate(44100),
+    _blocks(0) {
+  while (_n < fft_size && _n < SPECTRUM_MAX_FFT) {
+    _n <<= 1;
+    _log2n++;
+  }
+  for (uint16_t i = 0; i < _n / 2; ++i) {
+    float angle = 2.0f * kPi * i / _n;
+    _cos[i] = to_q15(cosf(angle));
+    _sin[i] = to_q15(sinf(angle));
+  }
+  for (uint16_t i = 0; i < _n; ++i) {
+    _window[i] = to_q15(0.5f - 0.5f * cosf(2.0f * kPi * i / (_n - 1)));
+  }
+  for (uint8_t b = 0; b < SPECTRUM_MAX_BANDS; ++b) {
+    _levels[b].store(0, std::memory_order_relaxed);
+  }
+  setSampleRate(_sample_rate);
+}
+
+void SpectrumAnalyzer::setSampleRate(uint32_t hz) {
+  if (hz == 0) {
+    return;
+  }
+  _sample_rate = hz;
+  uint16_t half = _n / 2;
+  float lo = (float)kLowestHz;
+  float hi = (float)(kHighestHz < hz / 2 ? kHighestHz : hz / 2);
+  uint16_t prev = 1;  // skip DC
+  for (uint8_t b = 0; b <= _band_count; ++b) {
+    float edge_hz = lo * powf(hi / lo, (float)b / (float)_band_count);
+    uint16_t bin = (uint16_t)(edge_hz * _n / hz + 0.5f);
+    // every band gets at least one bin, low bands included
+    if (bin <= prev && b > 0) {
+      bin = prev + 1;
+    }
+    if (bin > half) {
+      bin = half;
+    }
+    _band_edges[b] = b == 0 ? (bin < 1 ? 1 : bin) : bin;
+    prev = _band_edges[b];
+  }
+}
+
+void SpectrumAnalyzer::processBlock(const int16_t *stereo, uint32_t frames) {
+  if (stereo == nullptr) {
+    return;
+  }
+  for (uint32_t i = 0; i < frames; ++i) {
+    int32_t mono = ((int32_t)stereo[i * 2] + (int32_t)stereo[i * 2 + 1]) >> 1;
+    _re[_fill] = (int16_t)((mono * _window[_fill]) >> 15);
+    _im[_fill] = 0;
+    if (++_fill == _n) {
+      analyse();
+      _fill = 0;
+    }
+  }
+}
+
+void SpectrumAnalyzer::decay(uint8_t amount) {
+  for (uint8_t b = 0; b < _band_count; ++b) {
+    uint8_t level = _levels[b].load(std::memory_order_relaxed);
+    _levels[b].store(level > amount ? level - amount : 0, std::memory_order_relaxed);
+  }
+}
+
+void SpectrumAnalyzer::reset() {
+  _fill = 0;
+  for (uint8_t b = 0; b < _band_count; ++b) {
+    _levels[b].store(0, std::memory_order_relaxed);
+  }
+}
+
+uint8_t SpectrumAnalyzer::bands(uint8_t *out, uint8_t max) const {
+  uint8_t count = _band_count < max ? _band_count : max;
+  for (uint8_t b = 0; b < count; ++b) {
+    out[b] = _levels[b].load(std::memory_order_relaxed);
+  }
+  return count;
+}
+
+void SpectrumAnalyzer::transform(int16_t *re, int16_t *im) const {
+  // bit-reversal permutation
+  for (uint16_t i = 1, j = 0; i < _n; ++i) {
+    uint16_t bit = _n >> 1;
+    for (; j & bit; bit >>= 1) {
+      j ^= bit;
+    }
+    j |= bit;
+    if (i < j) {
+      int16_t t = re[i];
+      re[i] = re[j];
+      re[j] = t;
+      t = im[i];
+      im[i] = im[j];
+      im[j] = t;
+    }
+  }
+  // radix-2 butterflies, halving each stage
+  for (uint16_t len = 2; len <= _n; len <<= 1) {
+    uint16_t half = len >> 1;
+    uint16_t step = _n / len;
+    for (uint16_t i = 0; i < _n; i += len) {
+      for (uint16_t j = 0; j < half; ++j) {
+        int32_t wr = _cos[j * step];
+        int32_t wi = -_sin[j * step];
+        uint16_t a = i + j;
+        uint16_t b = a + half;
+        int32_t tr = (re[b] * wr - im[b] * wi) >> 15;
+        int32_t ti = (re[b] * wi + im[b] * wr) >> 15;
+        int32_t ar = re[a];
+        int32_t ai = im[a];
+        re[b] = (int16_t)((ar - tr) >> 1);
+        im[b] = (int16_t)((ai - ti) >> 1);
+        re[a] = (int16_t)((ar + tr) >> 1);
+        im[a] = (int16_t)((ai + ti) >> 1);
+      }
+    }
+  }
+}
+
+void SpectrumAnalyzer::analyse() {
+  transform(_re, _im);
+  for (uint8_t b = 0; b < _band_count; ++b) {
+    uint64_t energy = 0;
+    for (uint16_t k = _band_edges[b]; k < _band_edges[b + 1]; ++k) {
+      energy += (uint64_t)((int32_t)_re[k] * _re[k] + (int32_t)_im[k] * _im[k]);
+    }
+    // the output is scaled by 1/N; undo that so levels don't depend on the block size
+    int32_t lg = log2_q4(energy) + (int32_t)_log2n * 32;
+    int32_t level = energy == 0 ? 0 : ((lg - kFloorQ4) * 255) / kSpanQ4;
+    level = level < 0 ? 0 : (level > 255 ? 255 : level);
+    uint8_t previous = _levels[b].load(std::memory_order_relaxed);
+    uint8_t fallen = previous > kFallPerBlock ? previous - kFallPerBlock : 0;
+    _levels[b].store((uint8_t)(level > fallen ? level : fallen), std::memory_order_relaxed);
+  }
+  _blocks.fetch_add(1, std::memory_order_relaxed);
+}
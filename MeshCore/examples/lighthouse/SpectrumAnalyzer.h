@@ -0,0 +1,51 @@
+#pragma once
+
+#include <atomic>
+#include <stdint.h>
+
+#ifndef SPECTRUM_MAX_FFT
+#define SPECTRUM_MAX_FFT 512
+#endif
+
+#ifndef SPECTRUM_MAX_BANDS
+#define SPECTRUM_MAX_BANDS 32
+#endif
+
+// Block spectrum for the ring: mono-mixes stereo PCM into a Hann-windowed block, runs a
+// Q15 radix-2 FFT (scaled by 1/2 per stage, so it never overflows) and folds the bins
+// into log-spaced band levels 0-255. processBlock() runs on the decode task; bands()
+// may be read from any task. Arduino-free.
+class SpectrumAnalyzer {
+public:
+  // fft_size: power of two, 16..SPECTRUM_MAX_FFT. band_count <= SPECTRUM_MAX_BANDS.
+  SpectrumAnalyzer(uint16_t fft_size, uint8_t band_count);
+
+  void setSampleRate(uint32_t hz);
+  void processBlock(const int16_t *stereo, uint32_t frames);
+  void decay(uint8_t amount);
+  void reset();
+
+  uint8_t bandCount() const { return _band_count; }
+  uint8_t bands(uint8_t *out, uint8_t max) const;
+  uint32_t getBlocks() const { return _blocks.load(std::memory_order_relaxed); }
+
+  // In-place Q15 FFT over the first fft_size entries; exposed for host benchmarking.
+  void transform(int16_t *re, int16_t *im) const;
+
+private:
+  uint16_t _n;
+  uint8_t _log2n;
+  uint8_t _band_count;
+  uint16_t _fill;
+  uint32_t _sample_rate;
+  int16_t _cos[SPECTRUM_MAX_FFT / 2];
+  int16_t _sin[SPECTRUM_MAX_FFT / 2];
+  int16_t _window[SPECTRUM_MAX_FFT];
+  int16_t _re[SPECTRUM_MAX_FFT];
+  int16_t _im[SPECTRUM_MAX_FFT];
+  uint16_t _band_edges[SPECTRUM_MAX_BANDS + 1];  // first bin of each band, plus end
+  std::atomic<uint8_t> _levels[SPECTRUM_MAX_BANDS];
+  std::atomic<uint32_t> _blocks;
+
+  void analyse();
+};
@@ -0,0 +1,120 @@
+#include "StreamTuner.h"
+
+namespace {
+// assumed clip bitrate until a stream has been measured (128 kbps MP3)
+constexpr uint32_t kDefaultConsumeBps = 16000;
+// shortest window worth turning into a throughput estimate
+constexpr uint32_t kMinMeasureMs = 200;
+
+uint32_t clamp_u32(uint32_t v, uint32_t lo, uint32_t hi) {
+  return v < lo ? lo : (v > hi ? hi : v);
+}
+
+uint32_t blend(uint32_t old_value, uint32_t sample) {
+  return old_value == 0 ? sample : (uint32_t)(((uint64_t)old_value * 3 + sample) / 4);
+}
+}
+
+StreamTuner::StreamTuner(uint32_t min_buffer, uint32_t preroll_ms, uint32_t min_preroll_ms, uint32_t max_preroll_ms)
+  : _min_buffer(min_buffer),
+    _max_buffer(min_buffer),
+    _min_preroll_ms(min_preroll_ms),
+    _max_preroll_ms(max_preroll_ms),
+    _buffer_bytes(min_buffer),
+    _preroll_ms(clamp_u32(preroll_ms, min_preroll_ms, max_preroll_ms)),
+    _throughput_bps(0),
+    _consume_bps(0),
+    _active(false),
+    _stalled(false),
+    _start_ms(0),
+    _start_pos(0),
+    _last_ms(0),
+    _last_pos(0),
+    _net_bytes(0),
+    _net_ms(0),
+    _stalls(0),
+    _stall_ms(0),
+    _report() {
+}
+
+void StreamTuner::setMaxBuffer(uint32_t bytes) {
+  _max_buffer = bytes < _min_buffer ? _min_buffer : bytes;
+  _buffer_bytes = clamp_u32(_buffer_bytes, _min_buffer, _max_buffer);
+}
+
+uint32_t StreamTuner::prerollBytes() const {
+  uint32_t rate = _consume_bps > 0 ? _consume_bps : kDefaultConsumeBps;
+  uint32_t bytes = (uint32_t)(((uint64_t)rate * _preroll_ms) / 1000);
+  // leave room in the buffer for the source to keep reading while the decoder catches up
+  uint32_t limit = (_buffer_bytes / 4) * 3;
+  return bytes > limit ? limit : bytes;
+}
+
+void StreamTuner::beginStream(uint32_t now_ms, uint32_t source_pos) {
+  _active = true;
+  _stalled = false;
+  _start_ms = now_ms;
+  _start_pos = source_pos;
+  _last_ms = now_ms;
+  _last_pos = source_pos;
+  _net_bytes = 0;
+  _net_ms = 0;
+  _stalls = 0;
+  _stall_ms = 0;
+}
+
+void StreamTuner::sample(uint32_t now_ms, uint32_t source_pos, uint32_t fill, bool draining) {
+  if (!_active) {
+    return;
+  }
+  uint32_t dt = now_ms - _last_ms;
+  uint32_t got = source_pos - _last_pos;
+  // a full buffer means the decoder, not the network, set the pace; don't count it
+  if (fill < (_buffer_bytes / 4) * 3) {
+    _net_bytes += got;
+    _net_ms += dt;
+  }
+  bool starved = draining && fill == 0;
+  if (starved) {
+    if (!_stalled) {
+      _stalls++;
+    } else {
+      _stall_ms += dt;
+    }
+  }
+  _stalled = starved;
+  _last_ms = now_ms;
+  _last_pos = source_pos;
+}
+
+void StreamTuner::endStream(uint32_t now_ms, uint32_t source_pos, uint32_t underruns) {
+  if (!_active) {
+    return;
+  }
+  _active = false;
+
+  uint32_t elapsed = now_ms - _start_ms;
+  uint32_t consumed = source_pos - _start_pos;
+  if (elapsed >= kMinMeasureMs && consumed > 0) {
+    _consume_bps = blend(_consume_bps, (uint32_t)(((uint64_t)consumed * 1000) / elapsed));
+  }
+  if (_net_ms >= kMinMeasureMs) {
+    _throughput_bps = blend(_throughput_bps, (uint32_t)(((uint64_t)_net_bytes * 1000) / _net_ms));
+  }
+
+  uint32_t stalls = _stalls > underruns ? _stalls : underruns;
+  _report.seq++;
+  _report.stalls = stalls;
+  _report.stall_ms = _stall_ms;
+  _report.throughput_bps = _throughput_bps;
+  _report.buffer_bytes = _buffer_bytes;
+  _report.preroll_ms = _preroll_ms;
+
+  if (stalls > 0) {
+    _buffer_bytes = clamp_u32(_buffer_bytes * 2, _min_buffer, _max_buffer);
+    _preroll_ms = clamp_u32(_preroll_ms < 100 ? 100 : _preroll_ms * 2, _min_preroll_ms, _max_preroll_ms);
+  } else if (_consume_bps > 0 && _throughput_bps >= _consume_bps * 2) {
+    _buffer_bytes = clamp_u32((_buffer_bytes / 4) * 3, _min_buffer, _max_buffer);
+    _preroll_ms = clamp_u32(_preroll_ms / 2, _min_preroll_ms, _max_preroll_ms);
+  }
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <stdint.h>
+
+// Summary of one finished network stream, as reported in the registration heartbeat.
+struct StreamReport {
+  uint32_t seq;             // 0 until the first stream finishes
+  uint32_t stalls;          // source-starved episodes plus audible ring underruns
+  uint32_t stall_ms;        // time spent with the read-ahead buffer empty
+  uint32_t throughput_bps;  // sustained network bytes/s while the buffer had room
+  uint32_t buffer_bytes;    // read-ahead used for that stream
+  uint32_t preroll_ms;      // pre-roll used for that stream
+};
+
+// Sizes the read-ahead buffer and pre-roll of the next HTTP stream from what earlier streams
+// measured: a stall grows both, a link with plenty of headroom over the clip's bitrate shrinks
+// them back so a good connection doesn't pay for latency it doesn't need.
+// Arduino-free; the caller passes millis() and the source byte position.
+class StreamTuner {
+public:
+  StreamTuner(uint32_t min_buffer, uint32_t preroll_ms, uint32_t min_preroll_ms, uint32_t max_preroll_ms);
+
+  void setMaxBuffer(uint32_t bytes);
+
+  void beginStream(uint32_t now_ms, uint32_t source_pos);
+  // 'fill' is the read-ahead level; 'draining' is false while pre-rolling or after EOF.
+  void sample(uint32_t now_ms, uint32_t source_pos, uint32_t fill, bool draining);
+  void endStream(uint32_t now_ms, uint32_t source_pos, uint32_t underruns);
+
+  uint32_t bufferBytes() const { return _buffer_bytes; }
+  uint32_t prerollMs() const { return _preroll_ms; }
+  uint32_t prerollBytes() const;
+  uint32_t throughputBps() const { return _throughput_bps; }
+  uint32_t consumeBps() const { return _consume_bps; }
+  const StreamReport &lastReport() const { return _report; }
+
+private:
+  uint32_t _min_buffer;
+  uint32_t _max_buffer;
+  uint32_t _min_preroll_ms;
+  uint32_t _max_preroll_ms;
+  uint32_t _buffer_bytes;
+  uint32_t _preroll_ms;
+  uint32_t _throughput_bps;
+  uint32_t _consume_bps;
+
+  // per-stream accumulators
+  bool _active;
+  bool _stalled;
+  uint32_t _start_ms;
+  uint32_t _start_pos;
+  uint32_t _last_ms;
+  uint32_t _last_pos;
+  uint32_t _net_bytes;
+  uint32_t _net_ms;
+  uint32_t _stalls;
+  uint32_t _stall_ms;
+
+  StreamReport _report;
+};
@@ -0,0 +1,89 @@
+#include "SyncClock.h"
+
+SyncClock::SyncClock(uint32_t max_age_ms)
+  : _max_age_us((int64_t)max_age_ms * 1000),
+    _sntp_offset_us(0),
+    _sntp_at_us(0),
+    _beacon_offset_us(0),
+    _beacon_at_us(0),
+    _sample_count(0),
+    _sample_head(0),
+    _spread_us(0) {
+  for (uint8_t i = 0; i < kBeaconWindow; ++i) {
+    _samples[i] = 0;
+  }
+}
+
+bool SyncClock::fresh(int64_t at_us, int64_t local_us) const {
+  return at_us != 0 && local_us - at_us < _max_age_us;
+}
+
+void SyncClock::updateSntp(int64_t epoch_us, int64_t local_us) {
+  _sntp_offset_us = epoch_us - local_us;
+  _sntp_at_us = local_us != 0 ? local_us : 1;
+}
+
+void SyncClock::addBeaconSample(int64_t offset_us, int64_t local_us) {
+  if (_sample_count > 0 && !fresh(_beacon_at_us, local_us)) {
+    _sample_count = 0;  // a window that old would average in the drift since
+  }
+  _samples[_sample_head] = offset_us;
+  _sample_head = (uint8_t)((_sample_head + 1) % kBeaconWindow);
+  if (_sample_count < kBeaconWindow) {
+    _sample_count++;
+  }
+
+  // both ends stamp end-of-packet from the radio interrupt, but ISR latency and the receiver's
+  // end-of-packet detection still differ a little either way: average rather than trust the
+  // extreme sample, and keep the spread as the uncertainty
+  int64_t sum = 0;
+  int64_t lo = 0;
+  int64_t hi = 0;
+  for (uint8_t i = 0; i < _sample_count; ++i) {
+    int64_t s = _samples[(_sample_head + kBeaconWindow - 1 - i) % kBeaconWindow];
+    sum += s;
+    if (i == 0 || s < lo) {
+      lo = s;
+    }
+    if (i == 0 || s > hi) {
+      hi = s;
+    }
+  }
+  _beacon_offset_us = sum / _sample_count;
+  _spread_us = (uint32_t)(hi - lo);
+  _beacon_at_us = local_us != 0 ? local_us : 1;
+}
+
+SyncClock::Source SyncClock::source(int64_t local_us) const {
+  if (fresh(_sntp_at_us, local_us)) {
+    return Source::Sntp;
+  }
+  if (fresh(_beacon_at_us, local_us)) {
+    return Source::Beacon;
+  }
+  return Source::None;
+}
+
+int64_t SyncClock::offsetUs(int64_t local_us) const {
+  switch (source(local_us)) {
+    case Source::Sntp:
+      return _sntp_offset_us;
+    case Source::Beacon:
+      return _beacon_offset_us;
+    default:
+      // stale is still better than nothing; callers check isSynced() first
+      return _sntp_at_us != 0 ? _sntp_offset_us : _beacon_offset_us;
+  }
+}
+
+int64_t SyncClock::toEpochUs(int64_t local_us) const {
+  return local_us + offsetUs(local_us);
+}
+
+int64_t SyncClock::toLocalUs(int64_t epoch_us, int64_t local_now_us) const {
+  return epoch_us - offsetUs(local_now_us);
+}
+
+uint32_t SyncClock::getSpreadUs(int64_t local_us) const {
+  return source(local_us) == Source::Beacon ? _spread_us : 0;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <stdint.h>
+
+// Maps the local microsecond timer onto wall-clock (Unix epoch) time so lighthouses can agree
+// on when a scheduled clip starts. SNTP is the reference while it is current; otherwise the
+// offset comes from the gateway leader's mesh time beacons, averaged over a short window.
+// Arduino-free; the caller passes the local timer (esp_timer_get_time() on ESP32).
+class SyncClock {
+public:
+  enum class Source : uint8_t {
+    None,
+    Sntp,
+    Beacon
+  };
+
+  static const uint8_t kBeaconWindow = 4;
+
+  explicit SyncClock(uint32_t max_age_ms);
+
+  // system time 'epoch_us' read right after local timer 'local_us'
+  void updateSntp(int64_t epoch_us, int64_t local_us);
+  // one beacon measurement of (epoch - local), taken at 'local_us'
+  void addBeaconSample(int64_t offset_us, int64_t local_us);
+
+  Source source(int64_t local_us) const;
+  bool isSynced(int64_t local_us) const { return source(local_us) != Source::None; }
+  int64_t toEpochUs(int64_t local_us) const;
+  int64_t toLocalUs(int64_t epoch_us, int64_t local_now_us) const;
+  // spread of the beacon samples behind the current offset; 0 under SNTP
+  uint32_t getSpreadUs(int64_t local_us) const;
+
+private:
+  int64_t _max_age_us;
+  int64_t _sntp_offset_us;
+  int64_t _sntp_at_us;
+  int64_t _beacon_offset_us;
+  int64_t _beacon_at_us;
+  int64_t _samples[kBeaconWindow];
+  uint8_t _sample_count;
+  uint8_t _sample_head;
+  uint32_t _spread_us;
+
+  bool fresh(int64_t at_us, int64_t local_us) const;
+  int64_t offsetUs(int64_t local_us) const;
+};
@@ -0,0 +1,90 @@
+#include "TelemetryEncoder.h"
+
+#include <string.h>
+
+namespace {
+size_t put_varint(uint8_t *out, uint32_t value) {
+  size_t n = 0;
+  while (value >= 0x80) {
+    out[n++] = (uint8_t)(value | 0x80);
+    value >>= 7;
+  }
+  out[n++] = (uint8_t)value;
+  return n;
+}
+
+uint32_t zigzag(int32_t value) {
+  return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+}  // namespace
+
+TelemetryEncoder::TelemetryEncoder() {
+  memset(_values, 0, sizeof(_values));
+  reset();
+}
+
+void TelemetryEncoder::reset() {
+  memset(_sent, 0, sizeof(_sent));
+  memset(_base, 0, sizeof(_base));
+  _seq = 0;
+  _sent_seq = 0;
+  _base_seq = 0;
+  _sent_valid = false;
+  _base_valid = false;
+  _unacked = 0;
+}
+
+size_t TelemetryEncoder::encode(uint8_t number, const uint8_t mac[6], const char *firmware, bool heartbeat,
+                                uint8_t *out, size_t out_len) {
+  if (!out || out_len < kMaxFrame) {
+    return 0;
+  }
+  bool key = !_base_valid || _unacked >= kMaxUnacked;
+  uint16_t seq = ++_seq;
+
+  size_t n = 0;
+  out[n++] = 'L';
+  out[n++] = 'T';
+  out[n++] = kVersion;
+  out[n++] = (key ? kFlagKey : 0) | (heartbeat ? kFlagHeartbeat : 0);
+  out[n++] = number;
+  memcpy(&out[n], mac, 6);
+  n += 6;
+  out[n++] = (uint8_t)(seq & 0xFF);
+  out[n++] = (uint8_t)(seq >> 8);
+  out[n++] = (uint8_t)(_base_seq & 0xFF);
+  out[n++] = (uint8_t)(_base_seq >> 8);
+  out[n++] = kFieldCount;
+  for (uint8_t i = 0; i < kFieldCount; ++i) {
+    // unsigned wrap makes the difference exact for counters and gauges alike
+    uint32_t diff = key ? _values[i] : _values[i] - _base[i];
+    n += put_varint(&out[n], zigzag((int32_t)diff));
+  }
+  if (key) {
+    size_t len = firmware ? strlen(firmware) : 0;
+    if (len > 32) {
+      len = 32;
+    }
+    out[n++] = (uint8_t)len;
+    memcpy(&out[n], firmware, len);
+    n += len;
+  }
+
+  memcpy(_sent, _values, sizeof(_sent));
+  _sent_seq = seq;
+  _sent_valid = true;
+  if (!key) {
+    _unacked++;
+  }
+  return n;
+}
+
+void TelemetryEncoder::onAck(uint16_t seq) {
+  if (!_sent_valid || seq != _sent_seq) {
+    return;
+  }
+  memcpy(_base, _sent, sizeof(_base));
+  _base_seq = seq;
+  _base_valid = true;
+  _unacked = 0;
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Binary registration heartbeat ("LT" frame) sent to the bot every REGISTRATION_HEARTBEAT_MS.
+//
+//   0  'L' 'T'
+//   2  version
+//   3  flags (kFlagKey, kFlagHeartbeat)
+//   4  lighthouse number
+//   5  wifi MAC (6 bytes)
+//  11  seq (u16 LE)
+//  13  base_seq (u16 LE): the frame the values are relative to; unused on key frames
+//  15  field count
+//  16  one zigzag varint per field: value - base value, or the value itself on key frames
+//   .. key frames only: firmware version (length byte + chars)
+//
+// The base is the last frame the bot acknowledged (LHACK|<id>|<time>|<seq>), so a lost
+// datagram never leaves the bot without the frame a delta refers to. Without a recent
+// ack the next frame is a key frame. Fields are appended only; the count lets older bots
+// skip ones they don't know. Arduino-free.
+enum class TelemetryField : uint8_t {
+  Uptime,          // s
+  TxAirMs,         // Dispatcher totals since boot
+  RxAirMs,
+  SentFlood,
+  SentDirect,
+  RecvFlood,
+  RecvDirect,
+  FloodDups,       // SimpleMeshTables
+  DirectDups,
+  PoolFree,        // packet pool
+  QueueDepth,      // outbound queue
+  NoiseFloor,      // dBm, two's complement
+  HeapFree,
+  HeapLargest,
+  AudioUnderruns,
+  LoopMaxUs,       // slowest loop() since the previous frame
+  StreamSeq,       // last finished HTTP stream (StreamReport)
+  StreamStalls,
+  StreamStallMs,
+  StreamBps,
+  SyncSource,      // SyncClock::Source
+  SyncSpreadUs,    // beacon offset spread; 0 under SNTP
+  StartSkewUs,     // last scheduled start, two's complement; positive is late
+  ScheduledStarts,
+  FloodSuppressed, // queued rebroadcasts cancelled by overheard duplicates
+  TextRawBytes,    // channel/direct texts sent with compression on
+  TextPackedBytes, //   .. what went on air for them
+  TextAirSavedMs,
+  NeighboursHeard, // lighthouses/nodes heard first-hand on LoRa, last 10 min
+  LbtBusyPct,      // recent transmit attempts that found the channel busy
+  ChannelUtilPct,  // recent share of time others had the channel (rx airtime + LBT busy time)
+  Count
+};
+
+class TelemetryEncoder {
+public:
+  static const uint8_t kVersion = 1;
+  static const uint8_t kFlagKey = 0x01;
+  static const uint8_t kFlagHeartbeat = 0x02;
+  static const uint8_t kFieldCount = (uint8_t)TelemetryField::Count;
+  static const size_t kMaxFrame = 16 + kFieldCount * 5 + 1 + 32;
+  static const uint8_t kMaxUnacked = 2;  // deltas against an old base before falling back to a key frame
+
+  TelemetryEncoder();
+
+  void set(TelemetryField field, uint32_t value) { _values[(uint8_t)field] = value; }
+  void setSigned(TelemetryField field, int32_t value) { _values[(uint8_t)field] = (uint32_t)value; }
+
+  // Encodes the current values; returns the frame length (0 if 'out' is too small).
+  size_t encode(uint8_t number, const uint8_t mac[6], const char *firmware, bool heartbeat,
+                uint8_t *out, size_t out_len);
+  // Bot acknowledged 'seq': it becomes the base for the following deltas.
+  void onAck(uint16_t seq);
+  void reset();
+
+private:
+  uint32_t _values[kFieldCount];
+  uint32_t _sent[kFieldCount];
+  uint32_t _base[kFieldCount];
+  uint16_t _seq;
+  uint16_t _sent_seq;
+  uint16_t _base_seq;
+  bool _sent_valid;
+  bool _base_valid;
+  uint8_t _unacked;
+};
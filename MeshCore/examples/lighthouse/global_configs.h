@@ -2,6 +2,12 @@
 
 // Global lighthouse configuration values.
 
+// Factory default for units that haven't been provisioned (see LighthouseIdentity).
+// 0 means unprovisioned; a per-unit build can still bake one in with -D LIGHTHOUSE_NUMBER=N.
+#ifndef LIGHTHOUSE_NUMBER
+#define LIGHTHOUSE_NUMBER 0
+#endif
+
 #ifndef LIGHTHOUSE_IDLE_R
 #define LIGHTHOUSE_IDLE_R 15
 #endif
@@ -24,10 +30,82 @@
 #define AUDIO_BUFFER_BYTES 8192
 #endif
 
+// HTTP read-ahead starts at AUDIO_BUFFER_BYTES and grows after stalls, up to the
+// PSRAM cap when the module has PSRAM, otherwise the smaller internal-RAM cap.
+#ifndef AUDIO_BUFFER_PSRAM_MAX_BYTES
+#define AUDIO_BUFFER_PSRAM_MAX_BYTES (64 * 1024)
+#endif
+
+#ifndef AUDIO_BUFFER_INTERNAL_MAX_BYTES
+#define AUDIO_BUFFER_INTERNAL_MAX_BYTES (16 * 1024)
+#endif
+
+// Initial stream pre-roll; adapted per stream within [MIN, MAX].
 #ifndef AUDIO_PREROLL_MS
 #define AUDIO_PREROLL_MS 200
 #endif
 
+#ifndef AUDIO_PREROLL_MIN_MS
+#define AUDIO_PREROLL_MIN_MS 0
+#endif
+
+#ifndef AUDIO_PREROLL_MAX_MS
+#define AUDIO_PREROLL_MAX_MS 2000
+#endif
+
+#ifndef AUDIO_TUNE_SAMPLE_MS
+#define AUDIO_TUNE_SAMPLE_MS 100
+#endif
+
+// Decoded PCM queued between the decode task and the I2S writer (stereo frames, power of two).
+#ifndef AUDIO_RING_FRAMES
+#define AUDIO_RING_FRAMES 4096
+#endif
+
+#ifndef AUDIO_TASK_CORE
+#define AUDIO_TASK_CORE 0
+#endif
+
+// Ring shows a per-LED band spectrum while audio plays (0 = single brightness level).
+#ifndef AUDIO_SPECTRUM_ENABLED
+#define AUDIO_SPECTRUM_ENABLED 1
+#endif
+
+#ifndef AUDIO_SPECTRUM_FFT_SIZE
+#define AUDIO_SPECTRUM_FFT_SIZE 256
+#endif
+
+// Cache of streamed announcement/mail clips on LittleFS.
+#ifndef AUDIO_CACHE_DIR
+#define AUDIO_CACHE_DIR "/cache"
+#endif
+
+#ifndef AUDIO_CACHE_BUDGET_BYTES
+#define AUDIO_CACHE_BUDGET_BYTES (1024 * 1024)
+#endif
+
+#ifndef AUDIO_CACHE_MAX_ENTRIES
+#define AUDIO_CACHE_MAX_ENTRIES 16
+#endif
+
+#ifndef AUDIO_CACHE_QUEUE_SIZE
+#define AUDIO_CACHE_QUEUE_SIZE 4
+#endif
+
+#ifndef AUDIO_CACHE_TIMEOUT_MS
+#define AUDIO_CACHE_TIMEOUT_MS 5000
+#endif
+
+// Scheduled (synchronised) playback: the clip is armed this long before its start time so the
+// ring is pre-decoded, and a start later than the tolerance skips ahead to stay in step.
+#ifndef AUDIO_SYNC_ARM_MS
+#define AUDIO_SYNC_ARM_MS 1500
+#endif
+
+#ifndef AUDIO_SYNC_TOLERANCE_US
+#define AUDIO_SYNC_TOLERANCE_US 2000
+#endif
+
 
 
 // SFX //
@@ -94,3 +172,133 @@
 #ifndef REGISTRATION_LOCAL_PORT
 #define REGISTRATION_LOCAL_PORT 9011
 #endif
+
+// LAN backhaul (WITH_UDP_BRIDGE): mesh packets are also multicast between lighthouses on WiFi.
+// Packets from peers are encrypted with this secret (max 15 chars); other meshes are ignored.
+#ifndef LIGHTHOUSE_BRIDGE_SECRET
+#define LIGHTHOUSE_BRIDGE_SECRET "lighthouse-lan"
+#endif
+
+// While peers are heard over IP, our own LoRa floods wait this long so the IP copy lands first.
+#ifndef LIGHTHOUSE_BRIDGE_LORA_DELAY_MS
+#define LIGHTHOUSE_BRIDGE_LORA_DELAY_MS 1500
+#endif
+
+#ifndef LIGHTHOUSE_BRIDGE_RETRY_MS
+#define LIGHTHOUSE_BRIDGE_RETRY_MS 10000
+#endif
+
+// Help relay gateway election: every WiFi-connected lighthouse with a bot URL is eligible and
+// the lowest-numbered one relays. The leader heartbeats on the channel; standbys take over
+// once it has been silent for the timeout, lowest number first, CLAIM_STAGGER_MS apart.
+#ifndef GATEWAY_HEARTBEAT_MS
+#define GATEWAY_HEARTBEAT_MS 10000
+#endif
+
+#ifndef GATEWAY_TIMEOUT_MS
+#define GATEWAY_TIMEOUT_MS 25000
+#endif
+
+#ifndef GATEWAY_CLAIM_STAGGER_MS
+#define GATEWAY_CLAIM_STAGGER_MS 500
+#endif
+
+// Standbys post a REQ/CANCEL themselves if no ACK for it has been heard after this long.
+#ifndef GATEWAY_BACKUP_DELAY_MS
+#define GATEWAY_BACKUP_DELAY_MS 4000
+#endif
+
+// Clock agreement for scheduled playback. SNTP is polled every SYNC_NTP_INTERVAL_MS; point it
+// at a server on the venue LAN for single-digit ms agreement. A time reference (SNTP or the
+// gateway leader's zero-hop mesh beacons) is trusted for SYNC_MAX_AGE_MS after its last update.
+#ifndef SYNC_NTP_SERVER
+#define SYNC_NTP_SERVER "pool.ntp.org"
+#endif
+
+#ifndef SYNC_NTP_INTERVAL_MS
+#define SYNC_NTP_INTERVAL_MS 60000
+#endif
+
+#ifndef SYNC_MAX_AGE_MS
+#define SYNC_MAX_AGE_MS 180000
+#endif
+
+#ifndef SYNC_BEACON_INTERVAL_MS
+#define SYNC_BEACON_INTERVAL_MS 30000
+#endif
+
+// TDMA for the fixed fleet. With a synced clock (SNTP or beacons) lighthouse n only starts a
+// transmission in slot n-1 of a repeating frame, so a HELP|PING is answered one PONG at a time
+// instead of all at once. A slot fits TDMA_SLOT_BYTES on air plus TDMA_GUARD_MS of clock spread;
+// flood relays, anything longer and lighthouses numbered past TDMA_FLEET_SIZE share the
+// TDMA_SPARE_SLOTS at the end of the frame (under LBT). Unsynced units send at will. Every
+// transmission can wait up to a frame (~9 s for 30 at SF7/BW62.5), hence off by default.
+#ifndef LIGHTHOUSE_TDMA
+#define LIGHTHOUSE_TDMA 0
+#endif
+
+#ifndef TDMA_FLEET_SIZE
+#define TDMA_FLEET_SIZE 30
+#endif
+
+#ifndef TDMA_SPARE_SLOTS
+#define TDMA_SPARE_SLOTS 4
+#endif
+
+#ifndef TDMA_SLOT_BYTES
+#define TDMA_SLOT_BYTES 64
+#endif
+
+#ifndef TDMA_GUARD_MS
+#define TDMA_GUARD_MS 20
+#endif
+
+// LoRa flood relaying between lighthouses. Off by default: one hop plus the LAN bridge covers the
+// venue. When on, a rebroadcast waits a slot (an airtime each) and is dropped once
+// FLOOD_SUPPRESS_THRESHOLD neighbours are overheard relaying it first. The window grows with the
+// lighthouses heard nearby and the LBT busy rate, up to FLOOD_RETRANSMIT_MAX_SLOTS, and weak (far)
+// copies take the early slots. FLOOD_RETRANSMIT_MAX_SLOTS 0 = fixed FLOOD_RETRANSMIT_SLOTS, at random.
+#ifndef LIGHTHOUSE_FLOOD_FORWARD
+#define LIGHTHOUSE_FLOOD_FORWARD 0
+#endif
+
+#ifndef LIGHTHOUSE_FLOOD_MAX_HOPS
+#define LIGHTHOUSE_FLOOD_MAX_HOPS 4
+#endif
+
+#ifndef FLOOD_RETRANSMIT_SLOTS
+#define FLOOD_RETRANSMIT_SLOTS 8
+#endif
+
+#ifndef FLOOD_RETRANSMIT_MAX_SLOTS
+#define FLOOD_RETRANSMIT_MAX_SLOTS 16
+#endif
+
+#ifndef FLOOD_SUPPRESS_THRESHOLD
+#define FLOOD_SUPPRESS_THRESHOLD 3
+#endif
+
+// dB; only duplicates heard at least this strong count (default: all)
+#ifndef FLOOD_SUPPRESS_MIN_SNR
+#define FLOOD_SUPPRESS_MIN_SNR -128.0f
+#endif
+
+#if LIGHTHOUSE_FLOOD_FORWARD && FLOOD_SUPPRESS_THRESHOLD > 0 && !defined(WITH_FLOOD_SUPPRESSION)
+#error "FLOOD_SUPPRESS_THRESHOLD needs -D WITH_FLOOD_SUPPRESSION (Mesh leaves its tables out otherwise)"
+#endif
+#if LIGHTHOUSE_FLOOD_FORWARD && FLOOD_RETRANSMIT_MAX_SLOTS > 0 && !defined(WITH_HEARD_NEIGHBOURS)
+#error "FLOOD_RETRANSMIT_MAX_SLOTS needs -D WITH_HEARD_NEIGHBOURS (the window would never grow otherwise)"
+#endif
+
+// 1: channel texts and DMs go out packed (TXT_FLAG_COMPRESSED) when that makes them smaller,
+// which is most HELP lines. Lighthouses always read both forms (WITH_TEXT_COMPRESSION), but any
+// other node (older lighthouse firmware, stock MeshCore companion apps on the HELP channel) drops packed
+// texts without a trace, and never ACKs a packed DM, so the sender burns its retries and a flood.
+// There's no per-peer capability check: only turn this on once every node on the channel has it.
+#ifndef LIGHTHOUSE_TEXT_COMPRESSION
+#define LIGHTHOUSE_TEXT_COMPRESSION 0
+#endif
+
+#if LIGHTHOUSE_TEXT_COMPRESSION && !defined(WITH_TEXT_COMPRESSION)
+#error "LIGHTHOUSE_TEXT_COMPRESSION needs -D WITH_TEXT_COMPRESSION (BaseChatMesh can't unpack texts otherwise)"
+#endif
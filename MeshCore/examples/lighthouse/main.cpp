@@ -8,21 +8,23 @@
 #include "HelpBotClient.h"
 #include "HelpBotDiscovery.h"
 #include "HelpGatewayServer.h"
+#include "LighthouseIdentity.h"
+#include "TelemetryEncoder.h"
 #include "secrets.h"
 
-#ifndef LIGHTHOUSE_NUMBER
-#error "LIGHTHOUSE_NUMBER must be defined (1-30)"
-#endif
-
 #if defined(NRF52_PLATFORM) || defined(STM32_PLATFORM)
   #include <InternalFileSystem.h>
 #elif defined(RP2040_PLATFORM)
   #include <LittleFS.h>
 #elif defined(ESP32)
   #include <LittleFS.h>
+  #include <esp_heap_caps.h>
   #include <esp_partition.h>
   #include <WiFi.h>
   #include <WiFiUdp.h>
+  #include <esp_sntp.h>
+  #include <esp_timer.h>
+  #include <sys/time.h>
 #endif
 
 #ifdef ESP32
@@ -55,6 +57,7 @@
 StdRNG fast_rng;
 SimpleMeshTables tables;
 LighthouseMesh the_mesh(radio_driver, fast_rng, rtc_clock, tables);
+LighthouseIdentity identity;
 LightRing light_ring;
 LightChime light_chime;
 AudioStreamer audio_streamer;
@@ -79,6 +82,17 @@ static bool helpbot_hello_sent = false;
 static WiFiUDP registration_udp;
 static unsigned long last_registration_ms = 0;
 static bool registration_started = false;
+static TelemetryEncoder telemetry;
+static uint32_t last_loop_us = 0;
+static uint32_t loop_max_us = 0;  // since the last telemetry frame
+static bool sntp_started = false;
+static volatile bool sntp_synced = false;
+static volatile unsigned long sntp_synced_ms = 0;  // written from the SNTP task
+static unsigned long last_wall_clock_ms = 0;
+#endif
+#if !(defined(BLE_PIN_CODE) && !defined(DISABLE_BLE))
+static char provision_line[MAX_FRAME_SIZE + 1];
+static size_t provision_line_len = 0;
 #endif
 
 void halt() {
@@ -89,7 +103,12 @@ void setup() {
   Serial.begin(115200);
   delay(1000);
   
-  Serial.printf("\n\n=== Lighthouse #%d Starting ===\n", LIGHTHOUSE_NUMBER);
+  identity.begin();
+  the_mesh.setIdentity(identity);
+  Serial.printf("\n\n=== Lighthouse #%d Starting ===\n", identity.number());
+  if (!identity.isProvisioned()) {
+    Serial.println("Lighthouse is unprovisioned; send \"LHCFG number=N\" to assign it");
+  }
   
   light_ring.begin();
   light_ring.setIdleColor(LIGHTHOUSE_IDLE_R, LIGHTHOUSE_IDLE_G, LIGHTHOUSE_IDLE_B);
@@ -147,12 +166,11 @@ void setup() {
   }
   if (WiFi.status() == WL_CONNECTED) {
     Serial.printf("WiFi: connected, IP=%s\n", WiFi.localIP().toString().c_str());
-    if (LIGHTHOUSE_NUMBER == 1) {
-      help_bot.begin();
-      help_discovery.begin();
-      the_mesh.setHelpBotClient(&help_bot);
-      help_gateway.begin(&the_mesh);
-    }
+    // any connected lighthouse may end up relaying; the mesh elects which one does
+    help_bot.begin();
+    help_discovery.begin();
+    the_mesh.setHelpBotClient(&help_bot);
+    help_gateway.begin(&the_mesh);
     light_ring.finishStartup(true, 200);
   } else {
     Serial.println("WiFi: connection failed, continuing without help relay");
@@ -164,8 +182,8 @@ void setup() {
 
 #if defined(BLE_PIN_CODE) && !defined(DISABLE_BLE)
   char dev_name[32+16];
-  sprintf(dev_name, "%s%d", BLE_NAME_PREFIX, LIGHTHOUSE_NUMBER);
-  uint32_t ble_pin = (uint32_t)BLE_PIN_CODE;
+  sprintf(dev_name, "%s%d", BLE_NAME_PREFIX, identity.number());
+  uint32_t ble_pin = identity.blePin();
   Serial.println("Initializing BLE serial interface...");
   serial_interface.begin(dev_name, ble_pin);
   Serial.printf("BLE started: %s (PIN: %lu)\n", dev_name, (unsigned long)ble_pin);
@@ -182,7 +200,7 @@ void setup() {
   last_button_state = digitalRead(PIN_USER_BTN);
   button_state = last_button_state;
 
-  Serial.printf("Lighthouse #%d initialized successfully\n", LIGHTHOUSE_NUMBER);
+  Serial.printf("Lighthouse #%d initialized successfully\n", identity.number());
   Serial.printf("Node name: %s\n", the_mesh.getNodeName());
   Serial.printf("Press button on GPIO %d to request help; hold 2s to cancel\n", PIN_USER_BTN);
 
@@ -194,6 +212,32 @@ void setup() {
 }
 
 #ifdef ESP32
+static void on_sntp_sync(struct timeval *tv) {
+  (void)tv;
+  sntp_synced_ms = millis();
+  sntp_synced = true;
+}
+
+// Hands the SNTP-set system time to the mesh's SyncClock while the last sync is recent.
+static void update_wall_clock() {
+  if (!sntp_started) {
+    sntp_set_sync_interval(SYNC_NTP_INTERVAL_MS);
+    sntp_set_time_sync_notification_cb(on_sntp_sync);
+    configTime(0, 0, SYNC_NTP_SERVER);
+    sntp_started = true;
+    Serial.printf("Clock: SNTP from %s\n", SYNC_NTP_SERVER);
+  }
+  unsigned long now = millis();
+  if (!sntp_synced || now - sntp_synced_ms >= SYNC_MAX_AGE_MS || now - last_wall_clock_ms < 1000) {
+    return;
+  }
+  last_wall_clock_ms = now;
+  int64_t local_us = esp_timer_get_time();
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  the_mesh.updateWallClock((int64_t)tv.tv_sec * 1000000 + tv.tv_usec, local_us);
+}
+
 static void send_registration_packet(bool heartbeat) {
   if (WiFi.status() != WL_CONNECTED) {
     return;
@@ -202,35 +246,214 @@ static void send_registration_packet(bool heartbeat) {
   if (!server_ip.fromString(REGISTRATION_SERVER_IP)) {
     return;
   }
-  char lighthouse_id[8];
-  snprintf(lighthouse_id, sizeof(lighthouse_id), "LH-%02d", LIGHTHOUSE_NUMBER);
-  String ip = WiFi.localIP().toString();
-  String mac = WiFi.macAddress();
-  unsigned long uptime = millis() / 1000;
-  char payload[196];
-  snprintf(payload, sizeof(payload), "LHREG|%s|%s|%s|%s|%lu",
-           lighthouse_id,
-           ip.c_str(),
-           mac.c_str(),
-           FIRMWARE_VERSION,
-           uptime);
+  uint8_t mac[6];
+  WiFi.macAddress(mac);
+  StreamReport stream = audio_streamer.getLastStreamReport();
+
+  telemetry.set(TelemetryField::Uptime, millis() / 1000);
+  telemetry.set(TelemetryField::TxAirMs, the_mesh.getTotalAirTime());
+  telemetry.set(TelemetryField::RxAirMs, the_mesh.getReceiveAirTime());
+  telemetry.set(TelemetryField::SentFlood, the_mesh.getNumSentFlood());
+  telemetry.set(TelemetryField::SentDirect, the_mesh.getNumSentDirect());
+  telemetry.set(TelemetryField::RecvFlood, the_mesh.getNumRecvFlood());
+  telemetry.set(TelemetryField::RecvDirect, the_mesh.getNumRecvDirect());
+  telemetry.set(TelemetryField::FloodDups, tables.getNumFloodDups());
+  telemetry.set(TelemetryField::DirectDups, tables.getNumDirectDups());
+  telemetry.set(TelemetryField::PoolFree, the_mesh.getPoolFree());
+  telemetry.set(TelemetryField::QueueDepth, the_mesh.getQueueDepth());
+  telemetry.setSigned(TelemetryField::NoiseFloor, the_mesh.getNoiseFloor());
+  telemetry.set(TelemetryField::HeapFree, heap_caps_get_free_size(MALLOC_CAP_8BIT));
+  telemetry.set(TelemetryField::HeapLargest, heap_caps_get_largest_free_block(MALLOC_CAP_8BIT));
+  telemetry.set(TelemetryField::AudioUnderruns, audio_streamer.getUnderruns());
+  telemetry.set(TelemetryField::LoopMaxUs, loop_max_us);
+  telemetry.set(TelemetryField::StreamSeq, stream.seq);
+  telemetry.set(TelemetryField::StreamStalls, stream.stalls);
+  telemetry.set(TelemetryField::StreamStallMs, stream.stall_ms);
+  telemetry.set(TelemetryField::StreamBps, stream.throughput_bps);
+  telemetry.set(TelemetryField::SyncSource, (uint32_t)the_mesh.getSyncSource());
+  telemetry.set(TelemetryField::SyncSpreadUs, the_mesh.getSyncSpreadUs());
+  telemetry.setSigned(TelemetryField::StartSkewUs, audio_streamer.getLastStartSkewUs());
+  telemetry.set(TelemetryField::ScheduledStarts, audio_streamer.getScheduledStarts());
+  telemetry.set(TelemetryField::FloodSuppressed, the_mesh.getNumFloodSuppressed());
+  telemetry.set(TelemetryField::TextRawBytes, the_mesh.getTextRawBytes());
+  telemetry.set(TelemetryField::TextPackedBytes, the_mesh.getTextPackedBytes());
+  telemetry.set(TelemetryField::TextAirSavedMs, the_mesh.getTextAirtimeSaved());
+  telemetry.set(TelemetryField::NeighboursHeard, the_mesh.getNumNeighboursHeard());
+  telemetry.set(TelemetryField::LbtBusyPct, (uint32_t)(the_mesh.getChannelBusyRate() * 100.0f + 0.5f));
+  telemetry.set(TelemetryField::ChannelUtilPct, (uint32_t)(the_mesh.getChannelUtilisation() * 100.0f + 0.5f));
+  loop_max_us = 0;
+
+  uint8_t frame[TelemetryEncoder::kMaxFrame];
+  size_t len = telemetry.encode(identity.number(), mac, FIRMWARE_VERSION, heartbeat, frame, sizeof(frame));
   registration_udp.beginPacket(server_ip, REGISTRATION_SERVER_PORT);
-  registration_udp.write(reinterpret_cast<const uint8_t *>(payload), strlen(payload));
+  registration_udp.write(frame, len);
   registration_udp.endPacket();
-  Serial.printf("Registrar: sent %s\n", heartbeat ? "heartbeat" : "registration");
+  Serial.printf("Registrar: sent %s (%u bytes)\n", heartbeat ? "heartbeat" : "registration", (unsigned int)len);
+}
+
+static void send_registrar_reply(const char *reply) {
+  registration_udp.beginPacket(registration_udp.remoteIP(), registration_udp.remotePort());
+  registration_udp.write(reinterpret_cast<const uint8_t *>(reply), strlen(reply));
+  registration_udp.endPacket();
+}
+
+// LHCFG|<mac>|key=value|... provisions this unit; the MAC must be ours so a broadcast
+// can't renumber the whole fleet.
+static void handle_registrar_config(char *args) {
+  char *fields = strchr(args, '|');
+  if (fields == nullptr) {
+    return;
+  }
+  *fields++ = '\0';
+  if (!WiFi.macAddress().equalsIgnoreCase(args)) {
+    return;
+  }
+  char reply[96];
+  bool ok = identity.applyConfig(fields, reply, sizeof(reply));
+  Serial.printf("Registrar: %s\n", reply);
+  char ack[128];
+  snprintf(ack, sizeof(ack), "LHCFGACK|%s|%s", ok ? "ok" : "error", reply);
+  send_registrar_reply(ack);
+  if (ok) {
+    delay(100);
+    ESP.restart();
+  }
+}
+
+// LHCMD|<cmd_id>|HELP|... is a bot command delivered straight to this node. It is always
+// acknowledged (the bot retries until it sees LHCMDACK), but a repeat is only acted on once.
+static void handle_registrar_command(char *args) {
+  char *payload = strchr(args, '|');
+  if (payload == nullptr || strncmp(payload + 1, "HELP|", 5) != 0) {
+    return;
+  }
+  *payload++ = '\0';
+  the_mesh.handleDirectPayload(payload);
+  char ack[48];
+  snprintf(ack, sizeof(ack), "LHCMDACK|%.16s|%d", args, identity.number());
+  send_registrar_reply(ack);
+}
+
+// Packets from the registrar are "<kind>|<token>|...", except LHACK|<id>|<time>|<seq>, which
+// carries no token and only moves the telemetry delta base.
+static void handle_registrar_packet() {
+  int packet_size = registration_udp.parsePacket();
+  if (packet_size <= 0) {
+    return;
+  }
+  char buffer[320];
+  int len = registration_udp.read(buffer, sizeof(buffer) - 1);
+  if (len <= 0) {
+    return;
+  }
+  buffer[len] = '\0';
+  if (strncmp(buffer, "LHACK|", 6) == 0) {
+    // no seq field means the bot couldn't decode our last frame; the encoder then falls back
+    // to a key frame by itself
+    const char *time_field = strchr(buffer + 6, '|');
+    const char *seq_field = time_field ? strchr(time_field + 1, '|') : nullptr;
+    if (seq_field != nullptr && seq_field[1] != '\0') {
+      telemetry.onAck((uint16_t)atoi(seq_field + 1));
+    }
+    return;
+  }
+  bool is_config = strncmp(buffer, "LHCFG|", 6) == 0;
+  bool is_command = strncmp(buffer, "LHCMD|", 6) == 0;
+  if (!is_config && !is_command) {
+    return;
+  }
+  char *token = buffer + 6;
+  char *args = strchr(token, '|');
+  if (args == nullptr) {
+    return;
+  }
+  *args++ = '\0';
+#ifdef HELP_BOT_TOKEN
+  const char *expected = HELP_BOT_TOKEN;
+#else
+  const char *expected = "";
+#endif
+  if (expected[0] == '\0' || strcmp(token, expected) != 0) {
+    Serial.printf("Registrar: %s rejected (bad token)\n", is_config ? "LHCFG" : "LHCMD");
+    return;
+  }
+  if (is_config) {
+    handle_registrar_config(args);
+  } else {
+    handle_registrar_command(args);
+  }
 }
 #endif
 
+static void run_provisioning_command(const char *line, char *reply, size_t reply_len) {
+  bool reboot = false;
+  if (!identity.handleCommand(line, reply, reply_len, &reboot)) {
+    reply[0] = '\0';
+    return;
+  }
+  Serial.println(reply);
+#ifdef ESP32
+  if (reboot) {
+    delay(100);
+    ESP.restart();
+  }
+#endif
+}
+
+// LHCFG text commands arrive over USB serial on UART builds and as frames on the BLE
+// link otherwise; LighthouseMesh never reads companion frames, so nothing competes.
+static void poll_provisioning() {
+  char reply[96];
+#if defined(BLE_PIN_CODE) && !defined(DISABLE_BLE)
+  uint8_t frame[MAX_FRAME_SIZE + 1];
+  size_t len = serial_interface.checkRecvFrame(frame);
+  if (len == 0) {
+    return;
+  }
+  frame[len] = 0;
+  run_provisioning_command(reinterpret_cast<const char *>(frame), reply, sizeof(reply));
+  if (reply[0] != '\0') {
+    serial_interface.writeFrame(reinterpret_cast<const uint8_t *>(reply), strlen(reply));
+  }
+#else
+  while (Serial.available() > 0) {
+    char c = (char)Serial.read();
+    if (c == '\r' || c == '\n') {
+      if (provision_line_len > 0) {
+        provision_line[provision_line_len] = '\0';
+        provision_line_len = 0;
+        run_provisioning_command(provision_line, reply, sizeof(reply));
+      }
+    } else if (provision_line_len < MAX_FRAME_SIZE) {
+      provision_line[provision_line_len++] = c;
+    }
+  }
+#endif
+}
+
 void loop() {
+#ifdef ESP32
+  uint32_t now_us = micros();
+  if (last_loop_us != 0 && now_us - last_loop_us > loop_max_us) {
+    loop_max_us = now_us - last_loop_us;
+  }
+  last_loop_us = now_us;
+#endif
   the_mesh.loop();
+  poll_provisioning();
   rtc_clock.tick();
   light_ring.loop();
   light_chime.loop();
   audio_streamer.loop();
   if (audio_streamer.isPlaying()) {
     light_ring.setAudioLevel(audio_streamer.getLevel());
+#if AUDIO_SPECTRUM_ENABLED
+    uint8_t bands[LIGHT_RING_COUNT];
+    light_ring.setSpectrum(bands, audio_streamer.getSpectrum(bands, LIGHT_RING_COUNT));
+#endif
   } else {
     light_ring.setAudioLevel(0.0f);
+    light_ring.setSpectrum(nullptr, 0);
   }
   if (help_sfx_stage > 0 && !audio_streamer.isPlaying()) {
     if (help_sfx_stage == 1) {
@@ -244,16 +467,20 @@ void loop() {
     }
   }
   help_gateway.loop();
-  if (LIGHTHOUSE_NUMBER == 1) {
-    help_discovery.loop();
-    if (!help_bot.isEnabled() && help_discovery.hasUrl()) {
-      help_bot.setUrl(help_discovery.getUrl());
-    }
-    if (help_bot.isEnabled() && !helpbot_hello_sent) {
-      char hello[32];
-      snprintf(hello, sizeof(hello), "HELP|HELLO|LH%02d", LIGHTHOUSE_NUMBER);
-      helpbot_hello_sent = help_bot.postMeshEvent(hello, the_mesh.getNodeName());
-    }
+  help_discovery.loop();
+  if (!help_bot.isEnabled() && help_discovery.hasUrl()) {
+    help_bot.setUrl(help_discovery.getUrl());
+  }
+#ifdef ESP32
+  the_mesh.setGatewayEligible(identity.number() != 0 && WiFi.status() == WL_CONNECTED && help_bot.isEnabled());
+#endif
+  if (!the_mesh.isGatewayLeader()) {
+    helpbot_hello_sent = false;
+  } else if (help_bot.isEnabled() && !helpbot_hello_sent) {
+    // tells the bot which gateway to post to
+    char hello[32];
+    snprintf(hello, sizeof(hello), "HELP|HELLO|LH%02d", identity.number());
+    helpbot_hello_sent = help_bot.postMeshEvent(hello, the_mesh.getNodeName());
   }
 
 #ifdef ESP32
@@ -267,6 +494,10 @@ void loop() {
         Serial.println("Registrar: UDP bind failed");
       }
     }
+    if (registration_started) {
+      handle_registrar_packet();
+    }
+    update_wall_clock();
     unsigned long now = millis();
     if (last_registration_ms == 0 || (now - last_registration_ms) >= REGISTRATION_HEARTBEAT_MS) {
       send_registration_packet(last_registration_ms != 0);
@@ -293,7 +524,7 @@ void loop() {
       if (button_state == LOW) {
         press_start_ms = millis();
         long_press_sent = false;
-        Serial.printf("Lighthouse #%d: Button pressed\n", LIGHTHOUSE_NUMBER);
+        Serial.printf("Lighthouse #%d: Button pressed\n", identity.number());
         if (the_mesh.handleMailboxButton()) {
           return;
         }
@@ -301,22 +532,7 @@ void loop() {
           return;
         }
         if (!the_mesh.isHelpActive()) {
-          struct ColorChoice {
-            const char *name;
-            uint8_t r;
-            uint8_t g;
-            uint8_t b;
-          };
-          const ColorChoice choices[] = {
-            {"RED", 255, 0, 0},
-            {"ORANGE", 255, 128, 0},
-            {"YELLOW", 255, 255, 0},
-            {"GREEN", 0, 200, 0},
-            {"BLUE", 0, 120, 255},
-            {"VIOLET", 160, 0, 255},
-          };
-          size_t choice_index = (size_t)(millis() % (sizeof(choices) / sizeof(choices[0])));
-          const ColorChoice &choice = choices[choice_index];
+          const HelpColor &choice = helpColorAt((size_t)millis());
           if (the_mesh.requestHelp(choice.name)) {
             help_sfx_stage = 1;
             light_ring.setIdleColor(choice.r, choice.g, choice.b);
@@ -330,7 +546,7 @@ void loop() {
     unsigned long held_ms = millis() - press_start_ms;
     if (held_ms >= 2000 && the_mesh.isHelpActive() && !the_mesh.isAnnouncementActive() && !the_mesh.isMailboxActive()) {
       long_press_sent = true;
-      Serial.printf("Lighthouse #%d: Long press detected, canceling help\n", LIGHTHOUSE_NUMBER);
+      Serial.printf("Lighthouse #%d: Long press detected, canceling help\n", identity.number());
       if (the_mesh.cancelHelp()) {
         if (!audio_streamer.isPlaying()) {
           audio_streamer.playFile(SFX_DEQUEUE_PATH);
@@ -0,0 +1,35 @@
+#include "HelpProtocol.h"
+
+#include <chrono>
+#include <stdio.h>
+
+// Host rate of parseHelpMessage() + type lookup over a mix of channel texts, in messages/s.
+// The mesh delivers a few messages a second; this is for spotting regressions.
+int main() {
+  static const char *texts[] = {
+    "LH-03: HELP|PING|1729",
+    "HELP|REQ|r-17|BLUE|Table 4, second row",
+    "HELP|CLAIM|r-17|Mentor Sam",
+    "HELP|AUDIO|3|http://10.0.0.2:8080/clip.wav|1767225600123",
+    "HELP|TIME|1767225600123|7",
+    "LH-12: just chatting, nothing to parse here",
+    "HELP|DETAILS|r-17|1|2|3|4|5|6|7|8|9",
+    "HELP|RESOLVE|r-17",
+  };
+  const int kTexts = sizeof(texts) / sizeof(texts[0]);
+  const long kRounds = 2000000;
+
+  HelpMessage msg;
+  long parsed = 0, typed = 0;
+  auto t0 = std::chrono::steady_clock::now();
+  for (long i = 0; i < kRounds; i++) {
+    if (parseHelpMessage(texts[i % kTexts], msg)) {
+      parsed++;
+      typed += msg.type != HelpMsgType::Unknown;
+    }
+  }
+  double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+  printf("help protocol: %ld messages (%ld parsed, %ld typed) in %.3f s, %.2f M messages/s\n", kRounds, parsed, typed, s,
+         kRounds / s / 1e6);
+  return 0;
+}
@@ -0,0 +1,42 @@
+#include "SpectrumAnalyzer.h"
+
+#include <chrono>
+#include <math.h>
+#include <stdio.h>
+#include <vector>
+
+// Host cost of the spectrum analyser per block: the bare Q15 FFT, and processBlock() with the
+// window and band folding included. At 44.1 kHz a 512-sample block arrives every 11.6 ms; this is
+// for comparing block sizes and spotting regressions, not for absolute ESP32 numbers.
+int main() {
+  for (uint16_t n : { 256, 512 }) {
+    SpectrumAnalyzer sa(n, 16);
+    std::vector<int16_t> re(n), im(n, 0), work_re(n), work_im(n);
+    std::vector<int16_t> stereo(n * 2);
+    for (int i = 0; i < n; i++) {
+      re[i] = (int16_t)(12000 * sin(2 * M_PI * 17 * i / n));
+      stereo[i * 2] = stereo[i * 2 + 1] = re[i];
+    }
+
+    const int iters = 20000;
+    int32_t sink = 0;
+    auto t0 = std::chrono::steady_clock::now();
+    for (int it = 0; it < iters; it++) {
+      work_re = re;
+      work_im = im;
+      sa.transform(work_re.data(), work_im.data());
+      sink += work_im[17];
+    }
+    double fft_us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count() / iters;
+
+    t0 = std::chrono::steady_clock::now();
+    for (int it = 0; it < iters; it++) {
+      sa.processBlock(stereo.data(), n);
+    }
+    double block_us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - t0).count() / iters;
+
+    printf("spectrum %3u: fft %.2f us, processBlock %.2f us per block (%u blocks, sink %d)\n", n, fft_us, block_us,
+           (unsigned)sa.getBlocks(), (int)sink);
+  }
+  return 0;
+}
@@ -0,0 +1,13 @@
+#pragma once
+
+// Host stand-ins for the few Arduino/library symbols the mesh sources pull in, so src/ code
+// (bridges, packet managers) can be built into the host tests. Not a general Arduino shim.
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "Stream.h"
+
+unsigned long millis();  // defined by the test
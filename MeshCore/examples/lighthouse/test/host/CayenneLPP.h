@@ -0,0 +1,11 @@
+#pragma once
+
+#include <stdint.h>
+
+class CayenneLPP {
+public:
+  CayenneLPP(uint8_t) {}
+  void reset() {}
+  uint8_t getSize() { return 0; }
+  uint8_t *getBuffer() { return nullptr; }
+};
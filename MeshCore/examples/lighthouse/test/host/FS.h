@@ -0,0 +1,10 @@
+#pragma once
+
+#include "Stream.h"
+
+namespace fs {
+class FS {
+public:
+  bool mkdir(const char *) { return true; }
+};
+}
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <stdint.h>
+
+class DateTime {
+public:
+  DateTime(uint32_t) {}
+  int hour() const { return 0; }
+  int minute() const { return 0; }
+  int second() const { return 0; }
+  int day() const { return 1; }
+  int month() const { return 1; }
+  int year() const { return 2000; }
+};
@@ -0,0 +1,31 @@
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Not SHA-256: FNV-1a spread over the digest. Packet hashes only need to be stable and distinct
+// for the duplicate tables; nothing in the host tests relies on the real digest.
+class SHA256 {
+public:
+  void update(const void *data, size_t len) {
+    const uint8_t *p = (const uint8_t *)data;
+    for (size_t i = 0; i < len; i++) {
+      _h = (_h ^ p[i]) * 1099511628211ull;
+    }
+  }
+  void finalize(void *out, size_t len) {
+    uint8_t *o = (uint8_t *)out;
+    for (size_t i = 0; i < len; i++) {
+      o[i] = (uint8_t)(_h >> ((i % 8) * 8));
+      if (i % 8 == 7) {
+        _h *= 1099511628211ull;
+      }
+    }
+    _h = 1469598103934665603ull;
+  }
+  void resetHMAC(const void *, size_t) {}
+  void finalizeHMAC(const void *, size_t, void *, size_t) {}
+
+private:
+  uint64_t _h = 1469598103934665603ull;
+};
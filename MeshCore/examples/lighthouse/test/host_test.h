@@ -0,0 +1,34 @@
+#pragma once
+
+#include <stdio.h>
+
+// Minimal checks for the host tests. A failed check is printed and counted; main() returns
+// TEST_RESULT() so make stops on the first failing binary.
+static int g_failures = 0;
+
+#define CHECK(cond)                                                          \
+  do {                                                                       \
+    if (!(cond)) {                                                           \
+      printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond);        \
+      g_failures++;                                                          \
+    }                                                                        \
+  } while (0)
+
+#define CHECK_EQ(a, b)                                                       \
+  do {                                                                       \
+    long long _a = (long long)(a), _b = (long long)(b);                      \
+    if (_a != _b) {                                                          \
+      printf("%s:%d: %s == %s failed (%lld vs %lld)\n", __FILE__, __LINE__,  \
+             #a, #b, _a, _b);                                                \
+      g_failures++;                                                          \
+    }                                                                        \
+  } while (0)
+
+#define RUN(test)                                                            \
+  do {                                                                       \
+    int _before = g_failures;                                                \
+    test();                                                                  \
+    printf("%s %s\n", g_failures == _before ? "ok  " : "FAIL", #test);      \
+  } while (0)
+
+#define TEST_RESULT() (g_failures == 0 ? 0 : 1)
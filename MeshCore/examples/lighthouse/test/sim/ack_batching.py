@@ -0,0 +1,78 @@
+# Offline benchmark of direct-ACK batching (Mesh::getAckBatchWindow) around a room server.
+# R (room server) -- P (repeater) -- N clients, stock SF10/BW250/CR4-5. Airtime and ACK latency;
+# no collisions (so the "before" case is, if anything, flattered).
+import heapq, math, random
+
+def airtime(n, sf=10, bw=250000, cr=1, pre=8):
+    tsym = (2 ** sf) / bw * 1000
+    nsym = 8 + max(math.ceil((8 * n - 4 * sf + 28 + 16) / (4 * sf)) * (cr + 4), 0)
+    return (pre + 4.25) * tsym + nsym * tsym
+
+def pad16(n): return (n + 15) // 16 * 16
+TXT = 2 + 1 + 1 + 1 + 2 + pad16(5 + 60)   # header, path_len, path(1), dest/src hash, MAC, cipher
+TXT_ACK_DELAY = 200
+
+class Sim:
+    def __init__(self, window, extra):
+        self.window, self.extra = window, extra
+        self.ev, self.seq = [], 0
+        self.q = {}            # node -> [(path_len, born)]
+        self.due = {}
+        self.ack_air = self.data_air = 0.0
+        self.frames = 0
+        self.lat = []
+    def at(self, t, *e):
+        heapq.heappush(self.ev, (t, self.seq, e)); self.seq += 1
+    def ack(self, t, node, path_len, delay, born):
+        if self.window == 0:
+            self.tx(t + delay, node, [(path_len, born)]); return
+        q = self.q.setdefault(node, [])
+        if not q:
+            self.due[node] = t + delay + self.window
+            self.at(self.due[node], 'flush', node, self.due[node])
+        q.append((path_len, born))
+        if len(q) >= 8: self.flush(t, node)
+    def flush(self, t, node):
+        q = self.q.get(node)
+        if q: self.q[node] = []; self.tx(max(t, self.due[node]), node, q)
+    def tx(self, t, node, entries):
+        n = 2 + entries[0][0] + 4 if len(entries) == 1 else 2 + 1 + sum(5 + pl for pl, _ in entries)
+        a = airtime(n)
+        self.ack_air += a * (1 + self.extra); self.frames += 1 + self.extra
+        for pl, born in entries:
+            if pl == 0: self.lat.append(t + a - born)          # last hop: delivered
+            else: self.at(t + a, 'relay', pl - 1, born)          # the repeater takes it on
+    def run(self):
+        while self.ev:
+            t, _, e = heapq.heappop(self.ev)
+            if e[0] == 'data':              # a post/push arrives at its end node, which ACKs it back 2 hops
+                self.data_air += 2 * airtime(TXT)
+                self.ack(t, e[1], 1, TXT_ACK_DELAY, t)
+            elif e[0] == 'relay':
+                self.ack(t, 'P', e[1], 0, e[2])
+            elif e[0] == 'flush' and self.due.get(e[1]) == e[2]:
+                self.flush(t, e[1])
+
+def scenario(n, burst_s, posts, window, extra, seed=1):
+    rng = random.Random(seed)
+    s = Sim(window, extra)
+    times = sorted((rng.uniform(0, burst_s * 1000), c) for c in range(n) for _ in range(posts))
+    for t, c in times: s.at(t + 2 * airtime(TXT), 'data', 'R')   # post reaches R
+    t = burst_s * 1000 + 2000
+    for _, c in times:                                               # then R syncs it to everyone else
+        for d in range(n):
+            if d != c: s.at(t + 2 * airtime(TXT), 'data', f'C{d}'); t += 1200 / 2   # two clients per slot
+    s.run()
+    return s
+
+for extra in (0, 1):
+    print(f"multi_acks={extra}")
+    for n, burst in ((4, 5), (8, 5), (16, 10)):
+        base = None
+        for w in (0, 300, 800, 1500):
+            s = scenario(n, burst, 2, w, extra)
+            share = 100 * s.ack_air / (s.ack_air + s.data_air)
+            base = base or s.ack_air
+            print(f"  {n:2d} clients, {burst:2d}s burst, window {w:4d} ms: ACK share {share:4.1f}%, "
+                  f"{s.frames:4d} frames, -{100*(1-s.ack_air/base):4.1f}% ACK air, "
+                  f"latency {sum(s.lat)/len(s.lat):5.0f} ms mean, {max(s.lat):5.0f} max")
@@ -0,0 +1,169 @@
+// Flood rebroadcast delay policies: uniform slots vs a contention window sized from overheard
+// copies per flood and the LBT busy rate, optionally with SNR-weighted slots (far links first).
+// Several floods share the air (Poisson arrivals), so collisions and LBT deferrals are real.
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <vector>
+#include <queue>
+#include <random>
+#include <algorithm>
+
+enum Policy { UNIFORM, ADAPTIVE };
+struct Cfg { const char* name; Policy p; int slots; float slot_factor; int threshold; int max_slots; bool snr_weight; double per_k; };
+static std::vector<int> nbrs; static double BUSYW = 2;
+
+static int N;
+static std::vector<std::vector<double>> SNR;
+static std::mt19937 rng(42);
+static std::vector<double> echoes, busy;
+
+static double airtime_ms(int len) {
+  double ts = (1 << 7) / 62.5;
+  int sf = 7;
+  double pl = std::ceil((8.0 * len - 4 * sf + 28 + 16) / (4.0 * sf)) * 5;
+  return (8 + 4.25 + 8 + std::max(pl, 0.0)) * ts;
+}
+
+static int contention_slots(const Cfg& c, int n) {
+  double k = nbrs[n];
+  int w = (int)(2 + c.per_k * k * (1.0 + BUSYW * busy[n]));
+  return std::max(2, std::min(c.max_slots, w));
+}
+
+static int pick_slot(int w, double snr, bool weight) {
+  if (!weight) return rng() % w;
+  double q = (snr + 10) / 20; q = std::max(0.0, std::min(1.0, q));
+  int band = std::max(2, w / 2);
+  if (band > w) band = w;
+  int lo = (int)(q * (w - band) + 0.5);
+  return lo + rng() % band;
+}
+
+struct Tx { int node, flood; double start, end; };
+struct Ev { double t; int type; int node; int flood; bool operator<(const Ev& o) const { return t > o.t; } };
+struct Totals { double air = 0, delivered = 0, wanted = 0, full = 0, lat = 0; int floods = 0; };
+
+void run(const Cfg& c, int F, double rate_per_s, int len, Totals* tot) {
+  double air = airtime_ms(len + 1);
+  std::uniform_real_distribution<double> u(0, 1);
+  std::vector<std::vector<int>> got(F, std::vector<int>(N)), heard(F, std::vector<int>(N)), copies(F, std::vector<int>(N));
+  std::vector<std::vector<char>> sent(F, std::vector<char>(N)), cancelled(F, std::vector<char>(N)), pending(F, std::vector<char>(N));
+  std::vector<double> start(F), suml(F);
+  std::vector<Tx> txs;
+  std::priority_queue<Ev> q;
+  double t0 = 0;
+  for (int f = 0; f < F; f++) {
+    t0 += -std::log(1 - u(rng)) / rate_per_s * 1000;
+    int src = rng() % N;
+    start[f] = t0; got[f][src] = 1;
+    q.push({t0, 0, src, f});
+  }
+  int ntx = 0;
+  std::vector<int> folded(F, 0);
+  std::vector<double> radio_busy_until(N, 0);
+  while (!q.empty()) {
+    Ev e = q.top(); q.pop();
+    int n = e.node, f = e.flood;
+    if (e.type == 0) {
+      if (cancelled[f][n] || sent[f][n]) continue;
+      bool b = radio_busy_until[n] > e.t;
+      for (auto& t : txs) if (t.start <= e.t && e.t < t.end && SNR[t.node][n] > -7.5) b = true;
+      busy[n] = busy[n] * 15 / 16 + (b ? 1.0 / 16 : 0);
+      if (b) { q.push({e.t + (1 + rng() % 3) * 120.0, 0, n, f}); continue; }
+      sent[f][n] = 1; ntx++;
+      txs.push_back({n, f, e.t, e.t + air});
+      radio_busy_until[n] = e.t + air;
+      q.push({e.t + air, 1, n, f});
+    } else if (e.type == 1) {
+      Tx me{};
+      for (auto& t : txs) if (t.node == n && t.flood == f && std::abs(t.end - e.t) < 1e-9) me = t;
+      for (int r = 0; r < N; r++) {
+        if (r == n) continue;
+        double s = SNR[n][r];
+        if (s < -7.5) continue;
+        bool ok = true;
+        for (auto& o : txs) {
+          if (o.node == me.node && o.start == me.start) continue;
+          if (o.end <= me.start || o.start >= me.end) continue;
+          if (o.node == r) { ok = false; break; }
+          double i = SNR[o.node][r];
+          if (i > -20 && s - i < 6) { ok = false; break; }
+        }
+        if (!ok) continue;
+        copies[f][r]++;
+        if (!got[f][r]) {
+          got[f][r] = 1; suml[f] += e.t - start[f];
+          int w = c.p == UNIFORM ? c.slots : contention_slots(c, r);
+          int slot = c.p == UNIFORM ? (int)(rng() % w) : pick_slot(w, s, c.snr_weight);
+          q.push({e.t + slot * air * c.slot_factor, 0, r, f});
+          pending[f][r] = 1;
+          q.push({e.t + 20 * air, 2, r, f});   // fold copies into the estimate later (ring eviction)
+        } else if (c.threshold > 0 && !sent[f][r] && !cancelled[f][r] && pending[f][r]) {
+          if (++heard[f][r] >= c.threshold) cancelled[f][r] = 1;
+        }
+      }
+      // forget old transmissions
+      txs.erase(std::remove_if(txs.begin(), txs.end(), [&](const Tx& t){ return t.end < e.t - 5 * air; }), txs.end());
+    } else {
+      echoes[n] = echoes[n] < 0 ? copies[f][n] : echoes[n] * 0.875 + copies[f][n] * 0.125;
+    }
+  }
+  for (int f = 0; f < F; f++) {
+    int reach = 0; for (int i = 0; i < N; i++) if (got[f][i]) reach++;
+    tot->delivered += reach - 1; tot->wanted += N - 1;
+    if (reach == N) tot->full++;
+    tot->lat += reach > 1 ? suml[f] / (reach - 1) : 0;
+    tot->floods++;
+  }
+  tot->air += ntx * air;
+}
+
+static void layout(const char* kind, double n_exp) {
+  std::normal_distribution<double> shadow(0, 4.0), jit(0, 7.5);
+  std::vector<double> X, Y;
+  if (kind[0] == 'g') {   // 6x5 grid, 60 m pitch
+    N = 30;
+    for (int i = 0; i < N; i++) { X.push_back((i % 6) * 60 + jit(rng)); Y.push_back((i / 6) * 60 + jit(rng)); }
+  } else {                 // hack hall: 3 dense tables of 12 nodes, 150 m apart, plus 4 lobby nodes between
+    N = 40;
+    std::normal_distribution<double> tbl(0, 6);
+    for (int k = 0; k < 3; k++) for (int i = 0; i < 12; i++) { X.push_back(k * 150 + tbl(rng)); Y.push_back(tbl(rng)); }
+    for (int i = 0; i < 4; i++) { X.push_back(37 + i * 75 + jit(rng)); Y.push_back(30 + jit(rng)); }
+  }
+  SNR.assign(N, std::vector<double>(N, -99));
+  for (int a = 0; a < N; a++) for (int b = a + 1; b < N; b++) {
+    double d = std::max(1.0, std::hypot(X[a] - X[b], Y[a] - Y[b]));
+    double pl = 40 + 10 * n_exp * std::log10(d) + shadow(rng);
+    SNR[a][b] = SNR[b][a] = 22 - pl + 120;
+  }
+}
+
+int main(int argc, char** argv) {
+  if (argc > 1) BUSYW = atof(argv[1]);
+  Cfg cfgs[] = {
+    {"uniform 5 x air/2 (Mesh)",       UNIFORM, 5, 0.52, 0, 0, false, 0},
+    {"adaptive+SNR x air/2",           ADAPTIVE, 0, 0.52, 0, 16, true, .5},
+    {"uniform 8 x air, C=3 (lh)",      UNIFORM, 8, 1.04, 3, 0, false, 0},
+    {"adaptive, no SNR x air, C=3",    ADAPTIVE, 0, 1.04, 3, 16, false, .5},
+    {"adaptive+SNR x air, C=3",        ADAPTIVE, 0, 1.04, 3, 16, true, .5},
+  };
+  struct Scn { const char* kind; double n_exp; double rate; };
+  Scn scns[] = { {"grid", 4.5, 0.05}, {"grid", 5.5, 0.05}, {"grid", 5.5, 0.2}, {"hall", 4.5, 0.05}, {"hall", 5.0, 0.05}, {"hall", 5.0, 0.2} };
+  for (auto& sc : scns) {
+    nbrs.clear();
+    rng.seed(7);
+    layout(sc.kind, sc.n_exp);
+    int deg = 0; nbrs.assign(N, 0); for (int a = 0; a < N; a++) for (int b = 0; b < N; b++) if (a != b && SNR[a][b] > -7.5) { deg++; nbrs[a]++; }
+    printf("\n%s, exponent %.1f, %.2f floods/s: %d nodes, mean neighbours %.1f\n", sc.kind, sc.n_exp, sc.rate, N, deg / double(N));
+    printf("%-30s %7s %7s %11s %9s\n", "policy", "reach%", "full%", "air ms/dlv", "mean ms");
+    for (auto& c : cfgs) {
+      echoes.assign(N, -1); busy.assign(N, 0);
+      Totals warm; run(c, 100, sc.rate, 80, &warm);
+      Totals t;
+      for (int k = 0; k < 10; k++) run(c, 200, sc.rate, 80, &t);
+      printf("%-30s %7.2f %7.1f %11.1f %9.0f\n", c.name, 100 * t.delivered / t.wanted, 100 * t.full / t.floods,
+             t.air / t.delivered, t.lat / t.floods);
+    }
+  }
+}
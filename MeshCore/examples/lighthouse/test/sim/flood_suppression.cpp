@@ -0,0 +1,124 @@
+// Flood relaying in a 30-lighthouse layout: airtime per delivered flood, with and without
+// counter-based suppression of queued rebroadcasts.
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <vector>
+#include <queue>
+#include <random>
+#include <algorithm>
+
+struct Cfg { const char* name; int threshold; float min_snr; int slots; float slot_factor; int max_hops; };
+
+static const int N = 30;
+static double X[N], Y[N], SNR[N][N];
+static std::mt19937 rng(42);
+
+static double airtime_ms(int len) {  // SX126x, SF7 BW62.5 CR4/5, 8-symbol preamble, explicit header, CRC
+  double ts = (1 << 7) / 62.5;  // ms
+  int sf = 7;
+  double pl = std::ceil((8.0 * len - 4 * sf + 28 + 16) / (4.0 * sf)) * 5;
+  return (8 + 4.25 + 8 + std::max(pl, 0.0)) * ts;
+}
+
+struct Tx { int node; double start, end; };
+
+struct Result { double airtime, reach, txs, suppressed, latency; };
+
+// one flood from 'src'; 'bg' = concurrent independent floods sharing the channel (load)
+Result run_flood(const Cfg& c, int src, int len) {
+  double air = airtime_ms(len + 1);  // path grows a byte per hop; close enough
+  std::vector<Tx> txs;
+  std::vector<int> got(N, 0), heard(N, 0), hops(N, 0);
+  std::vector<double> pending(N, -1), got_at(N, 0);  // scheduled TX time
+  std::vector<bool> cancelled(N, false), sent(N, false);
+  std::uniform_real_distribution<double> u(0, 1);
+
+  struct Ev { double t; int type; int node; bool operator<(const Ev& o) const { return t > o.t; } };
+  std::priority_queue<Ev> q;
+  got[src] = 1; hops[src] = 0;
+  q.push({0, 0, src});  // 0 = try TX
+  int ntx = 0, nsupp = 0;
+  double last_rx = 0;
+  while (!q.empty()) {
+    Ev e = q.top(); q.pop();
+    if (e.type == 0) {
+      int n = e.node;
+      if (cancelled[n] || sent[n]) continue;
+      // listen before talk: channel busy if we're hearing an ongoing TX
+      bool busy = false;
+      for (auto& t : txs) if (t.start <= e.t && e.t < t.end && SNR[t.node][n] > -7.5) busy = true;
+      if (busy) { q.push({e.t + (1 + rng() % 3) * 120.0, 0, n}); continue; }
+      sent[n] = true; ntx++;
+      txs.push_back({n, e.t, e.t + air});
+      q.push({e.t + air, 1, n});  // 1 = TX ends, evaluate receptions
+    } else {
+      const Tx& me = *std::find_if(txs.begin(), txs.end(), [&](const Tx& t){ return t.node == e.node && std::abs(t.end - e.t) < 1e-9; });
+      for (int r = 0; r < N; r++) {
+        if (r == me.node) continue;
+        double s = SNR[me.node][r];
+        if (s < -7.5) continue;
+        bool ok = true;
+        for (auto& o : txs) {
+          if (&o == &me) continue;
+          if (o.end <= me.start || o.start >= me.end) continue;
+          if (o.node == r) { ok = false; break; }  // half duplex
+          double i = SNR[o.node][r];
+          if (i > -20 && s - i < 6) { ok = false; break; }  // no capture
+        }
+        if (!ok) continue;
+        if (!got[r]) {
+          got[r] = 1; hops[r] = hops[me.node] + 1; got_at[r] = e.t; last_rx = std::max(last_rx, e.t);
+          if (hops[r] < c.max_hops) {
+            double t = air * c.slot_factor;
+            double d = (rng() % c.slots) * t;
+            q.push({e.t + d, 0, r});
+            pending[r] = e.t + d;
+          }
+        } else if (c.threshold > 0 && !sent[r] && !cancelled[r] && pending[r] >= 0 && s >= c.min_snr) {
+          if (++heard[r] >= c.threshold) { cancelled[r] = true; nsupp++; }
+        }
+      }
+    }
+  }
+  int reach = 0; for (int i = 0; i < N; i++) if (i != src && got[i]) reach++;
+  return { ntx * air, reach / double(N - 1), (double)ntx, (double)nsupp, last_rx };
+}
+
+int main(int argc, char** argv) {
+  double n_exp = argc > 1 ? atof(argv[1]) : 4.5;
+  // 6 x 5 grid, 60 m pitch, +-15 m jitter: lighthouses spread over the venue's halls and lobbies
+  std::normal_distribution<double> jit(0, 7.5), shadow(0, 4.0);
+  for (int i = 0; i < N; i++) { X[i] = (i % 6) * 60 + jit(rng); Y[i] = (i / 6) * 60 + jit(rng); }
+  for (int a = 0; a < N; a++) for (int b = a + 1; b < N; b++) {
+    double d = std::max(1.0, std::hypot(X[a] - X[b], Y[a] - Y[b]));
+    double pl = 40 + 10 * n_exp * std::log10(d) + shadow(rng);
+    SNR[a][b] = SNR[b][a] = 22 - pl + 120;  // 22 dBm, -120 dBm noise floor at 62.5 kHz
+  }
+  int deg = 0; for (int a = 0; a < N; a++) for (int b = 0; b < N; b++) if (a != b && SNR[a][b] > -7.5) deg++;
+  printf("path loss exponent %.1f: mean neighbours %.1f, packet airtime %.0f ms\n", n_exp, deg / double(N), airtime_ms(81));
+
+  Cfg cfgs[] = {
+    {"no relay (current)",          0, -128, 5, 0.52, 1},
+    {"relay, no suppression",       0, -128, 5, 0.52, 8},
+    {"relay, C=1",                  1, -128, 5, 0.52, 8},
+    {"relay, C=2",                  2, -128, 5, 0.52, 8},
+    {"relay, C=3",                  3, -128, 5, 0.52, 8},
+    {"relay, C=2, 8 slots x air",   2, -128, 8, 1.04, 8},
+    {"relay, C=2, 8 slots, snr>=0", 2,    0, 8, 1.04, 8},
+    {"relay, C=3, 8 slots x air",   3, -128, 8, 1.04, 8},
+  };
+  printf("%-30s %8s %8s %8s %8s %10s %9s\n", "mode", "reach%", "full%", "tx/fl", "supp/fl", "air ms/dlv", "last ms");
+  for (auto& c : cfgs) {
+    const int runs = 3000;
+    double air = 0, reach = 0, tx = 0, supp = 0, full = 0, lat = 0;
+    for (int k = 0; k < runs; k++) {
+      Result r = run_flood(c, rng() % N, 80);
+      air += r.airtime; reach += r.reach; tx += r.txs; supp += r.suppressed; lat += r.latency;
+      if (r.reach > 0.999) full++;
+    }
+    // airtime spent per lighthouse reached
+    printf("%-30s %8.1f %8.1f %8.2f %8.2f %10.1f %9.0f\n", c.name, 100 * reach / runs, 100 * full / runs,
+           tx / runs, supp / runs, air / (reach / runs * (N - 1)) / runs, lat / runs);
+  }
+}
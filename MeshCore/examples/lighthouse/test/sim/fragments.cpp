@@ -0,0 +1,234 @@
+// Event-driven benchmark of FragmentPool transfers (1-4 KB) over LoRa SF7/BW62.5/CR4-5.
+// Chain topology (direct route, h hops) and a zero-hop group broadcast to N receivers.
+#include <FragmentPool.h>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <queue>
+#include <random>
+#include <vector>
+#include <memory>
+#include <algorithm>
+
+using namespace mesh;
+
+static double airtime(int len) {
+  const double sf = 7, bw = 62500, cr = 1, pre = 8;
+  double tsym = std::pow(2, sf) / bw * 1000;
+  double n = 8 + std::max(std::ceil((8.0 * len - 4 * sf + 28 + 16) / (4 * sf)) * (cr + 4), 0.0);
+  return (pre + 4.25) * tsym + n * tsym;
+}
+
+struct Pkt {
+  std::vector<uint8_t> payload;
+  bool nack;
+  int next_hop;  // direct: node that should take it; -1 flood
+  int path_len;
+  int uid;
+};
+
+struct Tx { int node; double start, end; std::shared_ptr<Pkt> pkt; };
+
+struct Ev {
+  double t; long seq; int type; int node; std::shared_ptr<Pkt> pkt;
+  bool operator<(const Ev& o) const { return t > o.t || (t == o.t && seq > o.seq); }
+};
+enum { TX_TRY, TX_END, SENDER_TICK, RECV_TICK };
+
+struct Config {
+  int nodes;          // including sender
+  bool chain;         // else everyone hears everyone (zero-hop group)
+  int hops;           // chain: receiver is node 'hops'
+  double loss;
+  double budget;
+  bool hop_aware;     // interval: hop/budget aware, else 1x airtime
+  bool nacks;
+  int len;
+};
+
+struct Result { int done; int total; double goodput_sum; double tx; double nacks; };
+
+static Result run(const Config& c, int trials, unsigned seed) {
+  std::mt19937 rng(seed);
+  std::uniform_real_distribution<double> U(0, 1);
+  Result r{0, 0, 0, 0, 0};
+  for (int trial = 0; trial < trials; trial++) {
+    int N = c.nodes;
+    std::vector<std::unique_ptr<FragmentPool>> pools;
+    for (int i = 0; i < N; i++) pools.emplace_back(new FragmentPool());
+    std::vector<double> quiet_until(N, 0), busy_until(N, 0);
+    std::vector<std::vector<std::shared_ptr<Pkt>>> txq(N);
+    std::vector<Tx> txs;
+    std::priority_queue<Ev> q;
+    long seq = 0;
+    auto hears = [&](int a, int b) { return a != b && (!c.chain || std::abs(a - b) == 1); };
+
+    // sender 0 -> receivers
+    uint8_t dest = 0x42, src = 0x01;
+    FragmentPool& S = *pools[0];
+    for (int i = 0; i < c.len; i++) S.getSendBuffer()[i] = (uint8_t)rng();
+    S.beginSend(PAYLOAD_TYPE_GRP_DATA, &dest, &src, 7, c.len);
+    double full_air = airtime(2 + c.hops + MAX_PACKET_PAYLOAD);
+    double interval;
+    if (c.hop_aware) {
+      int pl = c.chain ? c.hops - 1 : -1;
+      double spacing = 1.0 + (pl < 0 ? 0 : std::min(pl, 2));
+      spacing = std::max(spacing, 1.0 + c.budget);
+      interval = full_air * spacing * 1.1;
+    } else {
+      interval = full_air * (1.0 + c.budget) * 1.02;   // just the budget
+    }
+    double timeout = airtime(255) * 8;
+    std::vector<double> done_at(N, -1);
+    std::vector<int> receivers;
+    if (c.chain) receivers.push_back(c.hops); else for (int i = 1; i < N; i++) receivers.push_back(i);
+    std::vector<std::vector<int>> relayed(N);
+
+    auto enqueue = [&](int node, std::shared_ptr<Pkt> p, double at) {
+      q.push({at, seq++, TX_TRY, node, p});
+    };
+    q.push({0, seq++, SENDER_TICK, 0, nullptr});
+    for (int rcv : receivers) q.push({timeout / 4, seq++, RECV_TICK, rcv, nullptr});
+    double next_frag = 0;
+    double horizon = 600000;
+    int n_tx = 0, n_nack = 0;
+
+    while (!q.empty()) {
+      Ev e = q.top(); q.pop();
+      if (e.t > horizon) break;
+      bool all_done = true;
+      for (int rcv : receivers) if (done_at[rcv] < 0) all_done = false;
+      if (all_done && !S.isSending()) break;
+
+      if (e.type == SENDER_TICK) {
+        if (S.isSending() && e.t >= next_frag) {
+          auto p = std::make_shared<Pkt>();
+          p->payload.resize(MAX_PACKET_PAYLOAD);
+          p->payload.resize(S.nextFragment(p->payload.data()));
+          p->nack = false;
+          p->next_hop = c.chain ? 1 : -1;
+          p->path_len = c.chain ? c.hops - 1 : 0;
+          enqueue(0, p, e.t);
+          next_frag = e.t + interval;
+        }
+        q.push({std::max(e.t + 20, next_frag), seq++, SENDER_TICK, 0, nullptr});
+      } else if (e.type == RECV_TICK) {
+        if (c.nacks) {
+          uint8_t nack[FRAGMENT_NACK_SIZE];
+          uint8_t self = (uint8_t)(0x80 + e.node);
+          int n = pools[e.node]->checkStalled(nack, &self, (unsigned long)e.t, (unsigned long)timeout);
+          if (n > 0) {
+            auto p = std::make_shared<Pkt>();
+            p->payload.assign(nack, nack + n);
+            p->nack = true;
+            p->next_hop = -1;
+            p->uid = n_nack + 1;
+            enqueue(e.node, p, e.t);
+            n_nack++;
+          }
+        }
+        q.push({e.t + 50, seq++, RECV_TICK, e.node, nullptr});
+      } else if (e.type == TX_TRY) {
+        int n = e.node;
+        double t = e.t;
+        // own radio: busy transmitting or in budget silence
+        double wait = std::max(busy_until[n], quiet_until[n]);
+        // LBT: a neighbour on air
+        for (auto& x : txs) if (hears(x.node, n) && x.start <= t && x.end > t) wait = std::max(wait, x.end + U(rng) * 60);
+        if (wait > t) { q.push({wait, seq++, TX_TRY, n, e.pkt}); continue; }
+        int len = 2 + e.pkt->path_len + (int)e.pkt->payload.size();
+        double a = airtime(len);
+        txs.push_back({n, t, t + a, e.pkt});
+        busy_until[n] = t + a;
+        quiet_until[n] = t + a + a * c.budget;
+        n_tx++;
+        q.push({t + a, seq++, TX_END, n, e.pkt});
+      } else if (e.type == TX_END) {
+        Tx me = txs.back();
+        for (auto& x : txs) if (x.node == e.node && x.end == e.t) { me = x; break; }
+        for (int j = 0; j < N; j++) {
+          if (!hears(me.node, j)) continue;
+          bool ok = U(rng) >= c.loss;
+          for (auto& x : txs) {
+            if (&x == &me || x.node == me.node) continue;
+            if (x.start < me.end && x.end > me.start && (x.node == j || hears(x.node, j))) { ok = false; break; }
+          }
+          if (!ok) continue;
+          auto& p = *me.pkt;
+          if (p.nack) {
+            // NACK flood: the sender takes it, relays pass it on once
+            if (j == 0) {
+              S.onNack(p.payload.data(), p.payload.size(), &src);
+              if (next_frag < e.t) next_frag = e.t;
+            } else {
+              pools[j]->onNackOverheard(p.payload.data(), p.payload.size(), (unsigned long)e.t, (unsigned long)timeout);
+              auto& rl = relayed[j];
+              if (c.chain && j != c.hops && std::find(rl.begin(), rl.end(), p.uid) == rl.end()) {
+                rl.push_back(p.uid);
+                enqueue(j, me.pkt, e.t + (int)(U(rng) * 5) * airtime(20) * 0.52);
+              }
+            }
+          } else if (c.chain && j != c.hops) {
+            if (j == p.next_hop) {   // relay, forwards with no extra delay
+              auto f = std::make_shared<Pkt>(p);
+              f->next_hop = j + 1;
+              f->path_len = p.path_len - 1;
+              enqueue(j, f, e.t + 5);
+            }
+          } else if (j != 0 && done_at[j] < 0) {
+            double jit = timeout + U(rng) * timeout / 2;
+            if (pools[j]->addFragment(p.payload.data(), p.payload.size(), (unsigned long)e.t, (unsigned long)jit)) {
+              done_at[j] = e.t;
+            }
+          }
+        }
+      }
+      // drop old transmissions
+      if (txs.size() > 64) txs.erase(txs.begin(), txs.begin() + 32);
+    }
+    for (int rcv : receivers) {
+      r.total++;
+      if (done_at[rcv] > 0) {
+        r.done++;
+        r.goodput_sum += c.len / (done_at[rcv] / 1000.0);
+      }
+    }
+    r.tx += n_tx;
+    r.nacks += n_nack;
+  }
+  r.tx /= trials;
+  r.nacks /= trials;
+  return r;
+}
+
+int main() {
+  const int T = 200;
+  printf("chain, direct route, lighthouse budget 1.0 (goodput B/s over completed, completion %%, tx/transfer)\n");
+  printf("%-5s %-5s %-5s | %-28s | %-28s | %-28s\n", "len", "hops", "loss", "budget-only spacing +NACK", "hop-aware spacing, no NACK", "hop-aware spacing +NACK");
+  for (int len : {1024, 2048, 4096}) {
+    for (int hops : {1, 2, 3}) {
+      for (double loss : {0.0, 0.05, 0.15}) {
+        Config a{hops + 1, true, hops, loss, 1.0, false, true, len};
+        Config b{hops + 1, true, hops, loss, 1.0, true, false, len};
+        Config d{hops + 1, true, hops, loss, 1.0, true, true, len};
+        Result ra = run(a, T, 1), rb = run(b, T, 1), rd = run(d, T, 1);
+        auto fmt = [](Result r, char* out) {
+          snprintf(out, 64, "%6.0f B/s %5.1f%% %5.1f tx", r.done ? r.goodput_sum / r.done : 0.0, 100.0 * r.done / r.total, r.tx);
+        };
+        char sa[64], sb[64], sd[64];
+        fmt(ra, sa); fmt(rb, sb); fmt(rd, sd);
+        printf("%-5d %-5d %-5.2f | %-28s | %-28s | %-28s\n", len, hops, loss, sa, sb, sd);
+      }
+    }
+  }
+  printf("\nzero-hop group broadcast to 10 lighthouses (budget 1.0)\n");
+  for (int len : {320, 1024, 4096}) {
+    for (double loss : {0.05, 0.15}) {
+      Config nn{11, false, 1, loss, 1.0, true, false, len};
+      Config yn{11, false, 1, loss, 1.0, true, true, len};
+      Result a = run(nn, T, 2), b = run(yn, T, 2);
+      printf("len %-5d loss %.2f | no NACK: %5.1f%% complete | NACK: %5.1f%% complete, %6.0f B/s, %.1f NACKs, %.1f tx\n",
+             len, loss, 100.0 * a.done / a.total, 100.0 * b.done / b.total, b.done ? b.goodput_sum / b.done : 0.0, b.nacks, b.tx);
+    }
+  }
+}
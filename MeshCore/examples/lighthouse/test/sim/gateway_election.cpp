@@ -0,0 +1,103 @@
+// Gateway failover: four lighthouses (2, 5, 7, 12) run GatewayElection over a channel with a fixed
+// one-way latency. Leader #2 fails at t=60 s, by resigning (WiFi lost) or by going silent (power
+// loss); in the third scenario it resigns and comes back 40 s later.
+//   failover = time until another node leads, overlap = time two nodes both believed they led
+#include "GatewayElection.h"
+
+#include <deque>
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+namespace {
+struct Msg {
+  uint32_t at;
+  int from;
+  bool up;
+};
+
+const int kNums[] = { 2, 5, 7, 12 };
+const int kNodes = sizeof(kNums) / sizeof(kNums[0]);
+const uint32_t kFailAt = 60000, kReturnAfter = 40000, kEnd = 150000, kStep = 10;
+const char *kScenarios[] = { "resign", "silent", "resign+return" };
+
+void run(uint32_t latency, int scenario) {
+  std::vector<GatewayElection> g;
+  std::vector<bool> alive(kNodes, true);
+  for (int i = 0; i < kNodes; i++) {
+    g.emplace_back(10000, 25000, 500);
+    g.back().setSelf(kNums[i]);
+    g.back().setEligible(true, (uint32_t)(i * 137));
+  }
+
+  std::deque<Msg> air;
+  uint32_t new_leader_at = 0, overlap_ms = 0;
+  int announces = 0;
+  for (uint32_t t = 0; t < kEnd; t += kStep) {
+    if (t == kFailAt) {
+      if (scenario == 1) {
+        alive[0] = false;
+      } else {
+        g[0].setEligible(false, t);
+      }
+    }
+    if (scenario == 2 && t == kFailAt + kReturnAfter) {
+      g[0].setEligible(true, t);
+    }
+    while (!air.empty() && air.front().at <= t) {
+      Msg m = air.front();
+      air.pop_front();
+      for (int i = 0; i < kNodes; i++) {
+        if (alive[i] && kNums[i] != m.from) {
+          g[i].onHeartbeat(m.from, m.up, t);
+        }
+      }
+    }
+    int leaders = 0;
+    for (int i = 0; i < kNodes; i++) {
+      if (!alive[i]) {
+        continue;
+      }
+      GatewayElection::Action a = g[i].tick(t);
+      if (a != GatewayElection::Action::None) {
+        air.push_back({ t + latency, kNums[i], a == GatewayElection::Action::Announce });
+        announces += a == GatewayElection::Action::Announce;
+      }
+      if (g[i].isLeader(t)) {
+        leaders++;
+        if (t > kFailAt && new_leader_at == 0 && i > 0) {
+          new_leader_at = t;
+        }
+      }
+    }
+    if (leaders > 1) {
+      overlap_ms += kStep;
+    }
+  }
+
+  int leader_at_end = 0;
+  for (int i = 0; i < kNodes; i++) {
+    if (alive[i] && g[i].isLeader(kEnd)) {
+      leader_at_end = kNums[i];
+    }
+  }
+  printf("%6u ms  %-14s %8u ms %6d %8u ms %6d\n", latency, kScenarios[scenario],
+         new_leader_at ? new_leader_at - kFailAt : 0, leader_at_end, overlap_ms, announces);
+}
+}
+
+int main(int argc, char **argv) {
+  printf("latency    scenario       failover  leader   overlap  heartbeats\n");
+  if (argc > 1) {
+    for (int s = 0; s < 3; s++) {
+      run((uint32_t)atoi(argv[1]), s);
+    }
+    return 0;
+  }
+  for (uint32_t latency : { 300u, 2000u }) {
+    for (int s = 0; s < 3; s++) {
+      run(latency, s);
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,81 @@
+// per-link rate model: chain of direct hops, bursts of packets, SNR fading, same rules as Mesh::askLinkRate()
+#include <helpers/LoRaAirtime.h>
+#include <algorithm>
+#include <cstdio>
+#include <cmath>
+#include <random>
+#include <vector>
+
+struct Cfg { const char* name; uint8_t base_sf, min_sf, bw_div, cr; };
+static std::mt19937 rng(42);
+
+static double floorDb(int sf) { return -2.5*(sf - 4); }
+static uint32_t air(int len, int sf, const Cfg& c) { return LoRaAirtime::millis(len, sf, c.bw_div, c.cr, 16); }
+
+static int pickSF(double snr_low, const Cfg& c, double margin) {
+  for (int sf = c.min_sf; sf < c.base_sf; sf++) if (snr_low >= floorDb(sf) + margin) return sf;
+  return 0;
+}
+
+struct Result { double air_ms, time_ms; int sent, delivered; };
+
+// one burst of n packets of 'len' over a chain with given mean link SNRs
+static Result runBurst(const Cfg& c, const std::vector<double>& link_snr, int n, int len, bool adr, double margin, double sigma) {
+  std::normal_distribution<double> fade(0.0, sigma);
+  Result r = {0, 0, n, 0};
+  const double budget = 1.0, guard = 30;
+  const int ctl = 8 + 6;   // REQ + ACK raw bytes = 8 and 6
+  std::vector<bool> alive(n, true);
+  for (size_t h = 0; h < link_snr.size(); h++) {
+    int live = 0; for (bool a : alive) live += a;
+    if (live == 0) break;
+    double snr_low = link_snr[h] - 2*sigma;   // what snr_low settles around
+    int sf = adr ? pickSF(snr_low, c, margin) : 0;
+    int plen = len + (int)(link_snr.size() - h);   // path shrinks per hop
+    if (sf) {
+      double base_air = live*air(plen, c.base_sf, c), fast_air = live*air(plen, sf, c);
+      double ctl_air = air(8, c.base_sf, c) + air(6, c.base_sf, c);
+      if (base_air <= fast_air + ctl_air + 2*guard) sf = 0;
+      else {
+        // handshake at base SF: both must get through
+        bool ok = link_snr[h] + fade(rng) >= floorDb(c.base_sf) && link_snr[h] + fade(rng) >= floorDb(c.base_sf);
+        r.air_ms += ctl_air; r.time_ms += ctl_air + guard;
+        if (!ok) sf = 0;   // falls back, timeout adds the slack
+        if (!ok) r.time_ms += 300;
+      }
+    }
+    int use = sf ? sf : c.base_sf;
+    for (int i = 0; i < n; i++) {
+      if (!alive[i]) continue;
+      double a = air(plen, use, c);
+      r.air_ms += a; r.time_ms += a*(1 + budget) + (sf ? guard : 0);
+      if (link_snr[h] + fade(rng) < floorDb(use)) alive[i] = false;   // lost, end-to-end retry needed
+    }
+    (void)ctl;
+  }
+  for (bool a : alive) r.delivered += a;
+  return r;
+}
+
+int main() {
+  Cfg cfgs[] = { {"SF11/BW250 (stock)", 11, 7, 2, 5}, {"SF11/BW250, min SF5", 11, 5, 2, 5}, {"SF7/BW62.5 (lighthouse)", 7, 5, 8, 5} };
+  const int TRIALS = 4000, HOPS = 3;
+  printf("%-26s %5s %4s | %9s %9s | %9s %9s | %6s %6s | %5s\n", "config", "burst", "len", "air off", "air on", "time off", "time on", "dlv off", "dlv on", "gain");
+  for (const Cfg& c : cfgs) {
+    for (int len : {60, 180}) for (int n : {1, 2, 4, 8}) {
+      double a0=0,a1=0,t0=0,t1=0; long s=0,d0=0,d1=0;
+      for (int t = 0; t < TRIALS; t++) {
+        std::vector<double> links;
+        std::uniform_real_distribution<double> u(-8.0, 14.0);   // mean SNR of each hop, dB, at the base SF
+        for (int h = 0; h < HOPS; h++) links.push_back(u(rng));
+        if (*std::min_element(links.begin(), links.end()) < floorDb(c.base_sf) + 3) { t--; continue; }   // a route the base SF holds
+        Result off = runBurst(c, links, n, len, false, 10, 3), on = runBurst(c, links, n, len, true, 10, 3);
+        a0+=off.air_ms; a1+=on.air_ms; t0+=off.time_ms; t1+=on.time_ms; s+=n; d0+=off.delivered; d1+=on.delivered;
+      }
+      // goodput = delivered bytes per second of burst time
+      double g0 = d0*len/(t0/1000), g1 = d1*len/(t1/1000);
+      printf("%-26s %5d %4d | %9.0f %9.0f | %9.0f %9.0f | %5.1f%% %5.1f%% | %4.2fx\n", c.name, n, len,
+             a0/TRIALS, a1/TRIALS, t0/TRIALS, t1/TRIALS, 100.0*d0/s, 100.0*d1/s, g1/g0);
+    }
+  }
+}
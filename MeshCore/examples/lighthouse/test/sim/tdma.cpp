@@ -0,0 +1,85 @@
+// HELP|PING -> 30 PONGs: random access (LBT + 120-480 ms CAD retry) vs TDMA slots by lighthouse number.
+// Gateway leader is lighthouse 1; it must hear the other 29 PONGs. SF7/BW62.5, CR4/5.
+#include <cstdio>
+#include <cmath>
+#include <vector>
+#include <random>
+#include <algorithm>
+
+static double airtime(int len) {
+  double ts = (1 << 7) / 62.5;
+  double pl = std::ceil((8.0 * len - 4 * 7 + 28 + 16) / (4.0 * 7)) * 5;
+  return (8 + 4.25 + 8 + std::max(pl, 0.0)) * ts;
+}
+
+struct Tx { int node; double start, end; };
+
+int main() {
+  const int N = 30, PONG = 54, SLOT_BYTES = 64, SPARE = 4;
+  const double GUARD = 20, CAD_DETECT = 5 * 2.048;  // preamble symbols before CAD/rx sees a transmission
+  std::mt19937 rng(3);
+  std::uniform_real_distribution<double> U(0, 1);
+  double air = airtime(PONG);
+  double slot = airtime(SLOT_BYTES) + GUARD;
+  double spare = std::max(SPARE * slot, airtime(255) + GUARD);
+  double frame = N * slot + spare;
+  printf("PONG airtime %.0f ms, slot %.0f ms, frame %.0f ms\n", air, slot, frame);
+  printf("%-28s %10s %10s %10s %10s %10s\n", "mode", "collide%", "heard/29", "complete%", "last ms", "p95 ms");
+  for (double hear_p : {1.0, 0.85, 0.7}) {
+    for (int mode = 0; mode < 4; mode++) {   // 0 = random access, 1 = TDMA, 2 = TDMA with 0-15 ms clock error, 3 = random access, jittered over a frame
+      const int RUNS = 2000;
+      double coll = 0, ntx = 0, heard = 0, complete = 0, last_sum = 0;
+      std::vector<double> lasts;
+      for (int run = 0; run < RUNS; run++) {
+        std::vector<std::vector<bool>> hears(N, std::vector<bool>(N, true));
+        std::vector<double> snr(N);
+        for (int a = 0; a < N; a++) { snr[a] = U(rng) * 20; for (int b = a + 1; b < N; b++) hears[a][b] = hears[b][a] = U(rng) < hear_p || a == 0 || b == 0; }
+        double phase = U(rng) * frame;   // PING arrives at a random point of the frame
+        std::vector<double> clk(N, 0);
+        if (mode == 2) for (int i = 0; i < N; i++) clk[i] = (U(rng) - 0.5) * 15;
+        std::vector<double> want(N);
+        for (int i = 1; i < N; i++) {
+          double t = U(rng) * 20;   // rx + loop latency
+          if (mode == 3) t += U(rng) * frame;
+          if (mode == 1 || mode == 2) {
+            double pos = std::fmod(phase + t + clk[i], frame), st = i * slot;   // lighthouse i+1 -> slot i
+            double w = pos <= st + GUARD / 2 ? std::max(0.0, st - pos) : st + frame - pos;
+            t += w;
+          }
+          want[i] = t;
+        }
+        // event loop over attempts, in time order
+        std::vector<Tx> txs;
+        std::vector<bool> done(N, false);
+        for (int iter = 0; iter < 100000; iter++) {
+          int n = -1; double best = 1e18;
+          for (int i = 1; i < N; i++) if (!done[i] && want[i] < best) { best = want[i]; n = i; }
+          if (n < 0) break;
+          double t = want[n];
+          bool busy = false;
+          for (auto& x : txs) if (hears[x.node][n] && x.start + CAD_DETECT <= t && t < x.end) busy = true;
+          if (busy) { want[n] = t + (1 + rng() % 3) * 120.0; continue; }
+          txs.push_back({n, t, t + air}); done[n] = true;
+        }
+        double last = 0; int got = 0;
+        for (auto& me : txs) {
+          bool ok = true, overlapped = false;
+          for (auto& o : txs) {
+            if (&o == &me || o.end <= me.start || o.start >= me.end) continue;
+            overlapped = true;
+            if (snr[me.node] - snr[o.node] < 6) ok = false;
+          }
+          ntx++; if (overlapped) coll++;
+          if (ok) { got++; last = std::max(last, me.end); }
+        }
+        heard += got;
+        if (got == N - 1) { complete++; last_sum += last; lasts.push_back(last); }
+      }
+      std::sort(lasts.begin(), lasts.end());
+      const char* names[] = {"random access", "TDMA", "TDMA, +-7.5 ms clock", "random + frame jitter"};
+      char name[64]; snprintf(name, sizeof(name), "%s, hear %.0f%%", names[mode], hear_p * 100);
+      printf("%-28s %10.1f %10.1f %10.1f %10.0f %10.0f\n", name, 100 * coll / ntx, heard / RUNS, 100 * complete / RUNS,
+             complete ? last_sum / complete : 0, lasts.empty() ? 0 : lasts[lasts.size() * 95 / 100]);
+    }
+  }
+}
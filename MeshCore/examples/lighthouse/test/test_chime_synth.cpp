@@ -0,0 +1,102 @@
+#include "ChimeSynth.h"
+#include "host_test.h"
+
+#include <stdlib.h>
+
+namespace {
+// Same score as ChimePattern::Message in LightChime.cpp
+const ChimeNote kMessageNotes[] = { { 880, 120 }, { 0, 40 }, { 1175, 180 }, { 0, 40 } };
+const ChimeScore kMessage = { kMessageNotes, 4, { 5, 60, 160, 60 } };
+
+const uint32_t kSampleRate = 16000;
+const uint32_t kMessageSamples = kSampleRate * 380 / 1000;
+const uint32_t kMessageFnv = 0xBBD99D61;   // FNV-1a over the samples, as rendered when the synth was written
+int16_t g_pcm[kMessageSamples + 256];
+
+uint32_t fnv1a(const int16_t *pcm, uint32_t count) {
+  uint32_t h = 2166136261u;
+  for (uint32_t i = 0; i < count; i++) {
+    h = (h ^ (uint16_t)pcm[i]) * 16777619u;
+  }
+  return h;
+}
+
+uint32_t renderAll(ChimeSynth &synth, int16_t *out, uint16_t batch) {
+  uint32_t total = 0;
+  uint16_t n;
+  while ((n = synth.render(out + total, batch)) > 0) {
+    total += n;
+  }
+  return total;
+}
+
+void test_message_golden() {
+  // Integer-only synthesis: any change to this hash is an audible change, on every target.
+  ChimeSynth synth(kSampleRate, 0.4f);
+  synth.start(&kMessage);
+  uint32_t total = renderAll(synth, g_pcm, 256);
+  CHECK_EQ(total, kMessageSamples);
+  CHECK_EQ(fnv1a(g_pcm, total), kMessageFnv);
+  CHECK(!synth.isPlaying());
+}
+
+void test_batch_size_invariant() {
+  // LightChime::loop() renders whatever has elapsed, so the split into batches must not matter
+  static int16_t other[kMessageSamples + 256];
+  ChimeSynth a(kSampleRate, 0.4f), b(kSampleRate, 0.4f);
+  a.start(&kMessage);
+  b.start(&kMessage);
+  uint32_t na = renderAll(a, g_pcm, 256);
+  uint32_t nb = 0;
+  uint16_t sizes[] = { 1, 7, 33, 256, 100 };
+  for (int i = 0; b.isPlaying(); i++) {
+    uint16_t n = b.render(other + nb, sizes[i % 5]);
+    if (n == 0) {
+      break;
+    }
+    nb += n;
+  }
+  CHECK_EQ(na, nb);
+  int diffs = 0;
+  for (uint32_t i = 0; i < na && i < nb; i++) {
+    diffs += g_pcm[i] != other[i];
+  }
+  CHECK_EQ(diffs, 0);
+}
+
+void test_rests_and_note_edges_are_silent() {
+  ChimeSynth synth(kSampleRate, 0.4f);
+  synth.start(&kMessage);
+  renderAll(synth, g_pcm, 256);
+  // the release ends each note on zero, and the rest that follows stays there
+  uint32_t rest_start = kSampleRate * 120 / 1000, rest_end = kSampleRate * 160 / 1000;
+  int loud = 0;
+  for (uint32_t i = rest_start; i < rest_end; i++) {
+    loud += abs(g_pcm[i]) > 0;
+  }
+  CHECK_EQ(loud, 0);
+  CHECK(abs(g_pcm[rest_start - 1]) < 200);
+}
+
+void test_volume_bounds_peak() {
+  ChimeSynth synth(kSampleRate, 0.4f);
+  synth.start(&kMessage);
+  uint32_t total = renderAll(synth, g_pcm, 256);
+  int peak = 0;
+  for (uint32_t i = 0; i < total; i++) {
+    if (abs(g_pcm[i]) > peak) {
+      peak = abs(g_pcm[i]);
+    }
+  }
+  CHECK(peak > 32767 * 0.4f * 0.9f);
+  CHECK(peak <= 32767 * 0.4f + 1);
+}
+}
+
+int main() {
+  RUN(test_message_golden);
+  RUN(test_batch_size_invariant);
+  RUN(test_rests_and_note_edges_are_silent);
+  RUN(test_volume_bounds_peak);
+  return TEST_RESULT();
+}
@@ -0,0 +1,199 @@
+#include "HelpProtocol.h"
+#include "host_test.h"
+
+#include <string.h>
+
+namespace {
+void test_tokenizer_splits_fields() {
+  HelpMessage msg;
+  CHECK(parseHelpMessage("HELP|REQ|r-17|BLUE|Table 4", msg));
+  CHECK(msg.type == HelpMsgType::Req);
+  CHECK(msg.type_name.equals("REQ"));
+  CHECK_EQ(msg.num_fields, 3);
+  CHECK(msg.field(0).equals("r-17"));
+  CHECK(msg.field(1).equals("BLUE"));
+  CHECK(msg.field(2).equals("Table 4"));
+  CHECK(msg.field(3).empty());   // missing reads as empty
+}
+
+void test_tokenizer_finds_prefix_after_sender() {
+  // channel texts arrive as "<sender>: <text>"
+  const char *text = "LH-07: HELP|PING|42";
+  HelpMessage msg;
+  CHECK(parseHelpMessage(text, msg));
+  CHECK(msg.payload == text + 7);
+  CHECK(msg.type == HelpMsgType::Ping);
+  CHECK_EQ(msg.field(0).toInt(), 42);
+}
+
+void test_tokenizer_empty_and_trailing_fields() {
+  HelpMessage msg;
+  CHECK(parseHelpMessage("HELP|CLAIM||x|", msg));
+  CHECK_EQ(msg.num_fields, 3);
+  CHECK(msg.field(0).empty());
+  CHECK(msg.field(1).equals("x"));
+  CHECK(msg.field(2).empty());
+
+  CHECK(parseHelpMessage("HELP|", msg));
+  CHECK(msg.type == HelpMsgType::Unknown);
+  CHECK_EQ(msg.num_fields, 0);
+}
+
+void test_tokenizer_caps_fields() {
+  HelpMessage msg;
+  CHECK(parseHelpMessage("HELP|DETAILS|1|2|3|4|5|6|7|8|9|10", msg));
+  CHECK_EQ(msg.num_fields, HelpMessage::kMaxFields);
+  CHECK(msg.field(HelpMessage::kMaxFields - 1).equals("8"));
+}
+
+void test_tokenizer_rejects_other_text() {
+  HelpMessage msg;
+  CHECK(!parseHelpMessage("hello there", msg));
+  CHECK(!parseHelpMessage("HELP PING", msg));
+  CHECK(!parseHelpMessage(NULL, msg));
+  CHECK(parseHelpMessage("HELP|ping", msg));
+  CHECK(msg.type == HelpMsgType::Unknown);   // names are case sensitive
+}
+
+void test_span_helpers() {
+  HelpSpan s = {"  -12x", 6};
+  CHECK_EQ(s.toInt(), -12);
+  HelpSpan big = {"1767225600123|", 13};
+  CHECK(big.toUInt64() == 1767225600123ULL);
+  char out[4];
+  HelpSpan word = {"VIOLET", 6};
+  CHECK_EQ(word.copyTo(out, sizeof(out)), 3);
+  CHECK(strcmp(out, "VIO") == 0);
+  CHECK(!word.equals("VIOLETS"));
+  CHECK(!word.equals("VIOL"));
+}
+
+void test_type_table_round_trips() {
+  // every type LighthouseMesh dispatches on has a wire name that maps back to it
+  const HelpMsgType types[] = { HelpMsgType::Ping, HelpMsgType::Pong, HelpMsgType::Audio, HelpMsgType::Announce,
+                                HelpMsgType::Mail, HelpMsgType::Ack, HelpMsgType::Details, HelpMsgType::Req,
+                                HelpMsgType::Cancel, HelpMsgType::Claim, HelpMsgType::Resolve,
+                                HelpMsgType::Gateway, HelpMsgType::Time };
+  for (HelpMsgType t : types) {
+    const char *name = helpTypeName(t);
+    CHECK(name[0] != '\0');
+    HelpSpan span = {name, (uint16_t)strlen(name)};
+    CHECK(lookupHelpType(span) == t);
+  }
+  CHECK(helpTypeName(HelpMsgType::Unknown)[0] == '\0');
+  HelpSpan gw = {"GW", 2};
+  CHECK(lookupHelpType(gw) == HelpMsgType::Gateway);
+}
+
+void test_colors() {
+  CHECK(lookupHelpColor("BLUE") != NULL);
+  CHECK_EQ(lookupHelpColor("BLUE")->b, 255);
+  CHECK(lookupHelpColor("") == NULL);
+  CHECK(lookupHelpColor("PINK") == NULL);
+  CHECK(lookupHelpColor((const char *)NULL) == NULL);
+  CHECK_EQ(helpColorCount(), 6);
+  CHECK(&helpColorAt(helpColorCount()) == &helpColorAt(0));   // wraps
+}
+
+void test_request_state_machine() {
+  HelpRequestState s;
+  HelpSpan id = {"r-1", 3}, other = {"r-2", 3};
+  CHECK(s.state() == HelpRequestState::State::Idle);
+  CHECK(!s.claim(id));   // nothing open
+
+  CHECK(s.open("r-1", "RED"));
+  CHECK(s.state() == HelpRequestState::State::Pending);
+  CHECK(strcmp(s.colorName(), "RED") == 0);
+  CHECK(!s.open("r-2", "BLUE"));   // one at a time
+  CHECK(!s.claim(other));
+  CHECK(!s.close(other));
+
+  CHECK(s.claim(id));
+  CHECK(s.isClaimed());
+  CHECK(s.claim(id));   // a repeated CLAIM is harmless
+  CHECK(s.close(id));
+  CHECK(!s.isActive());
+  CHECK(!s.matches("r-1"));
+
+  CHECK(!s.open("", "RED"));   // an id is required
+  CHECK(s.open("r-3", NULL));
+  CHECK(s.colorName()[0] == '\0');
+  HelpSpan id3 = {"r-3", 3};
+  CHECK(s.close(id3));   // Pending -> Idle (cancelled) without a claim
+}
+
+void test_request_id_length_limit() {
+  HelpRequestState s;
+  char id[64];
+  memset(id, 'a', sizeof(id) - 1);
+  id[sizeof(id) - 1] = '\0';
+  CHECK(!s.open(id, "RED"));   // too long to store whole: refused rather than stuck Pending
+  CHECK(!s.isActive());
+
+  id[HelpRequestState::kMaxRequestIdLen] = '\0';   // the longest id that fits
+  CHECK(s.open(id, "RED"));
+  HelpSpan span = {id, HelpRequestState::kMaxRequestIdLen};
+  CHECK(s.claim(span));
+  CHECK(s.close(span));
+  CHECK(!s.isActive());
+}
+
+// The same paths LighthouseMesh takes: handleDirectPayload() for the bot's WiFi copy, then
+// onChannelMessageRecv() for its "<sender>: HELP|..." fallback flood.
+struct DirectThenFlood {
+  HelpDirectLog log;
+  int acted = 0;
+
+  void direct(const char *payload) {
+    if (log.add(payload)) {
+      acted++;
+    }
+  }
+  void channel(const char *text) {
+    if (!log.contains(text)) {
+      acted++;
+    }
+  }
+};
+
+void test_direct_command_acted_on_once() {
+  DirectThenFlood node;
+  node.direct("HELP|MAIL|7|hello");
+  node.direct("HELP|MAIL|7|hello");               // bot retry before it saw LHCMDACK
+  node.channel("LighthouseBot: HELP|MAIL|7|hello");
+  CHECK_EQ(node.acted, 1);
+
+  node.channel("LighthouseBot: HELP|MAIL|7|bye");  // never sent directly
+  CHECK_EQ(node.acted, 2);
+  node.direct("not a command");
+  CHECK_EQ(node.acted, 2);
+  CHECK(!node.log.contains("no help here"));
+}
+
+void test_direct_log_wraps() {
+  HelpDirectLog log;
+  char text[32];
+  for (int i = 0; i <= HelpDirectLog::kSize; i++) {
+    snprintf(text, sizeof(text), "HELP|PING|%d", i);
+    CHECK(log.add(text));
+  }
+  CHECK(!log.contains("HELP|PING|0"));   // oldest entry was overwritten
+  CHECK(log.contains("x: HELP|PING|1"));
+}
+}
+
+int main() {
+  RUN(test_tokenizer_splits_fields);
+  RUN(test_tokenizer_finds_prefix_after_sender);
+  RUN(test_tokenizer_empty_and_trailing_fields);
+  RUN(test_tokenizer_caps_fields);
+  RUN(test_tokenizer_rejects_other_text);
+  RUN(test_span_helpers);
+  RUN(test_type_table_round_trips);
+  RUN(test_colors);
+  RUN(test_request_state_machine);
+  RUN(test_request_id_length_limit);
+  RUN(test_direct_command_acted_on_once);
+  RUN(test_direct_log_wraps);
+  return TEST_RESULT();
+}
@@ -0,0 +1,58 @@
+#include "LevelMeter.h"
+#include "host_test.h"
+
+#include <math.h>
+
+namespace {
+bool near(float a, float b) {
+  return fabsf(a - b) < 1e-4f;
+}
+
+void test_tracks_block_peak() {
+  LevelMeter meter(0.5f);
+  int16_t block[4 * 2] = { 0, 100, -16384, 5, 7, 0, 0, 0 };
+  meter.processBlock(block, 4);
+  CHECK(near(meter.level(), 0.25f));   // half way to a 0.5 peak
+  meter.processBlock(block, 4);
+  CHECK(near(meter.level(), 0.375f));
+}
+
+void test_full_scale_negative() {
+  LevelMeter meter(1.0f);
+  int16_t block[2] = { -32768, 0 };
+  meter.processBlock(block, 1);
+  CHECK(near(meter.level(), 1.0f));
+}
+
+void test_ignores_empty_blocks() {
+  LevelMeter meter(1.0f);
+  int16_t block[2] = { 16384, 16384 };
+  meter.processBlock(block, 1);
+  meter.processBlock(nullptr, 4);
+  meter.processBlock(block, 0);
+  CHECK(near(meter.level(), 0.5f));
+}
+
+void test_decay_settles_to_zero() {
+  LevelMeter meter(1.0f);
+  int16_t block[2] = { 32767, 32767 };
+  meter.processBlock(block, 1);
+  meter.decay(0.5f);
+  CHECK(near(meter.level(), 32767.0f / 32768.0f * 0.5f));
+  for (int i = 0; i < 20; i++) {
+    meter.decay(0.5f);
+  }
+  CHECK(meter.level() == 0.0f);   // snaps to zero rather than creeping
+  meter.processBlock(block, 1);
+  meter.reset();
+  CHECK(meter.level() == 0.0f);
+}
+}
+
+int main() {
+  RUN(test_tracks_block_peak);
+  RUN(test_full_scale_negative);
+  RUN(test_ignores_empty_blocks);
+  RUN(test_decay_settles_to_zero);
+  return TEST_RESULT();
+}
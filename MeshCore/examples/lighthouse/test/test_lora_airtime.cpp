@@ -0,0 +1,85 @@
+// LoRaAirtime (integer, constexpr) against the SX126x datasheet formula evaluated in double
+// precision, over every SF5-12 x bandwidth x CR 4/5-4/8 x 0-255 byte x preamble x CRC x header
+// combination, plus the compile-time tables the radio wrappers build.
+#include "host_test.h"
+
+#include <helpers/LoRaAirtime.h>
+
+#include <algorithm>
+#include <initializer_list>
+#include <math.h>
+
+namespace {
+double datasheet_us(int len, int sf, double bw_hz, int cr, int preamble, bool crc, bool implicit_header) {
+  double tsym = pow(2.0, sf) / bw_hz;
+  bool ldro = tsym >= 0.016 - 1e-12;
+  double bits = 8.0 * len + 16 * crc - 4 * sf + (implicit_header ? 0 : 20);
+  double symbols;
+  if (sf < 7) {
+    symbols = preamble + 6.25 + 8 + ceil(std::max(bits, 0.0) / (4.0 * sf)) * cr;
+  } else {
+    symbols = preamble + 4.25 + 8 + ceil(std::max(bits + 8, 0.0) / (4.0 * (sf - 2 * ldro))) * cr;
+  }
+  return symbols * tsym * 1e6;
+}
+
+const float kBandwidths[] = { 7.8f, 10.4f, 15.6f, 20.8f, 31.25f, 41.7f, 62.5f, 125, 250, 500 };
+
+// lighthouse (SF7/BW62.5/CR5) and stock (SF11/BW250/CR5) radios, preamble 16
+typedef LoRaAirtimeTable<7, LoRaAirtime::bwDivisor(62.5), 5, 16, 255> Lighthouse;
+typedef LoRaAirtimeTable<11, LoRaAirtime::bwDivisor(250), 5, 16, 255> Stock;
+static_assert(Lighthouse::millis[0] == 69, "empty packet, SF7/BW62.5: (16 + 4.25 + 13) x 2.048 ms");
+static_assert(LoRaAirtime::micros(10, 7, 8, 5, 8) == 82432, "10 B, SF7/BW62.5, preamble 8: (8 + 4.25 + 28) x 2048 us");
+
+void test_bandwidth_divisors() {
+  for (float bw : kBandwidths) {
+    double actual_khz = 500.0 / LoRaAirtime::bwDivisor(bw);
+    CHECK(fabs(actual_khz - bw) <= 0.05 * bw);
+  }
+}
+
+// micros() rounds up to the microsecond, so it may be up to 1 us over the exact figure, never under.
+void test_matches_datasheet() {
+  long combinations = 0, mismatches = 0;
+  for (int sf = 5; sf <= 12; sf++) {
+    for (float bw : kBandwidths) {
+      uint8_t div = LoRaAirtime::bwDivisor(bw);
+      for (int cr = 5; cr <= 8; cr++) {
+        for (int preamble : { 8, 16 }) {
+          for (int crc = 0; crc < 2; crc++) {
+            for (int ih = 0; ih < 2; ih++) {
+              for (int len = 0; len <= 255; len++) {
+                double ref = datasheet_us(len, sf, 500000.0 / div, cr, preamble, crc, ih);
+                double err = LoRaAirtime::micros(len, sf, div, cr, preamble, crc, ih) - ref;
+                if (err < -1e-6 || err >= 1.0) {
+                  if (mismatches++ < 5) {
+                    printf("  sf%d bw%.2f cr%d pre%d crc%d ih%d len%d: off by %.3f us\n", sf, bw, cr, preamble, crc,
+                           ih, len, err);
+                  }
+                }
+                combinations++;
+              }
+            }
+          }
+        }
+      }
+    }
+  }
+  CHECK_EQ(combinations, 8L * 10 * 4 * 2 * 2 * 2 * 256);
+  CHECK_EQ(mismatches, 0);
+}
+
+void test_compile_time_tables() {
+  for (int len = 0; len <= 255; len++) {
+    CHECK_EQ(Lighthouse::millis[len], (uint32_t)ceil(datasheet_us(len, 7, 62500, 5, 16, true, false) / 1000 - 1e-9));
+    CHECK_EQ(Stock::millis[len], (uint32_t)ceil(datasheet_us(len, 11, 250000, 5, 16, true, false) / 1000 - 1e-9));
+  }
+}
+}
+
+int main() {
+  RUN(test_bandwidth_divisors);
+  RUN(test_matches_datasheet);
+  RUN(test_compile_time_tables);
+  return TEST_RESULT();
+}
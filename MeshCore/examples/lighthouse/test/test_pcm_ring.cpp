@@ -0,0 +1,135 @@
+#include "PcmRing.h"
+#include "host_test.h"
+
+#include <thread>
+
+namespace {
+void fill(int16_t *frames, uint32_t count, int16_t first) {
+  for (uint32_t i = 0; i < count; i++) {
+    frames[i * 2] = (int16_t)(first + i);
+    frames[i * 2 + 1] = (int16_t)-(first + i);
+  }
+}
+
+void test_attach_needs_power_of_two() {
+  static int16_t storage[64 * 2];
+  PcmRing ring;
+  CHECK(!ring.attach(nullptr, 64));
+  CHECK(!ring.attach(storage, 48));
+  CHECK(!ring.attach(storage, 1));
+  CHECK(ring.attach(storage, 64));
+  CHECK_EQ(ring.capacity(), 64);
+  CHECK_EQ(ring.space(), 64);
+  CHECK_EQ(ring.available(), 0);
+}
+
+void test_unattached_ring_takes_nothing() {
+  PcmRing ring;
+  int16_t frames[4] = { 1, 2, 3, 4 };
+  CHECK_EQ(ring.space(), 0);
+  CHECK_EQ(ring.write(frames, 2), 0);
+  CHECK_EQ(ring.read(frames, 2), 0);
+}
+
+void test_wraps_in_order() {
+  static int16_t storage[16 * 2];
+  int16_t in[12 * 2], out[12 * 2];
+  PcmRing ring;
+  ring.attach(storage, 16);
+  int16_t next_in = 0, next_out = 0;
+  for (int round = 0; round < 10; round++) {   // 12 at a time through 16 slots wraps every round
+    fill(in, 12, next_in);
+    CHECK_EQ(ring.write(in, 12), 12);
+    next_in += 12;
+    CHECK_EQ(ring.read(out, 12), 12);
+    for (int i = 0; i < 12; i++) {
+      CHECK_EQ(out[i * 2], (int16_t)(next_out + i));
+      CHECK_EQ(out[i * 2 + 1], (int16_t)-(next_out + i));
+    }
+    next_out += 12;
+  }
+  CHECK_EQ(ring.getOverruns(), 0);
+}
+
+void test_short_write_counts_overrun() {
+  static int16_t storage[8 * 2];
+  int16_t in[10 * 2];
+  PcmRing ring;
+  ring.attach(storage, 8);
+  fill(in, 10, 0);
+  CHECK_EQ(ring.write(in, 10), 8);
+  CHECK_EQ(ring.getOverruns(), 1);
+  CHECK_EQ(ring.write(in, 1), 0);
+  CHECK_EQ(ring.getOverruns(), 2);
+  ring.noteUnderrun();
+  CHECK_EQ(ring.getUnderruns(), 1);
+  ring.resetCounters();
+  CHECK_EQ(ring.getOverruns(), 0);
+  CHECK_EQ(ring.getUnderruns(), 0);
+}
+
+void test_discard_drops_queued() {
+  static int16_t storage[8 * 2];
+  int16_t in[6 * 2], out[2 * 2];
+  PcmRing ring;
+  ring.attach(storage, 8);
+  fill(in, 6, 0);
+  ring.write(in, 6);
+  ring.discard();
+  CHECK_EQ(ring.available(), 0);
+  CHECK_EQ(ring.space(), 8);
+  fill(in, 2, 100);
+  ring.write(in, 2);
+  CHECK_EQ(ring.read(out, 2), 2);
+  CHECK_EQ(out[0], 100);   // nothing from before the discard
+}
+
+void test_spsc_threads() {
+  // the decode task writes, the I2S writer task reads; every frame comes out once, in order
+  static int16_t storage[256 * 2];
+  PcmRing ring;
+  ring.attach(storage, 256);
+  const uint32_t kFrames = 2000000;
+  bool ordered = true;
+  std::thread consumer([&] {
+    int16_t out[37 * 2];
+    uint32_t got = 0;
+    while (got < kFrames) {
+      uint32_t n = ring.read(out, 37);
+      if (n == 0) {
+        std::this_thread::yield();   // the writer task blocks on I2S; don't starve a single core
+      }
+      for (uint32_t i = 0; i < n; i++) {
+        if (out[i * 2] != (int16_t)(got + i) || out[i * 2 + 1] != (int16_t)-(int16_t)(got + i)) {
+          ordered = false;
+        }
+      }
+      got += n;
+    }
+  });
+  int16_t in[53 * 2];
+  uint32_t sent = 0;
+  while (sent < kFrames) {
+    uint32_t want = kFrames - sent < 53 ? kFrames - sent : 53;
+    fill(in, want, (int16_t)sent);
+    uint32_t n = ring.write(in, want);   // a short write is retried from where it stopped, as the decoder does
+    if (n < want) {
+      std::this_thread::yield();
+    }
+    sent += n;
+  }
+  consumer.join();
+  CHECK(ordered);
+  CHECK_EQ(ring.available(), 0);
+}
+}
+
+int main() {
+  RUN(test_attach_needs_power_of_two);
+  RUN(test_unattached_ring_takes_nothing);
+  RUN(test_wraps_in_order);
+  RUN(test_short_write_counts_overrun);
+  RUN(test_discard_drops_queued);
+  RUN(test_spsc_threads);
+  return TEST_RESULT();
+}
@@ -0,0 +1,112 @@
+#include "RingCompositor.h"
+#include "host_test.h"
+
+#include <string.h>
+
+namespace {
+bool same(const RingPixel &a, const RingPixel &b) {
+  return a.r == b.r && a.g == b.g && a.b == b.b;
+}
+
+bool frame_equals(const RingPixel *got, const RingPixel *expected, uint16_t count) {
+  for (uint16_t i = 0; i < count; i++) {
+    if (!same(got[i], expected[i])) {
+      printf("  pixel %u: got %u,%u,%u expected %u,%u,%u\n", i, got[i].r, got[i].g, got[i].b, expected[i].r,
+             expected[i].g, expected[i].b);
+      return false;
+    }
+  }
+  return true;
+}
+
+// Idle fill with one bright pixel on top, the way the orbit effect draws.
+void test_layers_render_to_frame() {
+  RingCompositor ring(8);
+  ring.fill({ 0, 0, 40 });
+  ring.set(3, { 255, 255, 255 });
+  CHECK(ring.commit());
+  RingPixel expected[8];
+  for (int i = 0; i < 8; i++) {
+    expected[i] = { 0, 0, 40 };
+  }
+  expected[3] = { 255, 255, 255 };
+  CHECK(frame_equals(ring.output(), expected, 8));
+}
+
+void test_alpha_blends_over_lower_layer() {
+  RingCompositor ring(4);
+  ring.fill({ 15, 15, 15 });
+  ring.fill({ 255, 64, 64 }, 128);
+  ring.set(0, { 0, 0, 0 }, 255);   // opaque replaces
+  ring.set(1, { 0, 255, 0 }, 0);   // transparent is a no-op
+  CHECK(ring.commit());
+  const RingPixel expected[4] = { { 0, 0, 0 }, { 135, 40, 40 }, { 135, 40, 40 }, { 135, 40, 40 } };
+  CHECK(frame_equals(ring.output(), expected, 4));
+}
+
+void test_gamma_lut() {
+  RingCompositor ring(3);
+  ring.setGamma(2.0f, 0.5f);
+  ring.set(0, { 0, 255, 128 });
+  ring.set(1, { 255, 255, 255 });
+  ring.commit();
+  // 255 * 0.5 * (v/255)^2, rounded
+  const RingPixel expected[3] = { { 0, 128, 32 }, { 128, 128, 128 }, { 0, 0, 0 } };
+  CHECK(frame_equals(ring.output(), expected, 3));
+  // the frame itself stays linear
+  CHECK(same(ring.frame()[0], { 0, 255, 128 }));
+}
+
+void test_commit_reports_changes_only() {
+  RingCompositor ring(6);
+  CHECK(ring.commit());   // first frame always goes out
+  CHECK(!ring.commit());
+  ring.fill({ 10, 20, 30 });
+  CHECK(ring.commit());
+  ring.clear();
+  ring.fill({ 10, 20, 30 });
+  CHECK(!ring.commit());  // repainted to the same pixels
+  ring.invalidate();
+  CHECK(ring.commit());
+  ring.setGamma(1.0f);
+  CHECK(ring.commit());   // new LUT forces a push
+  CHECK(!ring.commit());
+}
+
+void test_bounds() {
+  RingCompositor ring(RING_COMPOSITOR_MAX_PIXELS + 10);
+  CHECK_EQ(ring.count(), RING_COMPOSITOR_MAX_PIXELS);
+  RingCompositor small(4);
+  small.set(4, { 255, 0, 0 });
+  small.set(1000, { 255, 0, 0 });
+  CHECK(small.commit());
+  RingPixel zero[4];
+  memset(zero, 0, sizeof(zero));
+  CHECK(frame_equals(small.output(), zero, 4));
+}
+
+// A few frames of a one-pixel spin over black, checked against the expected sequence.
+void test_spin_sequence() {
+  RingCompositor ring(5);
+  for (uint16_t frame = 0; frame < 7; frame++) {
+    uint16_t index = frame % ring.count();
+    ring.clear();
+    ring.set(index, { 0, 200, 0 });
+    CHECK(ring.commit());
+    RingPixel expected[5];
+    memset(expected, 0, sizeof(expected));
+    expected[index] = { 0, 200, 0 };
+    CHECK(frame_equals(ring.output(), expected, 5));
+  }
+}
+}
+
+int main() {
+  RUN(test_layers_render_to_frame);
+  RUN(test_alpha_blends_over_lower_layer);
+  RUN(test_gamma_lut);
+  RUN(test_commit_reports_changes_only);
+  RUN(test_bounds);
+  RUN(test_spin_sequence);
+  return TEST_RESULT();
+}
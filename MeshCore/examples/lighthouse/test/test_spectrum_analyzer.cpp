@@ -0,0 +1,146 @@
+#include "SpectrumAnalyzer.h"
+#include "host_test.h"
+
+#include <complex>
+#include <math.h>
+#include <vector>
+
+namespace {
+const int kBands = 12;
+
+std::vector<int16_t> stereo_tone(uint32_t hz, uint32_t rate, uint32_t frames, float amp) {
+  std::vector<int16_t> st(frames * 2);
+  for (uint32_t i = 0; i < frames; i++) {
+    int16_t v = (int16_t)(amp * sin(2.0 * M_PI * hz * i / rate));
+    st[i * 2] = v;
+    st[i * 2 + 1] = v;
+  }
+  return st;
+}
+
+int loudest(const uint8_t *bands, int count) {
+  int best = 0;
+  for (int b = 1; b < count; b++) {
+    if (bands[b] > bands[best]) {
+      best = b;
+    }
+  }
+  return best;
+}
+
+// transform() against a double-precision DFT scaled by 1/N; the Q15 rounding of log2(N) halving
+// stages keeps every bin within a few LSB.
+void check_transform(uint16_t n) {
+  SpectrumAnalyzer sa(n, kBands);
+  std::vector<int16_t> re(n), im(n, 0);
+  for (int i = 0; i < n; i++) {
+    re[i] = (int16_t)(12000 * sin(2 * M_PI * 17 * i / n) + 5000 * cos(2 * M_PI * 40 * i / n));
+  }
+  std::vector<int16_t> out_re = re, out_im = im;
+  sa.transform(out_re.data(), out_im.data());
+  double max_err = 0;
+  for (int k = 0; k < n; k++) {
+    std::complex<double> sum = 0;
+    for (int t = 0; t < n; t++) {
+      sum += (double)re[t] * std::polar(1.0, -2 * M_PI * k * t / n);
+    }
+    sum /= n;
+    double err = std::abs(sum - std::complex<double>(out_re[k], out_im[k]));
+    max_err = err > max_err ? err : max_err;
+  }
+  CHECK(max_err < 8.0);
+  CHECK(abs(out_im[17] + 6000) <= 4);   // 12000 sin -> -6000j at bin 17
+  CHECK(abs(out_re[40] - 2500) <= 4);   // 5000 cos -> 2500 at bin 40
+}
+
+void test_transform_matches_dft_256() {
+  check_transform(256);
+}
+
+void test_transform_matches_dft_512() {
+  check_transform(512);
+}
+
+// Tones well inside a band at both block sizes; at 256 points the low bands are one bin wide, so
+// mid-range tones sit a band or two lower than at 512.
+void test_tone_lands_in_its_band() {
+  const uint32_t tones[] = { 100, 4000, 8000 };
+  const int expected[] = { 0, 9, 11 };
+  for (uint16_t n : { 256, 512 }) {
+    for (int t = 0; t < 3; t++) {
+      SpectrumAnalyzer sa(n, kBands);
+      sa.setSampleRate(44100);
+      std::vector<int16_t> st = stereo_tone(tones[t], 44100, n * 4, 20000);
+      sa.processBlock(st.data(), n * 4);
+      uint8_t bands[kBands];
+      CHECK_EQ(sa.bands(bands, kBands), kBands);
+      CHECK_EQ(sa.getBlocks(), 4);
+      CHECK_EQ(loudest(bands, kBands), expected[t]);
+    }
+  }
+}
+
+// Reference levels for a 1 kHz tone through a 512-point analyser; any change to the window,
+// twiddles, band edges or level mapping shows up here.
+void test_reference_levels() {
+  static const uint8_t expected[kBands] = { 0, 0, 0, 0, 0, 118, 255, 79, 0, 5, 0, 0 };
+  SpectrumAnalyzer sa(512, kBands);
+  sa.setSampleRate(44100);
+  std::vector<int16_t> st = stereo_tone(1000, 44100, 512 * 4, 20000);
+  sa.processBlock(st.data(), 512 * 4);
+  uint8_t bands[kBands];
+  sa.bands(bands, kBands);
+  for (int b = 0; b < kBands; b++) {
+    CHECK_EQ(bands[b], expected[b]);
+  }
+}
+
+void test_split_blocks_match_whole() {
+  std::vector<int16_t> st = stereo_tone(440, 44100, 1024, 15000);
+  SpectrumAnalyzer whole(256, kBands), split(256, kBands);
+  whole.processBlock(st.data(), 1024);
+  for (uint32_t i = 0; i < 1024; i += 100) {
+    uint32_t frames = 1024 - i < 100 ? 1024 - i : 100;
+    split.processBlock(st.data() + i * 2, frames);
+  }
+  uint8_t a[kBands], b[kBands];
+  whole.bands(a, kBands);
+  split.bands(b, kBands);
+  CHECK_EQ(whole.getBlocks(), split.getBlocks());
+  for (int k = 0; k < kBands; k++) {
+    CHECK_EQ(a[k], b[k]);
+  }
+}
+
+void test_silence_decay_and_reset() {
+  SpectrumAnalyzer sa(256, kBands);
+  std::vector<int16_t> silence(256 * 2, 0);
+  sa.processBlock(silence.data(), 256);
+  uint8_t bands[kBands];
+  sa.bands(bands, kBands);
+  for (int b = 0; b < kBands; b++) {
+    CHECK_EQ(bands[b], 0);
+  }
+  std::vector<int16_t> st = stereo_tone(1000, 44100, 256, 20000);
+  sa.processBlock(st.data(), 256);
+  sa.bands(bands, kBands);
+  uint8_t peak = bands[loudest(bands, kBands)];
+  CHECK(peak > 100);
+  sa.decay(50);
+  sa.bands(bands, kBands);
+  CHECK_EQ(bands[loudest(bands, kBands)], peak - 50);
+  sa.reset();
+  sa.bands(bands, kBands);
+  CHECK_EQ(bands[loudest(bands, kBands)], 0);
+}
+}
+
+int main() {
+  RUN(test_transform_matches_dft_256);
+  RUN(test_transform_matches_dft_512);
+  RUN(test_tone_lands_in_its_band);
+  RUN(test_reference_levels);
+  RUN(test_split_blocks_match_whole);
+  RUN(test_silence_decay_and_reset);
+  return TEST_RESULT();
+}
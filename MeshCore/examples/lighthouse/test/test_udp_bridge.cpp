@@ -0,0 +1,174 @@
+// Three UDPBridge nodes in separate processes on loopback multicast (UDP_BRIDGE_INTERFACE is
+// 127.0.0.1 for this build). "a" and "b" share a secret, "c" uses another one, and the parent
+// drops a junk datagram on the group. Each child checks what it received and exits non-zero on
+// a failed check. If the host can't join the group (no multicast on lo), the test is skipped.
+#include "host_test.h"
+
+#include <Arduino.h>
+
+#include <helpers/StaticPoolPacketManager.h>
+#include <helpers/bridges/UDPBridge.h>
+
+#include <arpa/inet.h>
+#include <chrono>
+#include <netinet/in.h>
+#include <string>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+const auto kEpoch = std::chrono::steady_clock::now();
+const unsigned long kSendAt = 300, kJunkAt = 500, kStopAt = 1200;
+
+struct Node {
+  const char *name;
+  const char *secret;
+  int sends;
+};
+const Node kNodes[] = { { "a", "lighthouse", 3 }, { "b", "lighthouse", 2 }, { "c", "elsewhere", 1 } };
+const int kNodeCount = sizeof(kNodes) / sizeof(kNodes[0]);
+
+struct Clock : mesh::RTCClock {
+  uint32_t getCurrentTime() override { return 0; }
+  void setCurrentTime(uint32_t) override {}
+};
+
+void sleep_until(unsigned long ms) {
+  std::this_thread::sleep_until(kEpoch + std::chrono::milliseconds(ms));
+}
+
+bool can_join_group() {
+  int sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+  struct ip_mreq mreq = {};
+  mreq.imr_multiaddr.s_addr = inet_addr(UDP_BRIDGE_GROUP);
+  mreq.imr_interface.s_addr = inet_addr(UDP_BRIDGE_INTERFACE);
+  bool ok = sock >= 0 && setsockopt(sock, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) == 0;
+  if (sock >= 0) {
+    close(sock);
+  }
+  return ok;
+}
+
+void send_junk() {
+  int sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+  struct in_addr iface = {};
+  iface.s_addr = inet_addr(UDP_BRIDGE_INTERFACE);
+  setsockopt(sock, IPPROTO_IP, IP_MULTICAST_IF, &iface, sizeof(iface));
+  struct sockaddr_in group = {};
+  group.sin_family = AF_INET;
+  group.sin_port = htons(UDP_BRIDGE_PORT);
+  group.sin_addr.s_addr = inet_addr(UDP_BRIDGE_GROUP);
+  const char junk[] = "not a mesh packet";
+  sendto(sock, junk, sizeof(junk), 0, (struct sockaddr *)&group, sizeof(group));
+  close(sock);
+}
+
+int run_node(int self) {
+  const Node &node = kNodes[self];
+  NodePrefs prefs = {};
+  strcpy(prefs.bridge_secret, node.secret);
+  StaticPoolPacketManager mgr(16);
+  Clock rtc;
+  UDPBridge bridge(&prefs, &mgr, &rtc);
+  bridge.begin();
+  CHECK(bridge.isRunning());
+  if (!bridge.isRunning()) {
+    return 1;
+  }
+
+  sleep_until(kSendAt);
+  for (int i = 0; i < node.sends; i++) {
+    mesh::Packet *pkt = mgr.allocNew();
+    pkt->header = (PAYLOAD_TYPE_GRP_TXT << PH_TYPE_SHIFT) | ROUTE_TYPE_FLOOD;
+    pkt->path_len = 0;
+    pkt->payload_len = sprintf((char *)pkt->payload, "%s#%d", node.name, i);
+    bridge.sendPacket(pkt);
+    bridge.sendPacket(pkt);  // already seen: must not go out twice
+    mgr.free(pkt);
+  }
+
+  std::vector<std::string> heard;
+  while (millis() < kStopAt) {
+    bridge.loop();
+    while (mesh::Packet *in = mgr.getNextInbound(millis() + 1000)) {
+      heard.emplace_back((const char *)in->payload, in->payload_len);
+      mgr.free(in);
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  }
+
+  std::vector<std::string> expected;
+  int foreign = 1;  // the junk datagram
+  for (int n = 0; n < kNodeCount; n++) {
+    if (n == self) {
+      continue;
+    }
+    for (int i = 0; i < kNodes[n].sends; i++) {
+      if (strcmp(kNodes[n].secret, node.secret) == 0) {
+        expected.push_back(std::string(kNodes[n].name) + "#" + std::to_string(i));
+      } else {
+        foreign++;
+      }
+    }
+  }
+  CHECK_EQ(bridge.getTxCount(), node.sends);
+  CHECK_EQ(bridge.getRxCount(), expected.size());
+  CHECK_EQ(bridge.getRejectCount(), foreign);
+  CHECK_EQ(heard.size(), expected.size());
+  for (const std::string &want : expected) {
+    int copies = 0;
+    for (const std::string &got : heard) {
+      copies += got == want;
+    }
+    if (copies != 1) {
+      printf("%s: %s arrived %d times\n", node.name, want.c_str(), copies);
+      g_failures++;
+    }
+  }
+  CHECK_EQ(bridge.hasLivePeers(), !expected.empty());
+  bridge.end();
+  CHECK(!bridge.isRunning());
+  printf("node %s: tx=%u rx=%u rejected=%u\n", node.name, (unsigned)bridge.getTxCount(),
+         (unsigned)bridge.getRxCount(), (unsigned)bridge.getRejectCount());
+  return TEST_RESULT();
+}
+
+void test_loopback_multicast() {
+  pid_t pids[kNodeCount];
+  fflush(stdout);
+  for (int n = 0; n < kNodeCount; n++) {
+    pids[n] = fork();
+    if (pids[n] == 0) {
+      int rc = run_node(n);
+      fflush(stdout);
+      _exit(rc);
+    }
+    CHECK(pids[n] > 0);
+  }
+  sleep_until(kJunkAt);
+  send_junk();
+  for (int n = 0; n < kNodeCount; n++) {
+    int status = 0;
+    if (pids[n] > 0) {
+      waitpid(pids[n], &status, 0);
+    }
+    CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+  }
+}
+}
+
+unsigned long millis() {
+  return 1 + std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - kEpoch).count();
+}
+
+int main() {
+  if (!can_join_group()) {
+    printf("skip test_loopback_multicast (cannot join %s on %s)\n", UDP_BRIDGE_GROUP, UDP_BRIDGE_INTERFACE);
+    return 0;
+  }
+  RUN(test_loopback_multicast);
+  return TEST_RESULT();
+}
@@ -408,8 +408,32 @@ int MyMesh::calcRxDelay(float score, uint32_t air_time) const {
 
 uint32_t MyMesh::getRetransmitDelay(const mesh::Packet *packet) {
   uint32_t t = (_radio->getEstAirtimeFor(packet->path_len + packet->payload_len + 2) * _prefs.tx_delay_factor);
+  if (getRetransmitMaxSlots() > 0) return calcContentionDelay(packet, t);
   return getRNG()->nextInt(0, 5*t + 1);
 }
+int MyMesh::getEstNeighbours() const {
+  int n = mesh::Mesh::getEstNeighbours();   // heard relaying floods, with WITH_HEARD_NEIGHBOURS
+#if MAX_NEIGHBOURS
+  // .. or zero-hop adverts, whichever knows more
+  uint32_t now = getRTCClock()->getCurrentTime();
+  int adverts = 0;
+  for (int i = 0; i < MAX_NEIGHBOURS; i++) {
+    if (neighbours[i].heard_timestamp != 0 && now - neighbours[i].heard_timestamp < NEIGHBOUR_ACTIVE_SECS) adverts++;
+  }
+  if (adverts > n) n = adverts;
+#endif
+  return n;
+}
+uint8_t MyMesh::getLinkRateMinSF() const {
+  if (set_radio_at || revert_radio_at) return 0;   // not while on temp radio params
+  return LINK_RATE_MIN_SF;
+}
+void MyMesh::setLinkRateSF(uint8_t sf) {
+  radio_set_params(_prefs.freq, _prefs.bw, sf ? sf : _prefs.sf, _prefs.cr);
+}
+uint32_t MyMesh::getLinkRateAirtime(int len, uint8_t sf) const {
+  return LoRaAirtime::millis(len, sf, LoRaAirtime::bwDivisor(_prefs.bw), _prefs.cr, LORA_PREAMBLE_LEN);
+}
 uint32_t MyMesh::getDirectRetransmitDelay(const mesh::Packet *packet) {
   uint32_t t = (_radio->getEstAirtimeFor(packet->path_len + packet->payload_len + 2) * _prefs.direct_tx_delay_factor);
   return getRNG()->nextInt(0, 5*t + 1);
@@ -665,7 +689,7 @@ MyMesh::MyMesh(mesh::MainBoard &board, mesh::Radio &radio, mesh::MillisecondCloc
 #if defined(WITH_RS232_BRIDGE)
       , bridge(&_prefs, WITH_RS232_BRIDGE, _mgr, &rtc)
 #endif
-#if defined(WITH_ESPNOW_BRIDGE)
+#if defined(WITH_ESPNOW_BRIDGE) || defined(WITH_UDP_BRIDGE)
       , bridge(&_prefs, _mgr, &rtc)
 #endif
 {
@@ -874,7 +898,8 @@ void MyMesh::formatStatsReply(char *reply) {
 }
 
 void MyMesh::formatRadioStatsReply(char *reply) {
-  StatsFormatHelper::formatRadioStats(reply, _radio, radio_driver, getTotalAirTime(), getReceiveAirTime());
+  StatsFormatHelper::formatRadioStats(reply, _radio, radio_driver, getTotalAirTime(), getReceiveAirTime(),
+                                      getChannelUtilisation());
 }
 
 void MyMesh::formatPacketStatsReply(char *reply) {
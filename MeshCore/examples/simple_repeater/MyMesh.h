@@ -23,11 +23,17 @@
 #define WITH_BRIDGE
 #endif
 
+#ifdef WITH_UDP_BRIDGE
+#include "helpers/bridges/UDPBridge.h"
+#define WITH_BRIDGE
+#endif
+
 #include <helpers/AdvertDataHelpers.h>
 #include <helpers/ArduinoHelpers.h>
 #include <helpers/ClientACL.h>
 #include <helpers/CommonCLI.h>
 #include <helpers/IdentityStore.h>
+#include <helpers/LoRaAirtime.h>
 #include <helpers/SimpleMeshTables.h>
 #include <helpers/StaticPoolPacketManager.h>
 #include <helpers/StatsFormatHelper.h>
@@ -77,6 +83,26 @@ struct NeighbourInfo {
 
 #define FIRMWARE_ROLE "repeater"
 
+#ifndef RETRANSMIT_MAX_SLOTS
+  #define RETRANSMIT_MAX_SLOTS  0   // > 0 sizes the flood contention window from neighbours (see Mesh::getRetransmitMaxSlots())
+#endif
+
+#ifndef LINK_RATE_MIN_SF
+  #define LINK_RATE_MIN_SF  0   // > 0 lets direct bursts to strong neighbours go as fast as this SF (see Mesh::getLinkRateMinSF())
+#endif
+
+#if LINK_RATE_MIN_SF > 0 && !defined(WITH_LINK_RATE)
+  #error "LINK_RATE_MIN_SF needs -D WITH_LINK_RATE"
+#endif
+
+#ifndef CHANNEL_UTIL_BUDGET_GAIN
+  #define CHANNEL_UTIL_BUDGET_GAIN  2.0f   // busy channel: duty cycle down to 1/3 of airtime_factor's (see Dispatcher::getChannelUtilBudgetGain())
+#endif
+
+#ifndef NEIGHBOUR_ACTIVE_SECS
+  #define NEIGHBOUR_ACTIVE_SECS  (12*60*60)   // advert heard this recently = still around
+#endif
+
 #define PACKET_LOG_FILE  "/packet_log"
 
 class MyMesh : public mesh::Mesh, public CommonCLICallbacks {
@@ -110,6 +136,8 @@ class MyMesh : public mesh::Mesh, public CommonCLICallbacks {
   RS232Bridge bridge;
 #elif defined(WITH_ESPNOW_BRIDGE)
   ESPNowBridge bridge;
+#elif defined(WITH_UDP_BRIDGE)
+  UDPBridge bridge;
 #endif
 
   void putNeighbour(const mesh::Identity& id, uint32_t timestamp, float snr);
@@ -123,6 +151,9 @@ protected:
   float getAirtimeBudgetFactor() const override {
     return _prefs.airtime_factor;
   }
+  float getChannelUtilBudgetGain() const override {
+    return CHANNEL_UTIL_BUDGET_GAIN;
+  }
 
   bool allowPacketForward(const mesh::Packet* packet) override;
   const char* getLogDateTime() override;
@@ -135,6 +166,12 @@ protected:
 
   uint32_t getRetransmitDelay(const mesh::Packet* packet) override;
   uint32_t getDirectRetransmitDelay(const mesh::Packet* packet) override;
+  uint8_t getRetransmitMaxSlots() const override { return RETRANSMIT_MAX_SLOTS; }
+  int getEstNeighbours() const override;
+  uint8_t getLinkRateMinSF() const override;
+  uint8_t getLinkRateBaseSF() const override { return _prefs.sf; }
+  void setLinkRateSF(uint8_t sf) override;
+  uint32_t getLinkRateAirtime(int len, uint8_t sf) const override;
 
   int getInterferenceThreshold() const override {
     return _prefs.interference_threshold;
@@ -453,16 +453,8 @@ void MyMesh::onPeerDataRecv(mesh::Packet *packet, uint8_t type, int sender_idx,
           if (ack) sendFlood(ack, TXT_ACK_DELAY);
           delay_millis = TXT_ACK_DELAY + REPLY_DELAY_MILLIS;
         } else {
-          uint32_t d = TXT_ACK_DELAY;
-          if (getExtraAckTransmitCount() > 0) {
-            mesh::Packet *a1 = createMultiAck(ack_hash, 1);
-            if (a1) sendDirect(a1, client->out_path, client->out_path_len, d);
-            d += 300;
-          }
-
-          mesh::Packet *a2 = createAck(ack_hash);
-          if (a2) sendDirect(a2, client->out_path, client->out_path_len, d);
-          delay_millis = d + REPLY_DELAY_MILLIS;
+          sendDirectAck(ack_hash, client->out_path, client->out_path_len, TXT_ACK_DELAY);
+          delay_millis = TXT_ACK_DELAY + (getExtraAckTransmitCount() > 0 ? 300 : 0) + REPLY_DELAY_MILLIS;
         }
       } else {
         delay_millis = 0;
@@ -744,7 +736,8 @@ void MyMesh::formatStatsReply(char *reply) {
 }
 
 void MyMesh::formatRadioStatsReply(char *reply) {
-  StatsFormatHelper::formatRadioStats(reply, _radio, radio_driver, getTotalAirTime(), getReceiveAirTime());
+  StatsFormatHelper::formatRadioStats(reply, _radio, radio_driver, getTotalAirTime(), getReceiveAirTime(),
+                                      getChannelUtilisation());
 }
 
 void MyMesh::formatPacketStatsReply(char *reply) {
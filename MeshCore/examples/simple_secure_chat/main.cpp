@@ -451,7 +451,16 @@ public:
       }
     } else if (strcmp(command, "reset path") == 0) {
       if (curr_recipient) {
-        resetPathTo(*curr_recipient);
+        if (resetPathTo(*curr_recipient)) {
+          Serial.printf("   Done, %d hop spare route.\n", (int)curr_recipient->out_path_len);
+        } else {
+          Serial.println("   Done, flood.");
+        }
+        saveContacts();
+      }
+    } else if (strcmp(command, "reset path flood") == 0) {
+      if (curr_recipient) {
+        resetPathToFlood(*curr_recipient);
         saveContacts();
         Serial.println("   Done.");
       }
@@ -514,7 +523,7 @@ public:
       Serial.println("   to");
       Serial.println("   send <text>");
       Serial.println("   advert");
-      Serial.println("   reset path");
+      Serial.println("   reset path {flood}");
       Serial.println("   public <text>");
     } else {
       Serial.print("   ERROR: unknown command: "); Serial.println(command);
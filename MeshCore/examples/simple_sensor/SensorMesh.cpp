@@ -501,15 +501,7 @@ void SensorMesh::sendAckTo(const ClientInfo& dest, uint32_t ack_hash) {
     mesh::Packet* ack = createAck(ack_hash);
     if (ack) sendFlood(ack, TXT_ACK_DELAY);
   } else {
-    uint32_t d = TXT_ACK_DELAY;
-    if (getExtraAckTransmitCount() > 0) {
-      mesh::Packet* a1 = createMultiAck(ack_hash, 1);
-      if (a1) sendDirect(a1, dest.out_path, dest.out_path_len, d);
-      d += 300;
-    }
-
-    mesh::Packet* a2 = createAck(ack_hash);
-    if (a2) sendDirect(a2, dest.out_path, dest.out_path_len, d);
+    sendDirectAck(ack_hash, dest.out_path, dest.out_path_len, TXT_ACK_DELAY);
   }
 }
 
@@ -821,7 +813,8 @@ void SensorMesh::formatStatsReply(char *reply) {
 }
 
 void SensorMesh::formatRadioStatsReply(char *reply) {
-  StatsFormatHelper::formatRadioStats(reply, _radio, radio_driver, getTotalAirTime(), getReceiveAirTime());
+  StatsFormatHelper::formatRadioStats(reply, _radio, radio_driver, getTotalAirTime(), getReceiveAirTime(),
+                                      getChannelUtilisation());
 }
 
 void SensorMesh::formatPacketStatsReply(char *reply) {
@@ -14,6 +14,18 @@ namespace mesh {
   #define NOISE_FLOOR_CALIB_INTERVAL   2000     // 2 seconds
 #endif
 
+#ifndef CAD_BACKOFF_MAX_EXP
+  #define CAD_BACKOFF_MAX_EXP   4   // LBT retry delay grows to at most 16x, for the least urgent priorities
+#endif
+
+#ifndef CHANNEL_UTIL_SAMPLE_MILLIS
+  #define CHANNEL_UTIL_SAMPLE_MILLIS   10000   // utilisation is averaged over samples this long (1/4 weight each)
+#endif
+
+#ifndef CHANNEL_UTIL_BUDGET_THRESHOLD
+  #define CHANNEL_UTIL_BUDGET_THRESHOLD   0.25f   // utilisation below this leaves the airtime budget alone
+#endif
+
 void Dispatcher::begin() {
   n_sent_flood = n_sent_direct = 0;
   n_recv_flood = n_recv_direct = 0;
@@ -22,6 +34,7 @@ void Dispatcher::begin() {
 
   _radio->begin();
   prev_isrecv_mode = _radio->isInRecvMode();
+  util_sample_start = _ms->getMillis();
 }
 
 float Dispatcher::getAirtimeBudgetFactor() const {
@@ -38,6 +51,31 @@ uint32_t Dispatcher::getCADFailRetryDelay() const {
 uint32_t Dispatcher::getCADFailMaxDuration() const {
   return 4000;   // 4 seconds
 }
+uint8_t Dispatcher::getCADBackoffMaxExp(uint8_t priority) const {
+  return priority < CAD_BACKOFF_MAX_EXP ? priority + 1 : CAD_BACKOFF_MAX_EXP;
+}
+
+float Dispatcher::getEffectiveBudgetFactor() const {
+  float factor = getAirtimeBudgetFactor();
+  float gain = getChannelUtilBudgetGain();
+  if (gain > 0.0f && channel_util > CHANNEL_UTIL_BUDGET_THRESHOLD) {
+    // duty cycle is 1/(1 + factor), divide that by up to (1 + gain)
+    float over = (channel_util - CHANNEL_UTIL_BUDGET_THRESHOLD) / (1.0f - CHANNEL_UTIL_BUDGET_THRESHOLD);
+    factor = (1.0f + factor)*(1.0f + gain*over) - 1.0f;
+  }
+  return factor;
+}
+
+void Dispatcher::updateChannelUtil() {
+  unsigned long elapsed = _ms->getMillis() - util_sample_start;
+  if (elapsed > 0) {
+    float busy = (float)(util_rx_ms + util_busy_ms) / elapsed;
+    if (busy > 1.0f) busy = 1.0f;
+    channel_util = channel_util*0.75f + busy*0.25f;
+  }
+  util_rx_ms = util_busy_ms = 0;
+  util_sample_start = _ms->getMillis();
+}
 
 void Dispatcher::loop() {
   if (millisHasNowPassed(next_floor_calib_time)) {
@@ -46,6 +84,10 @@ void Dispatcher::loop() {
   }
   _radio->loop();
 
+  if (_ms->getMillis() - util_sample_start >= CHANNEL_UTIL_SAMPLE_MILLIS) {
+    updateChannelUtil();
+  }
+
   // check for radio 'stuck' in mode other than Rx
   bool is_recv = _radio->isInRecvMode();
   if (is_recv != prev_isrecv_mode) {
@@ -65,9 +107,10 @@ void Dispatcher::loop() {
       //Serial.print("  airtime="); Serial.println(t);
 
       // will need radio silence up to next_tx_time
-      next_tx_time = futureMillis(t * getAirtimeBudgetFactor());
+      next_tx_time = futureMillis(t * getEffectiveBudgetFactor());
 
       _radio->onSendFinished();
+      onRadioSendDone(outbound);
       logTx(outbound, 2 + outbound->path_len + outbound->payload_len);
       if (outbound->isRouteFlood()) {
         n_sent_flood++;
@@ -81,6 +124,7 @@ void Dispatcher::loop() {
 
       _radio->onSendFinished();
       logTxFail(outbound, 2 + outbound->path_len + outbound->payload_len);
+      onRadioSendFail(outbound);
 
       releasePacket(outbound);  // return to pool
       outbound = NULL;
@@ -160,6 +204,9 @@ void Dispatcher::checkRecv() {
             score = _radio->packetScore(_radio->getLastSNR(), len);
             air_time = _radio->getEstAirtimeFor(len);
             rx_air_time += air_time;
+            if (cad_busy_start == 0) {
+              util_rx_ms += air_time;   // (else, the LBT busy samples already cover it)
+            }
           }
         }
       }
@@ -190,6 +237,7 @@ void Dispatcher::checkRecv() {
 
     if (pkt->isRouteFlood()) {
       n_recv_flood++;
+      onRadioFloodRecv(pkt);
 
       int _delay = calcRxDelay(score, air_time);
       if (_delay < 50) {
@@ -226,10 +274,20 @@ void Dispatcher::processRecvPacket(Packet* pkt) {
 void Dispatcher::checkSend() {
   if (_mgr->getOutboundCount(_ms->getMillis()) == 0) return;  // nothing waiting to send
   if (!millisHasNowPassed(next_tx_time)) return;   // still in 'radio silence' phase (from airtime budget setting)
-  if (_radio->isReceiving()) {   // LBT - check if radio is currently mid-receive, or if channel activity
+  bool busy = _radio->isReceiving();   // LBT - check if radio is currently mid-receive, or if channel activity
+  lbt_busy_rate = lbt_busy_rate*15.0f/16.0f + (busy ? 1.0f/16.0f : 0.0f);
+  if (busy) {
     if (cad_busy_start == 0) {
       cad_busy_start = _ms->getMillis();   // record when CAD busy state started
     }
+    // meter only what was seen busy: a sample stands for at most one base retry delay before it, not the
+    // backoff sleep since the last one, and never reaches back past the start of this metering window
+    unsigned long now = _ms->getMillis();
+    uint32_t span = getCADFailRetryDelay();
+    if (util_busy_seen != 0 && now - util_busy_seen < span) span = now - util_busy_seen;
+    if (now - util_sample_start < span) span = now - util_sample_start;
+    util_busy_ms += span;
+    util_busy_seen = now;
 
     if (_ms->getMillis() - cad_busy_start > getCADFailMaxDuration()) {
       _err_flags |= ERR_EVENT_CAD_TIMEOUT;
@@ -238,13 +296,21 @@ void Dispatcher::checkSend() {
       // channel activity has gone on too long... (Radio might be in a bad state)
       // force the pending transmit below...
     } else {
-      next_tx_time = futureMillis(getCADFailRetryDelay());
+      // binary exponential backoff, capped by the priority of what is waiting
+      uint8_t max_exp = getCADBackoffMaxExp(_mgr->getNextOutboundPriority(_ms->getMillis()));
+      uint8_t e = cad_backoff < max_exp ? cad_backoff : max_exp;
+      if (cad_backoff < 0xFF) cad_backoff++;
+      next_tx_time = futureMillis(getCADFailRetryDelay() << e);
       return;
     }
   }
   cad_busy_start = 0;  // reset busy state
+  util_busy_seen = 0;
+  cad_backoff = 0;
 
-  outbound = _mgr->getNextOutbound(_ms->getMillis());
+  unsigned long now = _ms->getMillis();
+  uint8_t outbound_pri = _mgr->getNextOutboundPriority(now);   // in case it has to be queued again
+  outbound = _mgr->getNextOutbound(now);
   if (outbound) {
     int len = 0;
     uint8_t raw[MAX_TRANS_UNIT];
@@ -262,11 +328,19 @@ void Dispatcher::checkSend() {
 
     if (len + outbound->payload_len > MAX_TRANS_UNIT) {
       MESH_DEBUG_PRINTLN("%s Dispatcher::checkSend(): FATAL: Invalid packet queued... too long, len=%d", getLogDateTime(), len + outbound->payload_len);
+      onRadioSendFail(outbound);
       _mgr->free(outbound);
       outbound = NULL;
     } else {
       memcpy(&raw[len], outbound->payload, outbound->payload_len); len += outbound->payload_len;
 
+      uint32_t slot_wait = getTxSlotWait(outbound, _radio->getEstAirtimeFor(len));
+      if (slot_wait > 0) {
+        _mgr->queueOutbound(outbound, outbound_pri, futureMillis(slot_wait));
+        outbound = NULL;
+        return;
+      }
+
       uint32_t max_airtime = _radio->getEstAirtimeFor(len)*3/2;
       outbound_start = _ms->getMillis();
       bool success = _radio->startSendRaw(raw, len);
@@ -274,6 +348,7 @@ void Dispatcher::checkSend() {
         MESH_DEBUG_PRINTLN("%s Dispatcher::loop(): ERROR: send start failed!", getLogDateTime());
 
         logTxFail(outbound, outbound->getRawLength());
+        onRadioSendFail(outbound);
   
         releasePacket(outbound);  // return to pool
         outbound = NULL;
@@ -76,6 +76,12 @@ public:
 
   virtual float getLastRSSI() const { return 0; }
   virtual float getLastSNR() const { return 0; }
+
+  /**
+   * \returns  micros() when the radio raised its last TX-done / RX-done interrupt, 0 if not known.
+   *        More precise than the time isSendComplete() / recvRaw() get polled.
+  */
+  virtual uint32_t getLastIrqMicros() const { return 0; }
 };
 
 /**
@@ -89,9 +95,11 @@ public:
 
   virtual void queueOutbound(Packet* packet, uint8_t priority, uint32_t scheduled_for) = 0;
   virtual Packet* getNextOutbound(uint32_t now) = 0;    // by priority
+  virtual uint8_t getNextOutboundPriority(uint32_t now) const = 0;   // of what getNextOutbound() would return, 0xFF = none
   virtual int getOutboundCount(uint32_t now) const = 0;
   virtual int getFreeCount() const = 0;
   virtual Packet* getOutboundByIdx(int i) = 0;
+  virtual uint8_t getOutboundPriorityByIdx(int i) const = 0;   // as queued, for putting it back unchanged
   virtual Packet* removeOutboundByIdx(int i) = 0;
   virtual void queueInbound(Packet* packet, uint32_t scheduled_for) = 0;
   virtual Packet* getNextInbound(uint32_t now) = 0;
@@ -117,6 +125,11 @@ class Dispatcher {
   unsigned long outbound_expiry, outbound_start, total_air_time, rx_air_time;
   unsigned long next_tx_time;
   unsigned long cad_busy_start;
+  uint8_t cad_backoff;   // busy LBT checks in a row
+  float lbt_busy_rate;
+  unsigned long util_sample_start, util_busy_seen;   // start of the metering window, last busy LBT sample
+  uint32_t util_rx_ms, util_busy_ms;
+  float channel_util;
   unsigned long radio_nonrx_start;
   unsigned long next_floor_calib_time, next_agc_reset_time;
   bool  prev_isrecv_mode;
@@ -124,6 +137,7 @@ class Dispatcher {
   uint32_t n_recv_flood, n_recv_direct;
 
   void processRecvPacket(Packet* pkt);
+  void updateChannelUtil();
 
 protected:
   PacketManager* _mgr;
@@ -138,6 +152,11 @@ protected:
     total_air_time = rx_air_time = 0;
     next_tx_time = 0;
     cad_busy_start = 0;
+    cad_backoff = 0;
+    lbt_busy_rate = 0;
+    util_sample_start = util_busy_seen = 0;
+    util_rx_ms = util_busy_ms = 0;
+    channel_util = 0;
     next_floor_calib_time = next_agc_reset_time = 0;
     _err_flags = 0;
     radio_nonrx_start = 0;
@@ -149,6 +168,9 @@ protected:
   virtual void logRxRaw(float snr, float rssi, const uint8_t raw[], int len) { }   // custom hook
 
   virtual void logRx(Packet* packet, int len, float score) { }   // hooks for custom logging
+  virtual void onRadioFloodRecv(Packet* packet) { }   // every flood heard on air, before dedup and rx delay
+  virtual void onRadioSendDone(const Packet* packet) { }   // every completed transmit, before the packet is released
+  virtual void onRadioSendFail(const Packet* packet) { }   // a transmit that never made it on air, before the packet is released
   virtual void logTx(Packet* packet, int len) { }
   virtual void logTxFail(Packet* packet, int len) { }
   virtual const char* getLogDateTime() { return ""; }
@@ -157,9 +179,32 @@ protected:
   virtual int calcRxDelay(float score, uint32_t air_time) const;
   virtual uint32_t getCADFailRetryDelay() const;
   virtual uint32_t getCADFailMaxDuration() const;
+
+  /**
+   * \returns  cap on the LBT retry backoff for a packet of 'priority': the retry delay doubles per busy check in a row,
+   *     up to 2^cap times getCADFailRetryDelay(). Urgent (low number) priorities get the lower caps.
+   */
+  virtual uint8_t getCADBackoffMaxExp(uint8_t priority) const;
+
+  /**
+   * \returns  how hard a busy channel stretches the airtime budget. Above CHANNEL_UTIL_BUDGET_THRESHOLD, the duty cycle
+   *     from getAirtimeBudgetFactor() is divided by up to (1 + gain), at full utilisation. 0 = off (default).
+   */
+  virtual float getChannelUtilBudgetGain() const { return 0.0f; }
+
+  /**
+   * \returns  getAirtimeBudgetFactor(), stretched by getChannelUtilBudgetGain()
+   */
+  float getEffectiveBudgetFactor() const;
   virtual int getInterferenceThreshold() const { return 0; }    // disabled by default
   virtual int getAGCResetInterval() const { return 0; }    // disabled by default
 
+  /**
+   * \returns  milliseconds to hold 'packet' back, until it may start in a TX slot (eg. TDMA) long enough
+   *     for 'airtime_millis'. It then goes back in the queue, first in line once due. 0 = send now (default).
+   */
+  virtual uint32_t getTxSlotWait(const Packet* packet, uint32_t airtime_millis) { return 0; }
+
 public:
   void begin();
   void loop();
@@ -174,6 +219,8 @@ public:
   uint32_t getNumSentDirect() const { return n_sent_direct; }
   uint32_t getNumRecvFlood() const { return n_recv_flood; }
   uint32_t getNumRecvDirect() const { return n_recv_direct; }
+  float getChannelBusyRate() const { return lbt_busy_rate; }   // share of recent LBT checks that found the channel busy
+  float getChannelUtilisation() const { return channel_util; }   // recent share of time others had the channel (rx + LBT busy)
   void resetStats() {
     n_sent_flood = n_sent_direct = n_recv_flood = n_recv_direct = 0;
     _err_flags = 0;
@@ -0,0 +1,196 @@
+#include "FragmentPool.h"
+
+namespace mesh {
+
+static uint32_t fullMask(uint8_t count) {
+  return count >= MAX_FRAGMENTS ? 0xFFFFFFFF : (1UL << count) - 1;
+}
+
+static int rankSpare(const FragmentPool::Incoming* in) {   // which slot to give up first
+  if (!in->used) return 0;
+  return in->have == fullMask(in->count) ? 1 : 2;
+}
+
+FragmentPool::FragmentPool() {
+  _out_len = 0;
+  _out_pending = 0;
+  _out_attempt = 0;
+  _out_hold_until = 0;
+  memset(_in, 0, sizeof(_in));
+  _n_completed = _n_dropped = _n_resent = 0;
+}
+
+bool FragmentPool::beginSend(uint8_t type, const uint8_t* dest_hash, const uint8_t* src_hash, uint16_t id, size_t len) {
+  if (len == 0 || len > MAX_FRAGMENTED_PAYLOAD) return false;
+  int count = (len + FRAGMENT_DATA_SIZE - 1) / FRAGMENT_DATA_SIZE;
+  if (count > MAX_FRAGMENTS) return false;
+
+  _out_len = len;
+  _out_type = type;
+  memcpy(_out_dest, dest_hash, PATH_HASH_SIZE);
+  memcpy(_out_src, src_hash, PATH_HASH_SIZE);
+  _out_id = id;
+  _out_count = count;
+  _out_attempt = 0;
+  _out_pending = fullMask(count);
+  return true;
+}
+
+int FragmentPool::nextFragment(uint8_t* dest) {
+  if (_out_pending == 0) return 0;
+
+  int idx = 0;
+  while ((_out_pending & (1UL << idx)) == 0) idx++;
+  _out_pending &= ~(1UL << idx);
+
+  int i = 0;
+  dest[i++] = (_out_attempt << 4) | MULTIPART_TYPE_FRAGMENT;   // attempt keeps a re-send from looking 'seen'
+  dest[i++] = _out_type;
+  memcpy(&dest[i], _out_dest, PATH_HASH_SIZE); i += PATH_HASH_SIZE;
+  memcpy(&dest[i], _out_src, PATH_HASH_SIZE); i += PATH_HASH_SIZE;
+  memcpy(&dest[i], &_out_id, 2); i += 2;
+  dest[i++] = idx;
+  dest[i++] = _out_count;
+
+  int offset = idx * FRAGMENT_DATA_SIZE;
+  int n = _out_len - offset;
+  if (n > FRAGMENT_DATA_SIZE) n = FRAGMENT_DATA_SIZE;
+  memcpy(&dest[i], &_out[offset], n); i += n;
+  return i;
+}
+
+bool FragmentPool::onNack(const uint8_t* nack, size_t len, const uint8_t* self_hash) {
+  if (_out_len == 0 || len < FRAGMENT_NACK_SIZE) return false;
+
+  int i = 1;
+  if (memcmp(&nack[i], self_hash, PATH_HASH_SIZE) != 0) return false;   // not our payload
+  i += 2*PATH_HASH_SIZE;
+  uint16_t id;
+  memcpy(&id, &nack[i], 2); i += 2;
+  if (id != _out_id || _out_attempt >= 15) return false;
+
+  uint32_t missing;
+  memcpy(&missing, &nack[i], 4);
+  missing &= fullMask(_out_count);
+  if (missing == 0) return false;
+
+  if ((missing & ~_out_pending) != 0) {   // a new round, not one already being answered (eg. same NACK twice)
+    _out_attempt++;
+  }
+  _out_pending |= missing;
+  for (int k = 0; k < _out_count; k++) {
+    if (missing & (1UL << k)) _n_resent++;
+  }
+  return true;
+}
+
+FragmentPool::Incoming* FragmentPool::addFragment(const uint8_t* frag, size_t len, unsigned long now, unsigned long timeout) {
+  if (len <= FRAGMENT_HEADER_SIZE) return NULL;
+
+  int i = 1;
+  uint8_t type = frag[i++] & 0x0F;
+  const uint8_t* dest_hash = &frag[i]; i += PATH_HASH_SIZE;
+  const uint8_t* src_hash = &frag[i]; i += PATH_HASH_SIZE;
+  uint16_t id;
+  memcpy(&id, &frag[i], 2); i += 2;
+  uint8_t idx = frag[i++];
+  uint8_t count = frag[i++];
+  int n = len - i;
+
+  int offset = idx * FRAGMENT_DATA_SIZE;
+  if (count == 0 || count > MAX_FRAGMENTS || idx >= count || offset + n > MAX_FRAGMENTED_PAYLOAD
+      || (idx < count - 1 && n != FRAGMENT_DATA_SIZE)) {
+    return NULL;   // malformed
+  }
+
+  // same payload already under way? else a free slot, else a finished one, else the one due soonest
+  Incoming* in = NULL;
+  Incoming* spare = NULL;
+  for (int s = 0; s < FRAGMENT_RECV_SLOTS; s++) {
+    Incoming* c = &_in[s];
+    if (c->used && c->id == id && c->count == count && c->type == type
+        && memcmp(c->src_hash, src_hash, PATH_HASH_SIZE) == 0 && memcmp(c->dest_hash, dest_hash, PATH_HASH_SIZE) == 0) {
+      in = c;
+      break;
+    }
+    if (spare == NULL || rankSpare(c) < rankSpare(spare)
+        || (rankSpare(c) == rankSpare(spare) && (long)(c->nack_at - spare->nack_at) < 0)) {
+      spare = c;
+    }
+  }
+  if (in == NULL) {
+    in = spare;
+    if (in->used && in->have != fullMask(in->count)) _n_dropped++;
+    in->used = true;
+    in->len = 0;
+    in->type = type;
+    memcpy(in->dest_hash, dest_hash, PATH_HASH_SIZE);
+    memcpy(in->src_hash, src_hash, PATH_HASH_SIZE);
+    in->id = id;
+    in->count = count;
+    in->nacks = 0;
+    in->have = 0;
+  }
+  if (in->have & (1UL << idx)) return NULL;   // duplicate (or a re-send for someone else)
+
+  in->nack_at = now + timeout;
+  memcpy(&in->payload[offset], &frag[i], n);
+  in->have |= (1UL << idx);
+  if (idx == count - 1) in->len = offset + n;   // only the last one tells the total
+
+  if (in->have != fullMask(count)) return NULL;
+
+  // hold on to it while the others may still be asking for re-sends, or one would look like a new payload
+  in->nack_at = now + timeout*(FRAGMENT_MAX_NACKS + 1);
+  _n_completed++;
+  return in;
+}
+
+void FragmentPool::onNackOverheard(const uint8_t* nack, size_t len, unsigned long now, unsigned long timeout) {
+  if (len < FRAGMENT_NACK_SIZE) return;
+
+  const uint8_t* sender = &nack[1];
+  uint16_t id;
+  uint32_t missing;
+  memcpy(&id, &nack[1 + 2*PATH_HASH_SIZE], 2);
+  memcpy(&missing, &nack[3 + 2*PATH_HASH_SIZE], 4);
+  for (int s = 0; s < FRAGMENT_RECV_SLOTS; s++) {
+    Incoming* in = &_in[s];
+    if (!in->used || in->id != id || memcmp(in->src_hash, sender, PATH_HASH_SIZE) != 0) continue;
+
+    uint32_t ours = fullMask(in->count) & ~in->have;
+    if (ours != 0 && (missing & ours) == ours) {
+      // someone else asked for everything we need: count that as our round, and wait for the re-sends
+      if (in->nacks < FRAGMENT_MAX_NACKS) in->nacks++;
+      in->nack_at = now + timeout;
+    }
+  }
+}
+
+int FragmentPool::checkStalled(uint8_t* nack_dest, const uint8_t* self_hash, unsigned long now, unsigned long timeout) {
+  for (int s = 0; s < FRAGMENT_RECV_SLOTS; s++) {
+    Incoming* in = &_in[s];
+    if (!in->used || (long)(now - in->nack_at) < 0) continue;
+
+    uint32_t missing = fullMask(in->count) & ~in->have;
+    if (missing == 0 || in->nacks >= FRAGMENT_MAX_NACKS) {
+      if (missing != 0) _n_dropped++;   // given up on
+      in->used = false;
+      continue;
+    }
+    in->nacks++;
+    in->nack_at = now + timeout;   // wait for the re-sends
+
+    int i = 0;
+    nack_dest[i++] = MULTIPART_TYPE_FRAGMENT_NACK;
+    memcpy(&nack_dest[i], in->src_hash, PATH_HASH_SIZE); i += PATH_HASH_SIZE;   // back to whoever sent it
+    memcpy(&nack_dest[i], self_hash, PATH_HASH_SIZE); i += PATH_HASH_SIZE;
+    memcpy(&nack_dest[i], &in->id, 2); i += 2;
+    memcpy(&nack_dest[i], &missing, 4); i += 4;
+    nack_dest[i++] = in->nacks;
+    return i;
+  }
+  return 0;
+}
+
+}
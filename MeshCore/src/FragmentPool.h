@@ -0,0 +1,88 @@
+#pragma once
+
+#include <Packet.h>
+#include <string.h>
+
+#ifndef MAX_FRAGMENTED_PAYLOAD
+  #define MAX_FRAGMENTED_PAYLOAD  4096
+#endif
+
+#ifndef FRAGMENT_RECV_SLOTS
+  #define FRAGMENT_RECV_SLOTS  2
+#endif
+
+#ifndef FRAGMENT_MAX_NACKS
+  #define FRAGMENT_MAX_NACKS  3    // rounds of NACKs a receiver sends, before giving up on a payload
+#endif
+
+// MULTIPART fragment: type|attempt, inner payload type, dest hash, src hash, id (2), index, count, data...
+#define FRAGMENT_HEADER_SIZE  (6 + 2*PATH_HASH_SIZE)
+#define FRAGMENT_DATA_SIZE    (MAX_PACKET_PAYLOAD - FRAGMENT_HEADER_SIZE)
+// MULTIPART NACK: type, dest hash (the sender), src hash, id (2), bitmap of missing fragments (4), round
+// (the round keeps a repeat of the same NACK from being dropped as already 'seen')
+#define FRAGMENT_NACK_SIZE    (8 + 2*PATH_HASH_SIZE)
+#define MAX_FRAGMENTS         32   // one bit each
+
+namespace mesh {
+
+/**
+ * \brief  Buffers for payloads too big for one Packet: the one being sent, kept after its last fragment so the
+ *     ones a receiver NACKs can be sent again, and a few being reassembled. Only encodes/decodes, timing is
+ *     left to the Mesh. Owned by the sub-class, see Mesh::setFragmentPool().
+ */
+class FragmentPool {
+public:
+  struct Incoming {
+    uint8_t payload[MAX_FRAGMENTED_PAYLOAD];
+    uint16_t len;
+    uint8_t type;       // of the reassembled payload, eg. PAYLOAD_TYPE_GRP_TXT
+    uint8_t dest_hash[PATH_HASH_SIZE];
+    uint8_t src_hash[PATH_HASH_SIZE];
+    uint16_t id;
+    uint8_t count;
+    uint8_t nacks;      // rounds asked for so far (by us, or overheard)
+    uint32_t have;      // bitmap
+    unsigned long nack_at;      // when to ask for what's missing, if nothing more arrives
+    bool used;
+  };
+
+  FragmentPool();
+
+  // sending side
+  uint8_t* getSendBuffer() { return _out; }
+  bool beginSend(uint8_t type, const uint8_t* dest_hash, const uint8_t* src_hash, uint16_t id, size_t len);
+  bool isSending() const { return _out_pending != 0; }
+  // send buffer still needed, for re-sends a late NACK may ask for
+  bool isHeld(unsigned long now) const { return _out_pending != 0 || (_out_len != 0 && (long)(now - _out_hold_until) < 0); }
+  void holdUntil(unsigned long until) { _out_hold_until = until; }
+  int  nextFragment(uint8_t* dest);   // encodes next fragment due (MULTIPART payload), 0 = none
+  bool onNack(const uint8_t* nack, size_t len, const uint8_t* self_hash);
+  void endSend() { _out_len = 0; _out_pending = 0; }
+
+  // receiving side. A completed slot is kept until its timeout, so re-sends others asked for are ignored
+  Incoming* addFragment(const uint8_t* frag, size_t len, unsigned long now, unsigned long timeout);   // once complete
+  void onNackOverheard(const uint8_t* nack, size_t len, unsigned long now, unsigned long timeout);
+  int  checkStalled(uint8_t* nack_dest, const uint8_t* self_hash, unsigned long now, unsigned long timeout);   // NACK to send
+  uint8_t* getScratch() { return _scratch; }
+
+  uint32_t getNumCompleted() const { return _n_completed; }
+  uint32_t getNumDropped() const { return _n_dropped; }
+  uint32_t getNumResent() const { return _n_resent; }
+
+private:
+  uint8_t _out[MAX_FRAGMENTED_PAYLOAD];
+  uint16_t _out_len;    // 0 = nothing to send
+  uint8_t _out_type;
+  uint8_t _out_dest[PATH_HASH_SIZE];
+  uint8_t _out_src[PATH_HASH_SIZE];
+  uint16_t _out_id;
+  uint8_t _out_count;
+  uint8_t _out_attempt;
+  uint32_t _out_pending;  // bitmap of fragments still to (re)send
+  unsigned long _out_hold_until;   // NACK window, after the last fragment sent
+  Incoming _in[FRAGMENT_RECV_SLOTS];
+  uint8_t _scratch[MAX_FRAGMENTED_PAYLOAD + 1];   // for decrypting a reassembled payload
+  uint32_t _n_completed, _n_dropped, _n_resent;
+};
+
+}
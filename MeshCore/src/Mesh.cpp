@@ -3,12 +3,42 @@
 
 namespace mesh {
 
+#ifdef WITH_LINK_RATE
+#define LINK_RATE_IDLE     0
+#define LINK_RATE_ASKED    1   // REQ sent, waiting on the ACK
+#define LINK_RATE_ACKING   2   // REQ accepted, waiting for our ACK to go
+#define LINK_RATE_ACTIVE   3   // both on the faster SF
+
+#define LINK_RATE_REQ_LEN  6   // type, dest hash, src hash, sf, hold_millis(2)
+#define LINK_RATE_ACK_LEN  4   // type, dest hash, src hash, sf (0 = refused)
+#endif
+
 void Mesh::begin() {
   Dispatcher::begin();
 }
 
 void Mesh::loop() {
   Dispatcher::loop();
+#ifdef WITH_ROUTE_COLLECT
+  sendBetterRoutes();
+#endif
+#ifdef WITH_ACK_BATCHING
+  if (_num_batched_acks > 0 && millisHasNowPassed(_ack_batch_due)) {
+    sendAckBatch();
+  }
+#endif
+#ifdef WITH_FRAGMENTS
+  if (_fragments) {
+    sendPendingFragments();
+    checkStalledFragments();
+  }
+#endif
+#ifdef WITH_LINK_RATE
+  // ACKING only ends in onRadioSendDone()/onRadioSendFail(): the peer switches on hearing our ACK, whenever that goes
+  if (_link_rate.state != LINK_RATE_IDLE && _link_rate.state != LINK_RATE_ACKING && millisHasNowPassed(_link_rate.until)) {
+    endLinkRate();
+  }
+#endif
 }
 
 bool Mesh::allowPacketForward(const mesh::Packet* packet) { 
@@ -17,6 +47,7 @@ bool Mesh::allowPacketForward(const mesh::Packet* packet) {
 uint32_t Mesh::getRetransmitDelay(const mesh::Packet* packet) { 
   uint32_t t = (_radio->getEstAirtimeFor(packet->getRawLength()) * 52 / 50) / 2;
 
+  if (getRetransmitMaxSlots() > 0) return calcContentionDelay(packet, t);
   return _rng->nextInt(0, 5)*t;
 }
 uint32_t Mesh::getDirectRetransmitDelay(const Packet* packet) {
@@ -25,6 +56,24 @@ uint32_t Mesh::getDirectRetransmitDelay(const Packet* packet) {
 uint8_t Mesh::getExtraAckTransmitCount() const {
   return 0;
 }
+uint32_t Mesh::getAckBatchWindow() const {
+  return ACK_BATCH_WINDOW_MILLIS;
+}
+
+#ifdef WITH_FRAGMENTS
+uint32_t Mesh::getFragmentInterval(uint32_t airtime_millis, int path_len) const {
+  // 1st relay is busy passing one on while the next would arrive, 2nd one's transmission may still
+  // drown it out at the 1st, from the 3rd on they can overlap. And no relay can go faster than its
+  // airtime budget lets it.
+  float spacing = 1.0f + (path_len < 0 ? 0 : (path_len > 2 ? 2 : path_len));
+  if (spacing < 1.0f + getEffectiveBudgetFactor()) spacing = 1.0f + getEffectiveBudgetFactor();
+  return (uint32_t)(airtime_millis * spacing * 1.1f);
+}
+
+uint32_t Mesh::getFragmentTimeout() const {
+  return _radio->getEstAirtimeFor(MAX_TRANS_UNIT) * 8;
+}
+#endif
 
 uint32_t Mesh::getCADFailRetryDelay() const {
   return _rng->nextInt(1, 4)*120;
@@ -71,7 +120,18 @@ DispatcherAction Mesh::onRecvPacket(Packet* pkt) {
 
   if (pkt->isRouteDirect() && pkt->getPayloadType() == PAYLOAD_TYPE_CONTROL && (pkt->payload[0] & 0x80) != 0) {
     if (pkt->path_len == 0) {
-      onControlDataRecv(pkt);
+    #ifdef WITH_LINK_RATE
+      uint8_t type = pkt->payload[0] & 0xF0;
+      if (type == CTL_TYPE_LINK_RATE_REQ) {
+        recvLinkRateReq(pkt);
+      } else if (type == CTL_TYPE_LINK_RATE_ACK) {
+        recvLinkRateAck(pkt);
+      } else {
+        onControlDataRecv(pkt);
+      }
+    #else
+      onControlDataRecv(pkt);   // link rate handshakes too: not for us, like older firmware
+    #endif
     }
     // just zero-hop control packets allowed (for this subset of payloads)
     return ACTION_RELEASE;
@@ -129,8 +189,8 @@ DispatcherAction Mesh::onRecvPacket(Packet* pkt) {
         MESH_DEBUG_PRINTLN("%s Mesh::onRecvPacket(): incomplete data packet", getLogDateTime());
       } else if (!_tables->hasSeen(pkt)) {
         // NOTE: this is a 'first packet wins' impl. When receiving from multiple paths, the first to arrive wins.
-        //       For flood mode, the path may not be the 'best' in terms of hops.
-        // FUTURE: could send back multiple paths, using createPathReturn(), and let sender choose which to use(?)
+        //       For flood mode, the path may not be the 'best' in terms of hops, so later copies are compared
+        //       for getRouteCollectWindow(), and a better path is sent back too. (see sendBetterRoutes())
 
         if (self_id.isHashMatch(&dest_hash)) {
           // scan contacts DB, for all matching hashes of 'src_hash' (max 4 matches supported ATM)
@@ -145,6 +205,11 @@ DispatcherAction Mesh::onRecvPacket(Packet* pkt) {
             uint8_t data[MAX_PACKET_PAYLOAD];
             int len = Utils::MACThenDecrypt(secret, data, macAndData, pkt->payload_len - i);
             if (len > 0) {  // success!
+#ifdef WITH_ROUTE_COLLECT
+              if (pkt->isRouteFlood() && getRouteCollectWindow() > 0) {
+                trackRouteCandidate(pkt, &src_hash, secret);
+              }
+#endif
               if (pkt->getPayloadType() == PAYLOAD_TYPE_PATH) {
                 int k = 0;
                 uint8_t path_len = data[k++];
@@ -173,6 +238,10 @@ DispatcherAction Mesh::onRecvPacket(Packet* pkt) {
           }
         }
         action = routeRecvPacket(pkt);
+#ifdef WITH_ROUTE_COLLECT
+      } else if (pkt->isRouteFlood() && self_id.isHashMatch(&dest_hash)) {
+        updateRouteCandidate(pkt);   // a later copy of one already taken, maybe via a better route
+#endif
       }
       break;
     }
@@ -295,6 +364,17 @@ DispatcherAction Mesh::onRecvPacket(Packet* pkt) {
             onAckRecv(&tmp, ack_crc);
             //action = routeRecvPacket(&tmp);  // NOTE: currently not needed, as multipart ACKs not sent Flood
           }
+        } else if (type == MULTIPART_TYPE_FRAGMENT || type == MULTIPART_TYPE_FRAGMENT_NACK) {
+          if (!_tables->hasSeen(pkt)) {
+#ifdef WITH_FRAGMENTS
+            if (_fragments) recvFragment(pkt);
+#endif
+            action = routeRecvPacket(pkt);
+          }
+        } else if (type == MULTIPART_TYPE_ACK_BATCH) {
+          if (pkt->isRouteDirect() && !_tables->hasSeen(pkt)) {
+            recvAckBatch(pkt);
+          }
         } else {
           // FUTURE: other multipart types??
         }
@@ -323,6 +403,213 @@ void Mesh::removeSelfFromPath(Packet* pkt) {
 #endif
 }
 
+#ifdef WITH_ROUTE_COLLECT
+void Mesh::trackRouteCandidate(const Packet* packet, const uint8_t* src_hash, const uint8_t* secret) {
+  // reuse a free slot, else the one closest to expiring
+  RouteCandidate* c = &_route_candidates[0];
+  for (int i = 0; i < MAX_ROUTE_CANDIDATES; i++) {
+    if (_route_candidates[i].expires == 0) {
+      c = &_route_candidates[i];
+      break;
+    }
+    if ((long)(_route_candidates[i].expires - c->expires) < 0) c = &_route_candidates[i];
+  }
+  packet->calculatePacketHash(c->hash);
+  memcpy(c->src_hash, src_hash, PATH_HASH_SIZE);
+  memcpy(c->secret, secret, PUB_KEY_SIZE);
+  c->better = false;
+  c->snr = packet->_snr;
+  memcpy(c->path, packet->path, c->path_len = packet->path_len);
+  c->expires = futureMillis(getRouteCollectWindow());
+  if (c->expires == 0) c->expires = 1;
+}
+
+void Mesh::updateRouteCandidate(const Packet* packet) {
+  uint8_t hash[MAX_HASH_SIZE];
+  packet->calculatePacketHash(hash);
+  for (int i = 0; i < MAX_ROUTE_CANDIDATES; i++) {
+    RouteCandidate& c = _route_candidates[i];
+    if (c.expires == 0 || memcmp(hash, c.hash, MAX_HASH_SIZE) != 0) continue;
+
+    // hops first (what 'first packet wins' gets wrong), then the last hop's margin.
+    // NOTE: only the last hop's SNR is known here, per-hop SNRs are only carried by TRACE
+    if (packet->path_len < c.path_len
+        || (packet->path_len == c.path_len && packet->_snr >= c.snr + ROUTE_SNR_MARGIN*4)) {
+      c.better = true;
+      c.snr = packet->_snr;
+      memcpy(c.path, packet->path, c.path_len = packet->path_len);
+    }
+    return;
+  }
+}
+
+void Mesh::sendBetterRoutes() {
+  for (int i = 0; i < MAX_ROUTE_CANDIDATES; i++) {
+    RouteCandidate& c = _route_candidates[i];
+    if (c.expires == 0 || !millisHasNowPassed(c.expires)) continue;
+
+    c.expires = 0;
+    if (!c.better) continue;
+
+    Packet* rpath = createPathReturn(c.src_hash, c.secret, c.path, c.path_len, 0, NULL, 0);
+    if (rpath) {
+      // back along the route it arrived by, reversed
+      uint8_t back[MAX_PATH_SIZE];
+      for (int k = 0; k < c.path_len; k += PATH_HASH_SIZE) {
+        memcpy(&back[k], &c.path[c.path_len - PATH_HASH_SIZE - k], PATH_HASH_SIZE);
+      }
+      sendDirect(rpath, back, c.path_len);
+      _n_alt_paths_sent++;
+    }
+  }
+}
+#endif
+
+#ifdef WITH_FRAGMENTS
+bool Mesh::sendGroupFragmented(uint8_t type, const GroupChannel& channel, const uint8_t* data, size_t data_len) {
+  if (!(type == PAYLOAD_TYPE_GRP_TXT || type == PAYLOAD_TYPE_GRP_DATA)) return false;   // invalid type
+  if (isSendingFragments()) return false;
+  if (PATH_HASH_SIZE + CIPHER_MAC_SIZE + data_len + CIPHER_BLOCK_SIZE-1 > MAX_FRAGMENTED_PAYLOAD) return false;  // too long
+
+  // same layout as createGroupDatagram(), just not limited to one packet
+  uint8_t* payload = _fragments->getSendBuffer();
+  int len = 0;
+  memcpy(&payload[len], channel.hash, PATH_HASH_SIZE); len += PATH_HASH_SIZE;
+  len += Utils::encryptThenMAC(channel.secret, &payload[len], data, data_len);
+
+  return beginFragmented(type, channel.hash, len, NULL, -1);
+}
+
+bool Mesh::sendDatagramFragmented(uint8_t type, const Identity& dest, const uint8_t* secret, const uint8_t* data, size_t data_len,
+                                  const uint8_t* path, uint8_t path_len) {
+  if (!(type == PAYLOAD_TYPE_TXT_MSG || type == PAYLOAD_TYPE_REQ || type == PAYLOAD_TYPE_RESPONSE)) return false;
+  if (isSendingFragments()) return false;
+  if (2*PATH_HASH_SIZE + CIPHER_MAC_SIZE + data_len + CIPHER_BLOCK_SIZE-1 > MAX_FRAGMENTED_PAYLOAD) return false;
+
+  // same layout as createDatagram()
+  uint8_t* payload = _fragments->getSendBuffer();
+  int len = 0;
+  len += dest.copyHashTo(&payload[len]);  // dest hash
+  len += self_id.copyHashTo(&payload[len]);  // src hash
+  len += Utils::encryptThenMAC(secret, &payload[len], data, data_len);
+
+  return beginFragmented(type, payload, len, path, path ? path_len : -1);
+}
+
+bool Mesh::beginFragmented(uint8_t type, const uint8_t* dest_hash, size_t len, const uint8_t* path, int path_len) {
+  uint8_t src_hash[PATH_HASH_SIZE];
+  self_id.copyHashTo(src_hash);
+  if (!_fragments->beginSend(type, dest_hash, src_hash, ++_next_fragment_id, len)) return false;
+
+  _fragment_path_len = path_len;
+  if (path_len > 0) memcpy(_fragment_path, path, path_len);
+  _next_fragment_send = _ms->getMillis();
+  return true;
+}
+
+void Mesh::sendPendingFragments() {
+  // one at a time, so a long payload never takes more than a single packet from the pool
+  if (!_fragments->isSending() || !millisHasNowPassed(_next_fragment_send)) return;
+
+  Packet* packet = obtainNewPacket();
+  if (packet == NULL) {
+    MESH_DEBUG_PRINTLN("%s Mesh::sendPendingFragments(): error, packet pool empty", getLogDateTime());
+    _next_fragment_send = futureMillis(100);
+    return;
+  }
+  packet->header = (PAYLOAD_TYPE_MULTIPART << PH_TYPE_SHIFT);  // ROUTE_TYPE_* set later
+  packet->payload_len = _fragments->nextFragment(packet->payload);
+
+  uint32_t t = _radio->getEstAirtimeFor(packet->getRawLength());
+  uint32_t interval = getFragmentInterval(t, _fragment_path_len);
+  _next_fragment_send = futureMillis(interval);
+  // keep the buffer until every receiver has had all its NACK rounds (each up to 1.5x the timeout, see recvFragment())
+  _fragments->holdUntil(futureMillis(interval + getFragmentTimeout()*3/2*(FRAGMENT_MAX_NACKS + 1)));
+  if (_fragment_path_len >= 0) {
+    sendDirect(packet, _fragment_path, _fragment_path_len);
+  } else {
+    sendFlood(packet);
+  }
+}
+
+void Mesh::recvFragment(Packet* pkt) {
+  uint8_t type = pkt->payload[0] & 0x0F;
+  unsigned long now = _ms->getMillis();
+  uint32_t timeout = getFragmentTimeout();
+  timeout += _rng->nextInt(0, timeout / 2);   // so a whole channel doesn't NACK at once
+
+  if (type == MULTIPART_TYPE_FRAGMENT_NACK) {
+    if (pkt->payload_len < FRAGMENT_NACK_SIZE) return;
+    if (self_id.isHashMatch(&pkt->payload[1])) {
+      if (_fragments->onNack(pkt->payload, pkt->payload_len, self_id.pub_key) && millisHasNowPassed(_next_fragment_send)) {
+        _next_fragment_send = now;
+      }
+      pkt->markDoNotRetransmit();
+    } else {
+      _fragments->onNackOverheard(pkt->payload, pkt->payload_len, now, timeout);
+    }
+    return;
+  }
+
+  if (pkt->payload_len <= FRAGMENT_HEADER_SIZE) return;
+  uint8_t inner = pkt->payload[1] & 0x0F;
+  uint8_t* dest_hash = &pkt->payload[2];
+  if (inner == PAYLOAD_TYPE_GRP_TXT || inner == PAYLOAD_TYPE_GRP_DATA) {
+    GroupChannel channels[4];
+    if (searchChannelsByHash(dest_hash, channels, 4) == 0) return;   // not a channel of ours
+  } else if (!self_id.isHashMatch(dest_hash)) {
+    return;
+  } else {
+    pkt->markDoNotRetransmit();  // for this node, so don't retransmit
+  }
+
+  const FragmentPool::Incoming* in = _fragments->addFragment(pkt->payload, pkt->payload_len, now, timeout);
+  if (in) recvReassembled(pkt, in);
+}
+
+void Mesh::checkStalledFragments() {
+  uint8_t nack[FRAGMENT_NACK_SIZE];
+  int len = _fragments->checkStalled(nack, self_id.pub_key, _ms->getMillis(), getFragmentTimeout());
+  if (len == 0) return;
+
+  Packet* packet = obtainNewPacket();
+  if (packet == NULL) {
+    MESH_DEBUG_PRINTLN("%s Mesh::checkStalledFragments(): error, packet pool empty", getLogDateTime());
+    return;
+  }
+  packet->header = (PAYLOAD_TYPE_MULTIPART << PH_TYPE_SHIFT);  // ROUTE_TYPE_* set later
+  memcpy(packet->payload, nack, len);
+  packet->payload_len = len;
+  sendFlood(packet);   // direct fragments don't carry a path back
+}
+
+void Mesh::recvReassembled(Packet* pkt, const FragmentPool::Incoming* in) {
+  uint8_t* data = _fragments->getScratch();   // MAX_FRAGMENTED_PAYLOAD + 1, room for a null terminator
+  if (in->type == PAYLOAD_TYPE_GRP_TXT || in->type == PAYLOAD_TYPE_GRP_DATA) {
+    GroupChannel channels[4];
+    int num = searchChannelsByHash(in->payload, channels, 4);
+    for (int j = 0; j < num; j++) {
+      int len = Utils::MACThenDecrypt(channels[j].secret, data, &in->payload[PATH_HASH_SIZE], in->len - PATH_HASH_SIZE);
+      if (len > 0) {  // success!
+        onGroupDataRecv(pkt, in->type, channels[j], data, len);
+        break;
+      }
+    }
+  } else {
+    int num = searchPeersByHash(&in->payload[PATH_HASH_SIZE]);   // by src hash
+    for (int j = 0; j < num; j++) {
+      uint8_t secret[PUB_KEY_SIZE];
+      getPeerSharedSecret(secret, j);
+      int len = Utils::MACThenDecrypt(secret, data, &in->payload[2*PATH_HASH_SIZE], in->len - 2*PATH_HASH_SIZE);
+      if (len > 0) {  // success!
+        onPeerDataRecv(pkt, in->type, j, secret, data, len);
+        break;
+      }
+    }
+  }
+}
+#endif
+
 DispatcherAction Mesh::routeRecvPacket(Packet* packet) {
   if (packet->isRouteFlood() && !packet->isMarkedDoNotRetransmit()
     && packet->path_len + PATH_HASH_SIZE <= MAX_PATH_SIZE && allowPacketForward(packet)) {
@@ -330,12 +617,351 @@ DispatcherAction Mesh::routeRecvPacket(Packet* packet) {
     packet->path_len += self_id.copyHashTo(&packet->path[packet->path_len]);
 
     uint32_t d = getRetransmitDelay(packet);
+#ifdef WITH_FLOOD_SUPPRESSION
+    if (getFloodSuppressThreshold() > 0) {
+      trackPendingFlood(packet);
+    }
+#endif
     // as this propagates outwards, give it lower and lower priority
     return ACTION_RETRANSMIT_DELAYED(packet->path_len, d);   // give priority to closer sources, than ones further away
   }
   return ACTION_RELEASE;
 }
 
+#ifdef WITH_FLOOD_SUPPRESSION
+void Mesh::trackPendingFlood(Packet* packet) {
+  PendingFlood& p = _pending_floods[_next_pending_flood];
+  p.packet = packet;
+  packet->calculatePacketHash(p.hash);
+  p.heard = 0;
+  _next_pending_flood = (_next_pending_flood + 1) % MAX_PENDING_FLOODS;   // cyclic, oldest is overwritten
+}
+#endif
+
+#ifdef WITH_HEARD_NEIGHBOURS
+int Mesh::getNumNeighboursHeard() const {
+  int n = 0;
+  for (int i = 0; i < MAX_HEARD_NEIGHBOURS; i++) {
+    const HeardNeighbour& h = _heard_neighbours[i];
+    if (h.last_heard != 0 && _ms->getMillis() - h.last_heard < HEARD_NEIGHBOUR_MAX_AGE_MILLIS) n++;
+  }
+  return n;
+}
+#endif
+
+int Mesh::getContentionSlots() const {
+  // about a slot for every two neighbours (not all of them heard the same copy), widened while LBT keeps
+  // finding the channel busy
+  float w = 2.0f + 0.5f*getEstNeighbours()*(1.0f + 2.0f*getChannelBusyRate());
+  int max_slots = getRetransmitMaxSlots();
+  if (w > max_slots) return max_slots;
+  return (int) w;
+}
+
+uint32_t Mesh::calcContentionDelay(const Packet* packet, uint32_t slot_millis) {
+  int w = getContentionSlots();
+  if (w <= 1) return 0;
+
+  // a weak copy came from far off, so ours covers the most new ground: go early. Strong copies wait
+  // in the later slots, where they can overhear the others and be cancelled (getFloodSuppressThreshold())
+  float near = (packet->getSNR() - RETRANSMIT_SNR_FAR) / (RETRANSMIT_SNR_NEAR - RETRANSMIT_SNR_FAR);
+  if (near < 0.0f) near = 0.0f;
+  if (near > 1.0f) near = 1.0f;
+  int band = w / 2;    // random pick within a band, so neighbours with similar SNR still spread out
+  if (band < 2) band = 2;
+  if (band > w) band = w;
+  int first = (int)(near*(w - band) + 0.5f);
+  return (first + _rng->nextInt(0, band))*slot_millis;
+}
+
+#ifdef WITH_HEARD_NEIGHBOURS
+void Mesh::trackNeighbour(const Packet* pkt) {
+  if (pkt->path_len >= PATH_HASH_SIZE) {
+    trackNeighbour(&pkt->path[pkt->path_len - PATH_HASH_SIZE], pkt->_snr);   // last relay
+  } else if (pkt->getPayloadType() == PAYLOAD_TYPE_ADVERT && pkt->payload_len >= PUB_KEY_SIZE) {
+    trackNeighbour(pkt->payload, pkt->_snr);   // zero-hop advert, the sender's pub_key
+  }
+  // else, zero-hop, sender unknown (without decrypting)
+}
+
+Mesh::HeardNeighbour* Mesh::trackNeighbour(const uint8_t* hash, int8_t snr) {
+  HeardNeighbour* slot = &_heard_neighbours[0];
+  bool found = false;
+  for (int i = 0; i < MAX_HEARD_NEIGHBOURS; i++) {
+    HeardNeighbour& h = _heard_neighbours[i];
+    if (h.last_heard != 0 && memcmp(h.hash, hash, PATH_HASH_SIZE) == 0) {
+      slot = &h;
+      found = true;
+      break;
+    }
+    if (h.last_heard < slot->last_heard) slot = &h;   // else re-use the least recently heard
+  }
+  if (!found) {
+    memcpy(slot->hash, hash, PATH_HASH_SIZE);
+  }
+#ifdef WITH_LINK_RATE
+  if (found) {
+    slot->snr = (int8_t)((3*slot->snr + snr) / 4);
+    slot->snr_low = snr < slot->snr_low ? snr : (slot->snr_low < slot->snr ? slot->snr_low + 1 : slot->snr);
+  } else {
+    slot->snr = slot->snr_low = snr;
+    slot->no_rate_until = 0;
+  }
+#endif
+  slot->last_heard = _ms->getMillis();
+  if (slot->last_heard == 0) slot->last_heard = 1;
+  return slot;
+}
+#endif
+
+#ifdef WITH_LINK_RATE
+Mesh::HeardNeighbour* Mesh::findNeighbour(const uint8_t* hash) {
+  for (int i = 0; i < MAX_HEARD_NEIGHBOURS; i++) {
+    HeardNeighbour& h = _heard_neighbours[i];
+    if (h.last_heard != 0 && _ms->getMillis() - h.last_heard < HEARD_NEIGHBOUR_MAX_AGE_MILLIS
+        && memcmp(h.hash, hash, PATH_HASH_SIZE) == 0) {
+      return &h;
+    }
+  }
+  return NULL;
+}
+#endif
+
+void Mesh::onRadioFloodRecv(Packet* pkt) {
+#ifdef WITH_HEARD_NEIGHBOURS
+  trackNeighbour(pkt);
+#endif
+
+#ifdef WITH_FLOOD_SUPPRESSION
+  uint8_t threshold = getFloodSuppressThreshold();
+  if (threshold == 0 || pkt->getSNR() < getFloodSuppressMinSNR()) return;
+
+  int i;
+  for (i = 0; i < MAX_PENDING_FLOODS && _pending_floods[i].packet == NULL; i++) ;
+  if (i == MAX_PENDING_FLOODS) return;   // nothing waiting, skip the hash
+
+  uint8_t hash[MAX_HASH_SIZE];
+  pkt->calculatePacketHash(hash);
+  for (i = 0; i < MAX_PENDING_FLOODS; i++) {
+    PendingFlood& p = _pending_floods[i];
+    if (p.packet == NULL || memcmp(p.hash, hash, MAX_HASH_SIZE) != 0) continue;
+
+    if (++p.heard < threshold) return;
+
+    // still queued? (it may have been sent already, and its Packet reused for something else)
+    int n = _mgr->getOutboundCount(0xFFFFFFFF);
+    for (int j = 0; j < n; j++) {
+      Packet* queued = _mgr->getOutboundByIdx(j);
+      if (queued != p.packet) continue;
+
+      uint8_t queued_hash[MAX_HASH_SIZE];
+      queued->calculatePacketHash(queued_hash);
+      if (memcmp(queued_hash, p.hash, MAX_HASH_SIZE) == 0) {
+        MESH_DEBUG_PRINTLN("%s Mesh::onRadioFloodRecv(): retransmit cancelled after %d dups", getLogDateTime(), (uint32_t)p.heard);
+        releasePacket(_mgr->removeOutboundByIdx(j));
+        _n_flood_suppressed++;
+      }
+      break;
+    }
+    p.packet = NULL;
+    return;
+  }
+#endif
+}
+
+#ifdef WITH_LINK_RATE
+static bool isLinkRateCtl(const Packet* packet) {
+  uint8_t type = packet->payload[0] & 0xF0;
+  return packet->getPayloadType() == PAYLOAD_TYPE_CONTROL && packet->path_len == 0
+      && (type == CTL_TYPE_LINK_RATE_REQ || type == CTL_TYPE_LINK_RATE_ACK);
+}
+
+bool Mesh::isLinkRateActive() const {
+  return _link_rate.state == LINK_RATE_ACTIVE;
+}
+
+uint8_t Mesh::pickLinkRateSF(int8_t snr) const {
+  uint8_t min_sf = getLinkRateMinSF();
+  if (min_sf == 0) return 0;
+
+  for (uint8_t sf = min_sf; sf < getLinkRateBaseSF(); sf++) {
+    float floor = -2.5f*(sf - 4);   // demodulation floor, -7.5 dB at SF7, 2.5 dB lower per SF (Semtech datasheets)
+    if (snr / 4.0f >= floor + LINK_RATE_SNR_MARGIN) return sf;
+  }
+  return 0;   // not enough margin for any faster SF
+}
+
+bool Mesh::isForLinkPeer(const Packet* packet, const uint8_t* hop) const {
+  return packet->isRouteDirect() && packet->path_len >= PATH_HASH_SIZE && packet->getPayloadType() != PAYLOAD_TYPE_TRACE
+      && memcmp(packet->path, hop, PATH_HASH_SIZE) == 0;
+}
+
+uint32_t Mesh::getTxSlotWait(const Packet* packet, uint32_t airtime_millis) {
+  if (_link_rate.state == LINK_RATE_IDLE) {
+    if (getLinkRateMinSF() > 0 && isForLinkPeer(packet, packet->path) && askLinkRate(packet)) {
+      return _link_rate.until - _ms->getMillis();   // held back until the ACK is in (or given up on)
+    }
+    return 0;
+  }
+  if (isLinkRateCtl(packet)) return 0;   // the handshake itself
+
+  long left = (long)(_link_rate.until - _ms->getMillis());
+  if (_link_rate.state == LINK_RATE_ACTIVE && isForLinkPeer(packet, _link_rate.peer)
+      && (long)(getLinkRateAirtime(packet->getRawLength(), _link_rate.sf) + LINK_RATE_GUARD_MILLIS) <= left) {
+    return 0;   // fits in what is left of the session, so goes at the faster SF
+  }
+  return left > 0 ? left : 1;   // everything else waits for the radio to be back on the shared SF
+}
+
+bool Mesh::askLinkRate(const Packet* packet) {
+  HeardNeighbour* n = findNeighbour(packet->path);
+  if (n == NULL || (n->no_rate_until != 0 && !millisHasNowPassed(n->no_rate_until))) return false;
+
+  uint8_t base_sf = getLinkRateBaseSF();
+  uint8_t sf = pickLinkRateSF(n->snr_low);
+  if (sf == 0) return false;
+
+  // the burst: this packet, and any others queued for the same hop
+  int len = packet->getRawLength();
+  uint32_t first_air = getLinkRateAirtime(len, sf);
+  uint32_t base_air = getLinkRateAirtime(len, base_sf), fast_air = first_air;
+  int num = 1;
+  int q = _mgr->getOutboundCount(0xFFFFFFFF);
+  for (int j = 0; j < q; j++) {
+    const Packet* queued = _mgr->getOutboundByIdx(j);
+    if (isForLinkPeer(queued, packet->path)) {
+      len = queued->getRawLength();
+      base_air += getLinkRateAirtime(len, base_sf);
+      fast_air += getLinkRateAirtime(len, sf);
+      num++;
+    }
+  }
+  uint32_t ctl_air = getLinkRateAirtime(2 + LINK_RATE_REQ_LEN, base_sf) + getLinkRateAirtime(2 + LINK_RATE_ACK_LEN, base_sf);
+  if (base_air <= fast_air + ctl_air + 2*LINK_RATE_GUARD_MILLIS) return false;   // not worth the handshake
+
+  // with room for the airtime budget's silence after each one
+  uint32_t hold = (uint32_t)(fast_air*(1.0f + getEffectiveBudgetFactor())) + num*LINK_RATE_GUARD_MILLIS;
+  if (hold > LINK_RATE_MAX_HOLD_MILLIS) hold = LINK_RATE_MAX_HOLD_MILLIS;
+  if (first_air + LINK_RATE_GUARD_MILLIS > hold) return false;
+
+  uint8_t data[LINK_RATE_REQ_LEN];
+  data[0] = CTL_TYPE_LINK_RATE_REQ;
+  memcpy(&data[1], packet->path, PATH_HASH_SIZE);
+  self_id.copyHashTo(&data[2]);
+  data[3] = sf;
+  uint16_t h = hold;
+  memcpy(&data[4], &h, 2);
+  Packet* req = createControlData(data, sizeof(data));
+  if (req == NULL) return false;
+  sendZeroHop(req);
+
+  _link_rate.state = LINK_RATE_ASKED;
+  memcpy(_link_rate.peer, packet->path, PATH_HASH_SIZE);
+  _link_rate.sf = sf;
+  _link_rate.hold_millis = hold;
+  _link_rate.ack = NULL;
+  _link_rate.until = futureMillis(ctl_air + LINK_RATE_ACK_SLACK_MILLIS);
+  MESH_DEBUG_PRINTLN("%s Mesh::askLinkRate(): SF%d for %d packets, hold=%d", getLogDateTime(), (uint32_t)sf, num, hold);
+  return true;
+}
+
+void Mesh::recvLinkRateReq(Packet* pkt) {
+  if (pkt->payload_len < LINK_RATE_REQ_LEN || !self_id.isHashMatch(&pkt->payload[1])) return;
+
+  HeardNeighbour* n = trackNeighbour(&pkt->payload[2], pkt->_snr);
+  if (getLinkRateMinSF() == 0) return;   // off: stay quiet (like older firmware), the asker times out
+
+  uint16_t hold;
+  memcpy(&hold, &pkt->payload[4], 2);
+  // the burst comes this way, so what we hear the asker at has the say: no faster than asked, slower if need be
+  uint8_t sf = pickLinkRateSF(n->snr_low);
+  if (sf != 0 && sf < pkt->payload[3]) sf = pkt->payload[3];
+  if (_link_rate.state != LINK_RATE_IDLE || hold > LINK_RATE_MAX_HOLD_MILLIS || pkt->payload[3] < getLinkRateMinSF()
+      || pkt->payload[3] >= getLinkRateBaseSF()) {
+    sf = 0;
+  }
+
+  uint8_t data[LINK_RATE_ACK_LEN];
+  data[0] = CTL_TYPE_LINK_RATE_ACK;
+  memcpy(&data[1], &pkt->payload[2], PATH_HASH_SIZE);
+  self_id.copyHashTo(&data[2]);
+  data[3] = sf;
+  Packet* ack = createControlData(data, sizeof(data));
+  if (ack == NULL) return;
+  sendZeroHop(ack);
+  if (sf == 0) return;
+
+  _link_rate.state = LINK_RATE_ACKING;   // switch once the ACK has gone, see onRadioSendDone()
+  memcpy(_link_rate.peer, &pkt->payload[2], PATH_HASH_SIZE);
+  _link_rate.sf = sf;
+  _link_rate.hold_millis = hold;
+  _link_rate.ack = ack;
+}
+
+void Mesh::recvLinkRateAck(Packet* pkt) {
+  if (pkt->payload_len < LINK_RATE_ACK_LEN || !self_id.isHashMatch(&pkt->payload[1])) return;
+
+  HeardNeighbour* n = trackNeighbour(&pkt->payload[2], pkt->_snr);
+  if (_link_rate.state != LINK_RATE_ASKED || memcmp(_link_rate.peer, &pkt->payload[2], PATH_HASH_SIZE) != 0) return;
+
+  uint8_t sf = pkt->payload[3];
+  if (sf < getLinkRateMinSF() || sf >= getLinkRateBaseSF()) {   // refused
+    n->no_rate_until = futureMillis(LINK_RATE_BACKOFF_MILLIS);
+    _link_rate.state = LINK_RATE_IDLE;   // what was held back goes on the shared SF
+    return;
+  }
+  uint8_t base_sf = getLinkRateBaseSF();
+  _link_rate_air_saved -= getLinkRateAirtime(2 + LINK_RATE_REQ_LEN, base_sf) + getLinkRateAirtime(2 + LINK_RATE_ACK_LEN, base_sf);
+  _link_rate.sf = sf;
+  startLinkRate();
+}
+
+void Mesh::startLinkRate() {
+  setLinkRateSF(_link_rate.sf);
+  _radio->resetAGC();   // restarts receive, now on the faster SF
+  _link_rate.state = LINK_RATE_ACTIVE;
+  _link_rate.ack = NULL;
+  _link_rate.until = futureMillis(_link_rate.hold_millis);
+  _n_link_rate_sessions++;
+
+  // what was held back for the peer can go now, rather than when the handshake would have timed out
+  int n = _mgr->getOutboundCount(0xFFFFFFFF);
+  for (int j = n - 1; j >= 0; j--) {
+    if (isForLinkPeer(_mgr->getOutboundByIdx(j), _link_rate.peer)) {
+      uint8_t pri = _mgr->getOutboundPriorityByIdx(j);
+      _mgr->queueOutbound(_mgr->removeOutboundByIdx(j), pri, _ms->getMillis());
+    }
+  }
+}
+
+void Mesh::endLinkRate() {
+  if (_link_rate.state == LINK_RATE_ACTIVE) {
+    setLinkRateSF(0);
+    _radio->resetAGC();
+  } else if (_link_rate.state == LINK_RATE_ASKED) {   // no ACK: older firmware, switched off, or it didn't hear us
+    HeardNeighbour* n = findNeighbour(_link_rate.peer);
+    if (n) n->no_rate_until = futureMillis(LINK_RATE_BACKOFF_MILLIS);
+  }
+  _link_rate.state = LINK_RATE_IDLE;
+  _link_rate.ack = NULL;
+}
+
+void Mesh::onRadioSendFail(const Packet* packet) {
+  if (_link_rate.state == LINK_RATE_ACKING && packet == _link_rate.ack) {
+    endLinkRate();   // the peer never heard it, so stays on the shared SF
+  }
+}
+
+void Mesh::onRadioSendDone(const Packet* packet) {
+  if (_link_rate.state == LINK_RATE_ACKING && packet == _link_rate.ack) {
+    startLinkRate();
+  } else if (_link_rate.state == LINK_RATE_ACTIVE && isForLinkPeer(packet, _link_rate.peer)) {
+    int len = packet->getRawLength();
+    _link_rate_air_saved += getLinkRateAirtime(len, getLinkRateBaseSF()) - getLinkRateAirtime(len, _link_rate.sf);
+  }
+}
+#endif
+
 DispatcherAction Mesh::forwardMultipartDirect(Packet* pkt) {
   uint8_t remaining = pkt->payload[0] >> 4;  // num of packets in this multipart sequence still to be sent
   uint8_t type = pkt->payload[0] & 0x0F;
@@ -352,6 +978,12 @@ DispatcherAction Mesh::forwardMultipartDirect(Packet* pkt) {
       removeSelfFromPath(&tmp);
       routeDirectRecvAcks(&tmp, ((uint32_t)remaining + 1) * 300);  // expect multipart ACKs 300ms apart (x2)
     }
+  } else if (type == MULTIPART_TYPE_FRAGMENT || type == MULTIPART_TYPE_FRAGMENT_NACK) {
+    if (!_tables->hasSeen(pkt)) {
+      removeSelfFromPath(pkt);
+      // no random delay: the sender already spaces fragments for the relays along the route (see getFragmentInterval())
+      return ACTION_RETRANSMIT_DELAYED(0, 0);
+    }
   }
   return ACTION_RELEASE;
 }
@@ -361,6 +993,13 @@ void Mesh::routeDirectRecvAcks(Packet* packet, uint32_t delay_millis) {
     uint32_t crc;
     memcpy(&crc, packet->payload, 4);
 
+#ifdef WITH_ACK_BATCHING
+    if (getAckBatchWindow() > 0) {
+      queueBatchedAck(crc, packet->path, packet->path_len, delay_millis + getDirectRetransmitDelay(packet));
+      return;
+    }
+#endif
+
     uint8_t extra = getExtraAckTransmitCount();
     while (extra > 0) {
       delay_millis += getDirectRetransmitDelay(packet) + 300;
@@ -384,6 +1023,114 @@ void Mesh::routeDirectRecvAcks(Packet* packet, uint32_t delay_millis) {
   }
 }
 
+void Mesh::sendDirectAck(uint32_t ack_crc, const uint8_t* path, uint8_t path_len, uint32_t delay_millis) {
+#ifdef WITH_ACK_BATCHING
+  if (getAckBatchWindow() > 0) {
+    queueBatchedAck(ack_crc, path, path_len, delay_millis);
+    return;
+  }
+#endif
+  sendAckCopies(ack_crc, path, path_len, delay_millis);
+}
+
+void Mesh::sendAckCopies(uint32_t ack_crc, const uint8_t* path, uint8_t path_len, uint32_t delay_millis) {
+  if (getExtraAckTransmitCount() > 0) {
+    Packet* a1 = createMultiAck(ack_crc, 1);
+    if (a1) sendDirect(a1, path, path_len, delay_millis);
+    delay_millis += 300;
+  }
+  Packet* a2 = createAck(ack_crc);
+  if (a2) sendDirect(a2, path, path_len, delay_millis);
+}
+
+#ifdef WITH_ACK_BATCHING
+void Mesh::queueBatchedAck(uint32_t ack_crc, const uint8_t* path, uint8_t path_len, uint32_t delay_millis) {
+  for (int i = 0; i < _num_batched_acks; i++) {
+    if (_batched_acks[i].crc == ack_crc && _batched_acks[i].path_len == path_len
+        && memcmp(_batched_acks[i].path, path, path_len) == 0) return;   // already going
+  }
+  if (_num_batched_acks >= MAX_BATCHED_ACKS || 1 + _batched_ack_bytes + 5 + path_len > MAX_PACKET_PAYLOAD) {
+    sendAckBatch();   // full, this one starts the next
+  }
+  if (_num_batched_acks == 0) {
+    // the first ACK in sets the deadline, ones joining later don't push it back
+    _ack_batch_due = futureMillis(delay_millis + getAckBatchWindow());
+  }
+  BatchedAck& a = _batched_acks[_num_batched_acks++];
+  a.crc = ack_crc;
+  memcpy(a.path, path, a.path_len = path_len);
+  _batched_ack_bytes += 5 + path_len;
+}
+
+void Mesh::sendAckBatch() {
+  if (_num_batched_acks == 1) {   // nothing to share with: a plain ACK is smaller, and any node can read it
+    _num_batched_acks = 0;
+    _batched_ack_bytes = 0;
+    sendAckCopies(_batched_acks[0].crc, _batched_acks[0].path, _batched_acks[0].path_len, 0);
+    return;
+  }
+
+  // frame: type, then per ACK: crc (4), path_len, path (rest of the direct route, from the next hop on)
+  uint8_t payload[MAX_PACKET_PAYLOAD];
+  int len = 0;
+  payload[len++] = MULTIPART_TYPE_ACK_BATCH;
+  for (int i = 0; i < _num_batched_acks; i++) {
+    const BatchedAck& a = _batched_acks[i];
+    memcpy(&payload[len], &a.crc, 4); len += 4;
+    payload[len++] = a.path_len;
+    memcpy(&payload[len], a.path, a.path_len); len += a.path_len;
+  }
+  _n_acks_batched += _num_batched_acks;
+  _n_ack_batches++;
+  _num_batched_acks = 0;
+  _batched_ack_bytes = 0;
+
+  // extra copies go out the same as the first, a receiver that got that one ignores them as 'seen'
+  uint32_t d = 0;
+  for (int n = 0; n <= getExtraAckTransmitCount(); n++) {
+    Packet* packet = obtainNewPacket();
+    if (packet == NULL) {
+      MESH_DEBUG_PRINTLN("%s Mesh::sendAckBatch(): error, packet pool empty", getLogDateTime());
+      return;
+    }
+    packet->header = (PAYLOAD_TYPE_MULTIPART << PH_TYPE_SHIFT);  // ROUTE_TYPE_* set later
+    memcpy(packet->payload, payload, packet->payload_len = len);
+    sendZeroHop(packet, d);
+    d += 300;
+  }
+}
+#endif
+
+void Mesh::recvAckBatch(Packet* pkt) {
+  int i = 1;
+  while (i + 5 <= pkt->payload_len) {
+    Packet tmp;   // each as a plain direct ACK, which it stands in for
+    tmp.header = (PAYLOAD_TYPE_ACK << PH_TYPE_SHIFT) | ROUTE_TYPE_DIRECT;
+    memcpy(tmp.payload, &pkt->payload[i], 4); i += 4;
+    tmp.payload_len = 4;
+    tmp.path_len = pkt->payload[i++];
+    if (tmp.path_len > MAX_PATH_SIZE || i + tmp.path_len > pkt->payload_len) {
+      MESH_DEBUG_PRINTLN("%s Mesh::recvAckBatch(): malformed", getLogDateTime());
+      break;
+    }
+    memcpy(tmp.path, &pkt->payload[i], tmp.path_len); i += tmp.path_len;
+    tmp._snr = pkt->_snr;
+
+    if (tmp.path_len == 0) {   // last hop: for whoever is waiting on it
+      if (!_tables->hasSeen(&tmp)) {
+        uint32_t ack_crc;
+        memcpy(&ack_crc, tmp.payload, 4);
+        onAckRecv(&tmp, ack_crc);
+      }
+    } else if (self_id.isHashMatch(tmp.path) && allowPacketForward(&tmp)) {
+      if (!_tables->hasSeen(&tmp)) {
+        removeSelfFromPath(&tmp);
+        routeDirectRecvAcks(&tmp, 0);   // into our own next batch
+      }
+    }
+  }
+}
+
 Packet* Mesh::createAdvert(const LocalIdentity& id, const uint8_t* app_data, size_t app_data_len) {
   if (app_data_len > MAX_ADVERT_DATA_SIZE) return NULL;
 
@@ -1,6 +1,82 @@
 #pragma once
 
 #include <Dispatcher.h>
+#ifdef WITH_FRAGMENTS
+  #include <FragmentPool.h>
+#endif
+
+// Optional features. Each keeps its own tables in Mesh, so is only built in where defined (eg. -D WITH_...
+// in the platformio env). Without it, its hooks below are never called and its counters read 0.
+//   WITH_FLOOD_SUPPRESSION   cancel queued flood rebroadcasts once enough duplicates are overheard
+//   WITH_ROUTE_COLLECT       return a better path than the first flood copy's (and BaseChatMesh keeps spares)
+//   WITH_FRAGMENTS           send and reassemble payloads too big for one packet (relaying their fragments needs none)
+//   WITH_ACK_BATCHING        hold direct ACKs to share one frame (reading such frames is always built in)
+//   WITH_HEARD_NEIGHBOURS    keep the last hops heard on air, for getNumNeighboursHeard()
+//   WITH_LINK_RATE           agree a faster SF with a strong neighbour for a burst of direct packets
+
+#if defined(WITH_LINK_RATE) && !defined(WITH_HEARD_NEIGHBOURS)
+  #define WITH_HEARD_NEIGHBOURS   // link rate picks its SF from what it hears each neighbour at
+#endif
+
+#ifndef MAX_PENDING_FLOODS
+  #define MAX_PENDING_FLOODS  8
+#endif
+
+#ifndef MAX_ROUTE_CANDIDATES
+  #define MAX_ROUTE_CANDIDATES  4
+#endif
+
+#ifndef MAX_BATCHED_ACKS
+  #define MAX_BATCHED_ACKS  8
+#endif
+
+#ifndef ACK_BATCH_WINDOW_MILLIS
+  #define ACK_BATCH_WINDOW_MILLIS  0   // off, see getAckBatchWindow()
+#endif
+
+#if ACK_BATCH_WINDOW_MILLIS > 0 && !defined(WITH_ACK_BATCHING)
+  #error "ACK_BATCH_WINDOW_MILLIS needs -D WITH_ACK_BATCHING"
+#endif
+
+#ifndef MAX_HEARD_NEIGHBOURS
+  #define MAX_HEARD_NEIGHBOURS  16
+#endif
+
+#ifndef HEARD_NEIGHBOUR_MAX_AGE_MILLIS
+  #define HEARD_NEIGHBOUR_MAX_AGE_MILLIS  (10*60*1000UL)
+#endif
+
+#ifndef RETRANSMIT_SNR_FAR
+  #define RETRANSMIT_SNR_FAR    -10.0f   // dB, copies this weak (or weaker) take the earliest slots
+#endif
+
+#ifndef RETRANSMIT_SNR_NEAR
+  #define RETRANSMIT_SNR_NEAR    10.0f   // dB, .. and this strong, the latest
+#endif
+
+#ifndef LINK_RATE_SNR_MARGIN
+  #define LINK_RATE_SNR_MARGIN  10.0f   // dB a link must hold above an SF's demodulation floor, to be run at it
+#endif
+
+#ifndef LINK_RATE_MAX_HOLD_MILLIS
+  #define LINK_RATE_MAX_HOLD_MILLIS  4000   // longest the two ends of a link stay off the shared SF
+#endif
+
+#ifndef LINK_RATE_GUARD_MILLIS
+  #define LINK_RATE_GUARD_MILLIS  30   // radio re-config and turnaround, per switch and per packet
+#endif
+
+#ifndef LINK_RATE_ACK_SLACK_MILLIS
+  #define LINK_RATE_ACK_SLACK_MILLIS  300   // on top of the handshake's own airtime, before giving up on the ACK
+#endif
+
+#ifndef LINK_RATE_BACKOFF_MILLIS
+  #define LINK_RATE_BACKOFF_MILLIS  (60*1000UL)   // after a refused or unanswered handshake, stay on the shared SF
+#endif
+
+#ifndef ROUTE_SNR_MARGIN
+  #define ROUTE_SNR_MARGIN  6   // dB a same-length route's last hop must beat the first by
+#endif
 
 namespace mesh {
 
@@ -28,6 +104,110 @@ class Mesh : public Dispatcher {
   RNG* _rng;
   MeshTables* _tables;
 
+#ifdef WITH_FLOOD_SUPPRESSION
+  struct PendingFlood {   // a flood retransmission waiting in the outbound queue
+    Packet* packet;
+    uint8_t hash[MAX_HASH_SIZE];
+    uint8_t heard;        // duplicates overheard since it was queued
+  };
+  PendingFlood _pending_floods[MAX_PENDING_FLOODS];
+  int _next_pending_flood;
+  uint32_t _n_flood_suppressed;
+
+  void trackPendingFlood(Packet* packet);
+#endif
+
+#ifdef WITH_HEARD_NEIGHBOURS
+  struct HeardNeighbour {   // a node heard first-hand on air, ie. the last hop of a flood
+    uint8_t hash[PATH_HASH_SIZE];
+    unsigned long last_heard;   // 0 = free slot
+  #ifdef WITH_LINK_RATE
+    int8_t snr;                 // x4, running average of what we hear them at
+    int8_t snr_low;             // x4, recent worst, drifts back up to 'snr'
+    unsigned long no_rate_until;   // link rate handshake refused/unanswered, don't ask again until then
+  #endif
+  };
+  HeardNeighbour _heard_neighbours[MAX_HEARD_NEIGHBOURS];
+
+  void trackNeighbour(const Packet* pkt);
+  HeardNeighbour* trackNeighbour(const uint8_t* hash, int8_t snr);
+#endif
+
+#ifdef WITH_LINK_RATE
+  HeardNeighbour* findNeighbour(const uint8_t* hash);
+
+  struct LinkRateSession {   // this node and one neighbour, off the shared SF for a burst of direct packets
+    uint8_t state;
+    uint8_t peer[PATH_HASH_SIZE];
+    uint8_t sf;
+    uint16_t hold_millis;
+    const Packet* ack;        // (responder) our ACK, switch once it has gone
+    unsigned long until;      // deadline of the current state
+  };
+  LinkRateSession _link_rate;
+  uint32_t _n_link_rate_sessions;
+  int32_t _link_rate_air_saved;   // net of the handshakes
+
+  uint8_t pickLinkRateSF(int8_t snr) const;
+  bool isForLinkPeer(const Packet* packet, const uint8_t* hop) const;
+  bool askLinkRate(const Packet* packet);
+  void recvLinkRateReq(Packet* pkt);
+  void recvLinkRateAck(Packet* pkt);
+  void startLinkRate();
+  void endLinkRate();
+#endif
+
+#ifdef WITH_ROUTE_COLLECT
+  struct RouteCandidate {   // a flood datagram from a peer, whose later copies may have come a better way
+    uint8_t hash[MAX_HASH_SIZE];
+    uint8_t src_hash[PATH_HASH_SIZE];
+    uint8_t secret[PUB_KEY_SIZE];
+    unsigned long expires;  // 0 = free slot
+    bool better;            // 'path' beats the one already returned
+    int8_t snr;             // last hop SNR*4, of 'path'
+    uint8_t path_len;
+    uint8_t path[MAX_PATH_SIZE];
+  };
+  RouteCandidate _route_candidates[MAX_ROUTE_CANDIDATES];
+  uint32_t _n_alt_paths_sent;
+
+  void trackRouteCandidate(const Packet* packet, const uint8_t* src_hash, const uint8_t* secret);
+  void updateRouteCandidate(const Packet* packet);
+  void sendBetterRoutes();
+#endif
+
+#ifdef WITH_FRAGMENTS
+  FragmentPool* _fragments;     // NULL = payloads bigger than one packet not supported
+  uint16_t _next_fragment_id;
+  unsigned long _next_fragment_send;
+  int8_t _fragment_path_len;    // -1 = flood
+  uint8_t _fragment_path[MAX_PATH_SIZE];
+
+  bool beginFragmented(uint8_t type, const uint8_t* dest_hash, size_t len, const uint8_t* path, int path_len);
+  void sendPendingFragments();
+  void checkStalledFragments();
+  void recvFragment(Packet* pkt);
+  void recvReassembled(Packet* pkt, const FragmentPool::Incoming* in);
+#endif
+
+#ifdef WITH_ACK_BATCHING
+  struct BatchedAck {   // a direct ACK waiting to share one MULTIPART frame with others
+    uint32_t crc;
+    uint8_t path_len;
+    uint8_t path[MAX_PATH_SIZE];
+  };
+  BatchedAck _batched_acks[MAX_BATCHED_ACKS];
+  int _num_batched_acks;
+  int _batched_ack_bytes;   // payload the frame would need
+  unsigned long _ack_batch_due;
+  uint32_t _n_acks_batched, _n_ack_batches;
+
+  void queueBatchedAck(uint32_t ack_crc, const uint8_t* path, uint8_t path_len, uint32_t delay_millis);
+  void sendAckBatch();
+#endif
+  void sendAckCopies(uint32_t ack_crc, const uint8_t* path, uint8_t path_len, uint32_t delay_millis);
+  void recvAckBatch(Packet* pkt);
+
   void removeSelfFromPath(Packet* packet);
   void routeDirectRecvAcks(Packet* packet, uint32_t delay_millis);
   //void routeRecvAcks(Packet* packet, uint32_t delay_millis);
@@ -35,6 +215,12 @@ class Mesh : public Dispatcher {
 
 protected:
   DispatcherAction onRecvPacket(Packet* pkt) override;
+  void onRadioFloodRecv(Packet* pkt) override;
+#ifdef WITH_LINK_RATE
+  void onRadioSendDone(const Packet* packet) override;
+  void onRadioSendFail(const Packet* packet) override;
+  uint32_t getTxSlotWait(const Packet* packet, uint32_t airtime_millis) override;
+#endif
 
   virtual uint32_t getCADFailRetryDelay() const override;
 
@@ -60,6 +246,59 @@ protected:
    */
   virtual uint32_t getRetransmitDelay(const Packet* packet);
 
+  /**
+   * \returns  max slots for an adaptive flood retransmit contention window. When > 0, the window grows with
+   *     getEstNeighbours() and the LBT busy rate, and weaker (ie. farther) copies take the earlier slots.
+   *     0 = fixed window (default).
+   */
+  virtual uint8_t getRetransmitMaxSlots() const { return 0; }
+
+  /**
+   * \returns  how many neighbours may be relaying the same floods. Default: getNumNeighboursHeard(), which
+   *     needs WITH_HEARD_NEIGHBOURS (else 0, ie. the narrowest window).
+   */
+  virtual int getEstNeighbours() const { return getNumNeighboursHeard(); }
+
+  /**
+   * \brief  pick a slot of the adaptive contention window (see getRetransmitMaxSlots())
+   * \returns  the delay, in milliseconds
+   */
+  uint32_t calcContentionDelay(const Packet* packet, uint32_t slot_millis);
+
+  /**
+   * \returns  number of duplicate overhears that cancel a flood retransmission still waiting in the
+   *     outbound queue (counter-based suppression: enough neighbours have already covered the area).
+   *     0 = never cancel (default). Needs WITH_FLOOD_SUPPRESSION.
+   */
+  virtual uint8_t getFloodSuppressThreshold() const { return 0; }
+
+  /**
+   * \returns  weakest SNR (dB) at which an overheard duplicate counts towards getFloodSuppressThreshold().
+   *     A strong copy came from close by, so little extra area is left for ours to reach.
+   */
+  virtual float getFloodSuppressMinSNR() const { return -128.0f; }
+
+  /**
+   * \returns  milliseconds to keep comparing later flood copies of a datagram from a peer against the first.
+   *     When the window closes, if one came over fewer hops (or the same hops with a clearly stronger last hop),
+   *     that path is also returned to the sender, so it has a better direct route than 'first packet wins'.
+   *     0 = first path only (default). Needs WITH_ROUTE_COLLECT.
+   */
+  virtual uint32_t getRouteCollectWindow() const { return 0; }
+
+#ifdef WITH_FRAGMENTS
+  /**
+   * \returns  milliseconds between the fragments of one payload. Default gives the relays of a direct route time
+   *     to pass each one on before the next arrives, as they can't listen while transmitting.
+   */
+  virtual uint32_t getFragmentInterval(uint32_t airtime_millis, int path_len) const;
+
+  /**
+   * \returns  milliseconds a receiver waits after the last fragment heard, before NACKing the missing ones.
+   */
+  virtual uint32_t getFragmentTimeout() const;
+#endif
+
   /**
    * \returns  number of milliseconds delay to apply to retransmitting the given packet, for DIRECT mode.
    */
@@ -70,6 +309,36 @@ protected:
    */
   virtual uint8_t getExtraAckTransmitCount() const;
 
+  /**
+   * \returns  milliseconds to hold a direct ACK (sent, or passed on) so others due meanwhile share one zero-hop
+   *     MULTIPART frame with it, each with the rest of its own path. One preamble/header instead of several.
+   *     0 = off (default): only nodes with this firmware can read those frames, so all on the route need it.
+   *     Needs WITH_ACK_BATCHING.
+   */
+  virtual uint32_t getAckBatchWindow() const;
+
+  /**
+   * \returns  lowest spreading factor this node may switch to with a strong neighbour, for a burst of direct packets
+   *     to it. Agreed per burst with a zero-hop CONTROL handshake on the shared SF, and both ends go back to it on a
+   *     timer whatever happens. 0 = off (default): neither asks, nor accepts. Needs WITH_LINK_RATE.
+   */
+  virtual uint8_t getLinkRateMinSF() const { return 0; }
+
+  /**
+   * \returns  the spreading factor all neighbours listen on, ie. this node's configured one
+   */
+  virtual uint8_t getLinkRateBaseSF() const { return 0; }
+
+  /**
+   * \brief  re-configure the radio to 'sf' for a link rate session, or back to getLinkRateBaseSF() when 'sf' is 0
+   */
+  virtual void setLinkRateSF(uint8_t sf) { }
+
+  /**
+   * \returns  airtime (millis) of a 'len' byte packet at spreading factor 'sf', the other radio params as configured
+   */
+  virtual uint32_t getLinkRateAirtime(int len, uint8_t sf) const { return 0; }
+
   /**
    * \brief  Perform search of local DB of peers/contacts.
    * \returns  Number of peers with matching hash
@@ -168,6 +437,34 @@ protected:
   Mesh(Radio& radio, MillisecondClock& ms, RNG& rng, RTCClock& rtc, PacketManager& mgr, MeshTables& tables)
     : Dispatcher(radio, ms, mgr), _rng(&rng), _rtc(&rtc), _tables(&tables)
   {
+  #ifdef WITH_FLOOD_SUPPRESSION
+    memset(_pending_floods, 0, sizeof(_pending_floods));
+    _next_pending_flood = 0;
+    _n_flood_suppressed = 0;
+  #endif
+  #ifdef WITH_HEARD_NEIGHBOURS
+    memset(_heard_neighbours, 0, sizeof(_heard_neighbours));
+  #endif
+  #ifdef WITH_LINK_RATE
+    memset(&_link_rate, 0, sizeof(_link_rate));
+    _n_link_rate_sessions = _link_rate_air_saved = 0;
+  #endif
+  #ifdef WITH_ROUTE_COLLECT
+    memset(_route_candidates, 0, sizeof(_route_candidates));
+    _n_alt_paths_sent = 0;
+  #endif
+  #ifdef WITH_FRAGMENTS
+    _fragments = NULL;
+    _next_fragment_id = 0;
+    _next_fragment_send = 0;
+    _fragment_path_len = -1;
+  #endif
+  #ifdef WITH_ACK_BATCHING
+    _num_batched_acks = 0;
+    _batched_ack_bytes = 0;
+    _ack_batch_due = 0;
+    _n_acks_batched = _n_ack_batches = 0;
+  #endif
   }
 
   MeshTables* getTables() const { return _tables; }
@@ -180,6 +477,44 @@ public:
 
   RNG* getRNG() const { return _rng; }
   RTCClock* getRTCClock() const { return _rtc; }
+#ifdef WITH_FLOOD_SUPPRESSION
+  uint32_t getNumFloodSuppressed() const { return _n_flood_suppressed; }
+#else
+  uint32_t getNumFloodSuppressed() const { return 0; }
+#endif
+#ifdef WITH_HEARD_NEIGHBOURS
+  int getNumNeighboursHeard() const;
+#else
+  int getNumNeighboursHeard() const { return 0; }
+#endif
+  int getContentionSlots() const;
+#ifdef WITH_ROUTE_COLLECT
+  uint32_t getNumAltPathsSent() const { return _n_alt_paths_sent; }
+#else
+  uint32_t getNumAltPathsSent() const { return 0; }
+#endif
+#ifdef WITH_ACK_BATCHING
+  uint32_t getNumAcksBatched() const { return _n_acks_batched; }
+  uint32_t getNumAckBatches() const { return _n_ack_batches; }
+#else
+  uint32_t getNumAcksBatched() const { return 0; }
+  uint32_t getNumAckBatches() const { return 0; }
+#endif
+#ifdef WITH_LINK_RATE
+  uint32_t getNumLinkRateSessions() const { return _n_link_rate_sessions; }
+  int32_t getLinkRateAirtimeSaved() const { return _link_rate_air_saved; }   // millis, estimate
+  bool isLinkRateActive() const;
+#else
+  uint32_t getNumLinkRateSessions() const { return 0; }
+  int32_t getLinkRateAirtimeSaved() const { return 0; }
+  bool isLinkRateActive() const { return false; }
+#endif
+
+#ifdef WITH_FRAGMENTS
+  void setFragmentPool(FragmentPool* pool) { _fragments = pool; }
+  FragmentPool* getFragmentPool() const { return _fragments; }
+  bool isSendingFragments() const { return _fragments != NULL && _fragments->isHeld(_ms->getMillis()); }   // incl. NACK window
+#endif
 
   Packet* createAdvert(const LocalIdentity& id, const uint8_t* app_data=NULL, size_t app_data_len=0);
   Packet* createDatagram(uint8_t type, const Identity& dest, const uint8_t* secret, const uint8_t* data, size_t len);
@@ -193,6 +528,22 @@ public:
   Packet* createTrace(uint32_t tag, uint32_t auth_code, uint8_t flags = 0);
   Packet* createControlData(const uint8_t* data, size_t len);
 
+#ifdef WITH_FRAGMENTS
+  /**
+   * \brief  send a group datagram too big for one Packet (up to MAX_FRAGMENTED_PAYLOAD), flooded as numbered
+   *     MULTIPART fragments, one at a time. Receivers NACK the ones they miss. Needs setFragmentPool().
+   * \returns  false if too big, or the previous one is still being sent
+  */
+  bool sendGroupFragmented(uint8_t type, const GroupChannel& channel, const uint8_t* data, size_t data_len);
+
+  /**
+   * \brief  as sendGroupFragmented(), but a datagram (one of: PAYLOAD_TYPE_TXT_MSG, _REQ, _RESPONSE) to a peer
+   * \param  path   direct route to 'dest', or NULL to flood
+  */
+  bool sendDatagramFragmented(uint8_t type, const Identity& dest, const uint8_t* secret, const uint8_t* data, size_t data_len,
+                              const uint8_t* path=NULL, uint8_t path_len=0);
+#endif
+
   /**
    * \brief  send a locally-generated Packet with flood routing
   */
@@ -204,6 +555,12 @@ public:
   */
   void sendFlood(Packet* packet, uint16_t* transport_codes, uint32_t delay_millis=0);
 
+  /**
+   * \brief  send an ACK along a Direct route, with getExtraAckTransmitCount() extra copies. Batched with others
+   *     when getAckBatchWindow() is on.
+  */
+  void sendDirectAck(uint32_t ack_crc, const uint8_t* path, uint8_t path_len, uint32_t delay_millis=0);
+
   /**
    * \brief  send a locally-generated Packet with Direct routing
   */
@@ -31,6 +31,15 @@ namespace mesh {
 //...
 #define PAYLOAD_TYPE_RAW_CUSTOM   0x0F    // custom packet as raw bytes, for applications with custom encryption, payloads, etc
 
+// PAYLOAD_TYPE_MULTIPART sub-types (lower 4 bits of payload[0]), besides the payload types above (eg. multi-ACK)
+#define MULTIPART_TYPE_FRAGMENT       0x0C    // one piece of a payload too big for a single packet (see FragmentPool)
+#define MULTIPART_TYPE_FRAGMENT_NACK  0x0D    // the pieces a receiver is still missing
+#define MULTIPART_TYPE_ACK_BATCH      0x0E    // zero-hop: several ACK CRCs, each with the rest of its direct path
+
+// zero-hop PAYLOAD_TYPE_CONTROL types (upper 4 bits of payload[0]) handled by Mesh itself. 0x80/0x90 = node discovery
+#define CTL_TYPE_LINK_RATE_REQ   0xA0    // ask a neighbour to switch to a faster SF with us, for a burst of direct packets
+#define CTL_TYPE_LINK_RATE_ACK   0xB0    // .. the SF it agreed to (0 = refused)
+
 #define PAYLOAD_VER_1       0x00   // 1-byte src/dest hashes, 2-byte MAC
 #define PAYLOAD_VER_2       0x01   // FUTURE (eg. 2-byte hashes, 4-byte MAC ??)
 #define PAYLOAD_VER_3       0x02   // FUTURE
@@ -43,15 +43,7 @@ void BaseChatMesh::sendAckTo(const ContactInfo& dest, uint32_t ack_hash) {
     mesh::Packet* ack = createAck(ack_hash);
     if (ack) sendFloodScoped(dest, ack, TXT_ACK_DELAY);
   } else {
-    uint32_t d = TXT_ACK_DELAY;
-    if (getExtraAckTransmitCount() > 0) {
-      mesh::Packet* a1 = createMultiAck(ack_hash, 1);
-      if (a1) sendDirect(a1, dest.out_path, dest.out_path_len, d);
-      d += 300;
-    }
-
-    mesh::Packet* a2 = createAck(ack_hash);
-    if (a2) sendDirect(a2, dest.out_path, dest.out_path_len, d);
+    sendDirectAck(ack_hash, dest.out_path, dest.out_path_len, TXT_ACK_DELAY);
   }
 }
 
@@ -106,6 +98,9 @@ void BaseChatMesh::onAdvertRecv(mesh::Packet* packet, const mesh::Identity& id,
 
     is_new = true;
     if (num_contacts < MAX_CONTACTS) {
+    #ifdef WITH_ROUTE_COLLECT
+      path_learned[num_contacts] = 0;
+    #endif
       from = &contacts[num_contacts++];
       from->id = id;
       from->out_path_len = -1;  // initially out_path is unknown
@@ -163,6 +158,13 @@ void BaseChatMesh::onPeerDataRecv(mesh::Packet* packet, uint8_t type, int sender
 
   ContactInfo& from = contacts[i];
 
+#ifdef WITH_TEXT_COMPRESSION
+  if (type == PAYLOAD_TYPE_TXT_MSG && len > 5 && (data[4] >> 2) == (TXT_FLAG_COMPRESSED | TXT_TYPE_PLAIN)) {
+    data = expandText(data, len);   // then on as a plain text, ACK hash included
+    if (data == NULL) return;
+  }
+#endif
+
   if (type == PAYLOAD_TYPE_TXT_MSG && len > 5) {
     uint32_t timestamp;
     memcpy(&timestamp, data, 4);  // timestamp (by sender's RTC clock - which could be wrong)
@@ -259,10 +261,27 @@ bool BaseChatMesh::onPeerPathRecv(mesh::Packet* packet, int sender_idx, const ui
 }
 
 bool BaseChatMesh::onContactPathRecv(ContactInfo& from, uint8_t* in_path, uint8_t in_path_len, uint8_t* out_path, uint8_t out_path_len, uint8_t extra_type, uint8_t* extra, uint8_t extra_len) {
+  uint32_t now = getRTCClock()->getCurrentTime();
+#ifdef WITH_ROUTE_COLLECT
+  // NOTE: default impl, paths are ranked by hops. The shortest becomes 'out_path', the others are kept as
+  //       spares for resetPathTo() to fail over to, before falling back to flood. A current path that hasn't
+  //       been learned or confirmed for ALT_PATH_MAX_AGE_SECS is no better than a guess, so a fresh one replaces it.
+  uint32_t* learned = pathLearnedFor(from);
+  bool stale = learned == NULL || *learned == 0 || now > *learned + ALT_PATH_MAX_AGE_SECS;
+  if (from.out_path_len < 0 || out_path_len <= from.out_path_len || stale) {
+    if (from.out_path_len >= 0 && !stale && !(from.out_path_len == out_path_len && memcmp(from.out_path, out_path, out_path_len) == 0)) {
+      addAltPath(from, from.out_path, from.out_path_len);   // demote current
+    }
+    memcpy(from.out_path, out_path, from.out_path_len = out_path_len);  // store a copy of path, for sendDirect()
+    if (learned) *learned = now;
+  } else {
+    addAltPath(from, out_path, out_path_len);
+  }
+#else
   // NOTE: default impl, we just replace the current 'out_path' regardless, whenever sender sends us a new out_path.
-  // FUTURE: could store multiple out_paths per contact, and try to find which is the 'best'(?)
   memcpy(from.out_path, out_path, from.out_path_len = out_path_len);  // store a copy of path, for sendDirect()
-  from.lastmod = getRTCClock()->getCurrentTime();
+#endif
+  from.lastmod = now;
 
   onContactPathUpdated(from);
 
@@ -286,6 +305,11 @@ void BaseChatMesh::onAckRecv(mesh::Packet* packet, uint32_t ack_crc) {
     if (packet->isRouteFlood() && from->out_path_len >= 0) {
       // we have direct path, but other node is still sending flood, so maybe they didn't receive reciprocal path properly(?)
       handleReturnPathRetry(*from, packet->path, packet->path_len);
+#ifdef WITH_ROUTE_COLLECT
+    } else if (packet->isRouteDirect()) {
+      uint32_t* learned = pathLearnedFor(*from);
+      if (learned) *learned = getRTCClock()->getCurrentTime();   // out_path still works
+#endif
     }
   }
 }
@@ -310,6 +334,12 @@ int BaseChatMesh::searchChannelsByHash(const uint8_t* hash, mesh::GroupChannel d
 #endif
 
 void BaseChatMesh::onGroupDataRecv(mesh::Packet* packet, uint8_t type, const mesh::GroupChannel& channel, uint8_t* data, size_t len) {
+#ifdef WITH_TEXT_COMPRESSION
+  if (type == PAYLOAD_TYPE_GRP_TXT && len > 5 && (data[4] >> 2) == TXT_FLAG_COMPRESSED) {
+    data = expandText(data, len);
+    if (data == NULL) return;
+  }
+#endif
   uint8_t txt_type = data[4];
   if (type == PAYLOAD_TYPE_GRP_TXT && len > 5 && (txt_type >> 2) == 0) {  // 0 = plain text msg
     uint32_t timestamp;
@@ -323,6 +353,44 @@ void BaseChatMesh::onGroupDataRecv(mesh::Packet* packet, uint8_t type, const mes
   }
 }
 
+#ifdef WITH_TEXT_COMPRESSION
+uint8_t* BaseChatMesh::expandText(const uint8_t* data, size_t& len) {
+  int n = TxtCompressor::expand(&data[5], len - 5, (char *) &txt_expand_buf[5], MAX_EXPANDED_TEXT_LEN + 1);
+  if (n < 0) {
+    MESH_DEBUG_PRINTLN("expandText: malformed, or longer than MAX_EXPANDED_TEXT_LEN");
+    return NULL;
+  }
+  memcpy(txt_expand_buf, data, 5);   // timestamp, flags
+  txt_expand_buf[4] &= ~(TXT_FLAG_COMPRESSED << 2);
+  len = 5 + n;
+  return txt_expand_buf;
+}
+#endif
+
+int BaseChatMesh::packText(uint8_t* dest, const char* prefix, const char* text, int text_len) {
+#ifdef WITH_TEXT_COMPRESSION
+  int prefix_len = strlen(prefix);
+  if (!allowTextCompression() || prefix_len + text_len > MAX_EXPANDED_TEXT_LEN) return 0;
+
+  int n = TxtCompressor::compress(prefix, prefix_len, dest, MAX_TEXT_LEN);
+  int m = n < 0 ? -1 : TxtCompressor::compress(text, text_len, &dest[n], MAX_TEXT_LEN - n);
+  if (m < 0 || n + m >= prefix_len + text_len) return 0;   // still too long, or no smaller
+  return n + m;
+#else
+  return 0;   // this build couldn't read them back either
+#endif
+}
+
+void BaseChatMesh::countPackedText(int raw_len, int packed_len) {
+  txt_raw_bytes += raw_len;
+  txt_packed_bytes += packed_len;
+
+  // on air: header, path len, hash(es), MAC, then timestamp/flags + text padded to the cipher block
+  int raw_air = 2 + PATH_HASH_SIZE + CIPHER_MAC_SIZE + ((5 + raw_len + CIPHER_BLOCK_SIZE-1) / CIPHER_BLOCK_SIZE) * CIPHER_BLOCK_SIZE;
+  int packed_air = 2 + PATH_HASH_SIZE + CIPHER_MAC_SIZE + ((5 + packed_len + CIPHER_BLOCK_SIZE-1) / CIPHER_BLOCK_SIZE) * CIPHER_BLOCK_SIZE;
+  txt_air_saved += _radio->getEstAirtimeFor(raw_air) - _radio->getEstAirtimeFor(packed_air);
+}
+
 mesh::Packet* BaseChatMesh::composeMsgPacket(const ContactInfo& recipient, uint32_t timestamp, uint8_t attempt, const char *text, uint32_t& expected_ack) {
   int text_len = strlen(text);
   if (text_len > MAX_TEXT_LEN) return NULL;
@@ -337,6 +405,16 @@ mesh::Packet* BaseChatMesh::composeMsgPacket(const ContactInfo& recipient, uint3
   mesh::Utils::sha256((uint8_t *)&expected_ack, 4, temp, 5 + text_len, self_id.pub_key, PUB_KEY_SIZE);
 
   int len = 5 + text_len;
+  if (allowTextCompression()) {
+    uint8_t packed[MAX_TEXT_LEN];
+    int packed_len = packText(packed, "", text, text_len);
+    if (packed_len > 0) {
+      temp[4] |= (TXT_FLAG_COMPRESSED << 2);   // NOTE: expected_ack is still over the plain text
+      memcpy(&temp[5], packed, packed_len);
+      len = 5 + packed_len;
+    }
+    countPackedText(text_len, len - 5);
+  }
   if (attempt > 3) {
     temp[len++] = 0;  // null terminator
     temp[len++] = attempt;  // hide attempt number at tail end of payload
@@ -399,11 +477,22 @@ bool BaseChatMesh::sendGroupMessage(uint32_t timestamp, mesh::GroupChannel& chan
   char *ep = strchr((char *) &temp[5], 0);
   int prefix_len = ep - (char *) &temp[5];
 
-  if (text_len + prefix_len > MAX_TEXT_LEN) text_len = MAX_TEXT_LEN - prefix_len;
-  memcpy(ep, text, text_len);
-  ep[text_len] = 0;  // null terminator
+  int len;
+  uint8_t packed[MAX_TEXT_LEN];
+  int packed_len = packText(packed, (char *) &temp[5], text, text_len);   // may fit a text too long as is
+  if (packed_len > 0) {
+    temp[4] = TXT_FLAG_COMPRESSED << 2;
+    memcpy(&temp[5], packed, packed_len);
+    len = 5 + packed_len;
+  } else {
+    if (text_len + prefix_len > MAX_TEXT_LEN) text_len = MAX_TEXT_LEN - prefix_len;
+    memcpy(ep, text, text_len);
+    ep[text_len] = 0;  // null terminator
+    len = 5 + prefix_len + text_len;
+  }
+  if (allowTextCompression()) countPackedText(prefix_len + text_len, len - 5);
 
-  auto pkt = createGroupDatagram(PAYLOAD_TYPE_GRP_TXT, channel, temp, 5 + prefix_len + text_len);
+  auto pkt = createGroupDatagram(PAYLOAD_TYPE_GRP_TXT, channel, temp, len);
   if (pkt) {
     sendFloodScoped(channel, pkt);
     return true;
@@ -650,10 +739,111 @@ void BaseChatMesh::checkConnections() {
   }
 }
 
-void BaseChatMesh::resetPathTo(ContactInfo& recipient) {
+bool BaseChatMesh::resetPathTo(ContactInfo& recipient) {
+#ifdef WITH_ROUTE_COLLECT
+  // fail over to the best spare route, and only go back to flood once those are used up
+  AltPathInfo* alt = findBestAltPath(recipient);
+  if (alt) {
+    memcpy(recipient.out_path, alt->path, recipient.out_path_len = alt->path_len);
+    uint32_t* learned = pathLearnedFor(recipient);
+    if (learned) *learned = alt->learned;
+    alt->path_len = -1;
+    return true;
+  }
+#endif
+  recipient.out_path_len = -1;
+  return false;
+}
+
+void BaseChatMesh::resetPathToFlood(ContactInfo& recipient) {
+#ifdef WITH_ROUTE_COLLECT
+  clearAltPaths(recipient);
+#endif
   recipient.out_path_len = -1;
 }
 
+#ifdef WITH_ROUTE_COLLECT
+uint32_t* BaseChatMesh::pathLearnedFor(const ContactInfo& contact) {
+  if (&contact < contacts || &contact >= &contacts[num_contacts]) return NULL;   // a copy, not one of ours
+  return &path_learned[&contact - contacts];
+}
+
+void BaseChatMesh::addAltPath(const ContactInfo& contact, const uint8_t* path, uint8_t path_len) {
+  uint32_t now = getRTCClock()->getCurrentTime();
+  AltPathInfo* slot = NULL;
+  AltPathInfo* oldest = NULL;
+  AltPathInfo* worst = NULL;   // of this contact's: longest, then oldest
+  int n = 0;
+  for (int i = 0; i < MAX_ALT_PATHS; i++) {
+    AltPathInfo* a = &alt_paths[i];
+    if (a->path_len < 0 || now > a->learned + ALT_PATH_MAX_AGE_SECS) {
+      a->path_len = -1;
+      if (slot == NULL) slot = a;
+      continue;
+    }
+    if (memcmp(a->pub_key, contact.id.pub_key, sizeof(a->pub_key)) == 0) {
+      if (a->path_len == path_len && memcmp(a->path, path, path_len) == 0) {
+        a->learned = now;   // already have it
+        return;
+      }
+      n++;
+      if (worst == NULL || a->path_len > worst->path_len
+          || (a->path_len == worst->path_len && a->learned < worst->learned)) {
+        worst = a;
+      }
+    }
+    if (oldest == NULL || a->learned < oldest->learned) oldest = a;
+  }
+  if (n >= MAX_ALT_PATHS_PER_CONTACT) {
+    if (path_len > worst->path_len) return;   // all this contact's spares are shorter
+    slot = worst;
+  } else if (slot == NULL) {
+    slot = oldest;
+  }
+  memcpy(slot->pub_key, contact.id.pub_key, sizeof(slot->pub_key));
+  memcpy(slot->path, path, slot->path_len = path_len);
+  slot->learned = now;
+}
+
+AltPathInfo* BaseChatMesh::findBestAltPath(const ContactInfo& contact) {
+  uint32_t now = getRTCClock()->getCurrentTime();
+  AltPathInfo* best = NULL;
+  for (int i = 0; i < MAX_ALT_PATHS; i++) {
+    AltPathInfo* a = &alt_paths[i];
+    if (a->path_len < 0 || memcmp(a->pub_key, contact.id.pub_key, sizeof(a->pub_key)) != 0) continue;
+    if (now > a->learned + ALT_PATH_MAX_AGE_SECS) {
+      a->path_len = -1;   // too old to trust
+      continue;
+    }
+    if (best == NULL || a->path_len < best->path_len
+        || (a->path_len == best->path_len && a->learned > best->learned)) {
+      best = a;
+    }
+  }
+  return best;
+}
+
+void BaseChatMesh::clearAltPaths(const ContactInfo& contact) {
+  for (int i = 0; i < MAX_ALT_PATHS; i++) {
+    if (memcmp(alt_paths[i].pub_key, contact.id.pub_key, sizeof(alt_paths[i].pub_key)) == 0) {
+      alt_paths[i].path_len = -1;
+    }
+  }
+}
+
+int BaseChatMesh::getNumAltPaths(const ContactInfo& contact) const {
+  int n = 0;
+  for (int i = 0; i < MAX_ALT_PATHS; i++) {
+    if (alt_paths[i].path_len >= 0 && memcmp(alt_paths[i].pub_key, contact.id.pub_key, sizeof(alt_paths[i].pub_key)) == 0) n++;
+  }
+  return n;
+}
+#else
+int BaseChatMesh::getNumAltPaths(const ContactInfo& contact) const {
+  return 0;   // no spares kept
+}
+#endif
+
 static ContactInfo* table;  // pass via global :-(
 
 static int cmp_adv_timestamp(const void *a, const void *b) {
@@ -700,6 +890,9 @@ ContactInfo* BaseChatMesh::lookupContactByPubKey(const uint8_t* pub_key, int pre
 
 bool BaseChatMesh::addContact(const ContactInfo& contact) {
   if (num_contacts < MAX_CONTACTS) {
+  #ifdef WITH_ROUTE_COLLECT
+    path_learned[num_contacts] = 0;   // age of a stored out_path isn't known
+  #endif
     auto dest = &contacts[num_contacts++];
     *dest = contact;
 
@@ -718,10 +911,17 @@ bool BaseChatMesh::removeContact(ContactInfo& contact) {
   }
   if (idx >= num_contacts) return false;   // not found
 
+#ifdef WITH_ROUTE_COLLECT
+  clearAltPaths(contacts[idx]);
+#endif
+
   // remove from contacts array
   num_contacts--;
   while (idx < num_contacts) {
     contacts[idx] = contacts[idx + 1];
+  #ifdef WITH_ROUTE_COLLECT
+    path_learned[idx] = path_learned[idx + 1];
+  #endif
     idx++;
   }
   return true;  // Success
@@ -41,6 +41,36 @@ public:
   #define MAX_CONNECTIONS  16
 #endif
 
+// spare direct routes learned from duplicate floods, kept only with -D WITH_ROUTE_COLLECT (see Mesh.h)
+#ifndef MAX_ALT_PATHS
+  #define MAX_ALT_PATHS  8   // spare direct routes, shared by all contacts
+#endif
+
+#ifndef MAX_ALT_PATHS_PER_CONTACT
+  #define MAX_ALT_PATHS_PER_CONTACT  2
+#endif
+
+#ifndef ALT_PATH_MAX_AGE_SECS
+  #define ALT_PATH_MAX_AGE_SECS  (60*60)
+#endif
+
+#ifndef MAX_EXPANDED_TEXT_LEN
+  #define MAX_EXPANDED_TEXT_LEN  (3*MAX_TEXT_LEN)   // a compressed text can unpack past MAX_TEXT_LEN
+#endif
+
+#ifndef ALT_PATH_COLLECT_MILLIS
+  #define ALT_PATH_COLLECT_MILLIS  5000
+#endif
+
+#ifdef WITH_ROUTE_COLLECT
+struct AltPathInfo {   // a spare direct route to a contact, ranked behind its 'out_path'
+  uint8_t pub_key[8];   // prefix
+  int8_t path_len;      // -1 = unused
+  uint8_t path[MAX_PATH_SIZE];
+  uint32_t learned;     // by OUR clock
+};
+#endif
+
 struct ConnectionInfo {
   mesh::Identity server_id;
   unsigned long next_ping;
@@ -70,9 +100,26 @@ class BaseChatMesh : public mesh::Mesh {
   mesh::Packet* _pendingLoopback;
   uint8_t temp_buf[MAX_TRANS_UNIT];
   ConnectionInfo connections[MAX_CONNECTIONS];
+#ifdef WITH_ROUTE_COLLECT
+  AltPathInfo alt_paths[MAX_ALT_PATHS];
+  uint32_t path_learned[MAX_CONTACTS];   // when each contact's out_path was learned or last confirmed, by OUR clock. 0 = unknown
+#endif
+#ifdef WITH_TEXT_COMPRESSION
+  uint8_t txt_expand_buf[5 + MAX_EXPANDED_TEXT_LEN + 1];
+#endif
+  uint32_t txt_raw_bytes, txt_packed_bytes, txt_air_saved;
 
   mesh::Packet* composeMsgPacket(const ContactInfo& recipient, uint32_t timestamp, uint8_t attempt, const char *text, uint32_t& expected_ack);
   void sendAckTo(const ContactInfo& dest, uint32_t ack_hash);
+#ifdef WITH_ROUTE_COLLECT
+  void addAltPath(const ContactInfo& contact, const uint8_t* path, uint8_t path_len);
+  AltPathInfo* findBestAltPath(const ContactInfo& contact);
+  uint32_t* pathLearnedFor(const ContactInfo& contact);
+  void clearAltPaths(const ContactInfo& contact);
+#endif
+#ifdef WITH_TEXT_COMPRESSION
+  uint8_t* expandText(const uint8_t* data, size_t& len);
+#endif
 
 protected:
   BaseChatMesh(mesh::Radio& radio, mesh::MillisecondClock& ms, mesh::RNG& rng, mesh::RTCClock& rtc, mesh::PacketManager& mgr, mesh::MeshTables& tables)
@@ -86,12 +133,26 @@ protected:
     txt_send_timeout = 0;
     _pendingLoopback = NULL;
     memset(connections, 0, sizeof(connections));
+  #ifdef WITH_ROUTE_COLLECT
+    for (int i = 0; i < MAX_ALT_PATHS; i++) {
+      alt_paths[i].path_len = -1;
+    }
+    memset(path_learned, 0, sizeof(path_learned));
+  #endif
+    txt_raw_bytes = txt_packed_bytes = txt_air_saved = 0;
   }
 
   void resetContacts() { num_contacts = 0; }
 
   // 'UI' concepts, for sub-classes to implement
   virtual bool isAutoAddEnabled() const { return true; }
+
+  /**
+   * \returns  true to send plain texts TxtCompressor packed (flagged TXT_FLAG_COMPRESSED), when that makes them
+   *      smaller. Only nodes that know the flag can read them, so leave off unless the whole channel/contact does.
+   *      Needs -D WITH_TEXT_COMPRESSION, which also lets this node read packed texts (without it they are dropped).
+   */
+  virtual bool allowTextCompression() const { return false; }
   virtual void onDiscoveredContact(ContactInfo& contact, bool is_new, uint8_t path_len, const uint8_t* path) = 0;
   virtual ContactInfo* processAck(const uint8_t *data) = 0;
   virtual void onContactPathUpdated(const ContactInfo& contact) = 0;
@@ -116,6 +177,9 @@ protected:
 
   // Mesh overrides
   void onAdvertRecv(mesh::Packet* packet, const mesh::Identity& id, uint32_t timestamp, const uint8_t* app_data, size_t app_data_len) override;
+#ifdef WITH_ROUTE_COLLECT
+  uint32_t getRouteCollectWindow() const override { return ALT_PATH_COLLECT_MILLIS; }
+#endif
   int searchPeersByHash(const uint8_t* hash) override;
   void getPeerSharedSecret(uint8_t* dest_secret, int peer_idx) override;
   void onPeerDataRecv(mesh::Packet* packet, uint8_t type, int sender_idx, const uint8_t* secret, uint8_t* data, size_t len) override;
@@ -146,7 +210,14 @@ public:
   bool shareContactZeroHop(const ContactInfo& contact);
   uint8_t exportContact(const ContactInfo& contact, uint8_t dest_buf[]);
   bool importContact(const uint8_t src_buf[], uint8_t len);
-  void resetPathTo(ContactInfo& recipient);
+  bool resetPathTo(ContactInfo& recipient);
+  void resetPathToFlood(ContactInfo& recipient);   // drops the spares too
+  int  getNumAltPaths(const ContactInfo& contact) const;
+  int  packText(uint8_t* dest, const char* prefix, const char* text, int text_len);   // 0 = send as is
+  void countPackedText(int raw_len, int packed_len);
+  uint32_t getTextRawBytes() const { return txt_raw_bytes; }         // of texts sent while compression allowed
+  uint32_t getTextPackedBytes() const { return txt_packed_bytes; }   //   .. and what went on air for them
+  uint32_t getTextAirtimeSaved() const { return txt_air_saved; }     // millis, estimate
   void scanRecentContacts(int last_n, ContactVisitor* visitor);
   ContactInfo* searchContactsByPrefix(const char* name_prefix);
   ContactInfo* lookupContactByPubKey(const uint8_t* pub_key, int prefix_len);
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <stdint.h>
+
+#ifndef LORA_PREAMBLE_LEN
+  #define LORA_PREAMBLE_LEN  16    // what the Custom* radios begin() with
+#endif
+
+/**
+ * \brief  LoRa time-on-air, exactly as the Semtech SX126x datasheet (6.1.4) / AN1200.13 give it:
+ *
+ *     Tsym = 2^SF / BW
+ *     Npayload = 8 + ceil(max(8*PL + 16*CRC - 4*SF + 8 + 20*(explicit header), 0) / (4*(SF - 2*LDRO))) * (4 + CR)
+ *     Tpacket = (Npreamble + 4.25 + Npayload) * Tsym
+ *
+ *   SF5/SF6 (SX126x only) have 6.25 preamble symbols extra, and no '+ 8' bits. Low data rate optimisation
+ *   is on when a symbol lasts 16 ms or more, as RadioLib does it. All integer maths, and constexpr, so a
+ *   table for a fixed radio config (see LoRaAirtimeTable) costs nothing at run-time.
+ *
+ *   'cr' is the denominator of the coding rate (5..8 for 4/5..4/8), the same as RadioLib's begin() takes it.
+ */
+class LoRaAirtime {
+  static constexpr uint32_t ceilDiv(int32_t a, int32_t b) { return a <= 0 ? 0 : (uint32_t)((a + b - 1) / b); }
+
+public:
+  /**
+   * \returns  divisor of 500 kHz for the given bandwidth, ie. 62.5 -> 8. All the SX126x/SX127x bandwidths
+   *     are one (7.8, 10.4, 15.6, 20.8, 31.25, 41.7, 62.5, 125, 250, 500 kHz).
+   */
+  static constexpr uint8_t bwDivisor(float bw_khz) {
+    return bw_khz < 9.0f ? 64 : bw_khz < 13.0f ? 48 : bw_khz < 18.0f ? 32 : bw_khz < 26.0f ? 24 : bw_khz < 36.0f ? 16
+         : bw_khz < 52.0f ? 12 : bw_khz < 90.0f ? 8 : bw_khz < 180.0f ? 4 : bw_khz < 360.0f ? 2 : 1;
+  }
+
+  static constexpr uint32_t symbolNanos(uint8_t sf, uint8_t bw_div) { return ((uint32_t)1 << sf) * bw_div * 2000; }
+
+  static constexpr bool isLowDataRate(uint8_t sf, uint8_t bw_div) { return symbolNanos(sf, bw_div) >= 16000000; }
+
+  static constexpr uint32_t payloadSymbols(int len, uint8_t sf, uint8_t cr, bool crc, bool implicit_header, bool ldro) {
+    return sf < 7 ? 8 + ceilDiv(8*len + (crc ? 16 : 0) - 4*sf + (implicit_header ? 0 : 20), 4*sf) * cr
+                  : 8 + ceilDiv(8*len + (crc ? 16 : 0) - 4*sf + 8 + (implicit_header ? 0 : 20), 4*(sf - (ldro ? 2 : 0))) * cr;
+  }
+
+  /**
+   * \returns  whole packet in quarter symbols (the preamble ends on a quarter)
+   */
+  static constexpr uint32_t packetQuarterSymbols(int len, uint8_t sf, uint8_t bw_div, uint8_t cr, uint16_t preamble,
+                                                 bool crc, bool implicit_header) {
+    return 4*(uint32_t)preamble + (sf < 7 ? 25 : 17)
+         + 4*payloadSymbols(len, sf, cr, crc, implicit_header, isLowDataRate(sf, bw_div));
+  }
+
+  static constexpr uint32_t micros(int len, uint8_t sf, uint8_t bw_div, uint8_t cr, uint16_t preamble=16,
+                                   bool crc=true, bool implicit_header=false) {
+    return (uint32_t)(((uint64_t)packetQuarterSymbols(len, sf, bw_div, cr, preamble, crc, implicit_header)
+                        * symbolNanos(sf, bw_div) + 3999) / 4000);
+  }
+
+  static constexpr uint32_t millis(int len, uint8_t sf, uint8_t bw_div, uint8_t cr, uint16_t preamble=16,
+                                   bool crc=true, bool implicit_header=false) {
+    return (micros(len, sf, bw_div, cr, preamble, crc, implicit_header) + 999) / 1000;   // round up
+  }
+};
+
+template<int... I> struct LoRaAirtimeIndices { };
+template<int N, int... I> struct LoRaAirtimeMakeIndices : LoRaAirtimeMakeIndices<N - 1, N - 1, I...> { };
+template<int... I> struct LoRaAirtimeMakeIndices<0, I...> { typedef LoRaAirtimeIndices<I...> type; };
+
+/**
+ * \brief  millis[len] = time-on-air (rounded up) of a 0..MAX_LEN byte packet, built at compile time.
+ *     Explicit header, CRC on, as MeshCore runs its radios.
+ */
+template<uint8_t SF, uint8_t BW_DIV, uint8_t CR, uint16_t PREAMBLE, int MAX_LEN,
+         typename Seq = typename LoRaAirtimeMakeIndices<MAX_LEN + 1>::type>
+struct LoRaAirtimeTable;
+
+template<uint8_t SF, uint8_t BW_DIV, uint8_t CR, uint16_t PREAMBLE, int MAX_LEN, int... I>
+struct LoRaAirtimeTable<SF, BW_DIV, CR, PREAMBLE, MAX_LEN, LoRaAirtimeIndices<I...>> {
+  static constexpr uint32_t millis[sizeof...(I)] = { LoRaAirtime::millis(I, SF, BW_DIV, CR, PREAMBLE)... };
+};
+
+template<uint8_t SF, uint8_t BW_DIV, uint8_t CR, uint16_t PREAMBLE, int MAX_LEN, int... I>
+constexpr uint32_t LoRaAirtimeTable<SF, BW_DIV, CR, PREAMBLE, MAX_LEN, LoRaAirtimeIndices<I...>>::millis[sizeof...(I)];
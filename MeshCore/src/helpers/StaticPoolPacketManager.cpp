@@ -17,7 +17,7 @@ int PacketQueue::countBefore(uint32_t now) const {
   return n;
 }
 
-mesh::Packet* PacketQueue::get(uint32_t now) {
+int PacketQueue::nextIdx(uint32_t now) const {
   uint8_t min_pri = 0xFF;
   int best_idx = -1;
   for (int j = 0; j < _num; j++) {
@@ -27,6 +27,16 @@ mesh::Packet* PacketQueue::get(uint32_t now) {
       best_idx = j;
     }
   }
+  return best_idx;
+}
+
+uint8_t PacketQueue::peekPriority(uint32_t now) const {
+  int i = nextIdx(now);
+  return i < 0 ? 0xFF : _pri_table[i];
+}
+
+mesh::Packet* PacketQueue::get(uint32_t now) {
+  int best_idx = nextIdx(now);
   if (best_idx < 0) return NULL;   // empty, or all items are still in the future
 
   mesh::Packet* top = _table[best_idx];
@@ -90,6 +100,10 @@ mesh::Packet* StaticPoolPacketManager::getNextOutbound(uint32_t now) {
   return send_queue.get(now);
 }
 
+uint8_t StaticPoolPacketManager::getNextOutboundPriority(uint32_t now) const {
+  return send_queue.peekPriority(now);
+}
+
 int  StaticPoolPacketManager::getOutboundCount(uint32_t now) const {
   return send_queue.countBefore(now);
 }
@@ -101,6 +115,9 @@ int StaticPoolPacketManager::getFreeCount() const {
 mesh::Packet* StaticPoolPacketManager::getOutboundByIdx(int i) {
   return send_queue.itemAt(i);
 }
+uint8_t StaticPoolPacketManager::getOutboundPriorityByIdx(int i) const {
+  return send_queue.priorityAt(i);
+}
 mesh::Packet* StaticPoolPacketManager::removeOutboundByIdx(int i) {
   return send_queue.removeByIdx(i);
 }
@@ -8,13 +8,17 @@ class PacketQueue {
   uint32_t* _schedule_table;
   int _size, _num;
 
+  int nextIdx(uint32_t now) const;
+
 public:
   PacketQueue(int max_entries);
   mesh::Packet* get(uint32_t now);
+  uint8_t peekPriority(uint32_t now) const;   // of what get() would return, 0xFF = none
   void add(mesh::Packet* packet, uint8_t priority, uint32_t scheduled_for);
   int count() const { return _num; }
   int countBefore(uint32_t now) const;
   mesh::Packet* itemAt(int i) const { return _table[i]; }
+  uint8_t priorityAt(int i) const { return _pri_table[i]; }
   mesh::Packet* removeByIdx(int i);
 };
 
@@ -28,9 +32,11 @@ public:
   void free(mesh::Packet* packet) override;
   void queueOutbound(mesh::Packet* packet, uint8_t priority, uint32_t scheduled_for) override;
   mesh::Packet* getNextOutbound(uint32_t now) override;
+  uint8_t getNextOutboundPriority(uint32_t now) const override;
   int getOutboundCount(uint32_t now) const override;
   int getFreeCount() const override;
   mesh::Packet* getOutboundByIdx(int i) override;
+  uint8_t getOutboundPriorityByIdx(int i) const override;
   mesh::Packet* removeOutboundByIdx(int i) override;
   void queueInbound(mesh::Packet* packet, uint32_t scheduled_for) override;
   mesh::Packet* getNextInbound(uint32_t now) override;
@@ -23,14 +23,16 @@ public:
                               mesh::Radio* radio,
                               RadioDriverType& driver,
                               uint32_t total_air_time_ms,
-                              uint32_t total_rx_air_time_ms) {
+                              uint32_t total_rx_air_time_ms,
+                              float channel_util) {
     sprintf(reply, 
-      "{\"noise_floor\":%d,\"last_rssi\":%d,\"last_snr\":%.2f,\"tx_air_secs\":%u,\"rx_air_secs\":%u}",
+      "{\"noise_floor\":%d,\"last_rssi\":%d,\"last_snr\":%.2f,\"tx_air_secs\":%u,\"rx_air_secs\":%u,\"chan_util_pct\":%u}",
       (int16_t)radio->getNoiseFloor(),
       (int16_t)driver.getLastRSSI(),
       driver.getLastSNR(),
       total_air_time_ms / 1000,
-      total_rx_air_time_ms / 1000
+      total_rx_air_time_ms / 1000,
+      (uint32_t)(channel_util * 100.0f + 0.5f)
     );
   }
 
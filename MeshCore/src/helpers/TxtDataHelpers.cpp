@@ -1,4 +1,5 @@
 #include "TxtDataHelpers.h"
+#include <string.h>
 
 void StrHelper::strncpy(char* dest, const char* src, size_t buf_sz) {
   while (buf_sz > 1 && *src) {
@@ -172,3 +173,105 @@ uint32_t StrHelper::fromHex(const char* src) {
   }
   return n;
 }
+
+// shared by every node: never re-order or remove, only append (up to 96)
+static const char* const txt_dict[] = {
+  // lighthouse help protocol
+  "HELP|MAIL|", "HELP|ANNOUNCE|", "HELP|AUDIO|", "HELP|REQ|", "HELP|ACK|", "HELP|CANCEL|", "HELP|CLAIM|",
+  "HELP|RESOLVE|", "HELP|DETAILS|", "HELP|PING|", "HELP|PONG|", "HELP|TIME|", "HELP|GW|", "HELP|HELLO|",
+  "HELP|", "Lighthouse-", "|ALL|", "LH0", "LH1", "LH2", "LH3", "REQ|", "ACK|", "MAIL|", "ANNOUNCE|",
+  "RED", "ORANGE", "YELLOW", "GREEN", "BLUE", "VIOLET", "|UP", "|DOWN",
+  // bot URLs
+  "http://192.168.", "http://10.", "http://", "https://", "/audio/", ".wav", ".mp3", ":8080/", ":8081/", "/mesh",
+  // common words
+  " the ", " and ", " to ", " you", " is ", " in ", " for ", " of ", " on ", " at ", " we ", " it ", " be ",
+  "ing ", "ing", "tion", "the ", "The ", "ed ", "er ", "es ", "re ", "ly ", "st", "th", "ou",
+  "help", "Help", "need", "please", "Please", "here", "there", "thank", "Thank", "with ", "this ", "that ",
+  "can ", "not ", "are ", "have ", "what", "when", "where", "room", "table", "team", "hack", "now", "ok ", "OK"
+};
+#define TXT_DICT_SIZE  (sizeof(txt_dict) / sizeof(txt_dict[0]))
+
+#define TXT_CODE_DICT  0x80
+#define TXT_CODE_HEX   0xE0
+#define TXT_CODE_ESC   0xFF
+#define TXT_HEX_MIN    4
+#define TXT_HEX_MAX    (TXT_HEX_MIN + TXT_CODE_ESC - 1 - TXT_CODE_HEX)
+
+static_assert(TXT_DICT_SIZE <= TXT_CODE_HEX - TXT_CODE_DICT, "txt_dict has outgrown its codes");
+
+static int hexVal(char c) {
+  if (c >= '0' && c <= '9') return c - '0';
+  if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+  return -1;
+}
+
+int TxtCompressor::compress(const char* src, int src_len, uint8_t* dest, int dest_max) {
+  int i = 0, n = 0;
+  while (i < src_len) {
+    // longest dictionary word here, vs. a run of hex digits: take whichever saves more
+    int best = -1, best_len = 0;
+    for (int d = 0; d < (int)TXT_DICT_SIZE; d++) {
+      int len = strlen(txt_dict[d]);
+      if (len > best_len && len <= src_len - i && memcmp(&src[i], txt_dict[d], len) == 0) {
+        best = d;
+        best_len = len;
+      }
+    }
+    int run = 0;
+    while (run < TXT_HEX_MAX && i + run < src_len && hexVal(src[i + run]) >= 0) run++;
+
+    if (run >= TXT_HEX_MIN && run - 1 - (run + 1)/2 > best_len - 1) {
+      if (n + 1 + (run + 1)/2 > dest_max) return -1;
+      dest[n++] = TXT_CODE_HEX + run - TXT_HEX_MIN;
+      for (int k = 0; k < run; k += 2) {
+        dest[n++] = (hexVal(src[i + k]) << 4) | (k + 1 < run ? hexVal(src[i + k + 1]) : 0);
+      }
+      i += run;
+    } else if (best >= 0 && best_len > 1) {
+      if (n + 1 > dest_max) return -1;
+      dest[n++] = TXT_CODE_DICT + best;
+      i += best_len;
+    } else {
+      uint8_t c = src[i++];
+      if (c == 0 || c >= 0x80) {
+        if (n + 2 > dest_max) return -1;
+        dest[n++] = TXT_CODE_ESC;
+      } else if (n + 1 > dest_max) {
+        return -1;
+      }
+      dest[n++] = c;
+    }
+  }
+  return n;
+}
+
+int TxtCompressor::expand(const uint8_t* src, int src_len, char* dest, int dest_max) {
+  int i = 0, n = 0;
+  while (i < src_len && src[i] != 0) {
+    uint8_t c = src[i++];
+    if (c < TXT_CODE_DICT) {
+      if (n + 1 >= dest_max) return -1;
+      dest[n++] = c;
+    } else if (c < TXT_CODE_HEX) {
+      if (c - TXT_CODE_DICT >= (int)TXT_DICT_SIZE) return -1;   // from a newer dictionary
+      const char* word = txt_dict[c - TXT_CODE_DICT];
+      int len = strlen(word);
+      if (n + len >= dest_max) return -1;
+      memcpy(&dest[n], word, len);
+      n += len;
+    } else if (c < TXT_CODE_ESC) {
+      int run = c - TXT_CODE_HEX + TXT_HEX_MIN;
+      if (i + (run + 1)/2 > src_len || n + run >= dest_max) return -1;
+      for (int k = 0; k < run; k++) {
+        uint8_t nibble = (k & 1) ? (src[i + k/2] & 0x0F) : (src[i + k/2] >> 4);
+        dest[n++] = "0123456789abcdef"[nibble];
+      }
+      i += (run + 1)/2;
+    } else {
+      if (i >= src_len || n + 1 >= dest_max) return -1;
+      dest[n++] = src[i++];
+    }
+  }
+  dest[n] = 0;
+  return n;
+}
@@ -6,6 +6,7 @@
 #define TXT_TYPE_PLAIN          0    // a plain text message
 #define TXT_TYPE_CLI_DATA       1    // a CLI command
 #define TXT_TYPE_SIGNED_PLAIN   2    // plain text, signed by sender
+#define TXT_FLAG_COMPRESSED     0x20 // or'd into the types above: text is TxtCompressor packed (older nodes drop it, unACKed)
 
 class StrHelper {
 public:
@@ -16,3 +17,14 @@ public:
   static bool isBlank(const char* str);
   static uint32_t fromHex(const char* src);
 };
+
+/**
+ * \brief  Static-dictionary packer for short texts. Codes: 0x01-0x7F a literal char, 0x80-0xDF a dictionary
+ *     word, 0xE0-0xFE a run of 4-34 lower-case hex digits packed two per byte, 0xFF an escaped raw byte.
+ *     0x00 ends the text (so cipher padding, or a hidden tail, is never read as text).
+ */
+class TxtCompressor {
+public:
+  static int compress(const char* src, int src_len, uint8_t* dest, int dest_max);   // -1 if it won't fit
+  static int expand(const uint8_t* src, int src_len, char* dest, int dest_max);     // null-terminated, -1 if malformed/won't fit
+};
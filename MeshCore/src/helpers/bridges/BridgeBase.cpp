@@ -31,18 +31,19 @@ bool BridgeBase::validateChecksum(const uint8_t *data, size_t len, uint16_t rece
   return received_checksum == calculated_checksum;
 }
 
-void BridgeBase::handleReceivedPacket(mesh::Packet *packet) {
+bool BridgeBase::handleReceivedPacket(mesh::Packet *packet) {
   // Guard against uninitialized state
   if (_initialized == false) {
     BRIDGE_DEBUG_PRINTLN("RX packet received before initialization\n");
     _mgr->free(packet);
-    return;
+    return false;
   }
 
   if (!_seen_packets.hasSeen(packet)) {
     // bridge_delay provides a buffer to prevent immediate processing conflicts in the mesh network.
     _mgr->queueInbound(packet, millis() + _prefs->bridge_delay);
-  } else {
-    _mgr->free(packet);
+    return true;
   }
+  _mgr->free(packet);
+  return false;
 }
@@ -115,6 +115,7 @@ protected:
    * - Free packet if already seen to prevent duplicates
    *
    * @param packet The received mesh packet
+   * @return true if the packet was new and queued, false if it was dropped
    */
-  void handleReceivedPacket(mesh::Packet *packet);
+  bool handleReceivedPacket(mesh::Packet *packet);
 };
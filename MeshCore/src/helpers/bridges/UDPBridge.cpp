@@ -0,0 +1,210 @@
+#include "UDPBridge.h"
+
+#include <Arduino.h>
+
+#ifdef WITH_UDP_BRIDGE
+
+#ifdef ESP32
+#include <lwip/inet.h>
+#include <lwip/sockets.h>
+#else
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+UDPBridge::UDPBridge(NodePrefs *prefs, mesh::PacketManager *mgr, mesh::RTCClock *rtc)
+    : BridgeBase(prefs, mgr, rtc), _sock(-1), _last_peer_ms(0), _tx_count(0), _rx_count(0),
+      _reject_count(0) {}
+
+void UDPBridge::begin() {
+  BRIDGE_DEBUG_PRINTLN("Initializing...\n");
+  if (_sock >= 0) {
+    end();
+  }
+
+  _sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+  if (_sock < 0) {
+    BRIDGE_DEBUG_PRINTLN("Error creating socket\n");
+    return;
+  }
+
+  // Several nodes (or host processes) share the port
+  int yes = 1;
+  setsockopt(_sock, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+#ifdef SO_REUSEPORT
+  setsockopt(_sock, SOL_SOCKET, SO_REUSEPORT, &yes, sizeof(yes));
+#endif
+
+  struct sockaddr_in local = {};
+  local.sin_family = AF_INET;
+  local.sin_port = htons(UDP_BRIDGE_PORT);
+  local.sin_addr.s_addr = htonl(INADDR_ANY);
+  if (bind(_sock, (struct sockaddr *)&local, sizeof(local)) < 0) {
+    BRIDGE_DEBUG_PRINTLN("Error binding port %d\n", UDP_BRIDGE_PORT);
+    end();
+    return;
+  }
+
+  struct ip_mreq mreq = {};
+  mreq.imr_multiaddr.s_addr = inet_addr(UDP_BRIDGE_GROUP);
+  mreq.imr_interface.s_addr = inet_addr(UDP_BRIDGE_INTERFACE);
+  if (setsockopt(_sock, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) < 0) {
+    BRIDGE_DEBUG_PRINTLN("Error joining group %s\n", UDP_BRIDGE_GROUP);
+    end();
+    return;
+  }
+
+  struct in_addr iface = {};
+  iface.s_addr = inet_addr(UDP_BRIDGE_INTERFACE);
+  setsockopt(_sock, IPPROTO_IP, IP_MULTICAST_IF, &iface, sizeof(iface));
+  uint8_t ttl = UDP_BRIDGE_TTL;
+  setsockopt(_sock, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl));
+  uint8_t loop = 1;
+  setsockopt(_sock, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop));
+
+  int flags = fcntl(_sock, F_GETFL, 0);
+  fcntl(_sock, F_SETFL, flags | O_NONBLOCK);
+
+  BRIDGE_DEBUG_PRINTLN("Joined %s:%d\n", UDP_BRIDGE_GROUP, UDP_BRIDGE_PORT);
+  _initialized = true;
+}
+
+void UDPBridge::end() {
+  BRIDGE_DEBUG_PRINTLN("Stopping...\n");
+  if (_sock >= 0) {
+    struct ip_mreq mreq = {};
+    mreq.imr_multiaddr.s_addr = inet_addr(UDP_BRIDGE_GROUP);
+    mreq.imr_interface.s_addr = inet_addr(UDP_BRIDGE_INTERFACE);
+    setsockopt(_sock, IPPROTO_IP, IP_DROP_MEMBERSHIP, &mreq, sizeof(mreq));
+    close(_sock);
+    _sock = -1;
+  }
+  _last_peer_ms = 0;
+  _initialized = false;
+}
+
+void UDPBridge::loop() {
+  // Guard against uninitialized state
+  if (_initialized == false) {
+    return;
+  }
+
+  uint8_t buffer[MAX_UDP_PACKET_SIZE];
+  while (true) {
+    int len = recvfrom(_sock, buffer, sizeof(buffer), 0, nullptr, nullptr);
+    if (len <= 0) {
+      break;  // EAGAIN: nothing pending
+    }
+    onDataRecv(buffer, (size_t)len);
+  }
+}
+
+bool UDPBridge::hasLivePeers() const {
+  return _initialized && _last_peer_ms != 0 && (millis() - _last_peer_ms) < UDP_BRIDGE_PEER_TIMEOUT_MS;
+}
+
+void UDPBridge::xorCrypt(uint8_t *data, size_t len) {
+  size_t keyLen = strlen(_prefs->bridge_secret);
+  if (keyLen == 0) {
+    return;
+  }
+  for (size_t i = 0; i < len; i++) {
+    data[i] ^= _prefs->bridge_secret[i % keyLen];
+  }
+}
+
+void UDPBridge::onDataRecv(const uint8_t *data, size_t len) {
+  // Ignore packets that are too small to contain header + checksum
+  if (len < (BRIDGE_MAGIC_SIZE + BRIDGE_CHECKSUM_SIZE) || len > MAX_UDP_PACKET_SIZE) {
+    BRIDGE_DEBUG_PRINTLN("RX bad size, len=%d\n", (int)len);
+    _reject_count++;
+    return;
+  }
+
+  uint16_t received_magic = (data[0] << 8) | data[1];
+  if (received_magic != BRIDGE_PACKET_MAGIC) {
+    BRIDGE_DEBUG_PRINTLN("RX invalid magic 0x%04X\n", received_magic);
+    _reject_count++;
+    return;
+  }
+
+  uint8_t decrypted[MAX_UDP_PACKET_SIZE];
+  const size_t encryptedDataLen = len - BRIDGE_MAGIC_SIZE;
+  memcpy(decrypted, data + BRIDGE_MAGIC_SIZE, encryptedDataLen);
+  xorCrypt(decrypted, encryptedDataLen);
+
+  uint16_t received_checksum = (decrypted[0] << 8) | decrypted[1];
+  const size_t payloadLen = encryptedDataLen - BRIDGE_CHECKSUM_SIZE;
+  if (!validateChecksum(decrypted + BRIDGE_CHECKSUM_SIZE, payloadLen, received_checksum)) {
+    // Most likely another mesh on the same group with a different secret
+    BRIDGE_DEBUG_PRINTLN("RX checksum mismatch, rcv=0x%04X\n", received_checksum);
+    _reject_count++;
+    return;
+  }
+
+  mesh::Packet *pkt = _mgr->allocNew();
+  if (!pkt) {
+    BRIDGE_DEBUG_PRINTLN("RX failed to allocate packet\n");
+    return;
+  }
+  if (pkt->readFrom(decrypted + BRIDGE_CHECKSUM_SIZE, payloadLen)) {
+    onPacketReceived(pkt);
+  } else {
+    BRIDGE_DEBUG_PRINTLN("RX failed to parse packet\n");
+    _reject_count++;
+    _mgr->free(pkt);
+  }
+}
+
+void UDPBridge::sendPacket(mesh::Packet *packet) {
+  // Guard against uninitialized state
+  if (_initialized == false) {
+    return;
+  }
+
+  if (!packet) {
+    BRIDGE_DEBUG_PRINTLN("TX invalid packet pointer\n");
+    return;
+  }
+
+  if (!_seen_packets.hasSeen(packet)) {
+    uint8_t buffer[MAX_UDP_PACKET_SIZE];
+    const size_t packetOffset = BRIDGE_MAGIC_SIZE + BRIDGE_CHECKSUM_SIZE;
+    uint16_t meshPacketLen = packet->writeTo(buffer + packetOffset);
+
+    buffer[0] = (BRIDGE_PACKET_MAGIC >> 8) & 0xFF;
+    buffer[1] = BRIDGE_PACKET_MAGIC & 0xFF;
+
+    uint16_t checksum = fletcher16(buffer + packetOffset, meshPacketLen);
+    buffer[2] = (checksum >> 8) & 0xFF;
+    buffer[3] = checksum & 0xFF;
+
+    // Encrypt payload and checksum (not including magic header)
+    xorCrypt(buffer + BRIDGE_MAGIC_SIZE, meshPacketLen + BRIDGE_CHECKSUM_SIZE);
+
+    struct sockaddr_in group = {};
+    group.sin_family = AF_INET;
+    group.sin_port = htons(UDP_BRIDGE_PORT);
+    group.sin_addr.s_addr = inet_addr(UDP_BRIDGE_GROUP);
+    int sent = sendto(_sock, buffer, packetOffset + meshPacketLen, 0, (struct sockaddr *)&group, sizeof(group));
+    if (sent > 0) {
+      _tx_count++;
+      BRIDGE_DEBUG_PRINTLN("TX, len=%d\n", meshPacketLen);
+    } else {
+      BRIDGE_DEBUG_PRINTLN("TX FAILED!\n");
+    }
+  }
+}
+
+void UDPBridge::onPacketReceived(mesh::Packet *packet) {
+  if (handleReceivedPacket(packet)) {
+    // our own datagrams loop back too, but those were marked seen in sendPacket()
+    _last_peer_ms = millis();
+    _rx_count++;
+  }
+}
+
+#endif
@@ -0,0 +1,134 @@
+#pragma once
+
+#include "helpers/bridges/BridgeBase.h"
+
+#ifdef WITH_UDP_BRIDGE
+
+#ifndef UDP_BRIDGE_GROUP
+#define UDP_BRIDGE_GROUP "239.66.77.1"
+#endif
+
+#ifndef UDP_BRIDGE_PORT
+#define UDP_BRIDGE_PORT 45690
+#endif
+
+// Local interface to send/join on; "0.0.0.0" lets the stack pick (STA on ESP32).
+// Use "127.0.0.1" to run several host processes against each other on loopback.
+#ifndef UDP_BRIDGE_INTERFACE
+#define UDP_BRIDGE_INTERFACE "0.0.0.0"
+#endif
+
+#ifndef UDP_BRIDGE_TTL
+#define UDP_BRIDGE_TTL 1
+#endif
+
+// How long after the last new packet from a peer the IP path still counts as live
+#ifndef UDP_BRIDGE_PEER_TIMEOUT_MS
+#define UDP_BRIDGE_PEER_TIMEOUT_MS 60000
+#endif
+
+/**
+ * @brief Bridge implementation tunnelling mesh packets over UDP multicast on a LAN
+ *
+ * Nodes that share an IP network (e.g. the same WiFi) join one multicast group and
+ * exchange every packet they transmit or hear, so the LAN acts as a zero-airtime
+ * backhaul between radios that may be far out of LoRa range of each other.
+ *
+ * Features:
+ * - Connectionless multicast; no peer list or discovery needed
+ * - Network isolation using XOR encryption with shared secret (same scheme as ESPNowBridge)
+ * - Duplicate packet detection using SimpleMeshTables tracking
+ * - Plain BSD sockets, so the same code runs on ESP32 (lwIP) and on Linux hosts
+ *
+ * Packet Structure (one datagram per mesh packet):
+ * [2 bytes] Magic Header - Used to identify bridge packets
+ * [2 bytes] Fletcher-16 checksum of the payload
+ * [n bytes] Mesh packet payload
+ * Checksum and payload are XOR-encrypted with _prefs->bridge_secret; the magic is not.
+ *
+ * Multicast loopback stays enabled so several processes on one host can talk to each
+ * other. A node therefore receives its own datagrams; they are dropped by _seen_packets
+ * since sendPacket() already recorded them.
+ *
+ * Configuration:
+ * - Define WITH_UDP_BRIDGE to enable this bridge
+ * - UDP_BRIDGE_GROUP / UDP_BRIDGE_PORT select the multicast group
+ * - UDP_BRIDGE_INTERFACE selects the local interface address
+ * - _prefs->bridge_secret sets the network encryption key
+ *
+ * The network must be up before begin(); call it again after a reconnect.
+ */
+class UDPBridge : public BridgeBase {
+public:
+  /**
+   * Constructs a UDPBridge instance
+   *
+   * @param prefs Node preferences for configuration settings
+   * @param mgr PacketManager for allocating and queuing packets
+   * @param rtc RTCClock for timestamping debug messages
+   */
+  UDPBridge(NodePrefs *prefs, mesh::PacketManager *mgr, mesh::RTCClock *rtc);
+
+  /**
+   * Opens a non-blocking UDP socket, binds UDP_BRIDGE_PORT and joins the multicast group
+   */
+  void begin() override;
+
+  /**
+   * Leaves the group and closes the socket
+   */
+  void end() override;
+
+  /**
+   * Drains all pending datagrams; each valid one becomes a mesh packet
+   */
+  void loop() override;
+
+  /**
+   * Queues the packet for mesh processing if not seen before
+   *
+   * @param packet The received mesh packet
+   */
+  void onPacketReceived(mesh::Packet *packet) override;
+
+  /**
+   * Encrypts and multicasts the packet if not seen before
+   *
+   * @param packet The mesh packet to transmit
+   */
+  void sendPacket(mesh::Packet *packet) override;
+
+  /**
+   * @brief Whether another node has delivered a new packet over IP recently
+   *
+   * @return true if the IP path is running and a peer was heard within UDP_BRIDGE_PEER_TIMEOUT_MS
+   */
+  bool hasLivePeers() const;
+
+  /** Datagrams sent / new packets received / datagrams rejected (bad magic, checksum or parse) */
+  uint32_t getTxCount() const { return _tx_count; }
+  uint32_t getRxCount() const { return _rx_count; }
+  uint32_t getRejectCount() const { return _reject_count; }
+
+private:
+  /** Magic (2) + checksum (2) + largest mesh packet */
+  static const size_t MAX_UDP_PACKET_SIZE = BRIDGE_MAGIC_SIZE + BRIDGE_CHECKSUM_SIZE + MAX_TRANS_UNIT + 1;
+
+  int _sock;
+  unsigned long _last_peer_ms;
+  uint32_t _tx_count;
+  uint32_t _rx_count;
+  uint32_t _reject_count;
+
+  /**
+   * Same XOR scheme as ESPNowBridge; the operation is its own inverse
+   */
+  void xorCrypt(uint8_t *data, size_t len);
+
+  /**
+   * Validates and decodes one datagram
+   */
+  void onDataRecv(const uint8_t *data, size_t len);
+};
+
+#endif
@@ -12,6 +12,17 @@
 #define SAMPLING_THRESHOLD  14
 
 static volatile uint8_t state = STATE_IDLE;
+static volatile uint32_t irq_micros = 0;
+
+#if defined(LORA_SF) && defined(LORA_BW)
+  #ifdef LORA_CR
+    #define AIRTIME_TABLE_CR  LORA_CR
+  #else
+    #define AIRTIME_TABLE_CR  5
+  #endif
+  // time-on-air for every packet length, at the compiled-in radio params
+  typedef LoRaAirtimeTable<LORA_SF, LoRaAirtime::bwDivisor(LORA_BW), AIRTIME_TABLE_CR, LORA_PREAMBLE_LEN, MAX_TRANS_UNIT> AirtimeTable;
+#endif
 
 // this function is called when a complete packet
 // is transmitted by the module
@@ -22,6 +33,7 @@ static
 void setFlag(void) {
   // we sent a packet, set the flag
   state |= STATE_INT_READY;
+  irq_micros = micros() | 1;   // 0 means 'not known'
 }
 
 void RadioLibWrapper::begin() {
@@ -38,6 +50,27 @@ void RadioLibWrapper::begin() {
   // start average out some samples
   _num_floor_samples = 0;
   _floor_sample_sum = 0;
+
+  checkAirtimeTable();
+}
+
+void RadioLibWrapper::checkAirtimeTable() {
+#ifdef AIRTIME_TABLE_CR
+  // params can be changed at run-time (CLI 'set radio', companion app), so only trust the table while
+  // RadioLib's own figures (truncated to whole millis) still agree with it, at a short and a full-length packet
+  bool ok = true;
+  static const int probe_lens[] = { 10, MAX_TRANS_UNIT };
+  for (int i = 0; i < 2 && ok; i++) {
+    uint32_t lib_millis = _radio->getTimeOnAir(probe_lens[i]) / 1000;
+    uint32_t tbl_millis = AirtimeTable::millis[probe_lens[i]];
+    ok = tbl_millis == lib_millis || tbl_millis == lib_millis + 1;
+  }
+  if (ok != _airtime_table_ok) {
+    MESH_DEBUG_PRINTLN("RadioLibWrapper: airtime table %s", ok ? "in use" : "not matching radio params");
+    _airtime_table_ok = ok;
+  }
+#endif
+  _next_airtime_check = millis() + AIRTIME_TABLE_CHECK_MILLIS;
 }
 
 void RadioLibWrapper::idle() {
@@ -63,6 +96,10 @@ void RadioLibWrapper::resetAGC() {
 }
 
 void RadioLibWrapper::loop() {
+  if ((long)(millis() - _next_airtime_check) >= 0) {
+    checkAirtimeTable();
+  }
+
   if (state == STATE_RX && _num_floor_samples < NUM_NOISE_FLOOR_SAMPLES) {
     if (!isReceivingPacket()) {
       int rssi = getCurrentRSSI();
@@ -125,7 +162,12 @@ int RadioLibWrapper::recvRaw(uint8_t* bytes, int sz) {
 }
 
 uint32_t RadioLibWrapper::getEstAirtimeFor(int len_bytes) {
-  return _radio->getTimeOnAir(len_bytes) / 1000;
+#ifdef AIRTIME_TABLE_CR
+  if (_airtime_table_ok && len_bytes >= 0 && len_bytes <= MAX_TRANS_UNIT) {
+    return AirtimeTable::millis[len_bytes];
+  }
+#endif
+  return (_radio->getTimeOnAir(len_bytes) + 999) / 1000;   // round up, so back-to-back budgets don't under-count
 }
 
 bool RadioLibWrapper::startSendRaw(const uint8_t* bytes, int len) {
@@ -161,6 +203,10 @@ bool RadioLibWrapper::isChannelActive() {
           : getCurrentRSSI() > _noise_floor + _threshold;
 }
 
+uint32_t RadioLibWrapper::getLastIrqMicros() const {
+  return irq_micros;
+}
+
 float RadioLibWrapper::getLastRSSI() const {
   return _radio->getRSSI();
 }
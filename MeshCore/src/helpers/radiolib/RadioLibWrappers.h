@@ -2,6 +2,11 @@
 
 #include <Mesh.h>
 #include <RadioLib.h>
+#include <helpers/LoRaAirtime.h>
+
+#ifndef AIRTIME_TABLE_CHECK_MILLIS
+  #define AIRTIME_TABLE_CHECK_MILLIS  5000   // how often to re-check the radio is still on the compiled-in params
+#endif
 
 class RadioLibWrapper : public mesh::Radio {
 protected:
@@ -11,14 +16,21 @@ protected:
   int16_t _noise_floor, _threshold;
   uint16_t _num_floor_samples;
   int32_t _floor_sample_sum;
+  bool _airtime_table_ok;
+  unsigned long _next_airtime_check;
 
   void idle();
+  void checkAirtimeTable();
   void startRecv();
   float packetScoreInt(float snr, int sf, int packet_len);
   virtual bool isReceivingPacket() =0;
 
 public:
-  RadioLibWrapper(PhysicalLayer& radio, mesh::MainBoard& board) : _radio(&radio), _board(&board) { n_recv = n_sent = 0; }
+  RadioLibWrapper(PhysicalLayer& radio, mesh::MainBoard& board) : _radio(&radio), _board(&board) {
+    n_recv = n_sent = 0;
+    _airtime_table_ok = false;
+    _next_airtime_check = 0;
+  }
 
   void begin() override;
   virtual void powerOff() { _radio->sleep(); }
@@ -47,9 +59,11 @@ public:
   uint32_t getPacketsRecv() const { return n_recv; }
   uint32_t getPacketsSent() const { return n_sent; }
   void resetStats() { n_recv = n_sent = 0; }
+  bool isAirtimeTableInUse() const { return _airtime_table_ok; }
 
   virtual float getLastRSSI() const override;
   virtual float getLastSNR() const override;
+  uint32_t getLastIrqMicros() const override;
 
   float packetScore(float snr, int packet_len) override { return packetScoreInt(snr, 10, packet_len); }  // assume sf=10
 };
@@ -2,6 +2,8 @@ import re
 
 Import("env")
 
+# Units are numbered at runtime (LHCFG); an env named Lighthouse_sx126x_N still bakes N in
+# as the default for boards that were never provisioned.
 env_name = env.get("PIOENV", "")
 match = re.search(r"Lighthouse_sx126[28]_(\d+)", env_name)
 if match:
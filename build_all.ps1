@@ -1,8 +1,17 @@
+# Builds the single lighthouse image once, then flashes it to every port given, e.g.
+#   .\build_all.ps1 COM3 COM4 COM5
+# Units are numbered afterwards with "LHCFG number=N" or /provision_lighthouse.
 $projectRoot = Split-Path -Parent $MyInvocation.MyCommand.Path
 $meshCore = Join-Path $projectRoot "MeshCore"
+$envName = "Lighthouse_sx1262"
 
-for ($n = 1; $n -le 30; $n++) {
-  $envName = "Lighthouse_sx1262_$n"
-  $cmd = "Set-Location `"$meshCore`"; pio run -e $envName"
+Set-Location $meshCore
+pio run -e $envName
+if ($LASTEXITCODE -ne 0) {
+  exit $LASTEXITCODE
+}
+
+foreach ($port in $args) {
+  $cmd = "Set-Location `"$meshCore`"; pio run -e $envName -t nobuild -t upload --upload-port $port"
   Start-Process -FilePath "powershell" -ArgumentList "-NoExit", "-Command", $cmd
 }